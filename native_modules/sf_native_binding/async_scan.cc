@@ -0,0 +1,380 @@
+#include "async_scan.h"
+#include "memory.h"
+#include "session.h"
+#include <algorithm>
+
+Napi::FunctionReference CancellationToken::constructor;
+
+Napi::Object CancellationToken::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "CancellationToken", {
+    InstanceMethod("cancel", &CancellationToken::Cancel),
+    InstanceAccessor("cancelled", &CancellationToken::IsCancelled, nullptr),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("CancellationToken", func);
+  return exports;
+}
+
+std::shared_ptr<std::atomic<bool>> CancellationToken::FlagFrom(const Napi::Value& value) {
+  if (!value.IsObject() || !value.As<Napi::Object>().InstanceOf(constructor.Value())) {
+    return nullptr;
+  }
+  return Unwrap(value.As<Napi::Object>())->flag_;
+}
+
+CancellationToken::CancellationToken(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<CancellationToken>(info),
+    flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+Napi::Value CancellationToken::Cancel(const Napi::CallbackInfo& info) {
+  flag_->store(true);
+  return info.Env().Undefined();
+}
+
+Napi::Value CancellationToken::IsCancelled(const Napi::CallbackInfo& info) {
+  return Napi::Boolean::New(info.Env(), flag_->load());
+}
+
+Napi::Object ScanProgressToObject(Napi::Env env, const ScanProgress& progress) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("regionsDone", Napi::Number::New(env, progress.regionsDone));
+  result.Set("regionsTotal", Napi::Number::New(env, progress.regionsTotal));
+  result.Set("bytesScanned", Napi::Number::New(env, progress.bytesScanned));
+  result.Set("bytesTotal", Napi::Number::New(env, progress.bytesTotal));
+  result.Set("matches", Napi::Number::New(env, progress.matches));
+  result.Set("elapsedMs", Napi::Number::New(env, progress.elapsedSeconds * 1000.0));
+  double bytesPerSecond = progress.elapsedSeconds > 0 ? progress.bytesScanned / progress.elapsedSeconds : 0;
+  result.Set("bytesPerSecond", Napi::Number::New(env, bytesPerSecond));
+  return result;
+}
+
+ProgressPromiseWorker::ProgressPromiseWorker(Napi::Env env, Napi::Object session,
+                                             std::shared_ptr<std::atomic<bool>> cancelled, Napi::Value onProgress)
+  : Napi::AsyncProgressWorker<ScanProgress>(env),
+    deferred_(Napi::Promise::Deferred::New(env)),
+    session_(ProcessSession::Unwrap(session)),
+    cancelled_(std::move(cancelled)) {
+  // Keep the session object alive until the operation settles
+  sessionRef_ = Napi::Persistent(session);
+  if (onProgress.IsFunction()) {
+    onProgress_ = Napi::Persistent(onProgress.As<Napi::Function>());
+  }
+}
+
+ScanProgressCallback ProgressPromiseWorker::ProgressCallback(const ExecutionProgress& progress) const {
+  if (onProgress_.IsEmpty()) {
+    return ScanProgressCallback();
+  }
+  return [&progress](const ScanProgress& snapshot) {
+    progress.Send(&snapshot, 1);
+  };
+}
+
+void ProgressPromiseWorker::OnProgress(const ScanProgress* data, size_t count) {
+  if (onProgress_.IsEmpty() || count == 0) {
+    return;
+  }
+  Napi::HandleScope scope(Env());
+  onProgress_.Call({ ScanProgressToObject(Env(), data[count - 1]) });
+}
+
+void ProgressPromiseWorker::OnError(const Napi::Error& error) {
+  Napi::Object value = error.Value();
+  value.Set("cancelled", Napi::Boolean::New(Env(), cancelled_->load()));
+  deferred_.Reject(value);
+}
+
+ScanWorker::ScanWorker(Napi::Env env, Napi::Object session, ScanFunction scan, const RegionFilter& filter,
+                       std::shared_ptr<std::atomic<bool>> cancelled, Napi::Value onProgress, bool store)
+  : ProgressPromiseWorker(env, session, std::move(cancelled), onProgress),
+    scan_(std::move(scan)),
+    filter_(filter),
+    store_(store) {}
+
+void ScanWorker::Execute(const ExecutionProgress& progress) {
+  std::shared_ptr<FaultRecorder> process = session_->ScanHandle();
+  if (!process) {
+    SetError("Session is detached");
+    return;
+  }
+
+  std::shared_ptr<const std::vector<MemoryRegion>> regions = session_->ScanRegions(filter_);
+  if (!regions) {
+    SetError("Failed to enumerate memory regions: " + GetLastErrorAsString());
+    return;
+  }
+
+  ScanProgressCallback onProgress = ProgressCallback(progress);
+
+  bool completed = scan_(*process, *regions, matches_, cancelled_.get(), onProgress);
+  session_->ScanFinished(*process);
+  if (!completed) {
+    SetError("Scan cancelled");
+  }
+}
+
+void ScanWorker::OnOK() {
+  Napi::Env env = Env();
+  if (!store_) {
+    deferred_.Resolve(AddressesToJs(env, matches_));
+    return;
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("count", Napi::Number::New(env, matches_.size()));
+  result.Set("handle", Napi::Number::New(env, session_->StoreResults(MakeAddressResults(std::move(matches_)))));
+  deferred_.Resolve(result);
+}
+
+CandidateScanWorker::CandidateScanWorker(Napi::Env env, Napi::Object session, const ValueLayout& layout,
+                                         const ScanCriteria& criteria, bool refine,
+                                         const RdramLocation& space, const RegionFilter& filter,
+                                         std::shared_ptr<std::atomic<bool>> cancelled,
+                                         Napi::Value onProgress)
+  : ProgressPromiseWorker(env, session, std::move(cancelled), onProgress),
+    layout_(layout),
+    criteria_(criteria),
+    refine_(refine),
+    space_(space),
+    filter_(filter) {}
+
+void CandidateScanWorker::Execute(const ExecutionProgress& progress) {
+  // Passes of one session run one at a time; a superseded pass has
+  // already been cancelled and releases the lock quickly
+  std::lock_guard<std::mutex> lock(session_->ScanMutex());
+  if (cancelled_->load()) {
+    SetError("Scan cancelled");
+    return;
+  }
+
+  std::shared_ptr<FaultRecorder> process = session_->ScanHandle();
+  if (!process) {
+    SetError("Session is detached");
+    return;
+  }
+
+  ScanProgressCallback onProgress = ProgressCallback(progress);
+
+  std::string error;
+  std::shared_ptr<CandidateSet> candidates;
+  bool completed;
+  if (refine_) {
+    candidates = session_->Candidates();
+    if (!candidates) {
+      SetError("Run a first scan before refining");
+      return;
+    }
+    completed = candidates->NextScan(*process, criteria_, error, cancelled_.get(), onProgress);
+  } else {
+    std::shared_ptr<const std::vector<MemoryRegion>> regions;
+    if (space_.size > 0) {
+      regions = std::make_shared<std::vector<MemoryRegion>>(1, RdramRegion(space_));
+    } else {
+      regions = session_->ScanRegions(filter_);
+    }
+    if (!regions) {
+      SetError("Failed to enumerate memory regions: " + GetLastErrorAsString());
+      return;
+    }
+    candidates = std::make_shared<CandidateSet>(layout_);
+    completed = candidates->FirstScan(*process, *regions, criteria_, error, cancelled_.get(), onProgress);
+    if (completed) {
+      session_->SetCandidates(candidates, space_);
+    }
+  }
+  session_->ScanFinished(*process);
+
+  if (!completed) {
+    SetError(error.empty() ? "Scan cancelled" : error);
+    return;
+  }
+  count_ = candidates->Count();
+  memoryBytes_ = candidates->MemoryUsage();
+}
+
+void CandidateScanWorker::OnOK() {
+  Napi::Env env = Env();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("count", Napi::Number::New(env, count_));
+  result.Set("memoryBytes", Napi::Number::New(env, memoryBytes_));
+  deferred_.Resolve(result);
+}
+
+PointerScanWorker::PointerScanWorker(Napi::Env env, Napi::Object session, uint64_t target,
+                                     const PointerScanOptions& options, const RegionFilter& filter,
+                                     std::shared_ptr<std::atomic<bool>> cancelled, Napi::Value onProgress)
+  : ProgressPromiseWorker(env, session, std::move(cancelled), onProgress),
+    target_(target),
+    options_(options),
+    filter_(filter) {}
+
+void PointerScanWorker::Execute(const ExecutionProgress& progress) {
+  std::shared_ptr<FaultRecorder> process = session_->ScanHandle();
+  if (!process) {
+    SetError("Session is detached");
+    return;
+  }
+
+  std::shared_ptr<const std::vector<MemoryRegion>> regions = session_->ScanRegions(filter_);
+  if (!regions) {
+    SetError("Failed to enumerate memory regions: " + GetLastErrorAsString());
+    return;
+  }
+
+  ScanProgressCallback onProgress = ProgressCallback(progress);
+
+  std::string error;
+  bool completed = FindPointerChains(*process, *regions, target_, options_, chains_, truncated_, pointers_, error,
+                                     cancelled_.get(), onProgress);
+  session_->ScanFinished(*process);
+  if (!completed) {
+    SetError(error.empty() ? "Scan cancelled" : error);
+  }
+}
+
+void PointerScanWorker::OnOK() {
+  Napi::Env env = Env();
+  Napi::Array chains = Napi::Array::New(env, chains_.size());
+  for (size_t i = 0; i < chains_.size(); i++) {
+    chains[i] = PointerChainToJs(env, chains_[i]);
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("chains", chains);
+  result.Set("pointers", Napi::Number::New(env, static_cast<double>(pointers_)));
+  result.Set("truncated", Napi::Boolean::New(env, truncated_));
+  deferred_.Resolve(result);
+}
+
+SnapshotWorker::SnapshotWorker(Napi::Env env, Napi::Object session, const std::string& path,
+                               const SnapshotOptions& options, const RegionFilter& filter, const RdramLocation& rdram,
+                               std::shared_ptr<std::atomic<bool>> cancelled, Napi::Value onProgress)
+  : ProgressPromiseWorker(env, session, std::move(cancelled), onProgress),
+    path_(path),
+    options_(options),
+    filter_(filter),
+    rdram_(rdram) {}
+
+void SnapshotWorker::Execute(const ExecutionProgress& progress) {
+  std::shared_ptr<FaultRecorder> process = session_->ScanHandle();
+  if (!process) {
+    SetError("Session is detached");
+    return;
+  }
+
+  std::shared_ptr<const std::vector<MemoryRegion>> regions;
+  if (rdram_.size > 0) {
+    regions = std::make_shared<const std::vector<MemoryRegion>>(1, RdramRegion(rdram_));
+    options_.rdramBase = rdram_.base;
+  } else {
+    regions = session_->ScanRegions(filter_);
+  }
+  if (!regions) {
+    SetError("Failed to enumerate memory regions: " + GetLastErrorAsString());
+    return;
+  }
+
+  ScanProgressCallback onProgress = ProgressCallback(progress);
+
+  std::string error;
+  bool completed = WriteSnapshot(*process, *regions, path_, options_, stats_, error, cancelled_.get(), onProgress);
+  session_->ScanFinished(*process);
+  if (!completed) {
+    SetError(error.empty() ? "Scan cancelled" : error);
+  }
+}
+
+void SnapshotWorker::OnOK() {
+  Napi::Env env = Env();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("path", Napi::String::New(env, path_));
+  result.Set("regions", Napi::Number::New(env, static_cast<double>(stats_.regions)));
+  result.Set("pages", Napi::Number::New(env, static_cast<double>(stats_.pages)));
+  result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats_.bytes)));
+  result.Set("zeroPages", Napi::Number::New(env, static_cast<double>(stats_.zeroPages)));
+  result.Set("duplicatePages", Napi::Number::New(env, static_cast<double>(stats_.duplicatePages)));
+  result.Set("compressedPages", Napi::Number::New(env, static_cast<double>(stats_.compressedPages)));
+  result.Set("missingPages", Napi::Number::New(env, static_cast<double>(stats_.missingPages)));
+  result.Set("fileSize", Napi::Number::New(env, static_cast<double>(stats_.fileSize)));
+  deferred_.Resolve(result);
+}
+
+SnapshotDiffWorker::SnapshotDiffWorker(Napi::Env env, Napi::Object session, const std::string& path,
+                                       const SnapshotDiffOptions& options,
+                                       std::shared_ptr<std::atomic<bool>> cancelled, Napi::Value onProgress)
+  : ProgressPromiseWorker(env, session, std::move(cancelled), onProgress),
+    path_(path),
+    options_(options) {}
+
+void SnapshotDiffWorker::Execute(const ExecutionProgress& progress) {
+  std::shared_ptr<ProcessHandle> process = session_->Handle();
+  if (!process) {
+    SetError("Session is detached");
+    return;
+  }
+
+  std::string error;
+  std::unique_ptr<SnapshotFile> before = SnapshotFile::Open(path_, error);
+  if (!before) {
+    SetError(error);
+    return;
+  }
+  // RDRAM words are byte-swapped, so only whole words map onto N64
+  // addresses
+  rdramBase_ = before->RdramBase();
+  if (rdramBase_ != 0) {
+    options_.granularity = std::max<uint32_t>(options_.granularity, 4);
+  }
+
+  ScanProgressCallback onProgress = ProgressCallback(progress);
+
+  std::shared_ptr<SnapshotFile> after = session_->Snapshot();
+  bool finished = after
+    ? DiffSnapshots(*before, *after, options_, changes_, stats_, cancelled_.get())
+    : DiffSnapshotWithProcess(*before, *process, options_, changes_, stats_, cancelled_.get(), onProgress);
+  if (!finished) {
+    SetError("Scan cancelled");
+  }
+}
+
+void SnapshotDiffWorker::OnOK() {
+  Napi::Env env = Env();
+  Napi::Float64Array addresses = Napi::Float64Array::New(env, changes_.size());
+  Napi::Float64Array sizes = Napi::Float64Array::New(env, changes_.size());
+  for (size_t i = 0; i < changes_.size(); i++) {
+    uint64_t address = changes_[i].address;
+    if (rdramBase_ != 0) {
+      address = kN64Kseg0 | (address - rdramBase_);
+    }
+    addresses[i] = static_cast<double>(address);
+    sizes[i] = static_cast<double>(changes_[i].size);
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("addresses", addresses);
+  result.Set("sizes", sizes);
+  result.Set("pagesCompared", Napi::Number::New(env, static_cast<double>(stats_.pagesCompared)));
+  result.Set("pagesSkipped", Napi::Number::New(env, static_cast<double>(stats_.pagesSkipped)));
+  result.Set("pagesChanged", Napi::Number::New(env, static_cast<double>(stats_.pagesChanged)));
+  result.Set("bytesChanged", Napi::Number::New(env, static_cast<double>(stats_.bytesChanged)));
+  result.Set("pagesUnreadable", Napi::Number::New(env, static_cast<double>(stats_.pagesUnreadable)));
+  result.Set("truncated", Napi::Boolean::New(env, stats_.truncated));
+  result.Set("n64", Napi::Boolean::New(env, rdramBase_ != 0));
+  deferred_.Resolve(result);
+}
+
+Napi::Object PointerChainToJs(Napi::Env env, const PointerChain& chain) {
+  Napi::Array offsets = Napi::Array::New(env, chain.offsets.size());
+  for (size_t i = 0; i < chain.offsets.size(); i++) {
+    offsets[i] = Napi::Number::New(env, static_cast<double>(chain.offsets[i]));
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("module", Napi::String::New(env, chain.module));
+  result.Set("baseOffset", Napi::Number::New(env, static_cast<double>(chain.baseOffset)));
+  result.Set("offsets", offsets);
+  return result;
+}
+
+Napi::Object RegisterAsyncScanFunctions(Napi::Env env, Napi::Object exports) {
+  return CancellationToken::Init(env, exports);
+}
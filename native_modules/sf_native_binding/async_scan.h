@@ -0,0 +1,192 @@
+#pragma once
+#include <napi.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "candidate_set.h"
+#include "pointer_scan.h"
+#include "rdram.h"
+#include "region_map.h"
+#include "scanner.h"
+#include "snapshot.h"
+
+// Cancels an in-flight asynchronous operation. Create one with
+// new CancellationToken(), pass it as `token` and call cancel().
+class CancellationToken : public Napi::ObjectWrap<CancellationToken> {
+ public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+  // Returns the token's flag if `value` is a CancellationToken, else null
+  static std::shared_ptr<std::atomic<bool>> FlagFrom(const Napi::Value& value);
+
+  explicit CancellationToken(const Napi::CallbackInfo& info);
+
+ private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value Cancel(const Napi::CallbackInfo& info);
+  Napi::Value IsCancelled(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+class ProcessSession;
+
+// Common plumbing of the session's asynchronous operations: keeps the
+// session object alive until the Promise settles, forwards progress to an
+// optional onProgress callback and rejects with an error whose `cancelled`
+// property is true when the operation was cancelled. Subclasses implement
+// Execute and OnOK.
+class ProgressPromiseWorker : public Napi::AsyncProgressWorker<ScanProgress> {
+ public:
+  Napi::Promise Promise() const { return deferred_.Promise(); }
+
+ protected:
+  ProgressPromiseWorker(Napi::Env env, Napi::Object session, std::shared_ptr<std::atomic<bool>> cancelled,
+                        Napi::Value onProgress);
+
+  // Callback for the engines that reports through `progress`; empty when
+  // no onProgress was given
+  ScanProgressCallback ProgressCallback(const ExecutionProgress& progress) const;
+
+  void OnProgress(const ScanProgress* data, size_t count) override;
+  void OnError(const Napi::Error& error) override;
+
+  Napi::Promise::Deferred deferred_;
+  ProcessSession* session_;
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+
+ private:
+  Napi::ObjectReference sessionRef_;
+  Napi::FunctionReference onProgress_;
+};
+
+// A one-shot scan over the session's regions, e.g. ScanForUint32 or
+// ScanForPattern bound to its arguments
+typedef std::function<bool(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                           std::vector<uint64_t>& matches, const std::atomic<bool>* cancelled,
+                           const ScanProgressCallback& onProgress)> ScanFunction;
+
+// Runs a one-shot scan over the session regions passing `filter` on a
+// worker thread. Settles a Promise with the match addresses, or with
+// { handle, count } when `store` is set and the matches stay in the
+// session's result store; rejects with an error whose `cancelled` property
+// is true when the scan was cancelled.
+class ScanWorker : public ProgressPromiseWorker {
+ public:
+  ScanWorker(Napi::Env env, Napi::Object session, ScanFunction scan, const RegionFilter& filter,
+             std::shared_ptr<std::atomic<bool>> cancelled, Napi::Value onProgress, bool store);
+
+ protected:
+  void Execute(const ExecutionProgress& progress) override;
+  void OnOK() override;
+
+ private:
+  ScanFunction scan_;
+  RegionFilter filter_;
+  bool store_;
+  std::vector<uint64_t> matches_;
+};
+
+// Runs one pass of a session's narrowing scan on a worker thread. A first
+// pass builds a new candidate set with `layout` and installs it on success;
+// a refinement narrows the session's current set (`layout` is ignored). A
+// first pass visits the regions passing `filter`, or only the RDRAM block
+// when `space` is located. Resolves with { count, memoryBytes }.
+class CandidateScanWorker : public ProgressPromiseWorker {
+ public:
+  CandidateScanWorker(Napi::Env env, Napi::Object session, const ValueLayout& layout,
+                      const ScanCriteria& criteria, bool refine, const RdramLocation& space,
+                      const RegionFilter& filter, std::shared_ptr<std::atomic<bool>> cancelled,
+                      Napi::Value onProgress);
+
+ protected:
+  void Execute(const ExecutionProgress& progress) override;
+  void OnOK() override;
+
+ private:
+  ValueLayout layout_;
+  ScanCriteria criteria_;
+  bool refine_;
+  RdramLocation space_;
+  RegionFilter filter_;
+  uint64_t count_ = 0;
+  size_t memoryBytes_ = 0;
+};
+
+// Runs a pointer scan for `target` over the session regions passing
+// `filter` on a worker thread. Progress covers building the pointer index.
+// Resolves with { chains, pointers, truncated }.
+class PointerScanWorker : public ProgressPromiseWorker {
+ public:
+  PointerScanWorker(Napi::Env env, Napi::Object session, uint64_t target, const PointerScanOptions& options,
+                    const RegionFilter& filter, std::shared_ptr<std::atomic<bool>> cancelled,
+                    Napi::Value onProgress);
+
+ protected:
+  void Execute(const ExecutionProgress& progress) override;
+  void OnOK() override;
+
+ private:
+  uint64_t target_;
+  PointerScanOptions options_;
+  RegionFilter filter_;
+  std::vector<PointerChain> chains_;
+  uint64_t pointers_ = 0;
+  bool truncated_ = false;
+};
+
+// Writes a snapshot of the session regions passing `filter`, or of RDRAM
+// alone when `rdram` is located, on a worker thread. Resolves with the
+// SnapshotStats as an object.
+class SnapshotWorker : public ProgressPromiseWorker {
+ public:
+  SnapshotWorker(Napi::Env env, Napi::Object session, const std::string& path, const SnapshotOptions& options,
+                 const RegionFilter& filter, const RdramLocation& rdram,
+                 std::shared_ptr<std::atomic<bool>> cancelled, Napi::Value onProgress);
+
+ protected:
+  void Execute(const ExecutionProgress& progress) override;
+  void OnOK() override;
+
+ private:
+  std::string path_;
+  SnapshotOptions options_;
+  RegionFilter filter_;
+  RdramLocation rdram_;
+  SnapshotStats stats_;
+};
+
+// Compares the snapshot at `path` with the session's memory on a worker
+// thread: page hashes against the session's own snapshot when it was
+// opened from one, else a stream of the live target. Snapshots of RDRAM
+// report N64 addresses in 4-byte units. Resolves with { addresses, sizes,
+// pagesCompared, pagesSkipped, pagesChanged, bytesChanged,
+// pagesUnreadable, truncated, n64 }.
+class SnapshotDiffWorker : public ProgressPromiseWorker {
+ public:
+  SnapshotDiffWorker(Napi::Env env, Napi::Object session, const std::string& path,
+                     const SnapshotDiffOptions& options, std::shared_ptr<std::atomic<bool>> cancelled,
+                     Napi::Value onProgress);
+
+ protected:
+  void Execute(const ExecutionProgress& progress) override;
+  void OnOK() override;
+
+ private:
+  std::string path_;
+  SnapshotDiffOptions options_;
+  std::vector<SnapshotChange> changes_;
+  SnapshotDiffStats stats_;
+  uint64_t rdramBase_ = 0;
+};
+
+// { module, baseOffset, offsets } for a chain
+Napi::Object PointerChainToJs(Napi::Env env, const PointerChain& chain);
+
+// Converts a progress snapshot to the object passed to onProgress
+Napi::Object ScanProgressToObject(Napi::Env env, const ScanProgress& progress);
+
+// Function to register CancellationToken
+Napi::Object RegisterAsyncScanFunctions(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,141 @@
+#include "batch_read.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Requests closer than this are read together; the bytes in between cost
+// less than another syscall (a ReadProcessMemory per range on Windows)
+const uint64_t kMergeGap = 256;
+// Upper bound of one merged read
+const uint64_t kMaxMergedSize = 1 << 20;
+
+// Several requests read as one range into scratch memory
+struct MergedSpan {
+  uint64_t start = 0;
+  uint64_t end = 0;
+  size_t first = 0;  // into the sorted order
+  size_t last = 0;
+  size_t scratch = 0;
+};
+
+}  // namespace
+
+size_t LayoutBatch(const ReadRequest* requests, size_t count, std::vector<size_t>& offsets) {
+  offsets.resize(count);
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    offsets[i] = total;
+    total += requests[i].size;
+  }
+  return total;
+}
+
+size_t ReadBatch(ProcessHandle& process, const ReadRequest* requests, size_t count,
+                 const std::vector<size_t>& offsets, uint8_t* out, ReadStatus* status) {
+  std::vector<size_t> order;
+  order.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    status[i] = ReadStatus();
+    if (requests[i].size > 0) {
+      order.push_back(i);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [requests](size_t a, size_t b) {
+    return requests[a].address < requests[b].address;
+  });
+
+  // Group the sorted requests into spans
+  std::vector<MergedSpan> spans;
+  for (size_t k = 0; k < order.size(); k++) {
+    const ReadRequest& request = requests[order[k]];
+    uint64_t end = request.address + request.size;
+    if (!spans.empty()) {
+      MergedSpan& span = spans.back();
+      uint64_t merged = std::max(span.end, end);
+      if (request.address <= span.end + kMergeGap && merged - span.start <= kMaxMergedSize) {
+        span.end = merged;
+        span.last = k;
+        continue;
+      }
+    }
+    MergedSpan span;
+    span.start = request.address;
+    span.end = end;
+    span.first = k;
+    span.last = k;
+    spans.push_back(span);
+  }
+
+  // A span of one request reads straight into the output; merged spans go
+  // through scratch memory and are copied out per request
+  size_t scratchSize = 0;
+  for (MergedSpan& span : spans) {
+    if (span.first != span.last) {
+      span.scratch = scratchSize;
+      scratchSize += span.end - span.start;
+    }
+  }
+  std::vector<uint8_t> scratch(scratchSize);
+
+  std::vector<MemoryRange> ranges(spans.size());
+  for (size_t s = 0; s < spans.size(); s++) {
+    const MergedSpan& span = spans[s];
+    ranges[s].address = span.start;
+    ranges[s].size = span.end - span.start;
+    ranges[s].buffer = span.first == span.last ? out + offsets[order[span.first]]
+                                               : scratch.data() + span.scratch;
+  }
+  process.ReadMany(ranges.data(), ranges.size());
+
+  // Requests of merged spans that ran past the readable part
+  std::vector<size_t> retry;
+  for (size_t s = 0; s < spans.size(); s++) {
+    const MergedSpan& span = spans[s];
+    const MemoryRange& range = ranges[s];
+    if (span.first == span.last) {
+      size_t index = order[span.first];
+      status[index].transferred = static_cast<uint32_t>(range.transferred);
+      status[index].error = range.error;
+      continue;
+    }
+    uint64_t readEnd = span.start + range.transferred;
+    for (size_t k = span.first; k <= span.last; k++) {
+      size_t index = order[k];
+      const ReadRequest& request = requests[index];
+      if (request.address + request.size <= readEnd) {
+        memcpy(out + offsets[index], scratch.data() + span.scratch + (request.address - span.start), request.size);
+        status[index].transferred = request.size;
+      } else {
+        retry.push_back(index);
+      }
+    }
+  }
+
+  if (!retry.empty()) {
+    std::vector<MemoryRange> retries(retry.size());
+    for (size_t r = 0; r < retry.size(); r++) {
+      const ReadRequest& request = requests[retry[r]];
+      retries[r].address = request.address;
+      retries[r].size = request.size;
+      retries[r].buffer = out + offsets[retry[r]];
+    }
+    process.ReadMany(retries.data(), retries.size());
+    for (size_t r = 0; r < retry.size(); r++) {
+      status[retry[r]].transferred = static_cast<uint32_t>(retries[r].transferred);
+      status[retry[r]].error = retries[r].error;
+    }
+  }
+
+  size_t complete = 0;
+  for (size_t i = 0; i < count; i++) {
+    const ReadRequest& request = requests[i];
+    if (status[i].transferred == request.size) {
+      status[i].error = 0;
+      complete++;
+    } else {
+      memset(out + offsets[i] + status[i].transferred, 0, request.size - status[i].transferred);
+    }
+  }
+  return complete;
+}
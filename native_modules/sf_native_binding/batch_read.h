@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "platform.h"
+
+// One range of a batched read
+struct ReadRequest {
+  uint64_t address = 0;
+  uint32_t size = 0;
+};
+
+// Outcome of one request. `error` is the platform error code of the first
+// byte that could not be read, or 0 when `transferred` equals the size.
+struct ReadStatus {
+  uint32_t transferred = 0;
+  int error = 0;
+};
+
+// Bytes the output of ReadBatch needs: the request sizes laid end to end
+// in request order. `offsets` receives where each request starts.
+size_t LayoutBatch(const ReadRequest* requests, size_t count, std::vector<size_t>& offsets);
+
+// Reads every request into `out` at its offset from LayoutBatch. Requests
+// are sorted, overlapping and nearby ones are merged into a single read,
+// and the whole batch goes to the backend as one ReadMany. A merged read
+// that comes back short is retried per request, so one unreadable page
+// only fails the requests that touch it. Bytes that could not be read are
+// zeroed. Returns the number of requests read completely.
+size_t ReadBatch(ProcessHandle& process, const ReadRequest* requests, size_t count,
+                 const std::vector<size_t>& offsets, uint8_t* out, ReadStatus* status);
@@ -0,0 +1,490 @@
+// sf_bench: measures the memory engine against a synthetic sf_victim
+// process, without Node or Electron. Starts the victim, runs each
+// benchmark `--repeat` times and prints one JSON document (or writes it to
+// `--out`) so results can be compared across releases. A short summary
+// goes to stderr.
+//
+//   sf_bench [--victim path] [--repeat 5] [--reads 10000] [--batch 4096]
+//            [--heap-mb 256] [--blocks 64] [--plant-count 4096] [--rdram-mb 8]
+//            [--out results.json]
+//
+// Scan and read results carry the platform read calls they issued, taken
+// from the metrics counters.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+#include "batch_read.h"
+#include "candidate_set.h"
+#include "metrics.h"
+#include "platform.h"
+#include "rdram.h"
+#include "scanner.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+  std::string victim;
+  std::string out;
+  int repeat = 5;
+  size_t reads = 10000;
+  size_t batch = 4096;
+  // Passed through to the victim
+  std::vector<std::string> victimArgs;
+};
+
+// What the victim reported on startup
+struct VictimLayout {
+  uint32_t pid = 0;
+  uint64_t quit = 0;
+  uint32_t value = 0;
+  uint64_t planted = 0;
+  uint64_t rdramBase = 0;
+  uint64_t rdramSize = 0;
+  uint64_t markers = 0;
+  std::vector<std::pair<uint64_t, uint64_t>> blocks;
+};
+
+// One benchmark's result: every run's duration plus scalar fields
+struct Result {
+  std::string name;
+  std::vector<double> seconds;
+  std::vector<std::pair<std::string, double>> fields;
+
+  void Set(const std::string& key, double value) {
+    for (auto& field : fields) {
+      if (field.first == key) {
+        field.second = value;
+        return;
+      }
+    }
+    fields.push_back(std::make_pair(key, value));
+  }
+
+  double Median() const {
+    std::vector<double> sorted = seconds;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted.empty() ? 0 : sorted[sorted.size() / 2];
+  }
+};
+
+double Seconds(Clock::duration elapsed) {
+  return std::chrono::duration<double>(elapsed).count();
+}
+
+uint64_t ReadCalls() {
+  MetricsSnapshot snapshot;
+  SnapshotMetrics(snapshot);
+  return snapshot.values[static_cast<size_t>(Metric::ReadCalls)];
+}
+
+uint64_t NextRandom(uint64_t& state) {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545F4914F6CDD1DULL;
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+  std::string self = argv[0];
+  size_t slash = self.find_last_of("/\\");
+  std::string dir = slash == std::string::npos ? "." : self.substr(0, slash);
+#ifdef _WIN32
+  options.victim = dir + "\\sf_victim.exe";
+#else
+  options.victim = dir + "/sf_victim";
+#endif
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      fprintf(stderr, "sf_bench: %s needs a value\n", arg.c_str());
+      return false;
+    }
+    std::string value = argv[++i];
+    if (arg == "--victim") options.victim = value;
+    else if (arg == "--out") options.out = value;
+    else if (arg == "--repeat") options.repeat = std::max(1, atoi(value.c_str()));
+    else if (arg == "--reads") options.reads = std::max<size_t>(1, strtoull(value.c_str(), nullptr, 0));
+    else if (arg == "--batch") options.batch = std::max<size_t>(1, strtoull(value.c_str(), nullptr, 0));
+    else if (arg == "--heap-mb" || arg == "--blocks" || arg == "--plant-count" || arg == "--rdram-mb") {
+      options.victimArgs.push_back(arg);
+      options.victimArgs.push_back(value);
+    } else {
+      fprintf(stderr, "sf_bench: unknown option %s\n", arg.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parses "sf_victim pid=.. quit=.. value=.. planted=.. [rdram=base:size
+// markers=..] blocks=base:size,..."
+bool ParseVictimLine(const std::string& line, VictimLayout& layout) {
+  if (line.compare(0, 10, "sf_victim ") != 0) {
+    return false;
+  }
+  size_t start = 10;
+  while (start < line.size()) {
+    size_t end = line.find_first_of(" \r\n", start);
+    if (end == std::string::npos) {
+      end = line.size();
+    }
+    std::string token = line.substr(start, end - start);
+    start = end + 1;
+    size_t equals = token.find('=');
+    if (equals == std::string::npos) {
+      continue;
+    }
+    std::string key = token.substr(0, equals);
+    const char* value = token.c_str() + equals + 1;
+    char* rest = nullptr;
+    if (key == "pid") layout.pid = static_cast<uint32_t>(strtoul(value, nullptr, 0));
+    else if (key == "quit") layout.quit = strtoull(value, nullptr, 0);
+    else if (key == "value") layout.value = static_cast<uint32_t>(strtoul(value, nullptr, 0));
+    else if (key == "planted") layout.planted = strtoull(value, nullptr, 0);
+    else if (key == "markers") layout.markers = strtoull(value, nullptr, 0);
+    else if (key == "rdram") {
+      layout.rdramBase = strtoull(value, &rest, 0);
+      layout.rdramSize = *rest == ':' ? strtoull(rest + 1, nullptr, 0) : 0;
+    } else if (key == "blocks") {
+      while (*value) {
+        uint64_t base = strtoull(value, &rest, 0);
+        uint64_t size = *rest == ':' ? strtoull(rest + 1, &rest, 0) : 0;
+        layout.blocks.push_back(std::make_pair(base, size));
+        value = *rest == ',' ? rest + 1 : rest;
+        if (size == 0) {
+          break;
+        }
+      }
+    }
+  }
+  return layout.pid != 0 && layout.quit != 0 && !layout.blocks.empty();
+}
+
+// Keeps the regions overlapping [base, base + size)
+std::vector<MemoryRegion> RegionsWithin(const std::vector<MemoryRegion>& regions,
+                                        const std::vector<std::pair<uint64_t, uint64_t>>& ranges) {
+  std::vector<MemoryRegion> kept;
+  for (const MemoryRegion& region : regions) {
+    for (const auto& range : ranges) {
+      if (region.base < range.first + range.second && range.first < region.base + region.size) {
+        kept.push_back(region);
+        break;
+      }
+    }
+  }
+  return kept;
+}
+
+uint64_t TotalSize(const std::vector<MemoryRegion>& regions) {
+  uint64_t total = 0;
+  for (const MemoryRegion& region : regions) {
+    total += region.size;
+  }
+  return total;
+}
+
+// Runs `body` `repeat` times; body returns the seconds it wants counted
+Result Measure(const std::string& name, int repeat, const std::function<double(Result&)>& body) {
+  Result result;
+  result.name = name;
+  for (int i = 0; i < repeat; i++) {
+    uint64_t calls = ReadCalls();
+    result.seconds.push_back(body(result));
+    result.Set("readCalls", static_cast<double>(ReadCalls() - calls));
+  }
+  return result;
+}
+
+void AddThroughput(Result& result, uint64_t bytes) {
+  double median = result.Median();
+  result.Set("bytes", static_cast<double>(bytes));
+  result.Set("gbps", median > 0 ? bytes / median / 1e9 : 0);
+}
+
+double Percentile(std::vector<double> values, double fraction) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+  return values[index];
+}
+
+std::string JsonNumber(double value) {
+  char text[64];
+  if (value == static_cast<double>(static_cast<int64_t>(value))) {
+    snprintf(text, sizeof(text), "%lld", static_cast<long long>(value));
+  } else {
+    snprintf(text, sizeof(text), "%.9g", value);
+  }
+  return text;
+}
+
+std::string ToJson(const std::vector<Result>& results, const VictimLayout& layout, uint64_t heapBytes) {
+  std::string json = "{\n";
+  json += "  \"version\": 1,\n";
+  json += "  \"timestamp\": " + JsonNumber(static_cast<double>(time(nullptr))) + ",\n";
+#ifdef _WIN32
+  json += "  \"platform\": \"win32\",\n";
+#else
+  json += "  \"platform\": \"linux\",\n";
+#endif
+  json += "  \"threads\": " + JsonNumber(static_cast<double>(ThreadPool::Shared().Size())) + ",\n";
+  json += "  \"victim\": { \"heapBytes\": " + JsonNumber(static_cast<double>(heapBytes)) +
+          ", \"blocks\": " + JsonNumber(static_cast<double>(layout.blocks.size())) +
+          ", \"planted\": " + JsonNumber(static_cast<double>(layout.planted)) +
+          ", \"rdramBytes\": " + JsonNumber(static_cast<double>(layout.rdramSize)) + " },\n";
+  json += "  \"results\": {";
+  for (size_t r = 0; r < results.size(); r++) {
+    const Result& result = results[r];
+    json += r ? ",\n" : "\n";
+    json += "    \"" + result.name + "\": { \"medianSeconds\": " + JsonNumber(result.Median()) + ", \"runs\": [";
+    for (size_t i = 0; i < result.seconds.size(); i++) {
+      json += (i ? ", " : "") + JsonNumber(result.seconds[i]);
+    }
+    json += "]";
+    for (const auto& field : result.fields) {
+      json += ", \"" + field.first + "\": " + JsonNumber(field.second);
+    }
+    json += " }";
+  }
+  json += "\n  }\n}\n";
+  return json;
+}
+
+void PrintSummary(const Result& result) {
+  fprintf(stderr, "%-20s median %10.3f ms", result.name.c_str(), result.Median() * 1000);
+  for (const auto& field : result.fields) {
+    fprintf(stderr, "  %s=%.4g", field.first.c_str(), field.second);
+  }
+  fprintf(stderr, "\n");
+}
+
+std::vector<Result> RunBenchmarks(ProcessHandle& process, const VictimLayout& layout,
+                                  const Options& options, uint64_t& heapBytes) {
+  std::vector<Result> results;
+  std::vector<MemoryRegion> all;
+  process.EnumerateRegions(all);
+  std::vector<MemoryRegion> heap = RegionsWithin(all, layout.blocks);
+  heapBytes = TotalSize(heap);
+  ScanOperand value = ScanOperand::From<uint32_t>(layout.value);
+
+  // Full passes over the heap
+  results.push_back(Measure("scanUint32", options.repeat, [&](Result& result) {
+    std::vector<uint64_t> matches;
+    Clock::time_point start = Clock::now();
+    ScanForUint32(process, heap, layout.value, matches);
+    double seconds = Seconds(Clock::now() - start);
+    result.Set("matches", static_cast<double>(matches.size()));
+    return seconds;
+  }));
+  AddThroughput(results.back(), heapBytes);
+
+  results.push_back(Measure("firstScanExact", options.repeat, [&](Result& result) {
+    CandidateSet set;
+    ScanCriteria criteria;
+    criteria.value = value;
+    std::string error;
+    Clock::time_point start = Clock::now();
+    set.FirstScan(process, heap, criteria, error);
+    double seconds = Seconds(Clock::now() - start);
+    result.Set("candidates", static_cast<double>(set.Count()));
+    return seconds;
+  }));
+  AddThroughput(results.back(), heapBytes);
+
+  // A loose first pass keeps about 1 in 256 noise words, dense enough that
+  // the refinement re-reads whole regions
+  ScanCriteria range;
+  range.mode = CompareMode::InRange;
+  range.value = ScanOperand::From<uint32_t>(0);
+  range.value2 = ScanOperand::From<uint32_t>(0x00FFFFFF);
+  results.push_back(Measure("firstScanRange", options.repeat, [&](Result& result) {
+    CandidateSet set;
+    std::string error;
+    Clock::time_point start = Clock::now();
+    set.FirstScan(process, heap, range, error);
+    double seconds = Seconds(Clock::now() - start);
+    result.Set("candidates", static_cast<double>(set.Count()));
+    result.Set("candidateBytes", static_cast<double>(set.MemoryUsage()));
+    return seconds;
+  }));
+  AddThroughput(results.back(), heapBytes);
+
+  results.push_back(Measure("refineUnchanged", options.repeat, [&](Result& result) {
+    CandidateSet set;
+    std::string error;
+    set.FirstScan(process, heap, range, error);
+    ScanCriteria unchanged;
+    unchanged.mode = CompareMode::Unchanged;
+    Clock::time_point start = Clock::now();
+    set.NextScan(process, unchanged, error);
+    double seconds = Seconds(Clock::now() - start);
+    result.Set("candidates", static_cast<double>(set.Count()));
+    return seconds;
+  }));
+
+  if (layout.rdramSize > 0) {
+    // Finding RDRAM walks the full map, so it is timed against the whole
+    // process rather than the heap
+    results.push_back(Measure("rdramLocate", options.repeat, [&](Result& result) {
+      RdramLocation location;
+      Clock::time_point start = Clock::now();
+      std::vector<MemoryRegion> regions;
+      process.EnumerateRegions(regions);
+      bool found = LocateRdram(process, regions, location);
+      double seconds = Seconds(Clock::now() - start);
+      result.Set("found", found && location.base == layout.rdramBase ? 1 : 0);
+      return seconds;
+    }));
+
+    std::vector<MemoryRegion> rdram = RegionsWithin(all, { std::make_pair(layout.rdramBase, layout.rdramSize) });
+    BytePattern pattern;
+    std::string error;
+    ParseBytePattern("53 4D 41 53 48 46 41 43 54 4F 52 59", pattern, error);
+    pattern.wordSwapped = true;
+    results.push_back(Measure("rdramPatternScan", options.repeat, [&](Result& result) {
+      std::vector<uint64_t> matches;
+      Clock::time_point start = Clock::now();
+      ScanForPattern(process, rdram, pattern, matches);
+      double seconds = Seconds(Clock::now() - start);
+      result.Set("matches", static_cast<double>(matches.size()));
+      return seconds;
+    }));
+    AddThroughput(results.back(), TotalSize(rdram));
+  }
+
+  // Random aligned addresses across the heap blocks
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  auto randomAddress = [&](uint32_t size) {
+    const auto& block = layout.blocks[NextRandom(state) % layout.blocks.size()];
+    return block.first + NextRandom(state) % ((block.second - size) / size) * size;
+  };
+
+  results.push_back(Measure("singleRead", options.repeat, [&](Result& result) {
+    std::vector<double> latencies(options.reads);
+    uint32_t word;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < options.reads; i++) {
+      uint64_t address = randomAddress(4);
+      Clock::time_point before = Clock::now();
+      process.Read(address, &word, sizeof(word));
+      latencies[i] = Seconds(Clock::now() - before) * 1e6;
+    }
+    double seconds = Seconds(Clock::now() - start);
+    result.Set("reads", static_cast<double>(options.reads));
+    result.Set("p50Micros", Percentile(latencies, 0.5));
+    result.Set("p99Micros", Percentile(latencies, 0.99));
+    result.Set("readsPerSecond", options.reads / seconds);
+    return seconds;
+  }));
+
+  results.push_back(Measure("batchRead", options.repeat, [&](Result& result) {
+    std::vector<ReadRequest> requests(options.batch);
+    for (ReadRequest& request : requests) {
+      request.address = randomAddress(8);
+      request.size = 8;
+    }
+    std::vector<size_t> offsets;
+    std::vector<uint8_t> out(LayoutBatch(requests.data(), requests.size(), offsets));
+    std::vector<ReadStatus> status(requests.size());
+    Clock::time_point start = Clock::now();
+    size_t complete = ReadBatch(process, requests.data(), requests.size(), offsets, out.data(), status.data());
+    double seconds = Seconds(Clock::now() - start);
+    result.Set("requests", static_cast<double>(requests.size()));
+    result.Set("complete", static_cast<double>(complete));
+    result.Set("requestsPerSecond", requests.size() / seconds);
+    return seconds;
+  }));
+
+  return results;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    return 2;
+  }
+
+  std::string command = "\"" + options.victim + "\"";
+  for (const std::string& arg : options.victimArgs) {
+    command += " " + arg;
+  }
+#ifdef _WIN32
+  // cmd.exe strips the outer quotes of the whole line
+  command = "\"" + command + "\"";
+#endif
+  FILE* victim = popen(command.c_str(), "r");
+  if (!victim) {
+    fprintf(stderr, "sf_bench: failed to start %s\n", options.victim.c_str());
+    return 1;
+  }
+
+  std::string line;
+  char chunk[4096];
+  while (fgets(chunk, sizeof(chunk), victim)) {
+    line += chunk;
+    if (!line.empty() && line.back() == '\n') {
+      break;
+    }
+  }
+  VictimLayout layout;
+  if (!ParseVictimLine(line, layout)) {
+    fprintf(stderr, "sf_bench: victim did not report its layout\n");
+    pclose(victim);
+    return 1;
+  }
+
+  std::unique_ptr<ProcessHandle> process = OpenProcessHandle(layout.pid, kAccessRead | kAccessWrite | kAccessQuery);
+  if (!process) {
+    fprintf(stderr, "sf_bench: failed to open victim %u: %s\n", layout.pid, GetLastErrorAsString().c_str());
+    pclose(victim);
+    return 1;
+  }
+
+  uint64_t heapBytes = 0;
+  std::vector<Result> results = RunBenchmarks(*process, layout, options, heapBytes);
+
+  uint32_t stop = 1;
+  process->Write(layout.quit, &stop, sizeof(stop));
+  pclose(victim);
+
+  fprintf(stderr, "sf_bench: %llu heap bytes in %zu blocks, %llu planted values\n",
+          static_cast<unsigned long long>(heapBytes), layout.blocks.size(),
+          static_cast<unsigned long long>(layout.planted));
+  for (const Result& result : results) {
+    PrintSummary(result);
+  }
+
+  std::string json = ToJson(results, layout, heapBytes);
+  if (options.out.empty()) {
+    fputs(json.c_str(), stdout);
+    return 0;
+  }
+  FILE* file = fopen(options.out.c_str(), "wb");
+  if (!file) {
+    fprintf(stderr, "sf_bench: cannot write %s\n", options.out.c_str());
+    return 1;
+  }
+  fputs(json.c_str(), file);
+  fclose(file);
+  return 0;
+}
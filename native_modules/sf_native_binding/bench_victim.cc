@@ -0,0 +1,199 @@
+// sf_victim: a synthetic target for sf_bench. Allocates a heap split into
+// separate blocks, fills it with noise, plants a known uint32 value at
+// random aligned offsets and optionally adds an emulator-style RDRAM block
+// (big-endian memory kept as host-order 32-bit words). Prints one line
+// describing the layout, then idles until the bench writes a nonzero word
+// to the `quit` address or the lifetime runs out.
+//
+//   sf_victim [--heap-mb 256] [--blocks 64] [--plant-value 0x13371337]
+//             [--plant-count 4096] [--rdram-mb 8] [--seed 1] [--lifetime 600]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "platform.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t kPageSize = 4096;
+
+// Big-endian bytes planted into the RDRAM block, found by a word-swapped
+// pattern scan
+const char kRdramMarker[] = "SMASHFACTORY";
+
+std::atomic<uint32_t> quit(0);
+
+struct Options {
+  uint64_t heapMb = 256;
+  uint64_t blocks = 64;
+  uint32_t plantValue = 0x13371337;
+  uint64_t plantCount = 4096;
+  uint64_t rdramMb = 8;
+  uint64_t seed = 1;
+  uint64_t lifetimeSeconds = 600;
+};
+
+struct Block {
+  uint8_t* data = nullptr;
+  size_t size = 0;
+};
+
+uint64_t NextRandom(uint64_t& state) {
+  // xorshift64*
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545F4914F6CDD1DULL;
+}
+
+void FillNoise(uint8_t* data, size_t size, uint32_t avoid, uint64_t& state) {
+  uint32_t* words = reinterpret_cast<uint32_t*>(data);
+  for (size_t i = 0; i < size / 4; i++) {
+    uint32_t word = static_cast<uint32_t>(NextRandom(state));
+    // Keep the planted value unique so the bench can check match counts
+    words[i] = word == avoid ? word ^ 1 : word;
+  }
+}
+
+bool ParseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      fprintf(stderr, "sf_victim: %s needs a value\n", arg.c_str());
+      return false;
+    }
+    uint64_t value = strtoull(argv[++i], nullptr, 0);
+    if (arg == "--heap-mb") options.heapMb = value;
+    else if (arg == "--blocks") options.blocks = value;
+    else if (arg == "--plant-value") options.plantValue = static_cast<uint32_t>(value);
+    else if (arg == "--plant-count") options.plantCount = value;
+    else if (arg == "--rdram-mb") options.rdramMb = value;
+    else if (arg == "--seed") options.seed = value;
+    else if (arg == "--lifetime") options.lifetimeSeconds = value;
+    else {
+      fprintf(stderr, "sf_victim: unknown option %s\n", arg.c_str());
+      return false;
+    }
+  }
+  if (options.heapMb == 0 || options.blocks == 0 || options.seed == 0) {
+    fprintf(stderr, "sf_victim: --heap-mb, --blocks and --seed must be nonzero\n");
+    return false;
+  }
+  return true;
+}
+
+// Adjacent anonymous mappings merge into one region on Linux, so each
+// block is allocated a page larger and that page is unmapped again,
+// leaving a hole. Windows allocations are separate regions regardless.
+uint8_t* AllocateBlock(size_t size) {
+  uint8_t* data = static_cast<uint8_t*>(AllocatePages(size + kPageSize));
+#ifndef _WIN32
+  if (data) {
+    FreePages(data + size, kPageSize);
+  }
+#endif
+  return data;
+}
+
+uint32_t CurrentPid() {
+#ifdef _WIN32
+  return GetCurrentProcessId();
+#else
+  return static_cast<uint32_t>(getpid());
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    return 2;
+  }
+  uint64_t state = options.seed;
+
+  uint64_t heapBytes = options.heapMb * 1024 * 1024;
+  size_t blockSize = static_cast<size_t>((heapBytes / options.blocks + kPageSize - 1) / kPageSize * kPageSize);
+  std::vector<Block> blocks(options.blocks);
+  for (Block& block : blocks) {
+    block.size = blockSize;
+    block.data = AllocateBlock(blockSize);
+    if (!block.data) {
+      fprintf(stderr, "sf_victim: failed to allocate %zu bytes\n", blockSize);
+      return 1;
+    }
+    FillNoise(block.data, block.size, options.plantValue, state);
+  }
+
+  // Planted at distinct aligned offsets; a collision just plants fewer
+  uint64_t planted = 0;
+  for (uint64_t i = 0; i < options.plantCount; i++) {
+    Block& block = blocks[NextRandom(state) % blocks.size()];
+    uint32_t* word = reinterpret_cast<uint32_t*>(block.data) + NextRandom(state) % (block.size / 4);
+    if (*word != options.plantValue) {
+      *word = options.plantValue;
+      planted++;
+    }
+  }
+
+  Block rdram;
+  uint64_t markers = 0;
+  if (options.rdramMb > 0) {
+    rdram.size = static_cast<size_t>(options.rdramMb * 1024 * 1024);
+    rdram.data = AllocateBlock(rdram.size);
+    if (!rdram.data) {
+      fprintf(stderr, "sf_victim: failed to allocate %zu bytes of RDRAM\n", rdram.size);
+      return 1;
+    }
+    FillNoise(rdram.data, rdram.size, options.plantValue, state);
+    // The boot code leaves the RAM size at 0x318 and the cartridge base
+    // at 0x308, both as words
+    uint32_t ramSize = static_cast<uint32_t>(rdram.size);
+    uint32_t cartridgeBase = 0xB0000000;
+    memcpy(rdram.data + 0x318, &ramSize, 4);
+    memcpy(rdram.data + 0x308, &cartridgeBase, 4);
+
+    // Byte i of big-endian memory lives at host offset i ^ 3
+    size_t markerSize = sizeof(kRdramMarker) - 1;
+    for (size_t offset = 0x10000; offset + markerSize < rdram.size; offset += 0x40000) {
+      for (size_t i = 0; i < markerSize; i++) {
+        rdram.data[(offset + i) ^ 3] = static_cast<uint8_t>(kRdramMarker[i]);
+      }
+      markers++;
+    }
+  }
+
+  printf("sf_victim pid=%u quit=0x%llx value=0x%x planted=%llu", CurrentPid(),
+         static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(&quit)), options.plantValue,
+         static_cast<unsigned long long>(planted));
+  if (rdram.data) {
+    printf(" rdram=0x%llx:%zu markers=%llu", static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(rdram.data)),
+           rdram.size, static_cast<unsigned long long>(markers));
+  }
+  printf(" blocks=");
+  for (size_t i = 0; i < blocks.size(); i++) {
+    printf("%s0x%llx:%zu", i ? "," : "", static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(blocks[i].data)),
+           blocks[i].size);
+  }
+  printf("\n");
+  fflush(stdout);
+
+  std::chrono::steady_clock::time_point deadline =
+    std::chrono::steady_clock::now() + std::chrono::seconds(options.lifetimeSeconds);
+  while (!quit.load() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  return 0;
+}
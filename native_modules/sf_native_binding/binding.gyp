@@ -1,21 +1,93 @@
-{
-  "targets": [
-    {
-      "target_name": "sf_native",
-      "sources": [
-        "main.cc",
-        "processes.cc",
-        "memory.cc"
-      ],
-      "include_dirs": [
-        "<!@(node -p \"require('node-addon-api').include\")"
-      ],
-      "dependencies": [
-        "<!(node -p \"require('node-addon-api').gyp\")"
-      ],
-      "cflags!": ["-fno-exceptions"],
-      "cflags_cc!": ["-fno-exceptions"],
-      "defines": ["NAPI_DISABLE_CPP_EXCEPTIONS"]
-    }
-  ]
-}
\ No newline at end of file
+{
+  "target_defaults": {
+    "cflags!": ["-fno-exceptions"],
+    "cflags_cc!": ["-fno-exceptions"]
+  },
+  "targets": [
+    {
+      # The memory engine without any Node dependency, shared by the addon
+      # and the benchmark executables
+      "target_name": "sf_core",
+      "type": "static_library",
+      "sources": [
+        "batch_read.cc",
+        "scanner.cc",
+        "candidate_set.cc",
+        "region_stream.cc",
+        "buffer_pool.cc",
+        "scan_kernels.cc",
+        "thread_pool.cc",
+        "freeze_engine.cc",
+        "watch_engine.cc",
+        "rdram.cc",
+        "region_map.cc",
+        "pointer_scan.cc",
+        "snapshot.cc",
+        "process_watcher.cc",
+        "struct_plan.cc",
+        "page_cache.cc",
+        "scan_results.cc",
+        "log.cc",
+        "metrics.cc"
+      ],
+      "conditions": [
+        ["OS=='win'", {
+          "sources": ["platform_win.cc"],
+          "link_settings": {
+            "libraries": ["winmm.lib"]
+          }
+        }],
+        ["OS=='linux'", {
+          "sources": ["platform_linux.cc"],
+          # Linked into the addon's shared object
+          "cflags": ["-fPIC"]
+        }]
+      ]
+    },
+    {
+      "target_name": "sf_native",
+      "sources": [
+        "main.cc",
+        "processes.cc",
+        "memory.cc",
+        "session.cc",
+        "structs.cc",
+        "async_scan.cc",
+        "diagnostics.cc"
+      ],
+      "include_dirs": [
+        "<!@(node -p \"require('node-addon-api').include\")"
+      ],
+      "dependencies": [
+        "<!(node -p \"require('node-addon-api').gyp\")",
+        "sf_core"
+      ],
+      "defines": ["NAPI_DISABLE_CPP_EXCEPTIONS"]
+    },
+    {
+      # node-gyp build, then build/Release/sf_bench [--out results.json]
+      "target_name": "sf_bench",
+      "type": "executable",
+      "sources": ["bench.cc"],
+      "dependencies": ["sf_core", "sf_victim"],
+      "win_delay_load_hook": "false",
+      "conditions": [
+        ["OS=='linux'", {
+          "libraries": ["-pthread"]
+        }]
+      ]
+    },
+    {
+      "target_name": "sf_victim",
+      "type": "executable",
+      "sources": ["bench_victim.cc"],
+      "dependencies": ["sf_core"],
+      "win_delay_load_hook": "false",
+      "conditions": [
+        ["OS=='linux'", {
+          "libraries": ["-pthread"]
+        }]
+      ]
+    }
+  ]
+}
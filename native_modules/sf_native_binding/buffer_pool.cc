@@ -0,0 +1,45 @@
+#include "buffer_pool.h"
+#include "platform.h"
+
+namespace {
+
+const size_t kPageSize = 4096;
+
+}  // namespace
+
+BufferPool::BufferPool(size_t count, size_t bufferSize) {
+  // Round up so every buffer starts on a page boundary
+  bufferSize_ = (bufferSize + kPageSize - 1) & ~(kPageSize - 1);
+  count_ = count;
+  slabSize_ = bufferSize_ * count_;
+  slab_ = static_cast<uint8_t*>(AllocatePages(slabSize_));
+  if (!slab_) {
+    count_ = 0;
+    return;
+  }
+
+  free_.reserve(count_);
+  for (size_t i = 0; i < count_; i++) {
+    free_.push_back(slab_ + i * bufferSize_);
+  }
+}
+
+BufferPool::~BufferPool() {
+  FreePages(slab_, slabSize_);
+}
+
+uint8_t* BufferPool::Acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  available_.wait(lock, [this]() { return !free_.empty(); });
+  uint8_t* buffer = free_.back();
+  free_.pop_back();
+  return buffer;
+}
+
+void BufferPool::Release(uint8_t* buffer) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(buffer);
+  }
+  available_.notify_one();
+}
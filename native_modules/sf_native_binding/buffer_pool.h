@@ -0,0 +1,36 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Fixed set of equally sized, page-aligned buffers carved from one
+// allocation. Acquire blocks while every buffer is in use, which is what
+// caps the memory a streaming scan can hold at once.
+class BufferPool {
+ public:
+  BufferPool(size_t count, size_t bufferSize);
+  ~BufferPool();
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  // Null if the backing allocation failed
+  bool Valid() const { return slab_ != nullptr; }
+
+  size_t BufferSize() const { return bufferSize_; }
+  size_t Count() const { return count_; }
+
+  uint8_t* Acquire();
+  void Release(uint8_t* buffer);
+
+ private:
+  uint8_t* slab_ = nullptr;
+  size_t slabSize_ = 0;
+  size_t bufferSize_ = 0;
+  size_t count_ = 0;
+  std::vector<uint8_t*> free_;
+  std::mutex mutex_;
+  std::condition_variable available_;
+};
@@ -0,0 +1,1045 @@
+#include "candidate_set.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <type_traits>
+#include "region_stream.h"
+#include "scan_kernels.h"
+#include "thread_pool.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <stdlib.h>
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Windows are a multiple of 64 slots for every stride, so each window owns
+// whole bitmap words and concurrent windows never share one
+const size_t kWindowSize = 256 * 1024;
+
+// Sparse refinement reads: candidates closer than kCoalesceGap share one
+// range, a range stops growing at kMaxRangeBytes, and one ReadMany call
+// carries at most kBatchRanges ranges or kBatchBytes bytes
+const uint64_t kCoalesceGap = 256;
+const size_t kMaxRangeBytes = 64 * 1024;
+const size_t kBatchRanges = 1024;
+const size_t kBatchBytes = 1024 * 1024;
+
+// A first-pass window whose hits exceed this fraction of its slots is kept
+// as bitmap + bytes instead of a hit list
+const size_t kDenseWindowDivisor = 4;
+
+inline int CountTrailingZeros(uint64_t word) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, word);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(word);
+#endif
+}
+
+inline int PopCount(uint64_t word) {
+#ifdef _MSC_VER
+  return static_cast<int>(__popcnt64(word));
+#else
+  return __builtin_popcountll(word);
+#endif
+}
+
+inline uint8_t SwapBytes(uint8_t value) { return value; }
+
+inline uint16_t SwapBytes(uint16_t value) {
+#ifdef _MSC_VER
+  return _byteswap_ushort(value);
+#else
+  return __builtin_bswap16(value);
+#endif
+}
+
+inline uint32_t SwapBytes(uint32_t value) {
+#ifdef _MSC_VER
+  return _byteswap_ulong(value);
+#else
+  return __builtin_bswap32(value);
+#endif
+}
+
+inline uint64_t SwapBytes(uint64_t value) {
+#ifdef _MSC_VER
+  return _byteswap_uint64(value);
+#else
+  return __builtin_bswap64(value);
+#endif
+}
+
+template <size_t Size> struct UIntOfSize;
+template <> struct UIntOfSize<1> { typedef uint8_t type; };
+template <> struct UIntOfSize<2> { typedef uint16_t type; };
+template <> struct UIntOfSize<4> { typedef uint32_t type; };
+template <> struct UIntOfSize<8> { typedef uint64_t type; };
+
+// Loads a T from unaligned memory, reversing its bytes when Swap is set
+template <typename T, bool Swap>
+inline T Load(const uint8_t* p) {
+  typedef typename UIntOfSize<sizeof(T)>::type Bits;
+  Bits bits;
+  memcpy(&bits, p, sizeof(T));
+  if constexpr (Swap) {
+    bits = SwapBytes(bits);
+  }
+  T value;
+  memcpy(&value, &bits, sizeof(T));
+  return value;
+}
+
+void AppendVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t ReadVarint(const uint8_t*& p) {
+  uint64_t value = 0;
+  int shift = 0;
+  while (*p & 0x80) {
+    value |= static_cast<uint64_t>(*p++ & 0x7F) << shift;
+    shift += 7;
+  }
+  value |= static_cast<uint64_t>(*p++) << shift;
+  return value;
+}
+
+// Appends candidates in slot order to sparse storage
+class SparseWriter {
+ public:
+  SparseWriter(std::vector<uint8_t>& deltas, std::vector<uint8_t>& values, size_t valueSize)
+    : deltas_(deltas), values_(values), valueSize_(valueSize) {}
+
+  void Append(uint64_t slot, const uint8_t* value) {
+    AppendVarint(deltas_, slot - last_);
+    last_ = slot;
+    values_.insert(values_.end(), value, value + valueSize_);
+    count_++;
+  }
+
+  uint64_t Count() const { return count_; }
+
+ private:
+  std::vector<uint8_t>& deltas_;
+  std::vector<uint8_t>& values_;
+  size_t valueSize_;
+  uint64_t last_ = 0;
+  uint64_t count_ = 0;
+};
+
+// Walks sparse storage in slot order
+class SparseReader {
+ public:
+  SparseReader(const CandidateRegion& region, size_t valueSize)
+    : next_(region.deltas.data()), values_(region.values.data()),
+      valueSize_(valueSize), remaining_(region.count) {}
+
+  bool Next(uint64_t& slot, const uint8_t*& value) {
+    if (remaining_ == 0) {
+      return false;
+    }
+    slot_ += ReadVarint(next_);
+    slot = slot_;
+    value = values_;
+    values_ += valueSize_;
+    remaining_--;
+    return true;
+  }
+
+ private:
+  const uint8_t* next_;
+  const uint8_t* values_;
+  size_t valueSize_;
+  uint64_t remaining_;
+  uint64_t slot_ = 0;
+};
+
+// Calls fn(slot) for every set bit of `bitmap`, in order
+template <typename Fn>
+void ForEachSetBit(const std::vector<uint64_t>& bitmap, Fn&& fn) {
+  for (size_t i = 0; i < bitmap.size(); i++) {
+    uint64_t word = bitmap[i];
+    while (word) {
+      fn(i * 64 + CountTrailingZeros(word));
+      word &= word - 1;
+    }
+  }
+}
+
+size_t SlotCount(uint64_t bytes, size_t valueSize, size_t stride) {
+  return bytes < valueSize ? 0 : static_cast<size_t>((bytes - valueSize) / stride + 1);
+}
+
+// Scan operands decoded to the scanned type once per pass
+template <typename T>
+struct Operands {
+  T value;
+  T value2;
+  double epsilon;
+};
+
+template <typename T>
+inline bool Near(T a, T b, double epsilon) {
+  if constexpr (std::is_floating_point<T>::value) {
+    return std::fabs(static_cast<double>(a) - static_cast<double>(b)) <= epsilon;
+  } else {
+    return a == b;
+  }
+}
+
+template <typename T, CompareMode Mode>
+inline bool Matches(T current, T previous, const Operands<T>& operands) {
+  if constexpr (Mode == CompareMode::Unknown) return true;
+  if constexpr (Mode == CompareMode::Equal) return Near(current, operands.value, operands.epsilon);
+  if constexpr (Mode == CompareMode::NotEqual) return !Near(current, operands.value, operands.epsilon);
+  if constexpr (Mode == CompareMode::Changed) return current != previous;
+  if constexpr (Mode == CompareMode::Unchanged) return current == previous;
+  if constexpr (Mode == CompareMode::Increased) return current > previous;
+  if constexpr (Mode == CompareMode::Decreased) return current < previous;
+  if constexpr (Mode == CompareMode::IncreasedBy) {
+    return Near(current, static_cast<T>(previous + operands.value), operands.epsilon);
+  }
+  if constexpr (Mode == CompareMode::DecreasedBy) {
+    return Near(current, static_cast<T>(previous - operands.value), operands.epsilon);
+  }
+  if constexpr (Mode == CompareMode::InRange) return current >= operands.value && current <= operands.value2;
+  return false;
+}
+
+template <CompareMode Mode>
+using ModeTag = std::integral_constant<CompareMode, Mode>;
+
+// Instantiates `fn` for the runtime `mode` so every compare loop is
+// specialized on it instead of switching per value
+template <typename Fn>
+void DispatchMode(CompareMode mode, Fn&& fn) {
+  switch (mode) {
+    case CompareMode::Unknown: fn(ModeTag<CompareMode::Unknown>()); break;
+    case CompareMode::Equal: fn(ModeTag<CompareMode::Equal>()); break;
+    case CompareMode::NotEqual: fn(ModeTag<CompareMode::NotEqual>()); break;
+    case CompareMode::Changed: fn(ModeTag<CompareMode::Changed>()); break;
+    case CompareMode::Unchanged: fn(ModeTag<CompareMode::Unchanged>()); break;
+    case CompareMode::Increased: fn(ModeTag<CompareMode::Increased>()); break;
+    case CompareMode::Decreased: fn(ModeTag<CompareMode::Decreased>()); break;
+    case CompareMode::IncreasedBy: fn(ModeTag<CompareMode::IncreasedBy>()); break;
+    case CompareMode::DecreasedBy: fn(ModeTag<CompareMode::DecreasedBy>()); break;
+    case CompareMode::InRange: fn(ModeTag<CompareMode::InRange>()); break;
+  }
+}
+
+template <typename T>
+struct TypeTag {
+  typedef T type;
+};
+
+// Same for the value type
+template <typename Fn>
+void DispatchType(ValueType type, Fn&& fn) {
+  switch (type) {
+    case ValueType::Int8: fn(TypeTag<int8_t>()); break;
+    case ValueType::UInt8: fn(TypeTag<uint8_t>()); break;
+    case ValueType::Int16: fn(TypeTag<int16_t>()); break;
+    case ValueType::UInt16: fn(TypeTag<uint16_t>()); break;
+    case ValueType::Int32: fn(TypeTag<int32_t>()); break;
+    case ValueType::UInt32: fn(TypeTag<uint32_t>()); break;
+    case ValueType::Int64: fn(TypeTag<int64_t>()); break;
+    case ValueType::UInt64: fn(TypeTag<uint64_t>()); break;
+    case ValueType::Float32: fn(TypeTag<float>()); break;
+    case ValueType::Float64: fn(TypeTag<double>()); break;
+  }
+}
+
+// First-pass result of one window. Sparse windows list their hits; dense
+// ones keep a bitmap and the window's bytes.
+struct WindowHits {
+  bool dense = false;
+  std::vector<uint32_t> slots;
+  std::vector<uint8_t> values;
+  std::vector<uint64_t> bitmap;
+  std::vector<uint8_t> bytes;
+};
+
+template <typename T, bool Swap, CompareMode Mode>
+void CollectHits(const uint8_t* data, size_t slots, size_t stride, const Operands<T>& operands,
+                 WindowHits& hits) {
+  for (size_t slot = 0; slot < slots; slot++) {
+    const uint8_t* p = data + slot * stride;
+    T current = Load<T, Swap>(p);
+    if (Matches<T, Mode>(current, current, operands)) {
+      hits.slots.push_back(static_cast<uint32_t>(slot));
+      hits.values.insert(hits.values.end(), p, p + sizeof(T));
+    }
+  }
+}
+
+// Refines the set bits of `words` (the window at `windowOffset`, whose
+// first slot is `firstSlot`) against freshly read `data`. Previous values
+// come from the region snapshot; a value straddling the window end takes
+// its tail from `boundary`, a copy of the next window's first bytes made
+// before the pass, since that window may be refreshing them concurrently.
+// Returns the number of survivors.
+template <typename T, bool Swap, CompareMode Mode>
+uint64_t RefineDenseWindow(const uint8_t* data, size_t available, uint64_t windowOffset, size_t windowSize,
+                           uint64_t* words, size_t wordCount, size_t firstSlot, size_t stride,
+                           const uint8_t* snapshot, const uint8_t* boundary,
+                           const Operands<T>& operands) {
+  uint64_t survivors = 0;
+  for (size_t w = 0; w < wordCount; w++) {
+    uint64_t word = words[w];
+    uint64_t kept = word;
+    while (word) {
+      int bit = CountTrailingZeros(word);
+      word &= word - 1;
+
+      uint64_t offset = static_cast<uint64_t>(firstSlot + w * 64 + bit) * stride;
+      size_t inWindow = static_cast<size_t>(offset - windowOffset);
+      if (inWindow + sizeof(T) > available) {
+        kept &= ~(1ULL << bit);
+        continue;
+      }
+
+      T current = Load<T, Swap>(data + inWindow);
+      T previous;
+      if (inWindow + sizeof(T) <= windowSize || !boundary) {
+        previous = Load<T, Swap>(snapshot + offset);
+      } else {
+        uint8_t bytes[sizeof(T)];
+        size_t head = windowSize - inWindow;
+        memcpy(bytes, snapshot + offset, head);
+        memcpy(bytes + head, boundary, sizeof(T) - head);
+        previous = Load<T, Swap>(bytes);
+      }
+
+      if (Matches<T, Mode>(current, previous, operands)) {
+        survivors++;
+      } else {
+        kept &= ~(1ULL << bit);
+      }
+    }
+    words[w] = kept;
+  }
+  return survivors;
+}
+
+struct PendingCandidate {
+  uint64_t slot;
+  const uint8_t* previous;
+  size_t range;
+};
+
+// Refines one sparse region, reading survivors in coalesced batches.
+// Writes the new storage to `deltas`/`values`. Returns false if cancelled.
+template <typename T, bool Swap, CompareMode Mode>
+bool RefineSparseRegion(ProcessHandle& process, const CandidateRegion& region, size_t stride,
+                        const Operands<T>& operands, std::vector<uint8_t>& deltas,
+                        std::vector<uint8_t>& values, uint64_t& survivors,
+                        std::atomic<uint64_t>& bytesRead, std::atomic<uint64_t>& matches,
+                        const std::atomic<bool>* cancelled) {
+  SparseWriter writer(deltas, values, sizeof(T));
+  std::vector<MemoryRange> ranges;
+  std::vector<size_t> rangeOffsets;
+  std::vector<PendingCandidate> pending;
+  std::vector<uint8_t> buffer;
+  size_t batchBytes = 0;
+
+  auto flush = [&]() {
+    buffer.resize(batchBytes);
+    for (size_t i = 0; i < ranges.size(); i++) {
+      ranges[i].buffer = buffer.data() + rangeOffsets[i];
+    }
+    bytesRead += process.ReadMany(ranges.data(), ranges.size());
+
+    uint64_t kept = 0;
+    for (const PendingCandidate& candidate : pending) {
+      const MemoryRange& range = ranges[candidate.range];
+      uint64_t inRange = region.base + candidate.slot * stride - range.address;
+      if (inRange + sizeof(T) > range.transferred) {
+        continue;
+      }
+      T current = Load<T, Swap>(range.buffer + inRange);
+      if (Matches<T, Mode>(current, Load<T, Swap>(candidate.previous), operands)) {
+        writer.Append(candidate.slot, range.buffer + inRange);
+        kept++;
+      }
+    }
+    matches += kept;
+
+    ranges.clear();
+    rangeOffsets.clear();
+    pending.clear();
+    batchBytes = 0;
+  };
+
+  SparseReader reader(region, sizeof(T));
+  uint64_t slot;
+  const uint8_t* previous;
+  while (reader.Next(slot, previous)) {
+    uint64_t address = region.base + slot * stride;
+    uint64_t end = address + sizeof(T);
+
+    bool extend = false;
+    if (!ranges.empty()) {
+      MemoryRange& last = ranges.back();
+      uint64_t lastEnd = last.address + last.size;
+      extend = address <= lastEnd + kCoalesceGap && end - last.address <= kMaxRangeBytes;
+    }
+
+    if (extend) {
+      MemoryRange& last = ranges.back();
+      uint64_t lastEnd = last.address + last.size;
+      if (end > lastEnd) {
+        batchBytes += end - lastEnd;
+        last.size = end - last.address;
+      }
+    } else {
+      if (ranges.size() == kBatchRanges || batchBytes + sizeof(T) > kBatchBytes) {
+        flush();
+        if (cancelled && cancelled->load()) {
+          return false;
+        }
+      }
+      MemoryRange range;
+      range.address = address;
+      range.size = sizeof(T);
+      ranges.push_back(range);
+      rangeOffsets.push_back(batchBytes);
+      batchBytes += sizeof(T);
+    }
+    pending.push_back({ slot, previous, ranges.size() - 1 });
+  }
+
+  if (!ranges.empty()) {
+    flush();
+  }
+  survivors = writer.Count();
+  return !(cancelled && cancelled->load());
+}
+
+}  // namespace
+
+bool IsRelativeMode(CompareMode mode) {
+  switch (mode) {
+    case CompareMode::Changed:
+    case CompareMode::Unchanged:
+    case CompareMode::Increased:
+    case CompareMode::Decreased:
+    case CompareMode::IncreasedBy:
+    case CompareMode::DecreasedBy:
+      return true;
+    default:
+      return false;
+  }
+}
+
+size_t ValueTypeSize(ValueType type) {
+  size_t size = 0;
+  DispatchType(type, [&](auto tag) {
+    size = sizeof(typename decltype(tag)::type);
+  });
+  return size;
+}
+
+bool IsFloatType(ValueType type) {
+  return type == ValueType::Float32 || type == ValueType::Float64;
+}
+
+CandidateSet::CandidateSet(const ValueLayout& layout)
+  : layout_(layout),
+    valueSize_(ValueTypeSize(layout.type)),
+    stride_(layout.unaligned ? 1 : ValueTypeSize(layout.type)) {
+  // Reversing a single byte is a no-op
+  if (valueSize_ == 1) {
+    layout_.byteSwap = false;
+  }
+}
+
+bool CandidateSet::FirstScan(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                             const ScanCriteria& criteria, std::string& error,
+                             const std::atomic<bool>* cancelled,
+                             const ScanProgressCallback& onProgress) {
+  error.clear();
+  if (IsRelativeMode(criteria.mode)) {
+    error = "The first scan needs an exact value, a range or an unknown initial value";
+    return false;
+  }
+  if (criteria.mode == CompareMode::Unknown) {
+    uint64_t readable = 0;
+    for (const MemoryRegion& region : regions) {
+      if ((region.protection & kProtRead) && !(region.protection & kProtGuard)) {
+        readable += region.size;
+      }
+    }
+    if (readable > kMaxUnknownSnapshotBytes) {
+      error = "An unknown-value scan would copy " + std::to_string(readable >> 20) + " MB, more than the " +
+              std::to_string(kMaxUnknownSnapshotBytes >> 20) + " MB limit; scan N64 memory or fewer regions";
+      return false;
+    }
+  }
+
+  bool completed = false;
+  DispatchType(layout_.type, [&](auto tag) {
+    typedef typename decltype(tag)::type T;
+    completed = layout_.byteSwap
+      ? FirstScanAs<T, true>(process, regions, criteria, cancelled, onProgress)
+      : FirstScanAs<T, false>(process, regions, criteria, cancelled, onProgress);
+  });
+  return completed;
+}
+
+template <typename T, bool Swap>
+bool CandidateSet::FirstScanAs(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                               const ScanCriteria& criteria, const std::atomic<bool>* cancelled,
+                               const ScanProgressCallback& onProgress) {
+  Clock::time_point start = Clock::now();
+  regions_.clear();
+  scanned_ = false;
+
+  ScanProgress progress;
+  progress.regionsTotal = regions.size();
+
+  std::vector<StreamSpan> spans;
+  std::vector<CandidateRegion> found;
+  std::vector<std::vector<WindowHits>> hits;
+  uint64_t skippedRegions = 0;
+  uint64_t skippedBytes = 0;
+  for (const MemoryRegion& region : regions) {
+    progress.bytesTotal += region.size;
+    if (!(region.protection & kProtRead) || (region.protection & kProtGuard)) {
+      skippedRegions++;
+      skippedBytes += region.size;
+      continue;
+    }
+    StreamSpan span;
+    span.address = region.base;
+    span.size = region.size;
+    span.tag = found.size();
+    spans.push_back(span);
+
+    CandidateRegion candidates;
+    candidates.base = region.base;
+    candidates.size = region.size;
+    size_t slots = SlotCount(region.size, valueSize_, stride_);
+    if (criteria.mode == CompareMode::Unknown) {
+      // Every slot starts out a candidate, so go straight to dense storage
+      candidates.dense = true;
+      candidates.bitmap.assign((slots + 63) / 64, 0);
+      candidates.snapshot.resize(region.size);
+    }
+    found.push_back(std::move(candidates));
+    hits.emplace_back(criteria.mode == CompareMode::Unknown ? 0 : (region.size + kWindowSize - 1) / kWindowSize);
+  }
+
+  Operands<T> operands = { criteria.value.As<T>(), criteria.value2.As<T>(), criteria.epsilon };
+  std::atomic<uint64_t> matchesFound(0);
+
+  // Aligned 32-bit integer equality is the common case and has SIMD
+  // kernels; a byte-swapped search just swaps the needle
+  bool useKernel = false;
+  uint32_t needle = 0;
+  FindUint32Kernel kernel = nullptr;
+  if constexpr (sizeof(T) == 4 && std::is_integral<T>::value) {
+    if (criteria.mode == CompareMode::Equal && stride_ == sizeof(T)) {
+      useKernel = true;
+      memcpy(&needle, &operands.value, sizeof(needle));
+      if (Swap) {
+        needle = SwapBytes(needle);
+      }
+      kernel = SelectFindUint32Kernel();
+    }
+  }
+
+  StreamOptions options;
+  options.windowSize = kWindowSize;
+  options.overlap = valueSize_ - 1;
+  StreamStats stats;
+
+  auto handler = [&](const StreamWindow& window) {
+    CandidateRegion& region = found[window.tag];
+    uint64_t windowOffset = window.address - region.base;
+    size_t bytes = std::min(window.size + options.overlap, window.available);
+    size_t slots = std::min(SlotCount(bytes, valueSize_, stride_), window.size / stride_);
+
+    if (criteria.mode == CompareMode::Unknown) {
+      memcpy(region.snapshot.data() + windowOffset, window.data, std::min(window.size, window.available));
+      // The window owns whole bitmap words; set the readable slots
+      uint64_t* words = region.bitmap.data() + windowOffset / stride_ / 64;
+      for (size_t slot = 0; slot < slots; slot++) {
+        words[slot / 64] |= 1ULL << (slot % 64);
+      }
+      matchesFound += slots;
+      return;
+    }
+
+    WindowHits& windowHits = hits[window.tag][windowOffset / kWindowSize];
+    if (useKernel) {
+      thread_local std::vector<uint64_t> addresses;
+      addresses.clear();
+      kernel(window.data, slots * stride_, needle, 0, addresses);
+      windowHits.slots.reserve(addresses.size());
+      windowHits.values.reserve(addresses.size() * sizeof(T));
+      for (uint64_t offset : addresses) {
+        windowHits.slots.push_back(static_cast<uint32_t>(offset / stride_));
+        windowHits.values.insert(windowHits.values.end(), window.data + offset, window.data + offset + sizeof(T));
+      }
+    } else {
+      DispatchMode(criteria.mode, [&](auto mode) {
+        CollectHits<T, Swap, decltype(mode)::value>(window.data, slots, stride_, operands, windowHits);
+      });
+    }
+    matchesFound += windowHits.slots.size();
+
+    // Mostly-matching windows (e.g. searching for 0) are cheaper as a
+    // bitmap plus a copy of the bytes
+    if (windowHits.slots.size() > slots / kDenseWindowDivisor) {
+      windowHits.dense = true;
+      windowHits.bitmap.assign((slots + 63) / 64, 0);
+      for (uint32_t slot : windowHits.slots) {
+        windowHits.bitmap[slot / 64] |= 1ULL << (slot % 64);
+      }
+      windowHits.bytes.assign(window.data, window.data + bytes);
+      std::vector<uint32_t>().swap(windowHits.slots);
+      std::vector<uint8_t>().swap(windowHits.values);
+    }
+  };
+
+  auto report = [&]() {
+    if (!onProgress) {
+      return;
+    }
+    progress.regionsDone = skippedRegions + stats.spansDone;
+    progress.bytesScanned = skippedBytes + stats.bytesDone;
+    progress.matches = matchesFound;
+    progress.elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    onProgress(progress);
+  };
+
+  if (!StreamRegions(process, spans, options, handler, stats, cancelled, report)) {
+    return false;
+  }
+  RecordScanPass(spans.size(), skippedRegions, stats.bytesDone, Clock::now() - start);
+
+  // Assemble each region from its windows in address order
+  for (size_t r = 0; r < found.size(); r++) {
+    CandidateRegion& region = found[r];
+    if (criteria.mode == CompareMode::Unknown) {
+      for (uint64_t word : region.bitmap) {
+        region.count += PopCount(word);
+      }
+      Compact(region);
+      continue;
+    }
+
+    for (const WindowHits& windowHits : hits[r]) {
+      if (windowHits.dense) {
+        for (uint64_t word : windowHits.bitmap) {
+          region.count += PopCount(word);
+        }
+      } else {
+        region.count += windowHits.slots.size();
+      }
+    }
+    if (region.count == 0) {
+      continue;
+    }
+
+    size_t slots = SlotCount(region.size, valueSize_, stride_);
+    uint64_t denseCost = region.size + (slots + 63) / 64 * 8;
+    uint64_t sparseCost = region.count * (valueSize_ + 2);
+    region.dense = denseCost < sparseCost;
+    if (region.dense) {
+      region.bitmap.assign((slots + 63) / 64, 0);
+      region.snapshot.resize(region.size);
+    }
+    SparseWriter writer(region.deltas, region.values, valueSize_);
+
+    for (size_t w = 0; w < hits[r].size(); w++) {
+      WindowHits& windowHits = hits[r][w];
+      uint64_t windowOffset = static_cast<uint64_t>(w) * kWindowSize;
+      uint64_t firstSlot = windowOffset / stride_;
+      auto add = [&](uint64_t slot, const uint8_t* value) {
+        if (region.dense) {
+          uint64_t at = firstSlot + slot;
+          region.bitmap[at / 64] |= 1ULL << (at % 64);
+          memcpy(region.snapshot.data() + at * stride_, value, valueSize_);
+        } else {
+          writer.Append(firstSlot + slot, value);
+        }
+      };
+      if (windowHits.dense) {
+        ForEachSetBit(windowHits.bitmap, [&](uint64_t slot) {
+          add(slot, windowHits.bytes.data() + slot * stride_);
+        });
+      } else {
+        for (size_t i = 0; i < windowHits.slots.size(); i++) {
+          add(windowHits.slots[i], windowHits.values.data() + i * valueSize_);
+        }
+      }
+      windowHits = WindowHits();
+    }
+    region.deltas.shrink_to_fit();
+    region.values.shrink_to_fit();
+  }
+
+  for (CandidateRegion& region : found) {
+    if (region.count > 0) {
+      regions_.push_back(std::move(region));
+    }
+  }
+  scanned_ = true;
+  passes_++;
+  report();
+  return true;
+}
+
+bool CandidateSet::NextScan(ProcessHandle& process, const ScanCriteria& criteria, std::string& error,
+                            const std::atomic<bool>* cancelled,
+                            const ScanProgressCallback& onProgress) {
+  error.clear();
+  if (!scanned_) {
+    error = "Run a first scan before refining";
+    return false;
+  }
+  if (criteria.mode == CompareMode::Unknown) {
+    error = "A refinement needs a comparison";
+    return false;
+  }
+
+  bool completed = false;
+  DispatchType(layout_.type, [&](auto tag) {
+    typedef typename decltype(tag)::type T;
+    completed = layout_.byteSwap
+      ? NextScanAs<T, true>(process, criteria, cancelled, onProgress)
+      : NextScanAs<T, false>(process, criteria, cancelled, onProgress);
+  });
+  return completed;
+}
+
+template <typename T, bool Swap>
+bool CandidateSet::NextScanAs(ProcessHandle& process, const ScanCriteria& criteria,
+                              const std::atomic<bool>* cancelled,
+                              const ScanProgressCallback& onProgress) {
+  Clock::time_point start = Clock::now();
+  ThreadPool& pool = ThreadPool::Shared();
+  Operands<T> operands = { criteria.value.As<T>(), criteria.value2.As<T>(), criteria.epsilon };
+  size_t wordsPerWindow = kWindowSize / stride_ / 64;
+  size_t overlap = valueSize_ - 1;
+  // Unaligned values can straddle two windows
+  bool straddles = stride_ < valueSize_;
+
+  ScanProgress progress;
+  std::vector<StreamSpan> spans;
+  std::vector<size_t> sparse;
+  // Dense bitmaps are refined and snapshots refreshed in place; keep the
+  // bitmaps and the snapshot bytes of every window read for a rollback
+  std::vector<std::vector<uint64_t>> savedBitmaps(regions_.size());
+  std::vector<std::vector<std::vector<uint8_t>>> savedWindows(regions_.size());
+  std::vector<std::vector<uint8_t>> boundaries(regions_.size());
+  for (size_t r = 0; r < regions_.size(); r++) {
+    CandidateRegion& region = regions_[r];
+    if (!region.dense) {
+      sparse.push_back(r);
+      progress.bytesTotal += region.count * valueSize_;
+      continue;
+    }
+    savedBitmaps[r] = region.bitmap;
+
+    size_t windows = static_cast<size_t>((region.size + kWindowSize - 1) / kWindowSize);
+    savedWindows[r].resize(windows);
+    if (straddles) {
+      std::vector<uint8_t>& boundary = boundaries[r];
+      boundary.resize(windows * overlap);
+      for (size_t w = 0; w + 1 < windows; w++) {
+        uint64_t next = static_cast<uint64_t>(w + 1) * kWindowSize;
+        size_t bytes = static_cast<size_t>(std::min<uint64_t>(overlap, region.size - next));
+        memcpy(boundary.data() + w * overlap, region.snapshot.data() + next, bytes);
+      }
+    }
+
+    // Only windows that still hold a candidate are read; runs of them
+    // become one span
+    for (size_t w = 0; w < windows; w++) {
+      size_t first = w * wordsPerWindow;
+      size_t last = std::min(first + wordsPerWindow, region.bitmap.size());
+      if (first >= last || std::none_of(region.bitmap.begin() + first, region.bitmap.begin() + last,
+                                        [](uint64_t word) { return word != 0; })) {
+        continue;
+      }
+      uint64_t address = region.base + static_cast<uint64_t>(w) * kWindowSize;
+      uint64_t size = std::min<uint64_t>(kWindowSize, region.base + region.size - address);
+      if (!spans.empty() && spans.back().tag == r &&
+          spans.back().address + spans.back().size == address) {
+        spans.back().size += size;
+      } else {
+        StreamSpan span;
+        span.address = address;
+        span.size = size;
+        span.tag = r;
+        spans.push_back(span);
+      }
+      progress.bytesTotal += size;
+    }
+  }
+
+  // Overlap is clamped to the span, so a run that stops before the region
+  // does must include the bytes its last values straddle into
+  if (straddles) {
+    for (StreamSpan& span : spans) {
+      const CandidateRegion& region = regions_[span.tag];
+      uint64_t regionEnd = region.base + region.size;
+      span.size += std::min<uint64_t>(overlap, regionEnd - (span.address + span.size));
+    }
+  }
+  progress.regionsTotal = sparse.size() + spans.size();
+
+  std::vector<std::atomic<uint64_t>> survivors(regions_.size());
+  std::atomic<uint64_t> matchesFound(0);
+  std::atomic<uint64_t> sparseBytes(0);
+  std::atomic<uint64_t> sparseDone(0);
+  std::atomic<bool> sparseCancelled(false);
+
+  struct SparseResult {
+    std::vector<uint8_t> deltas;
+    std::vector<uint8_t> values;
+    uint64_t count = 0;
+  };
+  std::vector<SparseResult> sparseResults(regions_.size());
+
+  // Sparse regions are refined by pool tasks while the dense windows
+  // stream alongside them
+  TaskGroup group(pool);
+  for (size_t r : sparse) {
+    group.Run([&, r]() {
+      if (cancelled && cancelled->load()) {
+        sparseCancelled = true;
+        return;
+      }
+      SparseResult& result = sparseResults[r];
+      bool completed = true;
+      DispatchMode(criteria.mode, [&](auto mode) {
+        completed = RefineSparseRegion<T, Swap, decltype(mode)::value>(
+          process, regions_[r], stride_, operands, result.deltas, result.values,
+          result.count, sparseBytes, matchesFound, cancelled);
+      });
+      if (!completed) {
+        sparseCancelled = true;
+      }
+      sparseDone++;
+    });
+  }
+
+  StreamOptions options;
+  options.windowSize = kWindowSize;
+  options.overlap = overlap;
+  StreamStats stats;
+
+  auto handler = [&](const StreamWindow& window) {
+    CandidateRegion& region = regions_[window.tag];
+    uint64_t windowOffset = window.address - region.base;
+    size_t windowIndex = static_cast<size_t>(windowOffset / kWindowSize);
+    size_t firstSlot = static_cast<size_t>(windowOffset / stride_);
+    if (firstSlot / 64 >= region.bitmap.size()) {
+      return;
+    }
+    // A window may be only the few overlap bytes appended to a run; it
+    // then covers just the words of its own slots (all clear)
+    size_t wordCount = std::min((window.size / stride_ + 63) / 64, region.bitmap.size() - firstSlot / 64);
+    const uint8_t* boundary = straddles && windowIndex * overlap < boundaries[window.tag].size()
+      ? boundaries[window.tag].data() + windowIndex * overlap : nullptr;
+
+    uint64_t kept = 0;
+    DispatchMode(criteria.mode, [&](auto mode) {
+      kept = RefineDenseWindow<T, Swap, decltype(mode)::value>(
+        window.data, window.available, windowOffset, window.size, region.bitmap.data() + firstSlot / 64,
+        wordCount, firstSlot, stride_, region.snapshot.data(), boundary, operands);
+    });
+    // The snapshot is the region as last read. Each window is handled
+    // once, so its saved bytes are its own.
+    size_t copied = std::min(window.size, window.available);
+    if (windowIndex < savedWindows[window.tag].size()) {
+      savedWindows[window.tag][windowIndex].assign(region.snapshot.data() + windowOffset,
+                                                   region.snapshot.data() + windowOffset + copied);
+    }
+    memcpy(region.snapshot.data() + windowOffset, window.data, copied);
+    survivors[window.tag] += kept;
+    matchesFound += kept;
+  };
+
+  auto report = [&]() {
+    if (!onProgress) {
+      return;
+    }
+    progress.regionsDone = sparseDone + stats.spansDone;
+    progress.bytesScanned = sparseBytes + stats.bytesDone;
+    progress.matches = matchesFound;
+    progress.elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    onProgress(progress);
+  };
+
+  bool streamed = StreamRegions(process, spans, options, handler, stats, cancelled, report);
+  while (!group.WaitFor(std::chrono::milliseconds(50))) {
+    report();
+  }
+
+  if (!streamed || sparseCancelled) {
+    // Leave the candidates and their previous values as they were
+    for (size_t r = 0; r < regions_.size(); r++) {
+      CandidateRegion& region = regions_[r];
+      if (!region.dense) {
+        continue;
+      }
+      region.bitmap.swap(savedBitmaps[r]);
+      for (size_t w = 0; w < savedWindows[r].size(); w++) {
+        const std::vector<uint8_t>& saved = savedWindows[r][w];
+        if (!saved.empty()) {
+          memcpy(region.snapshot.data() + static_cast<uint64_t>(w) * kWindowSize, saved.data(), saved.size());
+        }
+      }
+    }
+    return false;
+  }
+  RecordScanPass(regions_.size(), 0, sparseBytes + stats.bytesDone, Clock::now() - start);
+
+  std::vector<CandidateRegion> refined;
+  for (size_t r = 0; r < regions_.size(); r++) {
+    CandidateRegion& region = regions_[r];
+    if (region.dense) {
+      region.count = survivors[r];
+    } else {
+      region.count = sparseResults[r].count;
+      region.deltas.swap(sparseResults[r].deltas);
+      region.values.swap(sparseResults[r].values);
+    }
+    if (region.count == 0) {
+      continue;
+    }
+    Compact(region);
+    refined.push_back(std::move(region));
+  }
+  regions_.swap(refined);
+  passes_++;
+
+  report();
+  return true;
+}
+
+void CandidateSet::Compact(CandidateRegion& region) const {
+  if (!region.dense) {
+    return;
+  }
+  uint64_t denseCost = region.snapshot.size() + region.bitmap.size() * sizeof(uint64_t);
+  uint64_t sparseCost = region.count * (valueSize_ + 2);
+  if (sparseCost >= denseCost) {
+    return;
+  }
+
+  std::vector<uint8_t> deltas;
+  std::vector<uint8_t> values;
+  values.reserve(region.count * valueSize_);
+  SparseWriter writer(deltas, values, valueSize_);
+  ForEachSetBit(region.bitmap, [&](uint64_t slot) {
+    writer.Append(slot, region.snapshot.data() + slot * stride_);
+  });
+  deltas.shrink_to_fit();
+
+  region.dense = false;
+  region.deltas.swap(deltas);
+  region.values.swap(values);
+  std::vector<uint64_t>().swap(region.bitmap);
+  std::vector<uint8_t>().swap(region.snapshot);
+}
+
+uint64_t CandidateSet::Count() const {
+  uint64_t count = 0;
+  for (const CandidateRegion& region : regions_) {
+    count += region.count;
+  }
+  return count;
+}
+
+size_t CandidateSet::MemoryUsage() const {
+  size_t bytes = regions_.capacity() * sizeof(CandidateRegion);
+  for (const CandidateRegion& region : regions_) {
+    bytes += region.bitmap.capacity() * sizeof(uint64_t);
+    bytes += region.snapshot.capacity();
+    bytes += region.deltas.capacity();
+    bytes += region.values.capacity();
+  }
+  return bytes;
+}
+
+size_t CandidateSet::DenseRegionCount() const {
+  return std::count_if(regions_.begin(), regions_.end(),
+                       [](const CandidateRegion& region) { return region.dense; });
+}
+
+size_t CandidateSet::SparseRegionCount() const {
+  return regions_.size() - DenseRegionCount();
+}
+
+void CandidateSet::Get(uint64_t offset, size_t count, std::vector<uint64_t>& addresses,
+                       std::vector<uint8_t>& values) const {
+  addresses.clear();
+  values.clear();
+  for (const CandidateRegion& region : regions_) {
+    if (addresses.size() == count) {
+      return;
+    }
+    if (offset >= region.count) {
+      offset -= region.count;
+      continue;
+    }
+
+    auto add = [&](uint64_t slot, const uint8_t* value) {
+      if (offset > 0) {
+        offset--;
+        return;
+      }
+      if (addresses.size() < count) {
+        addresses.push_back(region.base + slot * stride_);
+        values.insert(values.end(), value, value + valueSize_);
+      }
+    };
+
+    if (region.dense) {
+      ForEachSetBit(region.bitmap, [&](uint64_t slot) {
+        add(slot, region.snapshot.data() + slot * stride_);
+      });
+    } else {
+      SparseReader reader(region, valueSize_);
+      uint64_t slot;
+      const uint8_t* value;
+      while (addresses.size() < count && reader.Next(slot, value)) {
+        add(slot, value);
+      }
+    }
+  }
+}
+
+void CandidateSet::ForEach(const std::function<void(uint64_t address, const uint8_t* value)>& visit) const {
+  for (const CandidateRegion& region : regions_) {
+    if (region.dense) {
+      ForEachSetBit(region.bitmap, [&](uint64_t slot) {
+        visit(region.base + slot * stride_, region.snapshot.data() + slot * stride_);
+      });
+    } else {
+      SparseReader reader(region, valueSize_);
+      uint64_t slot;
+      const uint8_t* value;
+      while (reader.Next(slot, value)) {
+        visit(region.base + slot * stride_, value);
+      }
+    }
+  }
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "platform.h"
+#include "scanner.h"
+
+// How a candidate's current value is tested. Unknown keeps everything and
+// only records values; Changed through DecreasedBy compare against the value
+// recorded by the previous pass and are only valid on refinement passes.
+enum class CompareMode : uint8_t {
+  Unknown,
+  Equal,
+  NotEqual,
+  Changed,
+  Unchanged,
+  Increased,
+  Decreased,
+  IncreasedBy,
+  DecreasedBy,
+  InRange,
+};
+
+// True for modes that need a previous value
+bool IsRelativeMode(CompareMode mode);
+
+enum class ValueType : uint8_t {
+  Int8,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Int64,
+  UInt64,
+  Float32,
+  Float64,
+};
+
+size_t ValueTypeSize(ValueType type);
+bool IsFloatType(ValueType type);
+
+// How values are laid out in target memory
+struct ValueLayout {
+  ValueType type = ValueType::UInt32;
+  // Consider every byte offset instead of multiples of the value size
+  bool unaligned = false;
+  // Values are stored with their bytes reversed (big-endian targets)
+  bool byteSwap = false;
+};
+
+// 8 bytes of raw storage for a scan operand, reinterpreted per value type
+struct ScanOperand {
+  uint64_t bits = 0;
+
+  template <typename T>
+  T As() const {
+    T value;
+    memcpy(&value, &bits, sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  static ScanOperand From(T value) {
+    ScanOperand operand;
+    memcpy(&operand.bits, &value, sizeof(T));
+    return operand;
+  }
+};
+
+struct ScanCriteria {
+  CompareMode mode = CompareMode::Equal;
+  // Equal/NotEqual operand, IncreasedBy/DecreasedBy delta, InRange minimum
+  ScanOperand value;
+  // InRange maximum
+  ScanOperand value2;
+  // Floating point tolerance of Equal, NotEqual, IncreasedBy and DecreasedBy
+  double epsilon = 0;
+};
+
+// Candidates of one target region. A slot is a byte offset that is a
+// multiple of the stride. While many survive they are a bitmap with one bit
+// per slot plus a copy of the region's bytes as last read; once sparse they
+// become LEB128-encoded slot deltas plus the packed last-read values.
+struct CandidateRegion {
+  uint64_t base = 0;
+  uint64_t size = 0;
+  uint64_t count = 0;
+  bool dense = false;
+
+  std::vector<uint64_t> bitmap;
+  std::vector<uint8_t> snapshot;
+
+  std::vector<uint8_t> deltas;
+  std::vector<uint8_t> values;
+};
+
+// A narrowing scan: one first pass over the target, then any number of
+// refinement passes that only re-read surviving candidates. Not thread
+// safe; callers serialize passes and reads.
+class CandidateSet {
+ public:
+  explicit CandidateSet(const ValueLayout& layout = ValueLayout());
+
+  const ValueLayout& Layout() const { return layout_; }
+
+  // Scans every readable region. Relative modes are rejected (returns
+  // false with `error` set). Returns false with an empty `error` when
+  // cancelled, leaving the set empty.
+  //
+  // An Unknown first scan keeps every slot, so it holds a copy of every
+  // readable byte until refinements thin it out: 8 MB for N64 RDRAM, but
+  // gigabytes for a whole emulator process. It fails with `error` set when
+  // the readable regions exceed kMaxUnknownSnapshotBytes.
+  bool FirstScan(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                 const ScanCriteria& criteria, std::string& error,
+                 const std::atomic<bool>* cancelled = nullptr,
+                 const ScanProgressCallback& onProgress = nullptr);
+
+  // Re-reads the surviving candidates in batches and keeps those that
+  // match. A cancelled pass leaves the previous candidates in place.
+  bool NextScan(ProcessHandle& process, const ScanCriteria& criteria, std::string& error,
+                const std::atomic<bool>* cancelled = nullptr,
+                const ScanProgressCallback& onProgress = nullptr);
+
+  bool HasScanned() const { return scanned_; }
+  // Completed passes; changes whenever the candidates do
+  uint64_t Passes() const { return passes_; }
+  uint64_t Count() const;
+  size_t ValueSize() const { return valueSize_; }
+
+  // Bytes held by candidate storage
+  size_t MemoryUsage() const;
+  size_t DenseRegionCount() const;
+  size_t SparseRegionCount() const;
+
+  // Copies up to `count` candidates starting at the `offset`-th one, in
+  // address order, with their last-read values packed into `values`
+  void Get(uint64_t offset, size_t count, std::vector<uint64_t>& addresses,
+           std::vector<uint8_t>& values) const;
+
+  // Visits every candidate in address order with its last-read value
+  void ForEach(const std::function<void(uint64_t address, const uint8_t* value)>& visit) const;
+
+  static const uint64_t kMaxUnknownSnapshotBytes = static_cast<uint64_t>(256) << 20;
+
+ private:
+  template <typename T, bool Swap>
+  bool FirstScanAs(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                   const ScanCriteria& criteria, const std::atomic<bool>* cancelled,
+                   const ScanProgressCallback& onProgress);
+
+  template <typename T, bool Swap>
+  bool NextScanAs(ProcessHandle& process, const ScanCriteria& criteria,
+                  const std::atomic<bool>* cancelled, const ScanProgressCallback& onProgress);
+
+  // Picks the cheaper representation for a region after a pass
+  void Compact(CandidateRegion& region) const;
+
+  std::vector<CandidateRegion> regions_;
+  ValueLayout layout_;
+  size_t valueSize_;
+  size_t stride_;
+  bool scanned_ = false;
+  uint64_t passes_ = 0;
+};
@@ -0,0 +1,122 @@
+#include "diagnostics.h"
+#include <string>
+#include "log.h"
+#include "metrics.h"
+
+namespace {
+
+// Upper bound of the bucket holding the given fraction of samples
+uint64_t Percentile(const HistogramSnapshot& histogram, double fraction) {
+  if (histogram.count == 0) {
+    return 0;
+  }
+  uint64_t target = static_cast<uint64_t>(histogram.count * fraction);
+  uint64_t seen = 0;
+  for (size_t b = 0; b < kHistogramBuckets; b++) {
+    seen += histogram.buckets[b];
+    if (seen > target) {
+      return b == 0 ? 1 : uint64_t(1) << b;
+    }
+  }
+  return uint64_t(1) << (kHistogramBuckets - 1);
+}
+
+Napi::Object HistogramToObject(Napi::Env env, const HistogramSnapshot& histogram) {
+  Napi::Array buckets = Napi::Array::New(env, kHistogramBuckets);
+  for (size_t b = 0; b < kHistogramBuckets; b++) {
+    buckets[b] = Napi::Number::New(env, histogram.buckets[b]);
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("buckets", buckets);
+  result.Set("count", Napi::Number::New(env, histogram.count));
+  result.Set("sum", Napi::Number::New(env, histogram.sum));
+  result.Set("p50", Napi::Number::New(env, Percentile(histogram, 0.5)));
+  result.Set("p99", Napi::Number::New(env, Percentile(histogram, 0.99)));
+  return result;
+}
+
+Napi::Object ErrorsToObject(Napi::Env env, const std::vector<std::pair<int, uint64_t>>& errors) {
+  Napi::Object result = Napi::Object::New(env);
+  for (const auto& entry : errors) {
+    result.Set(std::to_string(entry.first), Napi::Number::New(env, entry.second));
+  }
+  return result;
+}
+
+}  // namespace
+
+// getStats() - counters, scanGBps, failures by error code and latency
+// histograms (log2 buckets with approximate p50/p99)
+Napi::Value GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  MetricsSnapshot snapshot;
+  SnapshotMetrics(snapshot);
+
+  Napi::Object result = Napi::Object::New(env);
+  for (size_t i = 0; i < static_cast<size_t>(Metric::kCount); i++) {
+    result.Set(MetricName(static_cast<Metric>(i)), Napi::Number::New(env, snapshot.values[i]));
+  }
+  uint64_t scanNanoseconds = snapshot.values[static_cast<size_t>(Metric::ScanNanoseconds)];
+  uint64_t bytesScanned = snapshot.values[static_cast<size_t>(Metric::BytesScanned)];
+  // Bytes per nanosecond is GB/s
+  result.Set("scanGBps", Napi::Number::New(env, scanNanoseconds ? double(bytesScanned) / scanNanoseconds : 0));
+  result.Set("readErrors", ErrorsToObject(env, snapshot.readErrors));
+  result.Set("writeErrors", ErrorsToObject(env, snapshot.writeErrors));
+
+  Napi::Object histograms = Napi::Object::New(env);
+  for (size_t h = 0; h < static_cast<size_t>(MetricHistogram::kCount); h++) {
+    histograms.Set(HistogramName(static_cast<MetricHistogram>(h)), HistogramToObject(env, snapshot.histograms[h]));
+  }
+  result.Set("histograms", histograms);
+
+  Napi::Object log = Napi::Object::New(env);
+  log.Set("level", Napi::String::New(env, LogLevelName(GetLogLevel())));
+  log.Set("dropped", Napi::Number::New(env, LogDropped()));
+  result.Set("log", log);
+  return result;
+}
+
+Napi::Value ResetStats(const Napi::CallbackInfo& info) {
+  ResetMetrics();
+  return info.Env().Undefined();
+}
+
+// drainLog(max = 1000) - the oldest buffered records as
+// [{ time, level, message }]
+Napi::Value DrainLogRecords(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  size_t max = info.Length() > 0 && info[0].IsNumber() ? info[0].As<Napi::Number>().Uint32Value() : 1000;
+  std::vector<LogRecord> records;
+  DrainLog(records, max);
+
+  Napi::Array result = Napi::Array::New(env, records.size());
+  for (size_t i = 0; i < records.size(); i++) {
+    Napi::Object entry = Napi::Object::New(env);
+    entry.Set("time", Napi::Number::New(env, static_cast<double>(records[i].time)));
+    entry.Set("level", Napi::String::New(env, LogLevelName(records[i].level)));
+    entry.Set("message", Napi::String::New(env, records[i].message));
+    result[i] = entry;
+  }
+  return result;
+}
+
+// setLogLevel('trace'|'debug'|'info'|'warn'|'error'|'off'). Levels below
+// the build's SF_LOG_MIN_LEVEL stay silent whatever is set here.
+Napi::Value SetLogLevelFromJs(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  LogLevel level;
+  if (info.Length() < 1 || !info[0].IsString() || !ParseLogLevel(info[0].As<Napi::String>().Utf8Value(), level)) {
+    Napi::TypeError::New(env, "setLogLevel requires a level: trace, debug, info, warn, error or off").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  SetLogLevel(level);
+  return env.Undefined();
+}
+
+Napi::Object RegisterDiagnosticsFunctions(Napi::Env env, Napi::Object exports) {
+  exports.Set("getStats", Napi::Function::New(env, GetStats));
+  exports.Set("resetStats", Napi::Function::New(env, ResetStats));
+  exports.Set("drainLog", Napi::Function::New(env, DrainLogRecords));
+  exports.Set("setLogLevel", Napi::Function::New(env, SetLogLevelFromJs));
+  return exports;
+}
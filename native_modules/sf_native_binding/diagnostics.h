@@ -0,0 +1,5 @@
+#pragma once
+#include <napi.h>
+
+// Function to register getStats, resetStats, drainLog and setLogLevel
+Napi::Object RegisterDiagnosticsFunctions(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,209 @@
+#include "freeze_engine.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Entries due within this much of each other share one batch
+const std::chrono::microseconds kBatchSlack(1000);
+
+}  // namespace
+
+FreezeEngine::FreezeEngine(std::shared_ptr<ProcessHandle> process)
+  : process_(std::move(process)),
+    windowStart_(Clock::now()) {
+  thread_ = std::thread(&FreezeEngine::Run, this);
+}
+
+FreezeEngine::~FreezeEngine() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+uint32_t FreezeEngine::Add(uint64_t address, std::vector<uint8_t> bytes, const FreezeOptions& options) {
+  Entry entry;
+  entry.address = address;
+  entry.bytes = std::move(bytes);
+  entry.interval = std::max(options.interval, std::chrono::microseconds(1000));
+  entry.onChange = options.onChange;
+  entry.next = Clock::now();
+
+  uint32_t id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    id = entry.id = nextId_++;
+    stats_.exited = false;
+    entries_.push_back(std::move(entry));
+  }
+  wake_.notify_one();
+  return id;
+}
+
+bool FreezeEngine::Remove(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(entries_.begin(), entries_.end(), [id](const Entry& entry) { return entry.id == id; });
+  if (it == entries_.end()) {
+    return false;
+  }
+  entries_.erase(it);
+  return true;
+}
+
+void FreezeEngine::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+
+FreezeStats FreezeEngine::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FreezeStats stats = stats_;
+  stats.entries = entries_.size();
+  if (entries_.empty()) {
+    stats.writesPerSecond = 0;
+  }
+  return stats;
+}
+
+void FreezeEngine::Run() {
+  bool highResolution = false;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (entries_.empty()) {
+      // Only hold the raised timer resolution while something is frozen
+      if (highResolution) {
+        EndHighResolutionTimer();
+        highResolution = false;
+      }
+      wake_.wait(lock);
+      continue;
+    }
+    if (!highResolution) {
+      BeginHighResolutionTimer();
+      highResolution = true;
+    }
+
+    Clock::time_point next = entries_.front().next;
+    for (const Entry& entry : entries_) {
+      next = std::min(next, entry.next);
+    }
+    Clock::time_point now = Clock::now();
+    if (next > now + kBatchSlack) {
+      // Woken early by Add/Remove/shutdown as well; the loop re-evaluates
+      wake_.wait_until(lock, next);
+      continue;
+    }
+
+    uint64_t failed = stats_.failed;
+    WriteDue(lock, now);
+    if (now - windowStart_ >= std::chrono::seconds(1)) {
+      std::chrono::duration<double> elapsed = now - windowStart_;
+      stats_.writesPerSecond = windowWrites_ / elapsed.count();
+      windowWrites_ = 0;
+      windowStart_ = now;
+    }
+    if (stats_.failed != failed) {
+      lock.unlock();
+      bool alive = process_->IsAlive();
+      lock.lock();
+      if (!alive) {
+        stats_.exited = true;
+        entries_.clear();
+      }
+    }
+  }
+  if (highResolution) {
+    EndHighResolutionTimer();
+  }
+}
+
+void FreezeEngine::WriteDue(std::unique_lock<std::mutex>& lock, Clock::time_point now) {
+  // Copy out the due values and advance their schedules while locked
+  size_t dueCount = 0;
+  for (Entry& entry : entries_) {
+    if (entry.next > now + kBatchSlack) {
+      continue;
+    }
+    if (dueCount == due_.size()) {
+      due_.emplace_back();
+    }
+    DueWrite& due = due_[dueCount++];
+    due.address = entry.address;
+    due.bytes.assign(entry.bytes.begin(), entry.bytes.end());
+    due.onChange = entry.onChange;
+
+    if (now > entry.next) {
+      stats_.maxLateness = std::max(stats_.maxLateness,
+                                    std::chrono::duration_cast<std::chrono::microseconds>(now - entry.next));
+    }
+    entry.next += entry.interval;
+    if (entry.next <= now) {
+      // Drop the periods we slept through instead of bursting to catch up
+      stats_.missed += (now - entry.next) / entry.interval + 1;
+      entry.next = now + entry.interval;
+    }
+  }
+  if (dueCount == 0) {
+    return;
+  }
+  lock.unlock();
+
+  // On-change entries read back first and are only written when the
+  // target moved the value
+  std::vector<MemoryRange> reads;
+  for (size_t i = 0; i < dueCount; i++) {
+    DueWrite& due = due_[i];
+    if (due.onChange) {
+      due.current.resize(due.bytes.size());
+      MemoryRange range;
+      range.address = due.address;
+      range.buffer = due.current.data();
+      range.size = due.current.size();
+      reads.push_back(range);
+    }
+  }
+  if (!reads.empty()) {
+    process_->ReadMany(reads.data(), reads.size());
+  }
+
+  std::vector<MemoryRange> writes;
+  uint64_t skipped = 0;
+  size_t read = 0;
+  for (size_t i = 0; i < dueCount; i++) {
+    DueWrite& due = due_[i];
+    if (due.onChange) {
+      const MemoryRange& range = reads[read++];
+      if (range.transferred == range.size && memcmp(range.buffer, due.bytes.data(), range.size) == 0) {
+        skipped++;
+        continue;
+      }
+    }
+    MemoryRange range;
+    range.address = due.address;
+    range.buffer = due.bytes.data();
+    range.size = due.bytes.size();
+    writes.push_back(range);
+  }
+  if (!writes.empty()) {
+    process_->WriteMany(writes.data(), writes.size());
+  }
+
+  lock.lock();
+  stats_.skipped += skipped;
+  if (writes.empty()) {
+    return;
+  }
+  stats_.batches++;
+  for (const MemoryRange& range : writes) {
+    if (range.transferred == range.size) {
+      stats_.writes++;
+      stats_.bytes += range.size;
+      windowWrites_++;
+    } else {
+      stats_.failed++;
+    }
+  }
+}
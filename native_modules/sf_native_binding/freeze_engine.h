@@ -0,0 +1,97 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "platform.h"
+
+struct FreezeOptions {
+  // Time between rewrites
+  std::chrono::microseconds interval{16667};
+  // Read the value every interval and only write it back when the target
+  // changed it
+  bool onChange = false;
+};
+
+struct FreezeStats {
+  size_t entries = 0;
+  uint64_t writes = 0;
+  uint64_t bytes = 0;
+  // WriteMany calls; each covers every entry due at that moment
+  uint64_t batches = 0;
+  // On-change checks that found the value still in place
+  uint64_t skipped = 0;
+  // Rewrites that came a whole interval late and were dropped
+  uint64_t missed = 0;
+  uint64_t failed = 0;
+  std::chrono::microseconds maxLateness{0};
+  // Writes during the last full second
+  double writesPerSecond = 0;
+  // The target exited; the engine dropped its entries and stopped
+  bool exited = false;
+};
+
+// Holds values in place by rewriting them from a dedicated thread. Entries
+// that fall due together go out as one WriteMany on the shared handle, so
+// a frame-rate freeze costs one syscall per frame on Linux and no work on
+// the JS thread. Entries can be added and removed from any thread.
+class FreezeEngine {
+ public:
+  explicit FreezeEngine(std::shared_ptr<ProcessHandle> process);
+  ~FreezeEngine();
+
+  FreezeEngine(const FreezeEngine&) = delete;
+  FreezeEngine& operator=(const FreezeEngine&) = delete;
+
+  // Returns the new entry's id; the first write happens immediately
+  uint32_t Add(uint64_t address, std::vector<uint8_t> bytes, const FreezeOptions& options);
+  bool Remove(uint32_t id);
+  void Clear();
+
+  FreezeStats Stats();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Entry {
+    uint32_t id = 0;
+    uint64_t address = 0;
+    std::vector<uint8_t> bytes;
+    // Last value read back, for on-change entries
+    std::vector<uint8_t> current;
+    std::chrono::microseconds interval{0};
+    bool onChange = false;
+    Clock::time_point next;
+  };
+
+  // A due entry's value, copied so the target I/O can run unlocked
+  struct DueWrite {
+    uint64_t address = 0;
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> current;
+    bool onChange = false;
+  };
+
+  void Run();
+  // Rewrites every entry due by `now`. Called with `lock` held on mutex_;
+  // releases it around the reads and writes so Add, Remove and Stats never
+  // wait on the target.
+  void WriteDue(std::unique_lock<std::mutex>& lock, Clock::time_point now);
+
+  std::shared_ptr<ProcessHandle> process_;
+  std::vector<Entry> entries_;
+  uint32_t nextId_ = 1;
+  FreezeStats stats_;
+  // Only touched by the freeze thread; reused between batches
+  std::vector<DueWrite> due_;
+  uint64_t windowWrites_ = 0;
+  Clock::time_point windowStart_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
@@ -0,0 +1,129 @@
+#include "log.h"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+
+namespace {
+
+const size_t kSlotCount = 1024;
+const size_t kMessageSize = 200;
+
+// One ring slot. `sequence` tells producers and the consumer whose turn
+// the slot is: equal to the claim position when free, one past it once
+// written (a bounded MPMC queue in the style of Vyukov's).
+struct Slot {
+  std::atomic<uint64_t> sequence{0};
+  int64_t time = 0;
+  LogLevel level = LogLevel::Info;
+  char message[kMessageSize];
+};
+
+struct Ring {
+  Ring() {
+    for (size_t i = 0; i < kSlotCount; i++) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  Slot slots[kSlotCount];
+  alignas(64) std::atomic<uint64_t> head{0};
+  alignas(64) uint64_t tail = 0;
+  std::mutex consumer;
+  std::atomic<uint64_t> dropped{0};
+};
+
+Ring& GetRing() {
+  static Ring ring;
+  return ring;
+}
+
+std::atomic<uint8_t> threshold{static_cast<uint8_t>(LogLevel::Info)};
+
+const char* const kLevelNames[] = {"trace", "debug", "info", "warn", "error", "off"};
+
+}  // namespace
+
+bool LogEnabled(LogLevel level) {
+  return static_cast<uint8_t>(level) >= threshold.load(std::memory_order_relaxed);
+}
+
+void SetLogLevel(LogLevel level) {
+  threshold.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+LogLevel GetLogLevel() {
+  return static_cast<LogLevel>(threshold.load(std::memory_order_relaxed));
+}
+
+const char* LogLevelName(LogLevel level) {
+  return kLevelNames[static_cast<size_t>(level)];
+}
+
+bool ParseLogLevel(const std::string& name, LogLevel& level) {
+  for (size_t i = 0; i <= static_cast<size_t>(LogLevel::Off); i++) {
+    if (name == kLevelNames[i]) {
+      level = static_cast<LogLevel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void LogWrite(LogLevel level, const char* format, ...) {
+  Ring& ring = GetRing();
+  uint64_t position = ring.head.load(std::memory_order_relaxed);
+  Slot* slot;
+  for (;;) {
+    slot = &ring.slots[position % kSlotCount];
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(sequence - position);
+    if (diff == 0) {
+      if (ring.head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The consumer has not freed this slot yet: the ring is full
+      ring.dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      position = ring.head.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->time = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  slot->level = level;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(slot->message, kMessageSize, format, args);
+  va_end(args);
+  slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+size_t DrainLog(std::vector<LogRecord>& records, size_t max) {
+  Ring& ring = GetRing();
+  std::lock_guard<std::mutex> lock(ring.consumer);
+  size_t drained = 0;
+  while (drained < max) {
+    Slot& slot = ring.slots[ring.tail % kSlotCount];
+    if (slot.sequence.load(std::memory_order_acquire) != ring.tail + 1) {
+      // Empty, or the next record is still being written
+      break;
+    }
+    LogRecord record;
+    record.time = slot.time;
+    record.level = slot.level;
+    record.message = slot.message;
+    records.push_back(std::move(record));
+    slot.sequence.store(ring.tail + kSlotCount, std::memory_order_release);
+    ring.tail++;
+    drained++;
+  }
+  return drained;
+}
+
+uint64_t LogDropped() {
+  return GetRing().dropped.load(std::memory_order_relaxed);
+}
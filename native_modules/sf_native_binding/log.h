@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class LogLevel : uint8_t {
+  Trace,
+  Debug,
+  Info,
+  Warn,
+  Error,
+  Off,
+};
+
+// Levels below this are compiled out entirely; build with
+// -DSF_LOG_MIN_LEVEL=2 to drop Trace and Debug from a release addon
+#ifndef SF_LOG_MIN_LEVEL
+#define SF_LOG_MIN_LEVEL 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SF_PRINTF_FORMAT(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+#define SF_PRINTF_FORMAT(formatIndex, firstArg)
+#endif
+
+// Runtime threshold, Info by default
+bool LogEnabled(LogLevel level);
+void SetLogLevel(LogLevel level);
+LogLevel GetLogLevel();
+
+const char* LogLevelName(LogLevel level);
+bool ParseLogLevel(const std::string& name, LogLevel& level);
+
+// Formats into the next free slot of a fixed ring; never blocks and never
+// allocates. When the ring is full the record is dropped and counted.
+// Messages are truncated to about 200 bytes.
+void LogWrite(LogLevel level, const char* format, ...) SF_PRINTF_FORMAT(2, 3);
+
+struct LogRecord {
+  // Milliseconds since the Unix epoch
+  int64_t time = 0;
+  LogLevel level = LogLevel::Info;
+  std::string message;
+};
+
+// Moves up to `max` of the oldest records out of the ring. One consumer at
+// a time.
+size_t DrainLog(std::vector<LogRecord>& records, size_t max);
+
+// Records lost to a full ring since startup
+uint64_t LogDropped();
+
+// SF_LOG(Info, "read %zu bytes", size). The level check is a constant below
+// SF_LOG_MIN_LEVEL, so stripped calls cost nothing, arguments included.
+#define SF_LOG(level, ...)                                                     \
+  do {                                                                         \
+    if (static_cast<int>(LogLevel::level) >= SF_LOG_MIN_LEVEL &&               \
+        LogEnabled(LogLevel::level)) {                                         \
+      LogWrite(LogLevel::level, __VA_ARGS__);                                  \
+    }                                                                          \
+  } while (0)
@@ -1,10 +1,18 @@
 #include <napi.h>
 #include "processes.h"
+#include "async_scan.h"
+#include "diagnostics.h"
 #include "memory.h"
+#include "session.h"
+#include "structs.h"
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports = RegisterProcessFunctions(env, exports);
   exports = RegisterMemoryFunctions(env, exports);
+  exports = RegisterSessionFunctions(env, exports);
+  exports = RegisterStructFunctions(env, exports);
+  exports = RegisterAsyncScanFunctions(env, exports);
+  exports = RegisterDiagnosticsFunctions(env, exports);
   return exports;
 }
 
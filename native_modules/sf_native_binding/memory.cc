@@ -1,35 +1,11 @@
 #include "memory.h"
-#include <tlhelp32.h>
-#include <psapi.h>
-#include <iostream>
+#include "batch_read.h"
+#include "log.h"
+#include "platform.h"
+#include "scanner.h"
+#include <algorithm>
+#include <cstring>
 #include <sstream>
-#include <iomanip>
-
-// Helper function to get the last error message
-std::string GetLastErrorAsString() {
-  DWORD error = GetLastError();
-  if (error == 0) {
-    return "No error";
-  }
-  
-  LPSTR messageBuffer = nullptr;
-  size_t size = FormatMessageA(
-    FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-    NULL,
-    error,
-    MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-    (LPSTR)&messageBuffer,
-    0,
-    NULL
-  );
-  
-  std::string message(messageBuffer, size);
-  LocalFree(messageBuffer);
-  
-  std::stringstream ss;
-  ss << "Error " << error << ": " << message;
-  return ss.str();
-}
 
 // Helper to print address in hex
 std::string AddressToHexString(uint64_t address) {
@@ -38,6 +14,118 @@ std::string AddressToHexString(uint64_t address) {
   return ss.str();
 }
 
+namespace {
+
+const struct {
+  const char* name;
+  ValueType type;
+} kValueTypes[] = {
+  { "int8", ValueType::Int8 },
+  { "uint8", ValueType::UInt8 },
+  { "int16", ValueType::Int16 },
+  { "uint16", ValueType::UInt16 },
+  { "int32", ValueType::Int32 },
+  { "uint32", ValueType::UInt32 },
+  { "int64", ValueType::Int64 },
+  { "uint64", ValueType::UInt64 },
+  { "float32", ValueType::Float32 },
+  { "float64", ValueType::Float64 },
+};
+
+}  // namespace
+
+bool ParseValueType(const std::string& name, ValueType& type) {
+  for (const auto& entry : kValueTypes) {
+    if (name == entry.name) {
+      type = entry.type;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* ValueTypeName(ValueType type) {
+  for (const auto& entry : kValueTypes) {
+    if (type == entry.type) {
+      return entry.name;
+    }
+  }
+  return "";
+}
+
+bool ToOperand(const Napi::Value& value, ValueType type, ScanOperand& operand) {
+  if (!value.IsNumber() && !value.IsBigInt()) {
+    return false;
+  }
+  bool lossless = false;
+  int64_t integer = value.IsBigInt()
+    ? value.As<Napi::BigInt>().Int64Value(&lossless)
+    : value.As<Napi::Number>().Int64Value();
+  double real = value.IsBigInt() ? static_cast<double>(integer) : value.As<Napi::Number>().DoubleValue();
+
+  switch (type) {
+    case ValueType::Int8: operand = ScanOperand::From(static_cast<int8_t>(integer)); break;
+    case ValueType::UInt8: operand = ScanOperand::From(static_cast<uint8_t>(integer)); break;
+    case ValueType::Int16: operand = ScanOperand::From(static_cast<int16_t>(integer)); break;
+    case ValueType::UInt16: operand = ScanOperand::From(static_cast<uint16_t>(integer)); break;
+    case ValueType::Int32: operand = ScanOperand::From(static_cast<int32_t>(integer)); break;
+    case ValueType::UInt32: operand = ScanOperand::From(static_cast<uint32_t>(integer)); break;
+    case ValueType::Int64: operand = ScanOperand::From(integer); break;
+    case ValueType::UInt64:
+      operand = ScanOperand::From(value.IsBigInt()
+        ? value.As<Napi::BigInt>().Uint64Value(&lossless)
+        : static_cast<uint64_t>(integer));
+      break;
+    case ValueType::Float32: operand = ScanOperand::From(static_cast<float>(real)); break;
+    case ValueType::Float64: operand = ScanOperand::From(real); break;
+  }
+  return true;
+}
+
+
+Napi::Value OperandToJs(Napi::Env env, uint64_t bits, ValueType type) {
+  ScanOperand value;
+  value.bits = bits;
+  switch (type) {
+    case ValueType::Int8: return Napi::Number::New(env, value.As<int8_t>());
+    case ValueType::UInt8: return Napi::Number::New(env, value.As<uint8_t>());
+    case ValueType::Int16: return Napi::Number::New(env, value.As<int16_t>());
+    case ValueType::UInt16: return Napi::Number::New(env, value.As<uint16_t>());
+    case ValueType::Int32: return Napi::Number::New(env, value.As<int32_t>());
+    case ValueType::UInt32: return Napi::Number::New(env, value.As<uint32_t>());
+    case ValueType::Int64: return Napi::BigInt::New(env, value.As<int64_t>());
+    case ValueType::UInt64: return Napi::BigInt::New(env, value.As<uint64_t>());
+    case ValueType::Float32: return Napi::Number::New(env, value.As<float>());
+    case ValueType::Float64: return Napi::Number::New(env, value.As<double>());
+  }
+  return env.Undefined();
+}
+
+Napi::Float64Array AddressesToJs(Napi::Env env, const std::vector<uint64_t>& addresses) {
+  Napi::Float64Array result = Napi::Float64Array::New(env, addresses.size());
+  double* out = result.Data();
+  for (size_t i = 0; i < addresses.size(); i++) {
+    out[i] = static_cast<double>(addresses[i]);
+  }
+  return result;
+}
+
+bool GetTargetBytes(const Napi::Value& value, uint8_t*& data, size_t& length) {
+  if (value.IsTypedArray()) {
+    Napi::TypedArray typed = value.As<Napi::TypedArray>();
+    data = static_cast<uint8_t*>(typed.ArrayBuffer().Data()) + typed.ByteOffset();
+    length = typed.ByteLength();
+    return true;
+  }
+  if (value.IsArrayBuffer()) {
+    Napi::ArrayBuffer buffer = value.As<Napi::ArrayBuffer>();
+    data = static_cast<uint8_t*>(buffer.Data());
+    length = buffer.ByteLength();
+    return true;
+  }
+  return false;
+}
+
 // Memory reading function
 Napi::Value Read(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
@@ -48,105 +136,50 @@ Napi::Value Read(const Napi::CallbackInfo& info) {
       return env.Null();
     }
     
-    DWORD pid = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t pid = info[0].As<Napi::Number>().Uint32Value();
     uint64_t addressValue = info[1].As<Napi::Number>().Int64Value();
-    LPVOID address = (LPVOID)addressValue;
-    SIZE_T size = info[2].As<Napi::Number>().Uint32Value();
+    size_t size = info[2].As<Napi::Number>().Uint32Value();
     
-    std::cout << "Reading memory: PID=" << pid 
-              << ", Address=" << AddressToHexString(addressValue)
-              << ", Size=" << size << std::endl;
+    SF_LOG(Debug, "Reading memory: PID=%u, Address=%s, Size=%zu", pid,
+           AddressToHexString(addressValue).c_str(), size);
     
-    HANDLE hProcess = OpenProcess(PROCESS_VM_READ, FALSE, pid);
-    if (hProcess == NULL) {
+    std::unique_ptr<ProcessHandle> process = OpenProcessHandle(pid, kAccessRead);
+    if (!process) {
       std::string errorMsg = "Failed to open process: " + GetLastErrorAsString();
-      std::cerr << errorMsg << std::endl;
+      SF_LOG(Warn, "%s", errorMsg.c_str());
       Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
       return env.Null();
     }
     
-    uint8_t* buffer = nullptr;
-    try {
-      buffer = new uint8_t[size];
-      std::cout << "Allocated buffer at " << buffer << " of size " << size << std::endl;
-    } catch (const std::exception& e) {
-      CloseHandle(hProcess);
-      std::string errorMsg = "Failed to allocate buffer: ";
-      errorMsg += e.what();
-      std::cerr << errorMsg << std::endl;
-      Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
-      return env.Null();
-    }
+    // Read straight into the Buffer's own storage. Electron's V8 memory
+    // cage rejects Buffers over external memory, so this is the only copy.
+    Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, size);
+    size_t bytesRead = process->Read(addressValue, buffer.Data(), size);
     
-    std::cout << "Attempting ReadProcessMemory..." << std::endl;
-    SIZE_T bytesRead = 0;
-    BOOL success = ReadProcessMemory(hProcess, address, buffer, size, &bytesRead);
-    DWORD lastError = GetLastError();
-    
-    CloseHandle(hProcess);
-    
-    if (!success) {
+    if (bytesRead != size) {
       std::string errorMsg = "Failed to read memory: " + GetLastErrorAsString() +
                             " (PID=" + std::to_string(pid) + 
                             ", Address=" + AddressToHexString(addressValue) + 
                             ", Size=" + std::to_string(size) + ")";
-      std::cerr << errorMsg << std::endl;
-      delete[] buffer;
+      SF_LOG(Warn, "%s", errorMsg.c_str());
       Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
       return env.Null();
     }
     
-    std::cout << "Successfully read " << bytesRead << " bytes from " 
-              << AddressToHexString(addressValue) << std::endl;
-    
-    // Create a safe fixed-size buffer for the return value
-    try {
-      // First create a temporary array to copy the data
-      uint8_t* safeBuffer = new uint8_t[bytesRead];
-      memcpy(safeBuffer, buffer, bytesRead);
-      delete[] buffer; // Free the original buffer
-      
-      std::cout << "Creating Napi::Buffer with " << bytesRead << " bytes" << std::endl;
-      
-      // Use a safer approach to create a buffer
-      Napi::Buffer<uint8_t> resultBuffer;
-      
-      // The finalizer will delete the buffer when Node.js garbage collects it
-      auto finalizer = [](Napi::Env, uint8_t* data) {
-        std::cout << "Finalizer called, deleting buffer at " << (void*)data << std::endl;
-        delete[] data;
-      };
-      
-      // Create the buffer with explicit size
-      resultBuffer = Napi::Buffer<uint8_t>::New(
-        env, 
-        safeBuffer,  // Data pointer 
-        bytesRead,   // Explicit size
-        finalizer    // Cleanup callback
-      );
-      
-      std::cout << "Successfully created buffer object to return to Node.js" << std::endl;
-      return resultBuffer;
-    }
-    catch (const std::exception& e) {
-      delete[] buffer; // Make sure to free the buffer on error
-      std::string errorMsg = "Failed to create return buffer: ";
-      errorMsg += e.what();
-      std::cerr << errorMsg << std::endl;
-      Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
-      return env.Null();
-    }
+    SF_LOG(Debug, "Successfully read %zu bytes from %s", bytesRead,
+           AddressToHexString(addressValue).c_str());
+    return buffer;
   }
   catch (const std::exception& e) {
     std::string errorMsg = "Exception in Read: ";
     errorMsg += e.what();
-    std::cerr << errorMsg << std::endl;
+    SF_LOG(Error, "%s", errorMsg.c_str());
     Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
     return env.Null();
   }
   catch (...) {
     std::string errorMsg = "Unknown exception in Read";
-    std::cerr << errorMsg << std::endl;
+    SF_LOG(Error, "%s", errorMsg.c_str());
     Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
     return env.Null();
   }
@@ -162,101 +195,85 @@ Napi::Value ReadAsArray(const Napi::CallbackInfo& info) {
       return env.Null();
     }
     
-    DWORD pid = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t pid = info[0].As<Napi::Number>().Uint32Value();
     uint64_t addressValue = info[1].As<Napi::Number>().Int64Value();
-    LPVOID address = (LPVOID)addressValue;
-    SIZE_T size = info[2].As<Napi::Number>().Uint32Value();
+    size_t size = info[2].As<Napi::Number>().Uint32Value();
     
-    if (size > 1024) {
-      Napi::Error::New(env, "Size too large, maximum is 1024 bytes").ThrowAsJavaScriptException();
-      return env.Null();
-    }
+    SF_LOG(Debug, "Reading memory as array: PID=%u, Address=%s, Size=%zu", pid,
+           AddressToHexString(addressValue).c_str(), size);
     
-    std::cout << "Reading memory as array: PID=" << pid 
-              << ", Address=" << AddressToHexString(addressValue)
-              << ", Size=" << size << std::endl;
-    
-    HANDLE hProcess = OpenProcess(PROCESS_VM_READ, FALSE, pid);
-    if (hProcess == NULL) {
+    std::unique_ptr<ProcessHandle> process = OpenProcessHandle(pid, kAccessRead);
+    if (!process) {
       std::string errorMsg = "Failed to open process: " + GetLastErrorAsString();
-      std::cerr << errorMsg << std::endl;
+      SF_LOG(Warn, "%s", errorMsg.c_str());
       Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
       return env.Null();
     }
     
-    // Use a fixed buffer on the stack
-    uint8_t buffer[1024] = {0};
-    SIZE_T bytesRead = 0;
-    
-    BOOL success = ReadProcessMemory(hProcess, address, buffer, size, &bytesRead);
-    CloseHandle(hProcess);
+    // Read straight into the returned Uint8Array
+    Napi::Uint8Array result = Napi::Uint8Array::New(env, size);
+    uint8_t* buffer = result.Data();
+    size_t bytesRead = process->Read(addressValue, buffer, size);
     
-    if (!success) {
+    if (bytesRead != size) {
       std::string errorMsg = "Failed to read memory: " + GetLastErrorAsString();
-      std::cerr << errorMsg << std::endl;
+      SF_LOG(Warn, "%s", errorMsg.c_str());
       Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
       return env.Null();
     }
     
-    // Display the data as different types if enough bytes were read
-    std::cout << "Successfully read " << bytesRead << " bytes" << std::endl;
-    
-    // Display raw bytes
-    std::cout << "Raw bytes: ";
-    for (size_t i = 0; i < bytesRead && i < 16; i++) {
-      std::cout << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(buffer[i]) << " ";
-    }
-    if (bytesRead > 16) std::cout << "...";
-    std::cout << std::dec << std::endl;
-    
-    // Display as different integer types
-    if (bytesRead >= 4) {
-      int32_t int32Value = *reinterpret_cast<int32_t*>(buffer);
-      uint32_t uint32Value = *reinterpret_cast<uint32_t*>(buffer);
-      std::cout << "As int32: " << int32Value << " (0x" << std::hex << int32Value << ")" << std::dec << std::endl;
-      std::cout << "As uint32: " << uint32Value << " (0x" << std::hex << uint32Value << ")" << std::dec << std::endl;
-    }
-    
-    if (bytesRead >= 8) {
-      int64_t int64Value = *reinterpret_cast<int64_t*>(buffer);
-      uint64_t uint64Value = *reinterpret_cast<uint64_t*>(buffer);
-      std::cout << "As int64: " << int64Value << " (0x" << std::hex << int64Value << ")" << std::dec << std::endl;
-      std::cout << "As uint64: " << uint64Value << " (0x" << std::hex << uint64Value << ")" << std::dec << std::endl;
-    }
-    
-    if (bytesRead >= 4) {
-      float floatValue = *reinterpret_cast<float*>(buffer);
-      std::cout << "As float: " << floatValue << std::endl;
-    }
-    
-    if (bytesRead >= 8) {
-      double doubleValue = *reinterpret_cast<double*>(buffer);
-      std::cout << "As double: " << doubleValue << std::endl;
-    }
-    
-    // Create a plain JavaScript array with the bytes
-    Napi::Array result = Napi::Array::New(env, bytesRead);
-    for (size_t i = 0; i < bytesRead; i++) {
-      result[i] = Napi::Number::New(env, buffer[i]);
-    }
+    SF_LOG(Debug, "Successfully read %zu bytes", bytesRead);
     
     return result;
   }
   catch (const std::exception& e) {
     std::string errorMsg = "Exception in ReadAsArray: ";
     errorMsg += e.what();
-    std::cerr << errorMsg << std::endl;
+    SF_LOG(Error, "%s", errorMsg.c_str());
     Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
     return env.Null();
   }
   catch (...) {
     std::string errorMsg = "Unknown exception in ReadAsArray";
-    std::cerr << errorMsg << std::endl;
+    SF_LOG(Error, "%s", errorMsg.c_str());
     Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
     return env.Null();
   }
 }
 
+// Reads into a caller-supplied Buffer, TypedArray or ArrayBuffer at
+// `offset`, filling the rest of it unless `size` is given. Returns the
+// number of bytes read; a short read is not an error, so one buffer can be
+// reused across polls.
+Napi::Value ReadInto(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint8_t* data = nullptr;
+  size_t length = 0;
+  if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !GetTargetBytes(info[2], data, length)) {
+    Napi::TypeError::New(env, "readMemoryInto requires 3 arguments: pid, address, buffer").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  uint32_t pid = info[0].As<Napi::Number>().Uint32Value();
+  uint64_t addressValue = info[1].As<Napi::Number>().Int64Value();
+  size_t offset = info.Length() > 3 && info[3].IsNumber() ? info[3].As<Napi::Number>().Uint32Value() : 0;
+  if (offset > length) {
+    Napi::RangeError::New(env, "offset is past the end of the buffer").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t size = length - offset;
+  if (info.Length() > 4 && info[4].IsNumber()) {
+    size = std::min<size_t>(size, info[4].As<Napi::Number>().Uint32Value());
+  }
+
+  std::unique_ptr<ProcessHandle> process = OpenProcessHandle(pid, kAccessRead);
+  if (!process) {
+    Napi::Error::New(env, "Failed to open process: " + GetLastErrorAsString()).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Number::New(env, process->Read(addressValue, data + offset, size));
+}
+
 // Memory writing function
 Napi::Boolean Write(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
@@ -267,35 +284,31 @@ Napi::Boolean Write(const Napi::CallbackInfo& info) {
       return Napi::Boolean::New(env, false);
     }
     
-    DWORD pid = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t pid = info[0].As<Napi::Number>().Uint32Value();
     uint64_t addressValue = info[1].As<Napi::Number>().Int64Value();
-    LPVOID address = (LPVOID)addressValue;
     Napi::Buffer<uint8_t> bufferObj = info[2].As<Napi::Buffer<uint8_t>>();
     uint8_t* buffer = bufferObj.Data();
-    SIZE_T size = bufferObj.Length();
+    size_t size = bufferObj.Length();
     
-    std::cout << "Writing memory: PID=" << pid 
-              << ", Address=" << AddressToHexString(addressValue)
-              << ", Size=" << size << std::endl;
+    SF_LOG(Debug, "Writing memory: PID=%u, Address=%s, Size=%zu", pid,
+           AddressToHexString(addressValue).c_str(), size);
     
-    HANDLE hProcess = OpenProcess(PROCESS_VM_WRITE | PROCESS_VM_OPERATION, FALSE, pid);
-    if (hProcess == NULL) {
+    std::unique_ptr<ProcessHandle> process = OpenProcessHandle(pid, kAccessWrite);
+    if (!process) {
       std::string errorMsg = "Failed to open process for writing: " + GetLastErrorAsString();
-      std::cerr << errorMsg << std::endl;
+      SF_LOG(Warn, "%s", errorMsg.c_str());
       Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
       return Napi::Boolean::New(env, false);
     }
     
-    SIZE_T bytesWritten;
-    BOOL success = WriteProcessMemory(hProcess, address, buffer, size, &bytesWritten);
-    CloseHandle(hProcess);
+    size_t bytesWritten = process->Write(addressValue, buffer, size);
     
-    if (!success) {
+    if (bytesWritten == 0) {
       std::string errorMsg = "Failed to write memory: " + GetLastErrorAsString() +
                            " (PID=" + std::to_string(pid) + 
                            ", Address=" + AddressToHexString(addressValue) + 
                            ", Size=" + std::to_string(size) + ")";
-      std::cerr << errorMsg << std::endl;
+      SF_LOG(Warn, "%s", errorMsg.c_str());
       Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
       return Napi::Boolean::New(env, false);
     }
@@ -303,164 +316,207 @@ Napi::Boolean Write(const Napi::CallbackInfo& info) {
     if (bytesWritten != size) {
       std::string errorMsg = "Incomplete memory write: requested " + std::to_string(size) + 
                            " bytes, but wrote " + std::to_string(bytesWritten) + " bytes";
-      std::cerr << errorMsg << std::endl;
+      SF_LOG(Warn, "%s", errorMsg.c_str());
       Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
       return Napi::Boolean::New(env, false);
     }
     
-    std::cout << "Successfully wrote " << bytesWritten << " bytes to " 
-              << AddressToHexString(addressValue) << std::endl;
+    SF_LOG(Debug, "Successfully wrote %zu bytes to %s", bytesWritten,
+           AddressToHexString(addressValue).c_str());
     
     return Napi::Boolean::New(env, true);
   }
   catch (const std::exception& e) {
     std::string errorMsg = "Exception in Write: ";
     errorMsg += e.what();
-    std::cerr << errorMsg << std::endl;
+    SF_LOG(Error, "%s", errorMsg.c_str());
     Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
     return Napi::Boolean::New(env, false);
   }
   catch (...) {
     std::string errorMsg = "Unknown exception in Write";
-    std::cerr << errorMsg << std::endl;
+    SF_LOG(Error, "%s", errorMsg.c_str());
     Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
     return Napi::Boolean::New(env, false);
   }
 }
 
 // Memory scanning function
-Napi::Array Scan(const Napi::CallbackInfo& info) {
+Napi::Value Scan(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
   
   try {
     if (info.Length() < 2) {
       Napi::Error::New(env, "scanMemoryForValue requires 2 arguments: pid, valueToFind").ThrowAsJavaScriptException();
-      return Napi::Array::New(env);
+      return env.Null();
     }
     
-    DWORD pid = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t pid = info[0].As<Napi::Number>().Uint32Value();
     uint32_t valueToFind = info[1].As<Napi::Number>().Uint32Value();
     
-    // Display the valueToFind in different formats for clarity
-    std::cout << "Scanning memory for value: " << std::endl;
-    std::cout << "  As uint32: " << valueToFind << " (0x" << std::hex << valueToFind << ")" << std::dec << std::endl;
-    std::cout << "  As int32:  " << static_cast<int32_t>(valueToFind) << " (0x" << std::hex << static_cast<int32_t>(valueToFind) << ")" << std::dec << std::endl;
-    std::cout << "  In PID:    " << pid << std::endl;
+    SF_LOG(Debug, "Scanning memory for value %u (0x%x) in PID %u", valueToFind, valueToFind, pid);
     
-    Napi::Array results = Napi::Array::New(env);
-    
-    HANDLE hProcess = OpenProcess(PROCESS_VM_READ | PROCESS_QUERY_INFORMATION, FALSE, pid);
-    if (hProcess == NULL) {
+    std::unique_ptr<ProcessHandle> process = OpenProcessHandle(pid, kAccessRead | kAccessQuery);
+    if (!process) {
       std::string errorMsg = "Failed to open process for scanning: " + GetLastErrorAsString();
-      std::cerr << errorMsg << std::endl;
+      SF_LOG(Warn, "%s", errorMsg.c_str());
       Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
-      return results;
+      return env.Null();
     }
     
-    SYSTEM_INFO sysInfo;
-    GetSystemInfo(&sysInfo);
-    
-    std::cout << "System info obtained. Address range: " 
-              << AddressToHexString((uint64_t)sysInfo.lpMinimumApplicationAddress) 
-              << " - " 
-              << AddressToHexString((uint64_t)sysInfo.lpMaximumApplicationAddress) << std::endl;
+    std::vector<MemoryRegion> regions;
+    if (!process->EnumerateRegions(regions)) {
+      std::string errorMsg = "Failed to enumerate memory regions: " + GetLastErrorAsString();
+      SF_LOG(Warn, "%s", errorMsg.c_str());
+      Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
+      return env.Null();
+    }
     
-    MEMORY_BASIC_INFORMATION memInfo;
-    LPVOID addr = sysInfo.lpMinimumApplicationAddress;
-    int resultIndex = 0;
-    int regionsScanned = 0;
+    SF_LOG(Debug, "Enumerated %zu committed regions", regions.size());
     
-    while (addr < sysInfo.lpMaximumApplicationAddress) {
-      if (VirtualQueryEx(hProcess, addr, &memInfo, sizeof(memInfo))) {
-        regionsScanned++;
-        
-        if ((memInfo.State == MEM_COMMIT) && 
-            (memInfo.Protect & (PAGE_READWRITE | PAGE_READONLY | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE))) {
-          
-          SIZE_T bytesToRead = memInfo.RegionSize;
-          
-          if (bytesToRead > 1024 * 1024 * 100) {  // Limit to 100MB per region for safety
-            std::cout << "Region too large (" << (bytesToRead / (1024 * 1024)) << "MB), limiting to 100MB" << std::endl;
-            bytesToRead = 1024 * 1024 * 100;
-          }
-          
-          std::cout << "Scanning region: " << AddressToHexString((uint64_t)memInfo.BaseAddress) 
-                    << ", Size: " << bytesToRead 
-                    << ", Protection: 0x" << std::hex << memInfo.Protect << std::dec << std::endl;
-          
-          try {
-            // Allocate buffer for memory reading
-            void* buffer = malloc(bytesToRead);
-            if (!buffer) {
-              std::cerr << "Failed to allocate memory for scan buffer" << std::endl;
-              addr = (BYTE*)memInfo.BaseAddress + memInfo.RegionSize;
-              continue;
-            }
-            
-            SIZE_T bytesRead = 0;
-            BOOL success = ReadProcessMemory(hProcess, memInfo.BaseAddress, buffer, bytesToRead, &bytesRead);
-            
-            if (success && bytesRead > 0) {
-              std::cout << "Successfully read " << bytesRead << " bytes. Scanning for value..." << std::endl;
-              
-              // Only scan up to the bytes we actually read
-              for (SIZE_T i = 0; i <= bytesRead - sizeof(uint32_t); i += sizeof(uint32_t)) {
-                uint32_t* currentValue = (uint32_t*)((BYTE*)buffer + i);
-                if (*currentValue == valueToFind) {
-                  uint64_t foundAddress = (uint64_t)memInfo.BaseAddress + i;
-                  std::cout << "Found match at " << AddressToHexString(foundAddress) << std::endl;
-                  results[resultIndex++] = Napi::Number::New(env, foundAddress);
-                }
-              }
-            } else {
-              std::cerr << "Failed to read memory region at " 
-                        << AddressToHexString((uint64_t)memInfo.BaseAddress) 
-                        << ": " << GetLastErrorAsString() << std::endl;
-            }
-            
-            free(buffer);
-          }
-          catch (const std::exception& e) {
-            std::cerr << "Exception scanning region: " << e.what() << std::endl;
-          }
-          catch (...) {
-            std::cerr << "Unknown exception scanning region" << std::endl;
-          }
-        }
-      } else {
-        std::cerr << "VirtualQueryEx failed at " << AddressToHexString((uint64_t)addr) 
-                  << ": " << GetLastErrorAsString() << std::endl;
-      }
-      
-      // Move to next region
-      addr = (BYTE*)memInfo.BaseAddress + memInfo.RegionSize;
-    }
+    std::vector<uint64_t> matches;
+    ScanForUint32(*process, regions, valueToFind, matches);
     
-    std::cout << "Scan completed. Scanned " << regionsScanned << " memory regions. Found " 
-              << resultIndex << " matches." << std::endl;
+    SF_LOG(Debug, "Scan completed. Scanned %zu memory regions. Found %zu matches.",
+           regions.size(), matches.size());
     
-    CloseHandle(hProcess);
-    return results;
+    return AddressesToJs(env, matches);
   }
   catch (const std::exception& e) {
     std::string errorMsg = "Exception in Scan: ";
     errorMsg += e.what();
-    std::cerr << errorMsg << std::endl;
+    SF_LOG(Error, "%s", errorMsg.c_str());
     Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
-    return Napi::Array::New(env);
+    return env.Null();
   }
   catch (...) {
     std::string errorMsg = "Unknown exception in Scan";
-    std::cerr << errorMsg << std::endl;
+    SF_LOG(Error, "%s", errorMsg.c_str());
     Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
-    return Napi::Array::New(env);
+    return env.Null();
+  }
+}
+
+namespace {
+
+// Cap on the bytes of one batch, so offsets fit a Uint32Array
+const size_t kMaxBatchBytes = 256 * 1024 * 1024;
+
+bool ParseRangePairs(const Napi::Value& value, std::vector<ReadRequest>& requests, std::string& error) {
+  std::vector<uint64_t> pairs;
+  if (value.IsTypedArray()) {
+    Napi::TypedArray typed = value.As<Napi::TypedArray>();
+    size_t length = typed.ElementLength();
+    if (typed.TypedArrayType() == napi_float64_array) {
+      Napi::Float64Array doubles = value.As<Napi::Float64Array>();
+      pairs.resize(length);
+      for (size_t i = 0; i < length; i++) {
+        pairs[i] = static_cast<uint64_t>(doubles[i]);
+      }
+    } else if (typed.TypedArrayType() == napi_biguint64_array) {
+      Napi::BigUint64Array bigs = value.As<Napi::BigUint64Array>();
+      pairs.assign(bigs.Data(), bigs.Data() + length);
+    } else {
+      error = "ranges must be a Float64Array, BigUint64Array or Array";
+      return false;
+    }
+  } else if (value.IsArray()) {
+    Napi::Array array = value.As<Napi::Array>();
+    pairs.resize(array.Length());
+    for (uint32_t i = 0; i < array.Length(); i++) {
+      Napi::Value element = array.Get(i);
+      if (element.IsBigInt()) {
+        bool lossless = false;
+        pairs[i] = element.As<Napi::BigInt>().Uint64Value(&lossless);
+      } else if (element.IsNumber()) {
+        pairs[i] = static_cast<uint64_t>(element.As<Napi::Number>().Int64Value());
+      } else {
+        error = "ranges must hold numbers or BigInts";
+        return false;
+      }
+    }
+  } else {
+    error = "ranges must be a Float64Array, BigUint64Array or Array";
+    return false;
+  }
+
+  if (pairs.size() % 2 != 0) {
+    error = "ranges must hold (address, size) pairs";
+    return false;
+  }
+
+  requests.resize(pairs.size() / 2);
+  size_t total = 0;
+  for (size_t i = 0; i < requests.size(); i++) {
+    uint64_t size = pairs[i * 2 + 1];
+    total += size;
+    if (size > kMaxBatchBytes || total > kMaxBatchBytes) {
+      error = "Batch exceeds " + std::to_string(kMaxBatchBytes) + " bytes";
+      return false;
+    }
+    requests[i].address = pairs[i * 2];
+    requests[i].size = static_cast<uint32_t>(size);
+  }
+  return true;
+}
+
+}  // namespace
+
+Napi::Value ReadBatchToObject(Napi::Env env, ProcessHandle& process, const Napi::Value& ranges) {
+  std::vector<ReadRequest> requests;
+  std::string error;
+  if (!ParseRangePairs(ranges, requests, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<size_t> offsets;
+  size_t total = LayoutBatch(requests.data(), requests.size(), offsets);
+  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, total);
+  std::vector<ReadStatus> status(requests.size());
+  size_t complete = ReadBatch(process, requests.data(), requests.size(), offsets, buffer.Data(), status.data());
+
+  Napi::Uint32Array offsetArray = Napi::Uint32Array::New(env, requests.size());
+  Napi::Uint32Array lengthArray = Napi::Uint32Array::New(env, requests.size());
+  Napi::Int32Array statusArray = Napi::Int32Array::New(env, requests.size());
+  for (size_t i = 0; i < requests.size(); i++) {
+    offsetArray[i] = static_cast<uint32_t>(offsets[i]);
+    lengthArray[i] = status[i].transferred;
+    statusArray[i] = status[i].error;
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("buffer", buffer);
+  result.Set("offsets", offsetArray);
+  result.Set("lengths", lengthArray);
+  result.Set("status", statusArray);
+  result.Set("complete", Napi::Number::New(env, complete));
+  return result;
+}
+
+// Batched reading function: one open and as few reads as the ranges allow
+Napi::Value ReadMemoryBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 2 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "readMemoryBatch requires 2 arguments: pid, ranges").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  uint32_t pid = info[0].As<Napi::Number>().Uint32Value();
+  std::unique_ptr<ProcessHandle> process = OpenProcessHandle(pid, kAccessRead);
+  if (!process) {
+    Napi::Error::New(env, "Failed to open process: " + GetLastErrorAsString()).ThrowAsJavaScriptException();
+    return env.Null();
   }
+  return ReadBatchToObject(env, *process, info[1]);
 }
 
 // Register all memory functions
 Napi::Object RegisterMemoryFunctions(Napi::Env env, Napi::Object exports) {
   exports.Set("readMemory", Napi::Function::New(env, Read));
   exports.Set("readMemoryAsArray", Napi::Function::New(env, ReadAsArray));
+  exports.Set("readMemoryInto", Napi::Function::New(env, ReadInto));
+  exports.Set("readMemoryBatch", Napi::Function::New(env, ReadMemoryBatch));
   exports.Set("writeMemory", Napi::Function::New(env, Write));
   exports.Set("scanMemoryForValue", Napi::Function::New(env, Scan));
   return exports;
@@ -1,6 +1,39 @@
 #pragma once
 #include <napi.h>
-#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "candidate_set.h"
+#include "platform.h"
+
+// Formats an address as 0x-prefixed uppercase hex
+std::string AddressToHexString(uint64_t address);
+
+// Value types by their JS names: "int8" ... "uint64", "float32", "float64"
+bool ParseValueType(const std::string& name, ValueType& type);
+const char* ValueTypeName(ValueType type);
+
+// Converts a Number or BigInt to `type`, truncating integers the way a
+// store of that width would
+bool ToOperand(const Napi::Value& value, ValueType type, ScanOperand& operand);
+
+// A value of `type` held in ScanOperand bits; BigInt for 64-bit integers
+Napi::Value OperandToJs(Napi::Env env, uint64_t bits, ValueType type);
+
+// Scan hits as a Float64Array. User-mode addresses on both platforms fit
+// in 47 bits, well inside the range a double holds exactly.
+Napi::Float64Array AddressesToJs(Napi::Env env, const std::vector<uint64_t>& addresses);
+
+// Resolves a TypedArray, Buffer or ArrayBuffer to the bytes backing it
+bool GetTargetBytes(const Napi::Value& value, uint8_t*& data, size_t& length);
+
+// Reads a batch of ranges given as (address, size) pairs in a
+// Float64Array, BigUint64Array or plain Array. Returns
+// { buffer, offsets, lengths, status, complete }: the ranges back to back
+// in one Buffer, where each starts, how many bytes of each were read and
+// the platform error code of each (0 when read completely). Throws and
+// returns null only on malformed input.
+Napi::Value ReadBatchToObject(Napi::Env env, ProcessHandle& process, const Napi::Value& ranges);
 
 // Function to register all memory functions
 Napi::Object RegisterMemoryFunctions(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,152 @@
+#include "metrics.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+
+namespace {
+
+struct Histogram {
+  std::atomic<uint64_t> buckets[kHistogramBuckets];
+  std::atomic<uint64_t> count{0};
+  std::atomic<uint64_t> sum{0};
+};
+
+struct Registry {
+  Registry() {
+    for (Histogram& histogram : histograms) {
+      for (std::atomic<uint64_t>& bucket : histogram.buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::atomic<uint64_t> values[static_cast<size_t>(Metric::kCount)] = {};
+  Histogram histograms[static_cast<size_t>(MetricHistogram::kCount)];
+  // Failures are the slow path; a lock keeps the per-code tables simple
+  std::mutex errorMutex;
+  std::map<int, uint64_t> readErrors;
+  std::map<int, uint64_t> writeErrors;
+};
+
+Registry& GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+const char* const kMetricNames[] = {
+  "readCalls",
+  "writeCalls",
+  "bytesRead",
+  "bytesWritten",
+  "failedReads",
+  "failedWrites",
+  "regionsScanned",
+  "regionsSkipped",
+  "bytesScanned",
+  "scanPasses",
+  "scanNanoseconds",
+};
+
+const char* const kHistogramNames[] = {
+  "readLatencyMicros",
+  "writeLatencyMicros",
+  "scanDurationMillis",
+};
+
+size_t BucketFor(uint64_t value) {
+  size_t bucket = 0;
+  while (value > 0 && bucket < kHistogramBuckets - 1) {
+    value >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+}  // namespace
+
+const char* MetricName(Metric metric) {
+  return kMetricNames[static_cast<size_t>(metric)];
+}
+
+const char* HistogramName(MetricHistogram histogram) {
+  return kHistogramNames[static_cast<size_t>(histogram)];
+}
+
+void AddMetric(Metric metric, uint64_t amount) {
+  GetRegistry().values[static_cast<size_t>(metric)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void RecordHistogram(MetricHistogram which, uint64_t value) {
+  Histogram& histogram = GetRegistry().histograms[static_cast<size_t>(which)];
+  histogram.buckets[BucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+  histogram.count.fetch_add(1, std::memory_order_relaxed);
+  histogram.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+void RecordTransferCall(bool write, uint64_t bytes, std::chrono::steady_clock::duration elapsed) {
+  uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  if (write) {
+    AddMetric(Metric::WriteCalls);
+    AddMetric(Metric::BytesWritten, bytes);
+    RecordHistogram(MetricHistogram::WriteLatencyMicros, micros);
+  } else {
+    AddMetric(Metric::ReadCalls);
+    AddMetric(Metric::BytesRead, bytes);
+    RecordHistogram(MetricHistogram::ReadLatencyMicros, micros);
+  }
+}
+
+void RecordTransferError(bool write, int error) {
+  Registry& registry = GetRegistry();
+  AddMetric(write ? Metric::FailedWrites : Metric::FailedReads);
+  std::lock_guard<std::mutex> lock(registry.errorMutex);
+  (write ? registry.writeErrors : registry.readErrors)[error]++;
+}
+
+void RecordScanPass(uint64_t regionsScanned, uint64_t regionsSkipped, uint64_t bytes,
+                    std::chrono::steady_clock::duration elapsed) {
+  AddMetric(Metric::ScanPasses);
+  AddMetric(Metric::RegionsScanned, regionsScanned);
+  AddMetric(Metric::RegionsSkipped, regionsSkipped);
+  AddMetric(Metric::BytesScanned, bytes);
+  AddMetric(Metric::ScanNanoseconds, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  RecordHistogram(MetricHistogram::ScanDurationMillis,
+                  std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+void SnapshotMetrics(MetricsSnapshot& snapshot) {
+  Registry& registry = GetRegistry();
+  for (size_t i = 0; i < static_cast<size_t>(Metric::kCount); i++) {
+    snapshot.values[i] = registry.values[i].load(std::memory_order_relaxed);
+  }
+  for (size_t h = 0; h < static_cast<size_t>(MetricHistogram::kCount); h++) {
+    const Histogram& histogram = registry.histograms[h];
+    for (size_t b = 0; b < kHistogramBuckets; b++) {
+      snapshot.histograms[h].buckets[b] = histogram.buckets[b].load(std::memory_order_relaxed);
+    }
+    snapshot.histograms[h].count = histogram.count.load(std::memory_order_relaxed);
+    snapshot.histograms[h].sum = histogram.sum.load(std::memory_order_relaxed);
+  }
+
+  std::lock_guard<std::mutex> lock(registry.errorMutex);
+  snapshot.readErrors.assign(registry.readErrors.begin(), registry.readErrors.end());
+  snapshot.writeErrors.assign(registry.writeErrors.begin(), registry.writeErrors.end());
+}
+
+void ResetMetrics() {
+  Registry& registry = GetRegistry();
+  for (std::atomic<uint64_t>& value : registry.values) {
+    value.store(0, std::memory_order_relaxed);
+  }
+  for (Histogram& histogram : registry.histograms) {
+    for (std::atomic<uint64_t>& bucket : histogram.buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    histogram.count.store(0, std::memory_order_relaxed);
+    histogram.sum.store(0, std::memory_order_relaxed);
+  }
+
+  std::lock_guard<std::mutex> lock(registry.errorMutex);
+  registry.readErrors.clear();
+  registry.writeErrors.clear();
+}
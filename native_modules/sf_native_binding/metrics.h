@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Process-wide performance counters. Updates are relaxed atomic adds, cheap
+// enough for every syscall; getStats() reads a snapshot.
+enum class Metric : uint8_t {
+  ReadCalls,
+  WriteCalls,
+  BytesRead,
+  BytesWritten,
+  FailedReads,
+  FailedWrites,
+  RegionsScanned,
+  RegionsSkipped,
+  BytesScanned,
+  ScanPasses,
+  ScanNanoseconds,
+  kCount,
+};
+
+// Log2-bucketed distributions: bucket 0 counts values below 1, bucket i
+// counts [2^(i-1), 2^i), the last bucket everything above
+enum class MetricHistogram : uint8_t {
+  ReadLatencyMicros,
+  WriteLatencyMicros,
+  ScanDurationMillis,
+  kCount,
+};
+
+const size_t kHistogramBuckets = 24;
+
+const char* MetricName(Metric metric);
+const char* HistogramName(MetricHistogram histogram);
+
+void AddMetric(Metric metric, uint64_t amount = 1);
+void RecordHistogram(MetricHistogram histogram, uint64_t value);
+
+// One platform read or write call: counts it, its bytes and its latency
+void RecordTransferCall(bool write, uint64_t bytes, std::chrono::steady_clock::duration elapsed);
+// A range that could not be transferred, by platform error code
+void RecordTransferError(bool write, int error);
+// One streaming scan pass over the target
+void RecordScanPass(uint64_t regionsScanned, uint64_t regionsSkipped, uint64_t bytes,
+                    std::chrono::steady_clock::duration elapsed);
+
+struct HistogramSnapshot {
+  uint64_t buckets[kHistogramBuckets] = {};
+  uint64_t count = 0;
+  uint64_t sum = 0;
+};
+
+struct MetricsSnapshot {
+  uint64_t values[static_cast<size_t>(Metric::kCount)] = {};
+  HistogramSnapshot histograms[static_cast<size_t>(MetricHistogram::kCount)];
+  // (error code, count), sorted by code
+  std::vector<std::pair<int, uint64_t>> readErrors;
+  std::vector<std::pair<int, uint64_t>> writeErrors;
+};
+
+void SnapshotMetrics(MetricsSnapshot& snapshot);
+void ResetMetrics();
@@ -0,0 +1,259 @@
+#include "page_cache.h"
+#include <algorithm>
+#include <cstring>
+
+PageCache::PageCache(const PageCacheOptions& options) : options_(options) {}
+
+void PageCache::Configure(const PageCacheOptions& options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  options_ = options;
+  Trim();
+}
+
+PageCacheOptions PageCache::Options() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return options_;
+}
+
+size_t PageCache::Read(ProcessHandle& process, uint64_t address, void* buffer, size_t size) {
+  MemoryRange range;
+  range.address = address;
+  range.buffer = static_cast<uint8_t*>(buffer);
+  range.size = size;
+  ReadMany(process, &range, 1);
+  return range.transferred;
+}
+
+size_t PageCache::ReadMany(ProcessHandle& process, MemoryRange* ranges, size_t count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Pages every range touches; a batch the cache cannot hold at once goes
+  // straight to the target
+  uint64_t pageCount = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (ranges[i].size > 0) {
+      pageCount += (ranges[i].address + ranges[i].size - 1) / kPageSize - ranges[i].address / kPageSize + 1;
+    }
+  }
+  if (pageCount > options_.capacity) {
+    return process.ReadMany(ranges, count);
+  }
+
+  Clock::time_point now = Clock::now();
+  std::vector<uint64_t> missing;
+  for (size_t i = 0; i < count; i++) {
+    if (ranges[i].size == 0) {
+      continue;
+    }
+    uint64_t end = (ranges[i].address + ranges[i].size - 1) / kPageSize + 1;
+    for (uint64_t index = ranges[i].address / kPageSize; index < end; index++) {
+      if (!IsFresh(index, now)) {
+        missing.push_back(index);
+      }
+    }
+  }
+  std::sort(missing.begin(), missing.end());
+  missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+  stats_.misses += missing.size();
+  stats_.hits += pageCount - missing.size();
+
+  // A single read that carries on from the previous one, either way,
+  // fetches the next few pages along with its own
+  if (count == 1 && ranges[0].size > 0) {
+    uint64_t first = ranges[0].address / kPageSize;
+    uint64_t end = (ranges[0].address + ranges[0].size - 1) / kPageSize + 1;
+    uint64_t ahead = std::min<uint64_t>(options_.prefetch, options_.capacity - (end - first));
+    size_t requested = missing.size();
+    if (first >= lastFirst_ && first <= lastEnd_ && end > lastEnd_) {
+      for (uint64_t index = end; index < end + ahead; index++) {
+        if (!IsFresh(index, now)) {
+          missing.push_back(index);
+        }
+      }
+    } else if (end <= lastEnd_ && end >= lastFirst_ && first < lastFirst_) {
+      for (uint64_t index = first; index > 0 && index + ahead > first; index--) {
+        if (!IsFresh(index - 1, now)) {
+          missing.push_back(index - 1);
+        }
+      }
+    }
+    stats_.prefetched += missing.size() - requested;
+    lastFirst_ = first;
+    lastEnd_ = end;
+  }
+  if (!missing.empty()) {
+    Fetch(process, missing, now);
+  }
+
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    MemoryRange& range = ranges[i];
+    range.transferred = 0;
+    range.error = 0;
+    while (range.transferred < range.size) {
+      uint64_t address = range.address + range.transferred;
+      auto found = index_.find(address / kPageSize);
+      if (found == index_.end()) {
+        break;
+      }
+      // Most recently used first
+      pages_.splice(pages_.begin(), pages_, found->second);
+      size_t offset = static_cast<size_t>(address % kPageSize);
+      size_t chunk = std::min<size_t>(kPageSize - offset, range.size - range.transferred);
+      memcpy(range.buffer + range.transferred, found->second->data.data() + offset, chunk);
+      range.transferred += chunk;
+    }
+    total += range.transferred;
+  }
+  Trim();
+  return total;
+}
+
+size_t PageCache::Write(ProcessHandle& process, uint64_t address, const void* buffer, size_t size) {
+  size_t written = process.Write(address, buffer, size);
+  Update(address, buffer, written, size);
+  return written;
+}
+
+void PageCache::Update(uint64_t address, const void* buffer, size_t written, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint8_t* bytes = static_cast<const uint8_t*>(buffer);
+  uint64_t end = (address + size - 1) / kPageSize + 1;
+  for (uint64_t index = address / kPageSize; index < end; index++) {
+    auto found = index_.find(index);
+    if (found == index_.end()) {
+      continue;
+    }
+    uint64_t pageStart = index * kPageSize;
+    uint64_t from = std::max(address, pageStart);
+    uint64_t to = std::min(address + written, pageStart + kPageSize);
+    if (from < to) {
+      memcpy(found->second->data.data() + (from - pageStart), bytes + (from - address), to - from);
+    }
+    // Part of the page may or may not have been written; read it again
+    if (std::max(address + written, pageStart) < std::min(address + size, pageStart + kPageSize)) {
+      Drop(found->second);
+      stats_.invalidations++;
+    }
+  }
+}
+
+void PageCache::Invalidate(uint64_t address, uint64_t size) {
+  if (size == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t first = address / kPageSize;
+  uint64_t end = (address + size - 1) / kPageSize + 1;
+  if (end - first > index_.size()) {
+    for (auto page = pages_.begin(); page != pages_.end();) {
+      auto next = std::next(page);
+      if (page->index >= first && page->index < end) {
+        Drop(page);
+        stats_.invalidations++;
+      }
+      page = next;
+    }
+    return;
+  }
+  for (uint64_t index = first; index < end; index++) {
+    auto found = index_.find(index);
+    if (found != index_.end()) {
+      Drop(found->second);
+      stats_.invalidations++;
+    }
+  }
+}
+
+void PageCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pages_.clear();
+  index_.clear();
+  spare_.clear();
+  lastFirst_ = 0;
+  lastEnd_ = 0;
+}
+
+PageCacheStats PageCache::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  PageCacheStats stats = stats_;
+  stats.pages = pages_.size();
+  return stats;
+}
+
+bool PageCache::IsFresh(uint64_t index, Clock::time_point now) {
+  auto found = index_.find(index);
+  return found != index_.end() &&
+         (options_.ttl.count() == 0 || now - found->second->fetched < options_.ttl);
+}
+
+void PageCache::Fetch(ProcessHandle& process, const std::vector<uint64_t>& indexes, Clock::time_point now) {
+  std::vector<MemoryRange> ranges(indexes.size());
+  std::vector<std::vector<uint8_t>> buffers(indexes.size());
+  for (size_t i = 0; i < indexes.size(); i++) {
+    if (!spare_.empty()) {
+      buffers[i] = std::move(spare_.back());
+      spare_.pop_back();
+    }
+    buffers[i].resize(kPageSize);
+    ranges[i].address = indexes[i] * kPageSize;
+    ranges[i].buffer = buffers[i].data();
+    ranges[i].size = kPageSize;
+  }
+  process.ReadMany(ranges.data(), ranges.size());
+  stats_.fetches++;
+
+  for (size_t i = 0; i < indexes.size(); i++) {
+    auto found = index_.find(indexes[i]);
+    if (ranges[i].transferred != kPageSize) {
+      // Gone from the target, or never there
+      if (found != index_.end()) {
+        Drop(found->second);
+      }
+      spare_.push_back(std::move(buffers[i]));
+      continue;
+    }
+    if (found != index_.end()) {
+      // A stale copy: swap the new bytes in
+      found->second->data.swap(buffers[i]);
+      found->second->fetched = now;
+      pages_.splice(pages_.begin(), pages_, found->second);
+      spare_.push_back(std::move(buffers[i]));
+      continue;
+    }
+    Page page;
+    page.index = indexes[i];
+    page.fetched = now;
+    page.data = std::move(buffers[i]);
+    pages_.push_front(std::move(page));
+    index_[indexes[i]] = pages_.begin();
+  }
+}
+
+void PageCache::Drop(PageIterator page) {
+  index_.erase(page->index);
+  spare_.push_back(std::move(page->data));
+  pages_.erase(page);
+}
+
+void PageCache::Trim() {
+  while (pages_.size() > options_.capacity) {
+    Drop(std::prev(pages_.end()));
+    stats_.evictions++;
+  }
+  // Keep a few buffers around for the next fetch, not every one ever used
+  if (spare_.size() > options_.prefetch + 16) {
+    spare_.resize(options_.prefetch + 16);
+  }
+}
+
+size_t CachedProcess::WriteMany(MemoryRange* ranges, size_t count) {
+  size_t total = process_.WriteMany(ranges, count);
+  for (size_t i = 0; i < count; i++) {
+    cache_.Update(ranges[i].address, ranges[i].buffer, ranges[i].transferred, ranges[i].size);
+  }
+  return total;
+}
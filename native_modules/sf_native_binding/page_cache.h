@@ -0,0 +1,132 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "platform.h"
+
+struct PageCacheOptions {
+  // Pages kept before the least recently used ones are dropped
+  size_t capacity = 1024;
+  // How long a fetched page is served before it is read again; 0 keeps
+  // pages until they are evicted or invalidated
+  std::chrono::milliseconds ttl{100};
+  // Pages fetched past the end of a read that continues the previous one,
+  // in the direction the reads are moving
+  uint32_t prefetch = 4;
+};
+
+struct PageCacheStats {
+  size_t pages = 0;
+  // Pages served from the cache, and pages that had to be fetched
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t prefetched = 0;
+  uint64_t evictions = 0;
+  uint64_t invalidations = 0;
+  // Batched fetches from the target
+  uint64_t fetches = 0;
+};
+
+// Copies of target memory kept by page, so views that re-read the same
+// small ranges (a hex view being scrolled, a struct being polled) cost a
+// lookup instead of a cross-process read. Pages are fetched a batch per
+// read, with sequential reads fetching a few pages ahead. Writes made
+// through the cache reach the target first and then update the copies, so
+// the cache never serves bytes older than its own writes; writes made
+// around it are only seen once the pages expire.
+class PageCache {
+ public:
+  static const uint64_t kPageSize = 4096;
+
+  explicit PageCache(const PageCacheOptions& options = PageCacheOptions());
+
+  PageCache(const PageCache&) = delete;
+  PageCache& operator=(const PageCache&) = delete;
+
+  // Drops the pages over a smaller capacity
+  void Configure(const PageCacheOptions& options);
+  PageCacheOptions Options();
+
+  // Like ProcessHandle::Read: returns the leading bytes read, stopping at
+  // the first page the target does not let us read
+  size_t Read(ProcessHandle& process, uint64_t address, void* buffer, size_t size);
+  // Like ProcessHandle::ReadMany, fetching the pages every range misses
+  // as one batch
+  size_t ReadMany(ProcessHandle& process, MemoryRange* ranges, size_t count);
+
+  // Writes to the target, then updates the cached copies of the bytes
+  // written. Returns the bytes written.
+  size_t Write(ProcessHandle& process, uint64_t address, const void* buffer, size_t size);
+  // Brings the cached copies in line after `size` bytes were sent to
+  // `address` and the leading `written` of them landed
+  void Update(uint64_t address, const void* buffer, size_t written, size_t size);
+
+  // Drops the pages overlapping [address, address + size)
+  void Invalidate(uint64_t address, uint64_t size);
+  void Clear();
+
+  PageCacheStats Stats();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Page {
+    uint64_t index = 0;
+    Clock::time_point fetched;
+    std::vector<uint8_t> data;
+  };
+
+  typedef std::list<Page>::iterator PageIterator;
+
+  // True when page `index` is cached and younger than the TTL. Called
+  // with mutex_ held, like the helpers below.
+  bool IsFresh(uint64_t index, Clock::time_point now);
+  // Fetches `indexes` in one batch and caches the pages that could be
+  // read
+  void Fetch(ProcessHandle& process, const std::vector<uint64_t>& indexes, Clock::time_point now);
+  void Drop(PageIterator page);
+  void Trim();
+
+  PageCacheOptions options_;
+  // Most recently used first
+  std::list<Page> pages_;
+  std::unordered_map<uint64_t, PageIterator> index_;
+  // Page buffers of evicted pages, reused by the next fetch
+  std::vector<std::vector<uint8_t>> spare_;
+  // Pages covered by the previous read, for spotting sequential access
+  uint64_t lastFirst_ = 0;
+  uint64_t lastEnd_ = 0;
+  PageCacheStats stats_;
+  std::mutex mutex_;
+};
+
+// A process handle whose reads go through `cache` and whose writes go
+// through it to `process`, for handing the cache to code written against
+// ProcessHandle (RDRAM and struct transfers)
+class CachedProcess : public ProcessHandle {
+ public:
+  CachedProcess(ProcessHandle& process, PageCache& cache) : process_(process), cache_(cache) {}
+
+  uint32_t Pid() const override { return process_.Pid(); }
+  bool IsAlive() override { return process_.IsAlive(); }
+  uint32_t PointerSize() override { return process_.PointerSize(); }
+  bool EnumerateRegions(std::vector<MemoryRegion>& regions, uint64_t start = 0, uint64_t end = UINT64_MAX) override {
+    return process_.EnumerateRegions(regions, start, end);
+  }
+  size_t Read(uint64_t address, void* buffer, size_t size) override {
+    return cache_.Read(process_, address, buffer, size);
+  }
+  size_t Write(uint64_t address, const void* buffer, size_t size) override {
+    return cache_.Write(process_, address, buffer, size);
+  }
+  size_t ReadMany(MemoryRange* ranges, size_t count) override { return cache_.ReadMany(process_, ranges, count); }
+  size_t WriteMany(MemoryRange* ranges, size_t count) override;
+
+ private:
+  ProcessHandle& process_;
+  PageCache& cache_;
+};
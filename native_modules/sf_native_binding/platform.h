@@ -0,0 +1,167 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Platform abstraction for everything that touches another process.
+// memory.cc and processes.cc only talk to this interface; the Win32
+// implementation lives in platform_win.cc and the Linux one (procfs +
+// process_vm_readv/writev) in platform_linux.cc.
+
+// Access rights requested when opening a process
+enum ProcessAccess : uint32_t {
+  kAccessRead = 1,
+  kAccessWrite = 2,
+  kAccessQuery = 4,
+};
+
+// Region protection bits, normalized across platforms
+enum RegionProtection : uint32_t {
+  kProtRead = 1,
+  kProtWrite = 2,
+  kProtExecute = 4,
+  kProtGuard = 8,
+};
+
+enum class RegionType : uint8_t {
+  Private,  // anonymous / heap / stack
+  Image,    // executable module
+  Mapped,   // file or shared mapping
+};
+
+// One committed region of the target's address space
+struct MemoryRegion {
+  uint64_t base = 0;
+  uint64_t size = 0;
+  uint32_t protection = 0;
+  RegionType type = RegionType::Private;
+  // Backing file of image and mapped regions, when the platform knows it
+  std::string path;
+};
+
+// One element of a scatter-gather transfer. The backend fills in
+// `transferred` and, when the range could not be moved completely,
+// `error` with the platform error code.
+struct MemoryRange {
+  uint64_t address = 0;
+  uint8_t* buffer = nullptr;
+  size_t size = 0;
+  size_t transferred = 0;
+  int error = 0;
+};
+
+struct ProcessEntry {
+  uint32_t pid = 0;
+  std::string name;
+};
+
+// An open process. Reads and writes are safe to issue from several
+// threads at once.
+class ProcessHandle {
+ public:
+  virtual ~ProcessHandle() = default;
+
+  virtual uint32_t Pid() const = 0;
+
+  // False once the target has exited (including zombies)
+  virtual bool IsAlive() = 0;
+
+  // Size of a pointer in the target: 4 for 32-bit processes, else 8
+  virtual uint32_t PointerSize() = 0;
+
+  // Fills `regions` with every committed region overlapping [start, end),
+  // sorted by address. Regions are reported whole, so they may extend
+  // past either end of the window.
+  virtual bool EnumerateRegions(std::vector<MemoryRegion>& regions, uint64_t start = 0,
+                                uint64_t end = UINT64_MAX) = 0;
+
+  // Single transfers; return the number of bytes moved
+  virtual size_t Read(uint64_t address, void* buffer, size_t size) = 0;
+  virtual size_t Write(uint64_t address, const void* buffer, size_t size) = 0;
+
+  // Scatter-gather transfers. A failing range does not stop the rest of
+  // the batch. Returns the total number of bytes moved.
+  virtual size_t ReadMany(MemoryRange* ranges, size_t count) = 0;
+  virtual size_t WriteMany(MemoryRange* ranges, size_t count) = 0;
+};
+
+// Opens `pid` with the given ProcessAccess bits. Returns nullptr on
+// failure; GetLastErrorAsString() describes why.
+std::unique_ptr<ProcessHandle> OpenProcessHandle(uint32_t pid, uint32_t access);
+
+// Enumerates running processes
+bool ListProcessEntries(std::vector<ProcessEntry>& processes);
+
+// Ids of the running processes, without looking any of them up, so
+// polling for new processes stays cheap
+bool ListProcessIds(std::vector<uint32_t>& pids);
+
+// File name and full path of the executable `pid` runs. Under Wine the
+// path is the Windows one the program was started from. False when the
+// process is gone or may not be queried.
+bool GetProcessImage(uint32_t pid, std::string& name, std::string& path);
+
+// Waits on the exit of a set of processes without polling them, through
+// pidfds on Linux and process handles on Windows. Add and Wait belong to
+// one thread; Wake may be called from any.
+class ExitMonitor {
+ public:
+  virtual ~ExitMonitor() = default;
+
+  // False if `pid` has already exited or cannot be waited on
+  virtual bool Add(uint32_t pid) = 0;
+  virtual void Remove(uint32_t pid) = 0;
+
+  // Blocks until a monitored process exits, Wake() is called or `timeout`
+  // passes. Appends the pids that exited to `exited` and stops monitoring
+  // them.
+  virtual void Wait(std::chrono::milliseconds timeout, std::vector<uint32_t>& exited) = 0;
+
+  // Ends the current or next Wait early
+  virtual void Wake() = 0;
+};
+
+std::unique_ptr<ExitMonitor> CreateExitMonitor();
+
+// Page-aligned allocation in our own process, for transfer buffers
+void* AllocatePages(size_t size);
+void FreePages(void* pages, size_t size);
+
+// A whole file mapped read-only into our own process. Pages are faulted in
+// on access, so files larger than physical memory can be mapped.
+class MappedFile {
+ public:
+  virtual ~MappedFile() = default;
+
+  // Null for an empty file
+  virtual const uint8_t* Data() const = 0;
+  virtual uint64_t Size() const = 0;
+};
+
+// Maps `path` (UTF-8). Returns nullptr on failure; GetLastErrorAsString()
+// describes why.
+std::unique_ptr<MappedFile> MapFile(const std::string& path);
+
+// fopen and remove for UTF-8 paths, which the C runtime only handles
+// outside Windows
+FILE* OpenFile(const std::string& path, const char* mode);
+bool RemoveFile(const std::string& path);
+
+// fseek to an absolute offset, past 2 GB included
+bool SeekFile(FILE* file, uint64_t offset);
+
+// Raise the system timer resolution to 1 ms while a thread depends on
+// short, regular sleeps; calls nest. Windows otherwise rounds waits up to
+// its 15.6 ms tick. No-ops where timers are already fine-grained.
+void BeginHighResolutionTimer();
+void EndHighResolutionTimer();
+
+// Describes the last platform error raised on this thread
+std::string GetLastErrorAsString();
+
+// Describes a platform error code (as stored in MemoryRange::error)
+std::string ErrorCodeToString(int error);
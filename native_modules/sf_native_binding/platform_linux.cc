@@ -0,0 +1,569 @@
+#include "platform.h"
+#include "metrics.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Linux 5.3; older C libraries do not define it
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+namespace {
+
+// Reads a whole procfs file, relative to `dirFd` when `path` is relative.
+// procfs reports a size of 0, so this reads until EOF instead of trusting
+// stat().
+bool ReadProcFile(const std::string& path, std::string& contents, int dirFd = AT_FDCWD) {
+  int fd = openat(dirFd, path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  contents.clear();
+  char chunk[4096];
+  ssize_t n;
+  while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+    contents.append(chunk, n);
+  }
+  int savedErrno = errno;
+  close(fd);
+  errno = savedErrno;
+  return n == 0;
+}
+
+uint32_t ParseProtection(const char* perms) {
+  uint32_t protection = 0;
+  if (perms[0] == 'r') protection |= kProtRead;
+  if (perms[1] == 'w') protection |= kProtWrite;
+  if (perms[2] == 'x') protection |= kProtExecute;
+  return protection;
+}
+
+// Pseudo-mappings the kernel lists but process_vm_readv cannot touch
+bool IsSpecialMapping(const std::string& path) {
+  return path == "[vvar]" || path == "[vvar_vclock]" || path == "[vsyscall]";
+}
+
+// Issues process_vm_readv/writev over `ranges`, IOV_MAX elements per
+// syscall. The kernel stops at the first remote range it cannot access, so
+// after a short transfer we mark that range failed and resume after it.
+template <bool IsWrite>
+size_t TransferMany(pid_t pid, MemoryRange* ranges, size_t count) {
+  std::vector<struct iovec> local;
+  std::vector<struct iovec> remote;
+  size_t total = 0;
+  size_t next = 0;
+
+  while (next < count) {
+    size_t batch = std::min<size_t>(count - next, IOV_MAX);
+    local.resize(batch);
+    remote.resize(batch);
+    for (size_t i = 0; i < batch; i++) {
+      MemoryRange& range = ranges[next + i];
+      range.transferred = 0;
+      range.error = 0;
+      local[i].iov_base = range.buffer;
+      local[i].iov_len = range.size;
+      remote[i].iov_base = reinterpret_cast<void*>(range.address);
+      remote[i].iov_len = range.size;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ssize_t moved = IsWrite
+      ? process_vm_writev(pid, local.data(), batch, remote.data(), batch, 0)
+      : process_vm_readv(pid, local.data(), batch, remote.data(), batch, 0);
+    int error = errno;
+    RecordTransferCall(IsWrite, moved > 0 ? moved : 0, std::chrono::steady_clock::now() - start);
+
+    if (moved < 0) {
+      // Nothing moved: the first range is the one at fault
+      ranges[next].error = error;
+      RecordTransferError(IsWrite, error);
+      if (error == ESRCH || error == EPERM) {
+        for (size_t i = next + 1; i < count; i++) {
+          ranges[i].transferred = 0;
+          ranges[i].error = error;
+          RecordTransferError(IsWrite, error);
+        }
+        errno = error;
+        return total;
+      }
+      next++;
+      continue;
+    }
+
+    total += moved;
+    size_t remaining = moved;
+    size_t i = 0;
+    for (; i < batch && remaining >= ranges[next + i].size; i++) {
+      ranges[next + i].transferred = ranges[next + i].size;
+      remaining -= ranges[next + i].size;
+    }
+
+    if (i == batch) {
+      next += batch;
+      continue;
+    }
+
+    // Short transfer: range `i` stopped early on an inaccessible page
+    ranges[next + i].transferred = remaining;
+    ranges[next + i].error = EFAULT;
+    RecordTransferError(IsWrite, EFAULT);
+    next += i + 1;
+  }
+
+  return total;
+}
+
+class LinuxProcessHandle : public ProcessHandle {
+ public:
+  // `procDir` is an open descriptor for /proc/<pid>. It keeps referring to
+  // the original process even if the pid is recycled after it exits.
+  LinuxProcessHandle(pid_t pid, int procDir) : pid_(pid), procDir_(procDir) {}
+
+  ~LinuxProcessHandle() override {
+    close(procDir_);
+  }
+
+  uint32_t Pid() const override { return static_cast<uint32_t>(pid_); }
+
+  bool IsAlive() override {
+    int fd = openat(procDir_, "stat", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return false;
+    }
+
+    char stat[512];
+    ssize_t n = read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+    if (n <= 0) {
+      return false;
+    }
+    stat[n] = '\0';
+
+    // The state field follows the parenthesized command name
+    const char* paren = strrchr(stat, ')');
+    if (!paren || paren[1] == '\0' || paren[2] == '\0') {
+      return false;
+    }
+    char state = paren[2];
+    return state != 'Z' && state != 'X';
+  }
+
+  // From the ELF class of the executable; 8 when it cannot be read
+  uint32_t PointerSize() override {
+    int fd = openat(procDir_, "exe", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return 8;
+    }
+    unsigned char ident[5] = {0};
+    ssize_t n = read(fd, ident, sizeof(ident));
+    close(fd);
+    return n == sizeof(ident) && memcmp(ident, "\x7f" "ELF", 4) == 0 && ident[4] == 1 ? 4 : 8;
+  }
+
+  bool EnumerateRegions(std::vector<MemoryRegion>& regions, uint64_t windowStart = 0,
+                        uint64_t windowEnd = UINT64_MAX) override {
+    std::string maps;
+    if (!ReadProcFile("maps", maps, procDir_)) {
+      return false;
+    }
+
+    regions.clear();
+    std::set<std::string> executablePaths;
+    std::istringstream lines(maps);
+    std::string line;
+
+    while (std::getline(lines, line)) {
+      unsigned long long start = 0, end = 0, offset = 0, inode = 0;
+      char perms[5] = {0};
+      char dev[16] = {0};
+      int pathStart = 0;
+      if (sscanf(line.c_str(), "%llx-%llx %4s %llx %15s %llu %n",
+                 &start, &end, perms, &offset, dev, &inode, &pathStart) < 6) {
+        continue;
+      }
+
+      // Modules are classified from every mapping, so only filter here
+      bool inWindow = end > windowStart && start < windowEnd;
+
+      MemoryRegion region;
+      region.base = start;
+      region.size = end - start;
+      region.protection = ParseProtection(perms);
+      if (pathStart > 0 && pathStart < static_cast<int>(line.size())) {
+        region.path = line.substr(pathStart);
+      }
+      if (IsSpecialMapping(region.path)) {
+        continue;
+      }
+
+      bool shared = perms[3] == 's';
+      bool fileBacked = inode != 0 && !region.path.empty() && region.path[0] == '/';
+      region.type = (shared || fileBacked) ? RegionType::Mapped : RegionType::Private;
+      if (fileBacked && (region.protection & kProtExecute)) {
+        executablePaths.insert(region.path);
+      }
+      if (inWindow) {
+        regions.push_back(std::move(region));
+      }
+    }
+
+    // Every mapping of a file that is mapped executable somewhere belongs
+    // to a loaded module (its .rodata/.data segments are not executable)
+    for (MemoryRegion& region : regions) {
+      if (region.type == RegionType::Mapped && executablePaths.count(region.path)) {
+        region.type = RegionType::Image;
+      }
+    }
+    return true;
+  }
+
+  size_t Read(uint64_t address, void* buffer, size_t size) override {
+    MemoryRange range;
+    range.address = address;
+    range.buffer = static_cast<uint8_t*>(buffer);
+    range.size = size;
+    size_t moved = TransferMany<false>(pid_, &range, 1);
+    errno = range.error;
+    return moved;
+  }
+
+  size_t Write(uint64_t address, const void* buffer, size_t size) override {
+    MemoryRange range;
+    range.address = address;
+    range.buffer = static_cast<uint8_t*>(const_cast<void*>(buffer));
+    range.size = size;
+    size_t moved = TransferMany<true>(pid_, &range, 1);
+    errno = range.error;
+    return moved;
+  }
+
+  size_t ReadMany(MemoryRange* ranges, size_t count) override {
+    return TransferMany<false>(pid_, ranges, count);
+  }
+
+  size_t WriteMany(MemoryRange* ranges, size_t count) override {
+    return TransferMany<true>(pid_, ranges, count);
+  }
+
+ private:
+  pid_t pid_;
+  int procDir_;
+};
+
+// Best display name for a process. Processes running under Wine report
+// the Windows image path in argv[0], so prefer its basename over the
+// 15-character comm field.
+std::string ProcessName(const std::string& procDir) {
+  std::string cmdline;
+  if (ReadProcFile(procDir + "/cmdline", cmdline) && !cmdline.empty()) {
+    std::string argv0 = cmdline.c_str();
+    size_t slash = argv0.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? argv0 : argv0.substr(slash + 1);
+    if (!name.empty()) {
+      return name;
+    }
+  }
+
+  std::string comm;
+  if (ReadProcFile(procDir + "/comm", comm)) {
+    while (!comm.empty() && comm.back() == '\n') {
+      comm.pop_back();
+    }
+  }
+  return comm;
+}
+
+}  // namespace
+
+std::unique_ptr<ProcessHandle> OpenProcessHandle(uint32_t pid, uint32_t access) {
+  (void)access;  // Linux checks ptrace permission per transfer
+
+  std::string procPath = "/proc/" + std::to_string(pid);
+  int procDir = open(procPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (procDir < 0) {
+    return nullptr;
+  }
+  return std::unique_ptr<ProcessHandle>(new LinuxProcessHandle(static_cast<pid_t>(pid), procDir));
+}
+
+bool ListProcessEntries(std::vector<ProcessEntry>& processes) {
+  DIR* proc = opendir("/proc");
+  if (!proc) {
+    return false;
+  }
+
+  processes.clear();
+  while (struct dirent* entry = readdir(proc)) {
+    char* end = nullptr;
+    unsigned long pid = strtoul(entry->d_name, &end, 10);
+    if (*end != '\0' || pid == 0) {
+      continue;
+    }
+
+    ProcessEntry process;
+    process.pid = static_cast<uint32_t>(pid);
+    process.name = ProcessName(std::string("/proc/") + entry->d_name);
+    processes.push_back(std::move(process));
+  }
+
+  closedir(proc);
+  return true;
+}
+
+bool ListProcessIds(std::vector<uint32_t>& pids) {
+  DIR* proc = opendir("/proc");
+  if (!proc) {
+    return false;
+  }
+
+  pids.clear();
+  while (struct dirent* entry = readdir(proc)) {
+    char* end = nullptr;
+    unsigned long pid = strtoul(entry->d_name, &end, 10);
+    if (*end == '\0' && pid != 0) {
+      pids.push_back(static_cast<uint32_t>(pid));
+    }
+  }
+
+  closedir(proc);
+  return true;
+}
+
+bool GetProcessImage(uint32_t pid, std::string& name, std::string& path) {
+  std::string procDir = "/proc/" + std::to_string(pid);
+  char target[PATH_MAX];
+  ssize_t length = readlink((procDir + "/exe").c_str(), target, sizeof(target) - 1);
+  if (length < 0) {
+    return false;
+  }
+  path.assign(target, static_cast<size_t>(length));
+  name = ProcessName(procDir);
+
+  // Wine runs every program as its loader; argv[0] holds the real image
+  std::string cmdline;
+  if (ReadProcFile(procDir + "/cmdline", cmdline) && !cmdline.empty()) {
+    std::string argv0 = cmdline.c_str();
+    size_t slash = path.find_last_of('/');
+    std::string exeName = slash == std::string::npos ? path : path.substr(slash + 1);
+    if (argv0.find('\\') != std::string::npos && name != exeName) {
+      path = argv0;
+    }
+  }
+  return true;
+}
+
+namespace {
+
+// pidfds become readable when their process exits, so one poll() covers
+// every monitored process plus an eventfd for Wake(). Kernels without
+// pidfds fall back to checking each process when the wait times out.
+class LinuxExitMonitor : public ExitMonitor {
+ public:
+  LinuxExitMonitor() : wake_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {}
+
+  ~LinuxExitMonitor() override {
+    for (auto& entry : pidfds_) {
+      close(entry.second);
+    }
+    if (wake_ >= 0) {
+      close(wake_);
+    }
+  }
+
+  bool Add(uint32_t pid) override {
+    if (pidfds_.count(pid) || fallback_.count(pid)) {
+      return true;
+    }
+    int fd = static_cast<int>(syscall(SYS_pidfd_open, static_cast<pid_t>(pid), 0));
+    if (fd >= 0) {
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+      pidfds_[pid] = fd;
+      return true;
+    }
+    if (errno == ESRCH) {
+      return false;
+    }
+    std::unique_ptr<ProcessHandle> process = OpenProcessHandle(pid, kAccessQuery);
+    if (!process || !process->IsAlive()) {
+      return false;
+    }
+    fallback_[pid] = std::move(process);
+    return true;
+  }
+
+  void Remove(uint32_t pid) override {
+    auto it = pidfds_.find(pid);
+    if (it != pidfds_.end()) {
+      close(it->second);
+      pidfds_.erase(it);
+    }
+    fallback_.erase(pid);
+  }
+
+  void Wait(std::chrono::milliseconds timeout, std::vector<uint32_t>& exited) override {
+    std::vector<struct pollfd> fds;
+    std::vector<uint32_t> pids;
+    fds.reserve(pidfds_.size() + 1);
+    fds.push_back({ wake_, POLLIN, 0 });
+    for (auto& entry : pidfds_) {
+      fds.push_back({ entry.second, POLLIN, 0 });
+      pids.push_back(entry.first);
+    }
+
+    int ready = poll(fds.data(), fds.size(), static_cast<int>(timeout.count()));
+    if (ready > 0) {
+      if (fds[0].revents) {
+        uint64_t count;
+        while (read(wake_, &count, sizeof(count)) > 0) {
+        }
+      }
+      for (size_t i = 1; i < fds.size(); i++) {
+        if (fds[i].revents) {
+          exited.push_back(pids[i - 1]);
+          Remove(pids[i - 1]);
+        }
+      }
+    }
+
+    for (auto it = fallback_.begin(); it != fallback_.end();) {
+      if (!it->second->IsAlive()) {
+        exited.push_back(it->first);
+        it = fallback_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void Wake() override {
+    uint64_t one = 1;
+    ssize_t written = write(wake_, &one, sizeof(one));
+    (void)written;
+  }
+
+ private:
+  int wake_;
+  std::unordered_map<uint32_t, int> pidfds_;
+  std::unordered_map<uint32_t, std::unique_ptr<ProcessHandle>> fallback_;
+};
+
+}  // namespace
+
+std::unique_ptr<ExitMonitor> CreateExitMonitor() {
+  return std::unique_ptr<ExitMonitor>(new LinuxExitMonitor());
+}
+
+void* AllocatePages(size_t size) {
+  void* pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return pages == MAP_FAILED ? nullptr : pages;
+}
+
+void FreePages(void* pages, size_t size) {
+  if (pages) {
+    munmap(pages, size);
+  }
+}
+
+namespace {
+
+class LinuxMappedFile : public MappedFile {
+ public:
+  LinuxMappedFile(const uint8_t* data, uint64_t size) : data_(data), size_(size) {}
+
+  ~LinuxMappedFile() override {
+    if (data_) {
+      munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+    }
+  }
+
+  const uint8_t* Data() const override { return data_; }
+  uint64_t Size() const override { return size_; }
+
+ private:
+  const uint8_t* data_;
+  uint64_t size_;
+};
+
+}  // namespace
+
+std::unique_ptr<MappedFile> MapFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    int error = errno;
+    close(fd);
+    errno = error;
+    return nullptr;
+  }
+  uint64_t size = static_cast<uint64_t>(info.st_size);
+  void* data = nullptr;
+  if (size > 0) {
+    data = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd, 0);
+  }
+  // The mapping keeps the file open
+  int error = errno;
+  close(fd);
+  if (data == MAP_FAILED) {
+    errno = error;
+    return nullptr;
+  }
+  return std::unique_ptr<MappedFile>(new LinuxMappedFile(static_cast<const uint8_t*>(data), size));
+}
+
+FILE* OpenFile(const std::string& path, const char* mode) {
+  return fopen(path.c_str(), mode);
+}
+
+bool RemoveFile(const std::string& path) {
+  return unlink(path.c_str()) == 0;
+}
+
+bool SeekFile(FILE* file, uint64_t offset) {
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+}
+
+// hrtimers already give sub-millisecond sleeps
+void BeginHighResolutionTimer() {}
+
+void EndHighResolutionTimer() {}
+
+std::string GetLastErrorAsString() {
+  return ErrorCodeToString(errno);
+}
+
+std::string ErrorCodeToString(int error) {
+  if (error == 0) {
+    return "No error";
+  }
+
+  std::stringstream ss;
+  ss << "Error " << error << ": " << strerror(error);
+  return ss.str();
+}
@@ -0,0 +1,505 @@
+#include "platform.h"
+#include "metrics.h"
+#include <windows.h>
+#include <tlhelp32.h>
+#include <psapi.h>
+#include <mmsystem.h>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+uint32_t ConvertProtection(DWORD protect) {
+  uint32_t protection = 0;
+  switch (protect & 0xFF) {
+    case PAGE_READONLY:
+      protection = kProtRead;
+      break;
+    case PAGE_READWRITE:
+    case PAGE_WRITECOPY:
+      protection = kProtRead | kProtWrite;
+      break;
+    case PAGE_EXECUTE:
+      protection = kProtExecute;
+      break;
+    case PAGE_EXECUTE_READ:
+      protection = kProtRead | kProtExecute;
+      break;
+    case PAGE_EXECUTE_READWRITE:
+    case PAGE_EXECUTE_WRITECOPY:
+      protection = kProtRead | kProtWrite | kProtExecute;
+      break;
+    default:
+      break;
+  }
+  if (protect & PAGE_GUARD) {
+    protection |= kProtGuard;
+  }
+  return protection;
+}
+
+RegionType ConvertType(DWORD type) {
+  switch (type) {
+    case MEM_IMAGE:
+      return RegionType::Image;
+    case MEM_MAPPED:
+      return RegionType::Mapped;
+    default:
+      return RegionType::Private;
+  }
+}
+
+class WinProcessHandle : public ProcessHandle {
+ public:
+  WinProcessHandle(uint32_t pid, HANDLE handle) : pid_(pid), handle_(handle) {}
+
+  ~WinProcessHandle() override {
+    CloseHandle(handle_);
+  }
+
+  uint32_t Pid() const override { return pid_; }
+
+  bool IsAlive() override {
+    return WaitForSingleObject(handle_, 0) == WAIT_TIMEOUT;
+  }
+
+  uint32_t PointerSize() override {
+#ifdef _WIN64
+    // Project64 and most emulators of its era are 32-bit processes
+    BOOL wow64 = FALSE;
+    return IsWow64Process(handle_, &wow64) && wow64 ? 4 : 8;
+#else
+    return 4;
+#endif
+  }
+
+  bool EnumerateRegions(std::vector<MemoryRegion>& regions, uint64_t start = 0,
+                        uint64_t end = UINT64_MAX) override {
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+
+    regions.clear();
+    MEMORY_BASIC_INFORMATION memInfo;
+    LPVOID addr = sysInfo.lpMinimumApplicationAddress;
+    if (start > (uint64_t)addr) {
+      addr = (LPVOID)start;
+      // A query inside a region reports it clipped at the queried page, so
+      // the walk restarts at its allocation and skips whatever ends before
+      // `start`; the straddling region then comes back whole
+      if (VirtualQueryEx(handle_, addr, &memInfo, sizeof(memInfo)) && memInfo.State != MEM_FREE &&
+          memInfo.AllocationBase != NULL && memInfo.AllocationBase < addr &&
+          memInfo.AllocationBase >= sysInfo.lpMinimumApplicationAddress) {
+        addr = memInfo.AllocationBase;
+      }
+    }
+    LPVOID stop = sysInfo.lpMaximumApplicationAddress;
+    if (end < (uint64_t)stop) {
+      stop = (LPVOID)end;
+    }
+
+    // The sections of one module share an allocation, so its file name is
+    // looked up once rather than per region
+    PVOID pathAllocation = NULL;
+    std::string path;
+
+    while (addr < stop) {
+      if (!VirtualQueryEx(handle_, addr, &memInfo, sizeof(memInfo))) {
+        return !regions.empty();
+      }
+
+      if (memInfo.State == MEM_COMMIT && (uint64_t)memInfo.BaseAddress + memInfo.RegionSize > start) {
+        MemoryRegion region;
+        region.base = (uint64_t)memInfo.BaseAddress;
+        region.size = memInfo.RegionSize;
+        region.protection = ConvertProtection(memInfo.Protect);
+        region.type = ConvertType(memInfo.Type);
+        if (region.type != RegionType::Private) {
+          if (memInfo.AllocationBase != pathAllocation) {
+            char name[MAX_PATH];
+            DWORD length = GetMappedFileNameA(handle_, memInfo.BaseAddress, name, MAX_PATH);
+            path.assign(name, length);
+            pathAllocation = memInfo.AllocationBase;
+          }
+          region.path = path;
+        }
+        regions.push_back(std::move(region));
+      }
+
+      addr = (BYTE*)memInfo.BaseAddress + memInfo.RegionSize;
+    }
+    return true;
+  }
+
+  size_t Read(uint64_t address, void* buffer, size_t size) override {
+    SIZE_T bytesRead = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BOOL success = ReadProcessMemory(handle_, (LPCVOID)address, buffer, size, &bytesRead);
+    RecordTransferCall(false, bytesRead, std::chrono::steady_clock::now() - start);
+    if (!success) {
+      DWORD error = GetLastError();
+      RecordTransferError(false, (int)error);
+      SetLastError(error);
+    }
+    return bytesRead;
+  }
+
+  size_t Write(uint64_t address, const void* buffer, size_t size) override {
+    SIZE_T bytesWritten = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BOOL success = WriteProcessMemory(handle_, (LPVOID)address, buffer, size, &bytesWritten);
+    RecordTransferCall(true, bytesWritten, std::chrono::steady_clock::now() - start);
+    if (!success) {
+      DWORD error = GetLastError();
+      RecordTransferError(true, (int)error);
+      SetLastError(error);
+    }
+    return bytesWritten;
+  }
+
+  // Win32 has no vectored cross-process copy, so batches are a loop of
+  // single calls on the one handle
+  size_t ReadMany(MemoryRange* ranges, size_t count) override {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+      MemoryRange& range = ranges[i];
+      SIZE_T bytesRead = 0;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      BOOL success = ReadProcessMemory(handle_, (LPCVOID)range.address, range.buffer, range.size, &bytesRead);
+      range.transferred = bytesRead;
+      range.error = success ? 0 : (int)GetLastError();
+      RecordTransferCall(false, bytesRead, std::chrono::steady_clock::now() - start);
+      if (range.error) {
+        RecordTransferError(false, range.error);
+      }
+      total += bytesRead;
+    }
+    return total;
+  }
+
+  size_t WriteMany(MemoryRange* ranges, size_t count) override {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+      MemoryRange& range = ranges[i];
+      SIZE_T bytesWritten = 0;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      BOOL success = WriteProcessMemory(handle_, (LPVOID)range.address, range.buffer, range.size, &bytesWritten);
+      range.transferred = bytesWritten;
+      range.error = success ? 0 : (int)GetLastError();
+      RecordTransferCall(true, bytesWritten, std::chrono::steady_clock::now() - start);
+      if (range.error) {
+        RecordTransferError(true, range.error);
+      }
+      total += bytesWritten;
+    }
+    return total;
+  }
+
+ private:
+  uint32_t pid_;
+  HANDLE handle_;
+};
+
+}  // namespace
+
+std::unique_ptr<ProcessHandle> OpenProcessHandle(uint32_t pid, uint32_t access) {
+  // SYNCHRONIZE lets IsAlive() wait on the handle
+  DWORD rights = SYNCHRONIZE;
+  if (access & kAccessRead) rights |= PROCESS_VM_READ;
+  if (access & kAccessWrite) rights |= PROCESS_VM_WRITE | PROCESS_VM_OPERATION;
+  if (access & kAccessQuery) rights |= PROCESS_QUERY_INFORMATION;
+
+  HANDLE handle = OpenProcess(rights, FALSE, pid);
+  if (handle == NULL) {
+    return nullptr;
+  }
+  return std::unique_ptr<ProcessHandle>(new WinProcessHandle(pid, handle));
+}
+
+bool ListProcessEntries(std::vector<ProcessEntry>& processes) {
+  HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+  if (snapshot == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  processes.clear();
+  PROCESSENTRY32 processEntry;
+  processEntry.dwSize = sizeof(PROCESSENTRY32);
+
+  if (Process32First(snapshot, &processEntry)) {
+    do {
+      ProcessEntry process;
+      process.pid = processEntry.th32ProcessID;
+      process.name = processEntry.szExeFile;
+      processes.push_back(std::move(process));
+    } while (Process32Next(snapshot, &processEntry));
+  }
+
+  CloseHandle(snapshot);
+  return true;
+}
+
+void* AllocatePages(size_t size) {
+  return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+}
+
+void FreePages(void* pages, size_t size) {
+  (void)size;
+  if (pages) {
+    VirtualFree(pages, 0, MEM_RELEASE);
+  }
+}
+
+namespace {
+
+std::wstring Utf8ToWide(const std::string& text) {
+  if (text.empty()) {
+    return std::wstring();
+  }
+  int length = MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), NULL, 0);
+  std::wstring wide(length, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), &wide[0], length);
+  return wide;
+}
+
+std::string WideToUtf8(const wchar_t* text, int size) {
+  if (size <= 0) {
+    return std::string();
+  }
+  int length = WideCharToMultiByte(CP_UTF8, 0, text, size, NULL, 0, NULL, NULL);
+  std::string utf8(length, '\0');
+  WideCharToMultiByte(CP_UTF8, 0, text, size, &utf8[0], length, NULL, NULL);
+  return utf8;
+}
+
+class WinMappedFile : public MappedFile {
+ public:
+  WinMappedFile(HANDLE mapping, const uint8_t* data, uint64_t size) : mapping_(mapping), data_(data), size_(size) {}
+
+  ~WinMappedFile() override {
+    if (data_) {
+      UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+      CloseHandle(mapping_);
+    }
+  }
+
+  const uint8_t* Data() const override { return data_; }
+  uint64_t Size() const override { return size_; }
+
+ private:
+  HANDLE mapping_;
+  const uint8_t* data_;
+  uint64_t size_;
+};
+
+}  // namespace
+
+std::unique_ptr<MappedFile> MapFile(const std::string& path) {
+  HANDLE file = CreateFileW(Utf8ToWide(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    DWORD error = GetLastError();
+    CloseHandle(file);
+    SetLastError(error);
+    return nullptr;
+  }
+  if (size.QuadPart == 0) {
+    CloseHandle(file);
+    return std::unique_ptr<MappedFile>(new WinMappedFile(NULL, nullptr, 0));
+  }
+
+  // The mapping keeps the file open
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  DWORD error = GetLastError();
+  CloseHandle(file);
+  if (!mapping) {
+    SetLastError(error);
+    return nullptr;
+  }
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data) {
+    error = GetLastError();
+    CloseHandle(mapping);
+    SetLastError(error);
+    return nullptr;
+  }
+  return std::unique_ptr<MappedFile>(
+    new WinMappedFile(mapping, static_cast<const uint8_t*>(data), static_cast<uint64_t>(size.QuadPart)));
+}
+
+FILE* OpenFile(const std::string& path, const char* mode) {
+  return _wfopen(Utf8ToWide(path).c_str(), Utf8ToWide(mode).c_str());
+}
+
+bool RemoveFile(const std::string& path) {
+  return DeleteFileW(Utf8ToWide(path).c_str()) != 0;
+}
+
+bool SeekFile(FILE* file, uint64_t offset) {
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+}
+
+bool ListProcessIds(std::vector<uint32_t>& pids) {
+  // EnumProcesses cannot say how many ids there are, only whether the
+  // buffer was filled
+  std::vector<DWORD> ids(1024);
+  DWORD bytes = 0;
+  for (;;) {
+    DWORD capacity = static_cast<DWORD>(ids.size() * sizeof(DWORD));
+    if (!EnumProcesses(ids.data(), capacity, &bytes)) {
+      return false;
+    }
+    if (bytes < capacity) {
+      break;
+    }
+    ids.resize(ids.size() * 2);
+  }
+
+  pids.clear();
+  for (size_t i = 0; i < bytes / sizeof(DWORD); i++) {
+    if (ids[i] != 0) {
+      pids.push_back(ids[i]);
+    }
+  }
+  return true;
+}
+
+bool GetProcessImage(uint32_t pid, std::string& name, std::string& path) {
+  HANDLE handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (handle == NULL) {
+    return false;
+  }
+  wchar_t buffer[MAX_PATH * 4];
+  DWORD length = MAX_PATH * 4;
+  BOOL ok = QueryFullProcessImageNameW(handle, 0, buffer, &length);
+  CloseHandle(handle);
+  if (!ok) {
+    return false;
+  }
+  path = WideToUtf8(buffer, static_cast<int>(length));
+  size_t slash = path.find_last_of('\\');
+  name = slash == std::string::npos ? path : path.substr(slash + 1);
+  return true;
+}
+
+namespace {
+
+// Process handles are signaled when the process exits. One
+// WaitForMultipleObjects call covers the wake event and the first
+// MAXIMUM_WAIT_OBJECTS - 1 processes; any beyond that are checked
+// whenever the wait returns.
+class WinExitMonitor : public ExitMonitor {
+ public:
+  WinExitMonitor() : wake_(CreateEventW(NULL, FALSE, FALSE, NULL)) {}
+
+  ~WinExitMonitor() override {
+    for (auto& entry : handles_) {
+      CloseHandle(entry.second);
+    }
+    if (wake_) {
+      CloseHandle(wake_);
+    }
+  }
+
+  bool Add(uint32_t pid) override {
+    if (handles_.count(pid)) {
+      return true;
+    }
+    HANDLE handle = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (handle == NULL) {
+      return false;
+    }
+    if (WaitForSingleObject(handle, 0) != WAIT_TIMEOUT) {
+      CloseHandle(handle);
+      return false;
+    }
+    handles_[pid] = handle;
+    return true;
+  }
+
+  void Remove(uint32_t pid) override {
+    auto it = handles_.find(pid);
+    if (it != handles_.end()) {
+      CloseHandle(it->second);
+      handles_.erase(it);
+    }
+  }
+
+  void Wait(std::chrono::milliseconds timeout, std::vector<uint32_t>& exited) override {
+    std::vector<HANDLE> waits;
+    waits.push_back(wake_);
+    for (auto& entry : handles_) {
+      if (waits.size() == MAXIMUM_WAIT_OBJECTS) {
+        break;
+      }
+      waits.push_back(entry.second);
+    }
+    WaitForMultipleObjects(static_cast<DWORD>(waits.size()), waits.data(), FALSE,
+                           static_cast<DWORD>(timeout.count()));
+
+    for (auto it = handles_.begin(); it != handles_.end();) {
+      if (WaitForSingleObject(it->second, 0) == WAIT_OBJECT_0) {
+        exited.push_back(it->first);
+        CloseHandle(it->second);
+        it = handles_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void Wake() override {
+    SetEvent(wake_);
+  }
+
+ private:
+  HANDLE wake_;
+  std::unordered_map<uint32_t, HANDLE> handles_;
+};
+
+}  // namespace
+
+std::unique_ptr<ExitMonitor> CreateExitMonitor() {
+  return std::unique_ptr<ExitMonitor>(new WinExitMonitor());
+}
+
+void BeginHighResolutionTimer() {
+  timeBeginPeriod(1);
+}
+
+void EndHighResolutionTimer() {
+  timeEndPeriod(1);
+}
+
+std::string GetLastErrorAsString() {
+  return ErrorCodeToString((int)GetLastError());
+}
+
+std::string ErrorCodeToString(int error) {
+  if (error == 0) {
+    return "No error";
+  }
+
+  LPSTR messageBuffer = nullptr;
+  size_t size = FormatMessageA(
+    FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+    NULL,
+    (DWORD)error,
+    MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+    (LPSTR)&messageBuffer,
+    0,
+    NULL
+  );
+
+  std::string message(messageBuffer, size);
+  LocalFree(messageBuffer);
+
+  std::stringstream ss;
+  ss << "Error " << error << ": " << message;
+  return ss.str();
+}
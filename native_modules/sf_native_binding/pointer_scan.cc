@@ -0,0 +1,537 @@
+#include "pointer_scan.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include "log.h"
+#include "region_map.h"
+#include "thread_pool.h"
+
+namespace {
+
+// Entries per block of a spilled run, the unit read back from disk
+const size_t kBlockEntries = 8192;
+// Targets handed to one pool task by FindReferrers
+const size_t kTargetsPerTask = 4096;
+
+typedef std::pair<uint64_t, uint64_t> IndexPair;
+
+uint64_t LoadPointer(const uint8_t* data, uint32_t pointerSize) {
+  if (pointerSize == 4) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+bool IsReadable(const MemoryRegion& region) {
+  return (region.protection & kProtRead) && !(region.protection & kProtGuard);
+}
+
+// The readable address ranges a pointer may point into, with adjacent
+// regions merged
+class AddressRanges {
+ public:
+  explicit AddressRanges(const std::vector<MemoryRegion>& regions) {
+    for (const MemoryRegion& region : regions) {
+      if (!IsReadable(region)) {
+        continue;
+      }
+      if (!ends_.empty() && ends_.back() == region.base) {
+        ends_.back() += region.size;
+      } else {
+        starts_.push_back(region.base);
+        ends_.push_back(region.base + region.size);
+      }
+    }
+  }
+
+  bool Contains(uint64_t address) const {
+    // Most values are not pointers at all; reject those without searching
+    if (starts_.empty() || address < starts_.front() || address >= ends_.back()) {
+      return false;
+    }
+    size_t i = std::upper_bound(starts_.begin(), starts_.end(), address) - starts_.begin() - 1;
+    return address < ends_[i];
+  }
+
+ private:
+  std::vector<uint64_t> starts_;
+  std::vector<uint64_t> ends_;
+};
+
+// Module images, where chains start
+class StaticRanges {
+ public:
+  struct Range {
+    uint64_t start;
+    uint64_t end;
+    uint64_t moduleBase;
+    std::string module;
+  };
+
+  explicit StaticRanges(const std::vector<MemoryRegion>& regions) {
+    std::map<std::string, uint64_t> moduleBases;
+    for (const MemoryRegion& region : regions) {
+      std::string module = RegionModule(region);
+      if (module.empty()) {
+        continue;
+      }
+      // Regions are sorted, so a module's first region is its base
+      uint64_t moduleBase = moduleBases.emplace(module, region.base).first->second;
+      ranges_.push_back({ region.base, region.base + region.size, moduleBase, module });
+    }
+  }
+
+  const Range* Find(uint64_t address) const {
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), address,
+                               [](uint64_t value, const Range& range) { return value < range.start; });
+    if (it == ranges_.begin() || address >= (it - 1)->end) {
+      return nullptr;
+    }
+    return &*(it - 1);
+  }
+
+ private:
+  std::vector<Range> ranges_;
+};
+
+}  // namespace
+
+struct PointerIndex::Run {
+  uint64_t count = 0;
+  // Resident runs
+  std::vector<uint64_t> values;
+  std::vector<uint64_t> addresses;
+  // Spilled runs: every value, then every address, and in memory the
+  // first value of each block
+  FILE* file = nullptr;
+  std::vector<uint64_t> fence;
+  std::mutex fileMutex;
+
+  ~Run() {
+    if (file) {
+      fclose(file);
+    }
+  }
+
+  size_t Blocks() const { return file ? fence.size() : 1; }
+};
+
+// Walks one run, keeping the last block read from disk
+class PointerIndex::Cursor {
+ public:
+  explicit Cursor(Run& run) : run_(run) {}
+
+  // Calls visit(value, address) for every entry with a value in
+  // [low, high]. False if a spilled block could not be read.
+  template <typename Visitor>
+  bool Visit(uint64_t low, uint64_t high, Visitor visit) {
+    if (run_.count == 0) {
+      return true;
+    }
+    size_t block = 0;
+    if (run_.file) {
+      // The block before the first one starting at or past `low` may end
+      // with values equal to it
+      block = std::lower_bound(run_.fence.begin(), run_.fence.end(), low) - run_.fence.begin();
+      block = block > 0 ? block - 1 : 0;
+    }
+    for (; block < run_.Blocks(); block++) {
+      if (!Load(block)) {
+        return false;
+      }
+      size_t i = std::lower_bound(values_, values_ + size_, low) - values_;
+      for (; i < size_ && values_[i] <= high; i++) {
+        visit(values_[i], addresses_[i]);
+      }
+      if (i < size_ || (block + 1 < run_.Blocks() && run_.fence[block + 1] > high)) {
+        break;
+      }
+    }
+    return true;
+  }
+
+ private:
+  bool Load(size_t block) {
+    if (!run_.file) {
+      values_ = run_.values.data();
+      addresses_ = run_.addresses.data();
+      size_ = run_.count;
+      return true;
+    }
+    if (block == loaded_) {
+      return true;
+    }
+
+    uint64_t first = static_cast<uint64_t>(block) * kBlockEntries;
+    size_ = static_cast<size_t>(std::min<uint64_t>(kBlockEntries, run_.count - first));
+    valueBuffer_.resize(size_);
+    addressBuffer_.resize(size_);
+    std::lock_guard<std::mutex> lock(run_.fileMutex);
+    if (!SeekFile(run_.file, first * 8) || fread(valueBuffer_.data(), 8, size_, run_.file) != size_ ||
+        !SeekFile(run_.file, (run_.count + first) * 8) ||
+        fread(addressBuffer_.data(), 8, size_, run_.file) != size_) {
+      loaded_ = SIZE_MAX;
+      return false;
+    }
+    values_ = valueBuffer_.data();
+    addresses_ = addressBuffer_.data();
+    loaded_ = block;
+    return true;
+  }
+
+  Run& run_;
+  size_t loaded_ = SIZE_MAX;
+  const uint64_t* values_ = nullptr;
+  const uint64_t* addresses_ = nullptr;
+  size_t size_ = 0;
+  std::vector<uint64_t> valueBuffer_;
+  std::vector<uint64_t> addressBuffer_;
+};
+
+PointerIndex::PointerIndex(uint32_t pointerSize, size_t memoryLimit)
+  : pointerSize_(pointerSize), memoryLimit_(memoryLimit) {}
+
+PointerIndex::~PointerIndex() = default;
+
+size_t PointerIndex::SpilledRuns() const {
+  size_t spilled = 0;
+  for (const std::unique_ptr<Run>& run : runs_) {
+    spilled += run->file ? 1 : 0;
+  }
+  return spilled;
+}
+
+bool PointerIndex::AddRun(std::vector<IndexPair>& pairs, bool resident, std::string& error) {
+  std::sort(pairs.begin(), pairs.end());
+  std::unique_ptr<Run> run(new Run());
+  run->count = pairs.size();
+
+  if (resident) {
+    run->values.reserve(pairs.size());
+    run->addresses.reserve(pairs.size());
+    for (const IndexPair& pair : pairs) {
+      run->values.push_back(pair.first);
+      run->addresses.push_back(pair.second);
+    }
+  } else {
+    run->file = std::tmpfile();
+    if (!run->file) {
+      error = "Failed to create a temporary file for the pointer index";
+      return false;
+    }
+    std::vector<uint64_t> chunk;
+    chunk.reserve(kBlockEntries);
+    for (int column = 0; column < 2; column++) {
+      for (size_t i = 0; i < pairs.size(); i += kBlockEntries) {
+        size_t end = std::min(pairs.size(), i + kBlockEntries);
+        chunk.clear();
+        for (size_t j = i; j < end; j++) {
+          chunk.push_back(column == 0 ? pairs[j].first : pairs[j].second);
+        }
+        if (column == 0) {
+          run->fence.push_back(chunk.front());
+        }
+        if (fwrite(chunk.data(), 8, chunk.size(), run->file) != chunk.size()) {
+          error = "Failed to spill the pointer index to disk";
+          return false;
+        }
+      }
+    }
+    SF_LOG(Debug, "Spilled %zu pointers to disk", pairs.size());
+  }
+  pairs.clear();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  count_ += run->count;
+  runs_.push_back(std::move(run));
+  return true;
+}
+
+bool PointerIndex::Build(ProcessHandle& process, const std::vector<MemoryRegion>& regions, std::string& error,
+                         const std::atomic<bool>* cancelled, const ScanProgressCallback& onProgress) {
+  ThreadPool& pool = ThreadPool::Shared();
+  AddressRanges targets(regions);
+
+  // Half the limit for worker buffers, half for the final resident run
+  size_t workerCapacity = std::max<size_t>(kBlockEntries, memoryLimit_ / 2 / sizeof(IndexPair) / pool.Size());
+  std::vector<std::vector<IndexPair>> pending(pool.Size());
+  std::atomic<uint64_t> found(0);
+  std::atomic<bool> failed(false);
+  std::mutex errorMutex;
+
+  // Windows are page aligned, so aligned pointers never straddle two
+  StreamOptions options;
+  auto handler = [&](const StreamWindow& window) {
+    if (failed) {
+      return;
+    }
+    std::vector<IndexPair>& buffer = pending[ThreadPool::CurrentWorker()];
+    size_t bytes = std::min(window.size, window.available);
+    size_t before = buffer.size();
+    for (size_t offset = 0; offset + pointerSize_ <= bytes; offset += pointerSize_) {
+      uint64_t value = LoadPointer(window.data + offset, pointerSize_);
+      if (targets.Contains(value)) {
+        buffer.emplace_back(value, window.address + offset);
+      }
+    }
+    found += buffer.size() - before;
+
+    if (buffer.size() >= workerCapacity) {
+      std::string runError;
+      if (!AddRun(buffer, false, runError)) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        error = runError;
+        failed = true;
+      }
+    }
+  };
+
+  if (!StreamReadableRegions(process, regions, options, handler, found, cancelled, onProgress)) {
+    return false;
+  }
+  if (failed) {
+    return false;
+  }
+
+  std::vector<IndexPair> rest;
+  for (std::vector<IndexPair>& buffer : pending) {
+    rest.insert(rest.end(), buffer.begin(), buffer.end());
+    std::vector<IndexPair>().swap(buffer);
+  }
+  return AddRun(rest, true, error);
+}
+
+bool PointerIndex::FindReferrers(const std::vector<uint64_t>& targets, uint64_t maxOffset,
+                                 std::vector<Referrer>& referrers, std::string& error,
+                                 const std::atomic<bool>* cancelled) const {
+  size_t tasks = (targets.size() + kTargetsPerTask - 1) / kTargetsPerTask;
+  std::vector<std::vector<Referrer>> found(tasks);
+  std::atomic<bool> failed(false);
+  {
+    TaskGroup group(ThreadPool::Shared());
+    for (size_t t = 0; t < tasks; t++) {
+      group.Run([&, t]() {
+        size_t first = t * kTargetsPerTask;
+        size_t last = std::min(targets.size(), first + kTargetsPerTask);
+        for (const std::unique_ptr<Run>& run : runs_) {
+          Cursor cursor(*run);
+          for (size_t i = first; i < last; i++) {
+            if (failed || (cancelled && cancelled->load())) {
+              return;
+            }
+            uint64_t target = targets[i];
+            uint64_t low = target > maxOffset ? target - maxOffset : 0;
+            bool read = cursor.Visit(low, target, [&](uint64_t value, uint64_t address) {
+              found[t].push_back({ address, target - value, i });
+            });
+            if (!read) {
+              failed = true;
+              return;
+            }
+          }
+        }
+      });
+    }
+  }
+
+  if (failed) {
+    error = "Failed to read the pointer index back from disk";
+    return false;
+  }
+  if (cancelled && cancelled->load()) {
+    return false;
+  }
+  for (std::vector<Referrer>& part : found) {
+    referrers.insert(referrers.end(), part.begin(), part.end());
+  }
+  return true;
+}
+
+namespace {
+
+// Addresses reached at one depth of the search, sorted, and the edges
+// leading from each of them to the level below
+struct SearchLevel {
+  struct Edge {
+    size_t node;
+    size_t parent;
+    uint64_t offset;
+  };
+  std::vector<uint64_t> addresses;
+  // Sorted by node
+  std::vector<Edge> edges;
+};
+
+// A pointer in a module image leading to node `parent` of `level`
+struct ChainStart {
+  const StaticRanges::Range* range;
+  uint64_t address;
+  size_t level;
+  size_t parent;
+  uint64_t offset;
+};
+
+// Emits every path from node `node` of `level` down to the target,
+// prefixed by `chain`. False once `maxResults` chains exist.
+bool EmitChains(const std::vector<SearchLevel>& levels, size_t level, size_t node, PointerChain& chain,
+                size_t maxResults, std::vector<PointerChain>& chains) {
+  if (level == 0) {
+    chains.push_back(chain);
+    return chains.size() < maxResults;
+  }
+  const std::vector<SearchLevel::Edge>& edges = levels[level].edges;
+  auto first = std::lower_bound(edges.begin(), edges.end(), node,
+                                [](const SearchLevel::Edge& edge, size_t value) { return edge.node < value; });
+  for (auto edge = first; edge != edges.end() && edge->node == node; ++edge) {
+    chain.offsets.push_back(edge->offset);
+    bool more = EmitChains(levels, level - 1, edge->parent, chain, maxResults, chains);
+    chain.offsets.pop_back();
+    if (!more) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool FindPointerChains(ProcessHandle& process, const std::vector<MemoryRegion>& regions, uint64_t target,
+                       const PointerScanOptions& options, std::vector<PointerChain>& chains, bool& truncated,
+                       uint64_t& pointers, std::string& error, const std::atomic<bool>* cancelled,
+                       const ScanProgressCallback& onProgress) {
+  uint32_t pointerSize = options.pointerSize ? options.pointerSize : process.PointerSize();
+  truncated = false;
+  chains.clear();
+
+  PointerIndex index(pointerSize, options.memoryLimit);
+  if (!index.Build(process, regions, error, cancelled, onProgress)) {
+    return false;
+  }
+  pointers = index.Count();
+  SF_LOG(Debug, "Pointer index holds %llu pointers, %zu runs on disk",
+         static_cast<unsigned long long>(pointers), index.SpilledRuns());
+
+  StaticRanges statics(regions);
+  std::vector<SearchLevel> levels(1);
+  levels[0].addresses.push_back(target);
+  std::vector<uint64_t> visited(1, target);
+  std::vector<ChainStart> starts;
+
+  for (size_t depth = 0; depth < options.maxDepth; depth++) {
+    std::vector<PointerIndex::Referrer> referrers;
+    if (!index.FindReferrers(levels[depth].addresses, options.maxOffset, referrers, error, cancelled)) {
+      return false;
+    }
+    std::sort(referrers.begin(), referrers.end(),
+              [](const PointerIndex::Referrer& a, const PointerIndex::Referrer& b) { return a.address < b.address; });
+
+    SearchLevel next;
+    bool last = depth + 1 == options.maxDepth;
+    for (const PointerIndex::Referrer& referrer : referrers) {
+      const StaticRanges::Range* range = statics.Find(referrer.address);
+      if (range) {
+        starts.push_back({ range, referrer.address, depth, referrer.target, referrer.offset });
+        continue;
+      }
+      // Addresses already reached at a shallower depth only make longer
+      // chains to the same places
+      if (last || std::binary_search(visited.begin(), visited.end(), referrer.address)) {
+        continue;
+      }
+      if (next.addresses.empty() || next.addresses.back() != referrer.address) {
+        next.addresses.push_back(referrer.address);
+      }
+      next.edges.push_back({ next.addresses.size() - 1, referrer.target, referrer.offset });
+    }
+    SF_LOG(Debug, "Pointer scan depth %zu: %zu referrers, %zu static, %zu to expand", depth + 1, referrers.size(),
+           starts.size(), next.addresses.size());
+
+    if (next.addresses.empty()) {
+      break;
+    }
+    if (next.addresses.size() > options.maxNodes) {
+      truncated = true;
+      break;
+    }
+    std::vector<uint64_t> merged;
+    merged.reserve(visited.size() + next.addresses.size());
+    std::merge(visited.begin(), visited.end(), next.addresses.begin(), next.addresses.end(),
+               std::back_inserter(merged));
+    visited.swap(merged);
+    levels.push_back(std::move(next));
+  }
+
+  // Starts were found level by level, so shorter chains come first
+  for (const ChainStart& start : starts) {
+    PointerChain chain;
+    chain.module = start.range->module;
+    chain.baseOffset = start.address - start.range->moduleBase;
+    chain.offsets.push_back(start.offset);
+    if (!EmitChains(levels, start.level, start.parent, chain, options.maxResults, chains)) {
+      truncated = true;
+      break;
+    }
+  }
+  return true;
+}
+
+void ResolvePointerChains(ProcessHandle& process, const std::vector<MemoryRegion>& regions, uint32_t pointerSize,
+                          const std::vector<PointerChain>& chains, std::vector<uint64_t>& resolved) {
+  if (pointerSize == 0) {
+    pointerSize = process.PointerSize();
+  }
+  resolved.assign(chains.size(), 0);
+
+  std::map<std::string, uint64_t> moduleBases;
+  size_t depth = 0;
+  for (size_t i = 0; i < chains.size(); i++) {
+    const PointerChain& chain = chains[i];
+    auto known = moduleBases.find(chain.module);
+    if (known == moduleBases.end()) {
+      uint64_t base = 0;
+      FindModuleBase(regions, chain.module, base);
+      known = moduleBases.emplace(chain.module, base).first;
+    }
+    if (known->second != 0) {
+      resolved[i] = known->second + chain.baseOffset;
+    }
+    depth = std::max(depth, chain.offsets.size());
+  }
+
+  // One batched read per level across every chain still going
+  std::vector<size_t> active;
+  std::vector<MemoryRange> ranges;
+  std::vector<uint64_t> values;
+  for (size_t level = 0; level < depth; level++) {
+    active.clear();
+    for (size_t i = 0; i < chains.size(); i++) {
+      if (resolved[i] != 0 && level < chains[i].offsets.size()) {
+        active.push_back(i);
+      }
+    }
+    values.assign(active.size(), 0);
+    ranges.assign(active.size(), MemoryRange());
+    for (size_t j = 0; j < active.size(); j++) {
+      ranges[j].address = resolved[active[j]];
+      ranges[j].buffer = reinterpret_cast<uint8_t*>(&values[j]);
+      ranges[j].size = pointerSize;
+    }
+    process.ReadMany(ranges.data(), ranges.size());
+    for (size_t j = 0; j < active.size(); j++) {
+      size_t i = active[j];
+      if (ranges[j].transferred != pointerSize) {
+        resolved[i] = 0;
+        continue;
+      }
+      uint64_t pointer = LoadPointer(reinterpret_cast<const uint8_t*>(&values[j]), pointerSize);
+      resolved[i] = pointer == 0 ? 0 : pointer + chains[i].offsets[level];
+    }
+  }
+}
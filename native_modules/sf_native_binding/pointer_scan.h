@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "platform.h"
+#include "scanner.h"
+
+// A path from static memory to a value: read a pointer at the module's
+// base + baseOffset, add offsets[0], read a pointer there, add offsets[1]
+// and so on. The last offset lands on the value itself. Stable across runs
+// as long as the module and the game's data structures are.
+struct PointerChain {
+  // File name of the module holding the first pointer, e.g. "Project64.exe"
+  std::string module;
+  uint64_t baseOffset = 0;
+  std::vector<uint64_t> offsets;
+};
+
+struct PointerScanOptions {
+  // 4 or 8; 0 takes the target's ProcessHandle::PointerSize()
+  uint32_t pointerSize = 0;
+  // Pointers dereferenced per chain, i.e. the longest offsets list
+  uint32_t maxDepth = 4;
+  // Largest offset added after a dereference (structure field offsets)
+  uint64_t maxOffset = 0x1000;
+  // Chains reported before the search stops
+  size_t maxResults = 10000;
+  // Addresses expanded per level before deeper levels are given up
+  size_t maxNodes = 1 << 22;
+  // Bytes of index kept in memory; beyond that, sorted runs are spilled
+  // to temporary files
+  size_t memoryLimit = static_cast<size_t>(512) * 1024 * 1024;
+};
+
+// Every aligned pointer-sized value in a set of regions that points into
+// one of them, as (value, address) pairs sorted by value. The index is
+// kept as sorted runs: each pool worker collects pairs into its own
+// buffer and sorts and spills it as a run once the buffer reaches its
+// share of the memory limit, so building is parallel and memory stays
+// bounded however many pointers the target holds. Runs store values and
+// addresses in separate arrays, so searches stream through values alone.
+class PointerIndex {
+ public:
+  PointerIndex(uint32_t pointerSize, size_t memoryLimit);
+  ~PointerIndex();
+
+  PointerIndex(const PointerIndex&) = delete;
+  PointerIndex& operator=(const PointerIndex&) = delete;
+
+  // Same cancellation and progress contract as ScanForUint32; progress
+  // counts pointers as matches. False with an empty `error` if cancelled.
+  bool Build(ProcessHandle& process, const std::vector<MemoryRegion>& regions, std::string& error,
+             const std::atomic<bool>* cancelled = nullptr, const ScanProgressCallback& onProgress = nullptr);
+
+  uint64_t Count() const { return count_; }
+  size_t SpilledRuns() const;
+
+  // A pointer stored at `address` whose value lies `offset` bytes below
+  // `targets[target]`
+  struct Referrer {
+    uint64_t address;
+    uint64_t offset;
+    size_t target;
+  };
+
+  // Appends the referrers of every target within `maxOffset` bytes.
+  // `targets` must be sorted; the search walks each run once, in order,
+  // with the targets split across the shared pool.
+  bool FindReferrers(const std::vector<uint64_t>& targets, uint64_t maxOffset, std::vector<Referrer>& referrers,
+                     std::string& error, const std::atomic<bool>* cancelled = nullptr) const;
+
+ private:
+  struct Run;
+  class Cursor;
+
+  // Sorts `pairs` into a new run, spilled to disk unless `resident`
+  bool AddRun(std::vector<std::pair<uint64_t, uint64_t>>& pairs, bool resident, std::string& error);
+
+  uint32_t pointerSize_;
+  size_t memoryLimit_;
+  // Guards count_ and runs_ while workers add runs
+  std::mutex mutex_;
+  uint64_t count_ = 0;
+  std::vector<std::unique_ptr<Run>> runs_;
+};
+
+// Searches backwards from `target` for chains starting in a module image,
+// level by level: the pointers to the target, then the pointers to those,
+// up to maxDepth. Each address is expanded once, at its shallowest level.
+// Sets `truncated` when maxResults or maxNodes cut the search short.
+bool FindPointerChains(ProcessHandle& process, const std::vector<MemoryRegion>& regions, uint64_t target,
+                       const PointerScanOptions& options, std::vector<PointerChain>& chains, bool& truncated,
+                       uint64_t& pointers, std::string& error, const std::atomic<bool>* cancelled = nullptr,
+                       const ScanProgressCallback& onProgress = nullptr);
+
+// Follows every chain with one batched read per level. resolved[i] is the
+// address chain i leads to, or 0 when its module is not loaded or one of
+// its pointers could not be read. A `pointerSize` of 0 takes the target's.
+void ResolvePointerChains(ProcessHandle& process, const std::vector<MemoryRegion>& regions, uint32_t pointerSize,
+                          const std::vector<PointerChain>& chains, std::vector<uint64_t>& resolved);
@@ -0,0 +1,187 @@
+#include "process_watcher.h"
+#include <algorithm>
+#include <cctype>
+#include "log.h"
+
+namespace {
+
+std::string ToLower(std::string text) {
+  for (char& c : text) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return text;
+}
+
+bool ContainsAny(const std::string& text, const std::vector<std::string>& needles) {
+  std::string lower = ToLower(text);
+  for (const std::string& needle : needles) {
+    if (lower.find(ToLower(needle)) != std::string::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+bool ProcessFilter::Matches(const std::string& name, const std::string& path) const {
+  if (names.empty() && paths.empty()) {
+    return true;
+  }
+  return ContainsAny(name, names) || ContainsAny(path, paths);
+}
+
+ProcessWatcher::ProcessWatcher(const ProcessFilter& filter)
+  : filter_(filter) {}
+
+ProcessWatcher::~ProcessWatcher() {
+  Stop();
+}
+
+void ProcessWatcher::Start(NotifyCallback onEvents, std::chrono::milliseconds interval) {
+  Stop();
+  std::lock_guard<std::mutex> lock(mutex_);
+  // A new consumer starts from the processes running now
+  exits_ = CreateExitMonitor();
+  seen_.clear();
+  running_.clear();
+  pending_.clear();
+  notified_ = false;
+  onEvents_ = std::move(onEvents);
+  interval_ = interval;
+  stopping_ = false;
+  thread_ = std::thread(&ProcessWatcher::Run, this);
+}
+
+void ProcessWatcher::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    if (exits_) {
+      exits_->Wake();
+    }
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void ProcessWatcher::TakeEvents(std::vector<ProcessEvent>& events) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  events.swap(pending_);
+  pending_.clear();
+  notified_ = false;
+}
+
+std::vector<WatchedProcess> ProcessWatcher::Processes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<WatchedProcess> processes;
+  processes.reserve(running_.size());
+  for (auto& entry : running_) {
+    processes.push_back(entry.second);
+  }
+  std::sort(processes.begin(), processes.end(),
+            [](const WatchedProcess& a, const WatchedProcess& b) { return a.pid < b.pid; });
+  return processes;
+}
+
+void ProcessWatcher::Run() {
+  std::vector<uint32_t> exited;
+  for (;;) {
+    std::chrono::milliseconds interval;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_) {
+        break;
+      }
+      interval = interval_;
+    }
+
+    Discover();
+
+    exited.clear();
+    exits_->Wait(interval, exited);
+    if (exited.empty()) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (uint32_t pid : exited) {
+      auto it = running_.find(pid);
+      if (it == running_.end()) {
+        continue;
+      }
+      SF_LOG(Info, "process %u (%s) exited", pid, it->second.name.c_str());
+      Queue(false, it->second);
+      running_.erase(it);
+    }
+  }
+}
+
+void ProcessWatcher::Discover() {
+  std::vector<uint32_t> pids;
+  if (!ListProcessIds(pids)) {
+    return;
+  }
+
+  // Rebuilt every pass, so a pid that disappears and is reused later
+  // counts as a new process
+  std::unordered_map<uint32_t, uint32_t> seen;
+  std::vector<WatchedProcess> found;
+  for (uint32_t pid : pids) {
+    // Only this thread changes running_, so it may read it unlocked
+    if (running_.count(pid)) {
+      continue;
+    }
+    auto previous = seen_.find(pid);
+    uint32_t lookups = previous == seen_.end() ? kLookups : previous->second;
+    if (lookups == 0) {
+      seen[pid] = 0;
+      continue;
+    }
+
+    WatchedProcess process;
+    process.pid = pid;
+    if (!GetProcessImage(pid, process.name, process.path) || !filter_.Matches(process.name, process.path)) {
+      seen[pid] = lookups - 1;
+      continue;
+    }
+    if (!exits_->Add(pid)) {
+      // Already gone
+      seen[pid] = 0;
+      continue;
+    }
+
+    std::unique_ptr<ProcessHandle> handle = OpenProcessHandle(pid, kAccessRead | kAccessQuery);
+    std::vector<MemoryRegion> regions;
+    if (handle) {
+      process.bits = handle->PointerSize() * 8;
+      if (handle->EnumerateRegions(regions)) {
+        ListModules(regions, process.modules);
+      }
+    }
+    found.push_back(std::move(process));
+  }
+  seen_.swap(seen);
+
+  if (found.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (WatchedProcess& process : found) {
+    SF_LOG(Info, "process %u (%s) started, %u-bit, %zu modules", process.pid, process.name.c_str(), process.bits,
+           process.modules.size());
+    Queue(true, process);
+    running_[process.pid] = std::move(process);
+  }
+}
+
+void ProcessWatcher::Queue(bool started, const WatchedProcess& process) {
+  ProcessEvent event;
+  event.started = started;
+  event.process = process;
+  pending_.push_back(std::move(event));
+  if (!notified_ && onEvents_) {
+    notified_ = true;
+    onEvents_();
+  }
+}
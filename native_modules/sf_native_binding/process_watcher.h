@@ -0,0 +1,94 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "platform.h"
+#include "region_map.h"
+
+// Which processes a ProcessWatcher reports. A process matches when its
+// executable name contains one of `names` or its path one of `paths`,
+// compared case-insensitively; with both lists empty every process does.
+struct ProcessFilter {
+  std::vector<std::string> names;
+  std::vector<std::string> paths;
+
+  bool Matches(const std::string& name, const std::string& path) const;
+};
+
+// A matching process as it was when first seen
+struct WatchedProcess {
+  uint32_t pid = 0;
+  std::string name;
+  std::string path;
+  // 32 or 64; 0 when the process could not be opened
+  uint32_t bits = 0;
+  // Modules loaded when the process was found
+  std::vector<ModuleInfo> modules;
+};
+
+struct ProcessEvent {
+  // Start, else exit
+  bool started = true;
+  WatchedProcess process;
+};
+
+// Tracks the processes matching a filter from a background thread and
+// queues an event when one starts or exits. Only processes that are new
+// since the last look are queried, so a quiet system costs one cheap list
+// of process ids per interval, and exits are waited on through the
+// platform's ExitMonitor instead of being polled. Processes running when
+// the watcher starts are reported as started. Like WatchEngine, the
+// notify callback fires once when events become pending and not again
+// until the consumer takes them.
+class ProcessWatcher {
+ public:
+  typedef std::function<void()> NotifyCallback;
+
+  explicit ProcessWatcher(const ProcessFilter& filter);
+  ~ProcessWatcher();
+
+  ProcessWatcher(const ProcessWatcher&) = delete;
+  ProcessWatcher& operator=(const ProcessWatcher&) = delete;
+
+  // `onEvents` runs on the watcher thread. `interval` bounds how long a
+  // new process goes unnoticed; exits are reported as they happen.
+  void Start(NotifyCallback onEvents, std::chrono::milliseconds interval = std::chrono::milliseconds(500));
+  void Stop();
+
+  // Moves the pending events into `events`, oldest first
+  void TakeEvents(std::vector<ProcessEvent>& events);
+
+  // The matching processes currently running, by pid
+  std::vector<WatchedProcess> Processes();
+
+ private:
+  // Looks a process up a few times after it appears: a process can exec
+  // or, under Wine, rename itself once it has started
+  static const uint32_t kLookups = 4;
+
+  void Run();
+  // Finds processes started since the last call
+  void Discover();
+  // Queues an event and notifies the consumer. Called with mutex_ held.
+  void Queue(bool started, const WatchedProcess& process);
+
+  ProcessFilter filter_;
+  std::unique_ptr<ExitMonitor> exits_;
+  // Lookups left for each non-matching process seen on the last pass
+  std::unordered_map<uint32_t, uint32_t> seen_;
+  std::unordered_map<uint32_t, WatchedProcess> running_;
+  std::vector<ProcessEvent> pending_;
+  bool notified_ = false;
+  NotifyCallback onEvents_;
+  std::chrono::milliseconds interval_{500};
+  std::mutex mutex_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
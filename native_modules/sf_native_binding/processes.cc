@@ -1,39 +1,190 @@
 #include <napi.h>
-#include <windows.h>
-#include <tlhelp32.h>
-#include <psapi.h>
+#include <chrono>
 #include <string>
 #include <vector>
+#include "platform.h"
 #include "processes.h"
 
+namespace {
+
+std::vector<std::string> GetStrings(const Napi::Object& object, const char* key) {
+  std::vector<std::string> strings;
+  Napi::Value value = object.Get(key);
+  if (!value.IsArray()) {
+    return strings;
+  }
+  Napi::Array array = value.As<Napi::Array>();
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Napi::Value item = array.Get(i);
+    if (item.IsString()) {
+      strings.push_back(item.As<Napi::String>().Utf8Value());
+    }
+  }
+  return strings;
+}
+
+Napi::Object WatchedProcessToJs(Napi::Env env, const WatchedProcess& process) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("pid", Napi::Number::New(env, process.pid));
+  result.Set("name", Napi::String::New(env, process.name));
+  result.Set("path", Napi::String::New(env, process.path));
+  result.Set("bits", Napi::Number::New(env, process.bits));
+  Napi::Array modules = Napi::Array::New(env, process.modules.size());
+  for (size_t i = 0; i < process.modules.size(); i++) {
+    const ModuleInfo& module = process.modules[i];
+    Napi::Object entry = Napi::Object::New(env);
+    entry.Set("name", Napi::String::New(env, module.name));
+    entry.Set("path", Napi::String::New(env, module.path));
+    entry.Set("base", Napi::Number::New(env, static_cast<double>(module.base)));
+    entry.Set("size", Napi::Number::New(env, static_cast<double>(module.size)));
+    modules[i] = entry;
+  }
+  result.Set("modules", modules);
+  return result;
+}
+
+}  // namespace
+
+Napi::FunctionReference ProcessWatch::constructor;
+
 Napi::Array List(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
   Napi::Array processes = Napi::Array::New(env);
 
-  HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-  if (snapshot == INVALID_HANDLE_VALUE) {
+  std::vector<ProcessEntry> entries;
+  if (!ListProcessEntries(entries)) {
     return processes;
   }
 
-  PROCESSENTRY32 processEntry;
-  processEntry.dwSize = sizeof(PROCESSENTRY32);
-
   int index = 0;
-  if (Process32First(snapshot, &processEntry)) {
-    do {
-      Napi::Object process = Napi::Object::New(env);
-      process.Set("pid", Napi::Number::New(env, processEntry.th32ProcessID));
-      process.Set("name", Napi::String::New(env, processEntry.szExeFile));
-      
-      processes[index++] = process;
-    } while (Process32Next(snapshot, &processEntry));
+  for (const ProcessEntry& entry : entries) {
+    Napi::Object process = Napi::Object::New(env);
+    process.Set("pid", Napi::Number::New(env, entry.pid));
+    process.Set("name", Napi::String::New(env, entry.name));
+
+    processes[index++] = process;
   }
 
-  CloseHandle(snapshot);
   return processes;
 }
 
+Napi::Object ProcessWatch::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "ProcessWatch", {
+    InstanceMethod("stop", &ProcessWatch::Stop),
+    InstanceMethod("processes", &ProcessWatch::GetProcesses),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+  return exports;
+}
+
+// watchProcesses({ names, paths, intervalMs }, callback) - reports matching
+// processes as they start and exit. callback receives an array of
+// { type: 'start' | 'exit', pid, name, path, bits, modules: [{ name, path,
+// base, size }] }, first with every matching process already running.
+// names and paths match case-insensitive substrings of the executable's
+// name and path; intervalMs (500 by default) bounds how late a start is
+// noticed, while exits arrive as they happen.
+Napi::Value ProcessWatch::Watch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsFunction()) {
+    Napi::TypeError::New(env, "watchProcesses requires 2 arguments: filter, callback").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::Value interval = info[0].As<Napi::Object>().Get("intervalMs");
+  if (!interval.IsUndefined() && (!interval.IsNumber() || interval.As<Napi::Number>().DoubleValue() < 1)) {
+    Napi::RangeError::New(env, "intervalMs must be at least 1").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return constructor.New({ info[0], info[1] });
+}
+
+ProcessWatch::ProcessWatch(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<ProcessWatch>(info) {
+  Napi::Env env = info.Env();
+  Napi::Object options = info[0].As<Napi::Object>();
+  ProcessFilter filter;
+  filter.names = GetStrings(options, "names");
+  filter.paths = GetStrings(options, "paths");
+  std::chrono::milliseconds interval(500);
+  Napi::Value intervalMs = options.Get("intervalMs");
+  if (intervalMs.IsNumber()) {
+    interval = std::chrono::milliseconds(intervalMs.As<Napi::Number>().Int64Value());
+  }
+
+  Napi::ThreadSafeFunction callback = Napi::ThreadSafeFunction::New(
+    env, info[1].As<Napi::Function>(), "sf_native process watch", 0, 1);
+  callback_ = callback;
+  hasCallback_ = true;
+  // The thread must not keep the app alive on its own
+  callback_.Unref(env);
+
+  watcher_ = std::make_shared<ProcessWatcher>(filter);
+  // Queued calls outlive stop(); the weak pointer lets them bail out once
+  // the watcher is gone
+  std::weak_ptr<ProcessWatcher> weak = watcher_;
+  watcher_->Start([callback, weak]() {
+    callback.NonBlockingCall([weak](Napi::Env env, Napi::Function jsCallback) {
+      std::shared_ptr<ProcessWatcher> watcher = weak.lock();
+      if (!watcher) {
+        return;
+      }
+      std::vector<ProcessEvent> events;
+      watcher->TakeEvents(events);
+      if (events.empty()) {
+        return;
+      }
+      Napi::Array result = Napi::Array::New(env, events.size());
+      for (size_t i = 0; i < events.size(); i++) {
+        Napi::Object entry = WatchedProcessToJs(env, events[i].process);
+        entry.Set("type", Napi::String::New(env, events[i].started ? "start" : "exit"));
+        result[i] = entry;
+      }
+      jsCallback.Call({ result });
+    });
+  }, interval);
+}
+
+ProcessWatch::~ProcessWatch() {
+  StopThread();
+}
+
+void ProcessWatch::StopThread() {
+  if (watcher_) {
+    watcher_->Stop();
+    watcher_.reset();
+  }
+  if (hasCallback_) {
+    callback_.Release();
+    hasCallback_ = false;
+  }
+}
+
+// stop() - ends the watch; no further events are delivered
+Napi::Value ProcessWatch::Stop(const Napi::CallbackInfo& info) {
+  StopThread();
+  return info.Env().Undefined();
+}
+
+// processes() - the matching processes running now, in the same shape as
+// start events
+Napi::Value ProcessWatch::GetProcesses(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::vector<WatchedProcess> processes;
+  if (watcher_) {
+    processes = watcher_->Processes();
+  }
+  Napi::Array result = Napi::Array::New(env, processes.size());
+  for (size_t i = 0; i < processes.size(); i++) {
+    result[i] = WatchedProcessToJs(env, processes[i]);
+  }
+  return result;
+}
+
 Napi::Object RegisterProcessFunctions(Napi::Env env, Napi::Object exports) {
+  ProcessWatch::Init(env, exports);
   exports.Set("listProcesses", Napi::Function::New(env, List));
+  exports.Set("watchProcesses", Napi::Function::New(env, ProcessWatch::Watch));
   return exports;
-}
\ No newline at end of file
+}
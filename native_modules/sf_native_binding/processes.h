@@ -1,9 +1,33 @@
 #pragma once
 #include <napi.h>
-#include <windows.h>
+#include <memory>
+#include "process_watcher.h"
 
 // Function declarations
 Napi::Array List(const Napi::CallbackInfo& info);
 
+// Handle returned by watchProcesses(). Stopping it, or letting it be
+// collected, ends the watcher thread.
+class ProcessWatch : public Napi::ObjectWrap<ProcessWatch> {
+ public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  static Napi::Value Watch(const Napi::CallbackInfo& info);
+
+  explicit ProcessWatch(const Napi::CallbackInfo& info);
+  ~ProcessWatch();
+
+ private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value GetProcesses(const Napi::CallbackInfo& info);
+
+  void StopThread();
+
+  std::shared_ptr<ProcessWatcher> watcher_;
+  Napi::ThreadSafeFunction callback_;
+  bool hasCallback_ = false;
+};
+
 // Function to register all process-related functions
 Napi::Object RegisterProcessFunctions(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,154 @@
+#include "rdram.h"
+#include <cstring>
+
+namespace {
+
+const uint64_t kMinRdramSize = 4 * 1024 * 1024;
+const uint64_t kMaxRdramSize = 8 * 1024 * 1024;
+const uint32_t kRomBaseOffset = 0x308;
+const uint32_t kMemSizeOffset = 0x318;
+const uint32_t kCartridgeBase = 0xB0000000;
+
+bool IsCandidate(const MemoryRegion& region) {
+  return (region.protection & kProtRead) && (region.protection & kProtWrite) &&
+         !(region.protection & kProtGuard) && region.type != RegionType::Image;
+}
+
+}  // namespace
+
+bool CheckRdramSignature(ProcessHandle& process, uint64_t base, uint32_t& size) {
+  uint32_t words[5];
+  if (process.Read(base + kRomBaseOffset, words, sizeof(words)) != sizeof(words)) {
+    return false;
+  }
+  uint32_t romBase = words[0];
+  uint32_t memSize = words[(kMemSizeOffset - kRomBaseOffset) / 4];
+  if (romBase != kCartridgeBase || (memSize != kMinRdramSize && memSize != kMaxRdramSize)) {
+    return false;
+  }
+  size = memSize;
+  return true;
+}
+
+bool LocateRdram(ProcessHandle& process, const std::vector<MemoryRegion>& regions, RdramLocation& location) {
+  size_t r = 0;
+  while (r < regions.size()) {
+    if (!IsCandidate(regions[r])) {
+      r++;
+      continue;
+    }
+    // Find the run of contiguous candidate regions starting here
+    size_t end = r + 1;
+    uint64_t runEnd = regions[r].base + regions[r].size;
+    while (end < regions.size() && regions[end].base == runEnd && IsCandidate(regions[end])) {
+      runEnd += regions[end].size;
+      end++;
+    }
+
+    for (size_t i = r; i < end; i++) {
+      uint64_t base = regions[i].base;
+      uint32_t size = 0;
+      if (runEnd - base >= kMinRdramSize && CheckRdramSignature(process, base, size) && runEnd - base >= size) {
+        location.base = base;
+        location.size = size;
+        return true;
+      }
+    }
+    r = end;
+  }
+  return false;
+}
+
+bool RdramOffset(const RdramLocation& rdram, uint32_t address, size_t size, uint32_t& offset) {
+  offset = address & kN64PhysicalMask;
+  return rdram.size > 0 && offset <= rdram.size && size <= rdram.size - offset;
+}
+
+uint64_t RdramHostAddress(const RdramLocation& rdram, uint32_t offset, size_t valueSize) {
+  switch (valueSize) {
+    case 1: return rdram.base + (offset ^ 3);
+    case 2: return rdram.base + (offset ^ 2);
+    default: return rdram.base + offset;
+  }
+}
+
+uint32_t RdramVirtualAddress(const RdramLocation& rdram, uint64_t host, size_t valueSize) {
+  uint32_t offset = static_cast<uint32_t>(host - rdram.base);
+  switch (valueSize) {
+    case 1: return kN64Kseg0 | (offset ^ 3);
+    case 2: return kN64Kseg0 | (offset ^ 2);
+    default: return kN64Kseg0 | offset;
+  }
+}
+
+MemoryRegion RdramRegion(const RdramLocation& rdram) {
+  MemoryRegion region;
+  region.base = rdram.base;
+  region.size = rdram.size;
+  region.protection = kProtRead | kProtWrite;
+  return region;
+}
+
+size_t ReadRdram(ProcessHandle& process, const RdramLocation& rdram, uint32_t address, uint8_t* out, size_t size) {
+  uint32_t offset;
+  if (size == 0 || !RdramOffset(rdram, address, size, offset)) {
+    return 0;
+  }
+  // Read the whole words covering the range, then unswap
+  uint32_t first = offset & ~3u;
+  uint32_t last = static_cast<uint32_t>((offset + size + 3) & ~static_cast<size_t>(3));
+  std::vector<uint8_t> words(last - first);
+  size_t complete = process.Read(rdram.base + first, words.data(), words.size()) & ~static_cast<size_t>(3);
+
+  size_t done = 0;
+  for (; done < size; done++) {
+    size_t index = (offset - first + done) ^ 3;
+    if (index >= complete) {
+      break;
+    }
+    out[done] = words[index];
+  }
+  return done;
+}
+
+size_t WriteRdram(ProcessHandle& process, const RdramLocation& rdram, uint32_t address, const uint8_t* data,
+                  size_t size) {
+  uint32_t offset;
+  if (size == 0 || !RdramOffset(rdram, address, size, offset)) {
+    return 0;
+  }
+
+  std::vector<uint8_t> swapped(size);
+  std::vector<MemoryRange> ranges;
+  auto addByte = [&](size_t i) {
+    swapped[i] = data[i];
+    MemoryRange range;
+    range.address = rdram.base + ((offset + i) ^ 3);
+    range.buffer = &swapped[i];
+    range.size = 1;
+    ranges.push_back(range);
+  };
+
+  size_t i = 0;
+  while (i < size && (offset + i) % 4 != 0) {
+    addByte(i++);
+  }
+  size_t words = (size - i) / 4;
+  if (words > 0) {
+    MemoryRange range;
+    range.address = rdram.base + offset + i;
+    range.buffer = &swapped[i];
+    range.size = words * 4;
+    for (size_t w = 0; w < words; w++, i += 4) {
+      for (size_t b = 0; b < 4; b++) {
+        swapped[i + b] = data[i + 3 - b];
+      }
+    }
+    ranges.push_back(range);
+  }
+  while (i < size) {
+    addByte(i++);
+  }
+
+  return process.WriteMany(ranges.data(), ranges.size());
+}
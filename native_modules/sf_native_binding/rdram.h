@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "platform.h"
+
+// Emulated N64 RDRAM inside an emulator process. Project64 keeps it as
+// host-order 32-bit words: an aligned word reads natively, while byte i of
+// the big-endian N64 memory sits at host offset i ^ 3 (halfwords at i ^ 2).
+// N64 addresses are virtual (KSEG0 0x80xxxxxx, KSEG1 0xA0xxxxxx) or
+// physical; all of them map onto RDRAM offsets with kN64PhysicalMask.
+
+const uint32_t kN64PhysicalMask = 0x1FFFFFFF;
+const uint32_t kN64Kseg0 = 0x80000000;
+
+struct RdramLocation {
+  uint64_t base = 0;
+  // 4 or 8 MB; 0 while not located
+  uint32_t size = 0;
+};
+
+// True when `base` holds the words the boot code leaves behind: the RAM
+// size (osMemSize) at 0x318 and the cartridge base (osRomBase) at 0x308.
+// Sets `size` from the former.
+bool CheckRdramSignature(ProcessHandle& process, uint64_t base, uint32_t& size);
+
+// Looks for RDRAM among the read/write regions of at least 4 MB, checking
+// the signature at each region start. Adjacent regions count as one run.
+bool LocateRdram(ProcessHandle& process, const std::vector<MemoryRegion>& regions, RdramLocation& location);
+
+// RDRAM offset of [address, address + size); false past the end of RDRAM
+bool RdramOffset(const RdramLocation& rdram, uint32_t address, size_t size, uint32_t& offset);
+
+// Host address holding the 1, 2 or 4 byte value at RDRAM `offset`
+uint64_t RdramHostAddress(const RdramLocation& rdram, uint32_t offset, size_t valueSize);
+
+// KSEG0 address of the 1, 2 or 4 byte value found at host address `host`.
+// Word-swapped pattern matches are already in N64 byte order; pass 4.
+uint32_t RdramVirtualAddress(const RdramLocation& rdram, uint64_t host, size_t valueSize);
+
+// The RDRAM block as a region, for scans restricted to it
+MemoryRegion RdramRegion(const RdramLocation& rdram);
+
+// Reads `size` bytes at N64 `address` into `out` in N64 (big-endian) byte
+// order. Returns the leading bytes read; 0 outside RDRAM.
+size_t ReadRdram(ProcessHandle& process, const RdramLocation& rdram, uint32_t address, uint8_t* out, size_t size);
+
+// Writes `size` big-endian bytes at N64 `address`. Whole words go out as
+// one swapped range; partial words at either end are written byte by byte
+// so the neighbouring bytes are never rewritten. Returns the bytes written.
+size_t WriteRdram(ProcessHandle& process, const RdramLocation& rdram, uint32_t address, const uint8_t* data,
+                  size_t size);
@@ -0,0 +1,266 @@
+#include "region_map.h"
+#include <algorithm>
+#include <cctype>
+#include <unordered_map>
+
+namespace {
+
+bool EqualsIgnoreCase(const std::string& a, const std::string& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SameRegion(const MemoryRegion& a, const MemoryRegion& b) {
+  return a.base == b.base && a.size == b.size && a.protection == b.protection && a.type == b.type &&
+         a.path == b.path;
+}
+
+// Counts the difference between two sorted lists of regions, pairing
+// regions by base address
+void Compare(const std::vector<MemoryRegion>& before, const std::vector<MemoryRegion>& after, RegionDelta& delta) {
+  size_t i = 0, j = 0;
+  while (i < before.size() || j < after.size()) {
+    if (j == after.size() || (i < before.size() && before[i].base < after[j].base)) {
+      delta.removed++;
+      i++;
+    } else if (i == before.size() || after[j].base < before[i].base) {
+      delta.added++;
+      j++;
+    } else {
+      if (!SameRegion(before[i], after[j])) {
+        delta.changed++;
+      }
+      i++;
+      j++;
+    }
+  }
+}
+
+}  // namespace
+
+bool RegionFilter::Matches(const MemoryRegion& region) const {
+  if (writableOnly && !(region.protection & kProtWrite)) {
+    return false;
+  }
+  if (privateOnly && region.type != RegionType::Private) {
+    return false;
+  }
+  if (region.size < minSize || region.size > maxSize) {
+    return false;
+  }
+  if (region.base >= end || region.base + region.size <= start) {
+    return false;
+  }
+  return module.empty() || EqualsIgnoreCase(RegionModule(region), module);
+}
+
+bool RegionFilter::IsEmpty() const {
+  return !writableOnly && !privateOnly && module.empty() && start == 0 && end == UINT64_MAX && minSize == 0 &&
+         maxSize == UINT64_MAX;
+}
+
+std::string RegionModule(const MemoryRegion& region) {
+  if (region.type != RegionType::Image) {
+    return "";
+  }
+  // Windows reports device paths with backslashes
+  size_t slash = region.path.find_last_of("/\\");
+  return slash == std::string::npos ? region.path : region.path.substr(slash + 1);
+}
+
+bool FindModuleBase(const std::vector<MemoryRegion>& regions, const std::string& module, uint64_t& base) {
+  // Regions are sorted, so the first match is the lowest
+  for (const MemoryRegion& region : regions) {
+    if (region.type == RegionType::Image && EqualsIgnoreCase(RegionModule(region), module)) {
+      base = region.base;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ListModules(const std::vector<MemoryRegion>& regions, std::vector<ModuleInfo>& modules) {
+  modules.clear();
+  // Sections of one image may be split by unrelated mappings, so group by
+  // path rather than by adjacency
+  std::unordered_map<std::string, size_t> index;
+  for (const MemoryRegion& region : regions) {
+    if (region.type != RegionType::Image || region.path.empty()) {
+      continue;
+    }
+    auto found = index.find(region.path);
+    if (found == index.end()) {
+      index[region.path] = modules.size();
+      ModuleInfo module;
+      module.name = RegionModule(region);
+      module.path = region.path;
+      module.base = region.base;
+      module.size = region.size;
+      modules.push_back(std::move(module));
+      continue;
+    }
+    ModuleInfo& module = modules[found->second];
+    module.size = std::max(module.size, region.base + region.size - module.base);
+  }
+}
+
+std::vector<MemoryRegion> FilterRegions(const std::vector<MemoryRegion>& regions, const RegionFilter& filter) {
+  std::vector<MemoryRegion> result;
+  for (const MemoryRegion& region : regions) {
+    if (!filter.Matches(region)) {
+      continue;
+    }
+    result.push_back(region);
+    MemoryRegion& clipped = result.back();
+    uint64_t regionEnd = std::min(region.base + region.size, filter.end);
+    clipped.base = std::max(region.base, filter.start);
+    clipped.size = regionEnd - clipped.base;
+  }
+  return result;
+}
+
+std::shared_ptr<const std::vector<MemoryRegion>> RegionMap::Get(ProcessHandle& process,
+                                                                std::chrono::milliseconds maxAge) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (regions_ && (maxAge == std::chrono::milliseconds::max() ||
+                     std::chrono::steady_clock::now() - refreshed_ <= maxAge)) {
+      return regions_;
+    }
+  }
+  if (!Refresh(process)) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return regions_;
+}
+
+bool RegionMap::Refresh(ProcessHandle& process, uint64_t start, uint64_t end, RegionDelta* delta) {
+  {
+    // A window only makes sense once there is a map to splice it into
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!regions_) {
+      start = 0;
+      end = UINT64_MAX;
+    }
+  }
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::vector<MemoryRegion> fresh;
+  if (!process.EnumerateRegions(fresh, start, end)) {
+    return false;
+  }
+  // Regions come back whole, so the window grows to cover them
+  if (!fresh.empty()) {
+    start = std::min(start, fresh.front().base);
+    end = std::max(end, fresh.back().base + fresh.back().size);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto regions = std::make_shared<std::vector<MemoryRegion>>();
+  std::vector<MemoryRegion> stale;
+  size_t i = 0;
+  if (regions_) {
+    regions->reserve(regions_->size() + fresh.size());
+    for (; i < regions_->size() && (*regions_)[i].base + (*regions_)[i].size <= start; i++) {
+      regions->push_back((*regions_)[i]);
+    }
+    for (; i < regions_->size() && (*regions_)[i].base < end; i++) {
+      stale.push_back((*regions_)[i]);
+    }
+  }
+  regions->insert(regions->end(), fresh.begin(), fresh.end());
+  if (regions_) {
+    regions->insert(regions->end(), regions_->begin() + i, regions_->end());
+  }
+
+  RegionDelta difference;
+  Compare(stale, fresh, difference);
+  if (!regions_ || difference.added || difference.removed || difference.changed) {
+    generation_++;
+  }
+  regions_ = regions;
+  if (start == 0 && end == UINT64_MAX) {
+    refreshed_ = now;
+  }
+  if (delta) {
+    *delta = difference;
+  }
+  return true;
+}
+
+bool RegionMap::RefreshFaults(ProcessHandle& process, const std::vector<std::pair<uint64_t, uint64_t>>& faults) {
+  if (faults.size() > kMaxFaultWindows) {
+    return Refresh(process);
+  }
+  for (const auto& fault : faults) {
+    if (!Refresh(process, fault.first, fault.second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t RegionMap::Generation() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return generation_;
+}
+
+void RegionMap::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  regions_.reset();
+}
+
+size_t FaultRecorder::Read(uint64_t address, void* buffer, size_t size) {
+  size_t read = process_->Read(address, buffer, size);
+  if (read < size) {
+    Note(address + read, size - read);
+  }
+  return read;
+}
+
+size_t FaultRecorder::ReadMany(MemoryRange* ranges, size_t count) {
+  size_t total = process_->ReadMany(ranges, count);
+  for (size_t i = 0; i < count; i++) {
+    if (ranges[i].transferred < ranges[i].size) {
+      Note(ranges[i].address + ranges[i].transferred, ranges[i].size - ranges[i].transferred);
+    }
+  }
+  return total;
+}
+
+void FaultRecorder::Note(uint64_t address, uint64_t size) {
+  const uint64_t kPage = 4096;
+  uint64_t start = address & ~(kPage - 1);
+  uint64_t end = std::max(address + size, start + kPage);
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Reads mostly fail in runs, so extend the last fault when they touch
+  if (!faults_.empty() && start <= faults_.back().second && end >= faults_.back().first) {
+    faults_.back().first = std::min(faults_.back().first, start);
+    faults_.back().second = std::max(faults_.back().second, end);
+    return;
+  }
+  faults_.emplace_back(start, end);
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> FaultRecorder::Faults() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::pair<uint64_t, uint64_t>> merged(faults_);
+  std::sort(merged.begin(), merged.end());
+  size_t kept = 0;
+  for (size_t i = 0; i < merged.size(); i++) {
+    if (kept > 0 && merged[i].first <= merged[kept - 1].second) {
+      merged[kept - 1].second = std::max(merged[kept - 1].second, merged[i].second);
+    } else {
+      merged[kept++] = merged[i];
+    }
+  }
+  merged.resize(kept);
+  return merged;
+}
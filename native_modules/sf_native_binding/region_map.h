@@ -0,0 +1,125 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "platform.h"
+
+// Narrows the regions a scan visits. Every condition set must hold; a
+// default-constructed filter passes everything.
+struct RegionFilter {
+  bool writableOnly = false;
+  bool privateOnly = false;
+  // File name of the owning module, e.g. "Project64.exe", compared
+  // case-insensitively. Only image regions have an owning module.
+  std::string module;
+  // Address window [start, end); regions straddling it are clipped
+  uint64_t start = 0;
+  uint64_t end = UINT64_MAX;
+  // Bounds on the size of the whole region, before clipping
+  uint64_t minSize = 0;
+  uint64_t maxSize = UINT64_MAX;
+
+  bool Matches(const MemoryRegion& region) const;
+  // True when every region passes unchanged
+  bool IsEmpty() const;
+};
+
+// File name of the module owning an image region, "" for other regions
+std::string RegionModule(const MemoryRegion& region);
+
+// Lowest address of the module named `module` (case-insensitive file
+// name); false when no image region belongs to it
+bool FindModuleBase(const std::vector<MemoryRegion>& regions, const std::string& module, uint64_t& base);
+
+// A loaded executable or library, spanning its image regions
+struct ModuleInfo {
+  // File name, as RegionModule() reports it
+  std::string name;
+  std::string path;
+  uint64_t base = 0;
+  uint64_t size = 0;
+};
+
+// The modules mapped into a sorted region list, in load address order
+void ListModules(const std::vector<MemoryRegion>& regions, std::vector<ModuleInfo>& modules);
+
+// The regions passing `filter`, clipped to its address window
+std::vector<MemoryRegion> FilterRegions(const std::vector<MemoryRegion>& regions, const RegionFilter& filter);
+
+// What a refresh changed, counted in regions
+struct RegionDelta {
+  size_t added = 0;
+  size_t removed = 0;
+  size_t changed = 0;
+};
+
+// A process's region map, enumerated on first use and kept up to date with
+// refreshes of the whole address space or of one window of it. Snapshots
+// are immutable and shared, so a scan keeps the map it started with while
+// a refresh installs a new one.
+class RegionMap {
+ public:
+  // Current map; enumerates it when there is none yet or the last refresh
+  // is older than `maxAge`. Null if the enumeration fails.
+  std::shared_ptr<const std::vector<MemoryRegion>> Get(
+    ProcessHandle& process, std::chrono::milliseconds maxAge = std::chrono::milliseconds::max());
+
+  // Re-enumerates the regions overlapping [start, end) and splices them
+  // into the map, keeping everything outside the window. Fills `delta`
+  // with the difference. False if the enumeration fails.
+  bool Refresh(ProcessHandle& process, uint64_t start = 0, uint64_t end = UINT64_MAX,
+               RegionDelta* delta = nullptr);
+
+  // Re-enumerates just the windows of `faults` (sorted, disjoint [start,
+  // end) ranges reads failed on), or the whole map when there are more
+  // than kMaxFaultWindows of them. False if an enumeration fails.
+  bool RefreshFaults(ProcessHandle& process, const std::vector<std::pair<uint64_t, uint64_t>>& faults);
+  static const size_t kMaxFaultWindows = 32;
+
+  // Bumped by every refresh that changed the map
+  uint64_t Generation();
+
+  void Clear();
+
+ private:
+  std::mutex mutex_;
+  std::shared_ptr<const std::vector<MemoryRegion>> regions_;
+  std::chrono::steady_clock::time_point refreshed_;
+  uint64_t generation_ = 0;
+};
+
+// Passes every call through to `process` and notes the pages reads failed
+// on. A scan reads through one so that afterwards its region map can be
+// refreshed where it went stale instead of re-enumerated whole.
+class FaultRecorder : public ProcessHandle {
+ public:
+  explicit FaultRecorder(std::shared_ptr<ProcessHandle> process) : process_(std::move(process)) {}
+
+  uint32_t Pid() const override { return process_->Pid(); }
+  bool IsAlive() override { return process_->IsAlive(); }
+  uint32_t PointerSize() override { return process_->PointerSize(); }
+  bool EnumerateRegions(std::vector<MemoryRegion>& regions, uint64_t start = 0, uint64_t end = UINT64_MAX) override {
+    return process_->EnumerateRegions(regions, start, end);
+  }
+  size_t Read(uint64_t address, void* buffer, size_t size) override;
+  size_t Write(uint64_t address, const void* buffer, size_t size) override {
+    return process_->Write(address, buffer, size);
+  }
+  size_t ReadMany(MemoryRange* ranges, size_t count) override;
+  size_t WriteMany(MemoryRange* ranges, size_t count) override { return process_->WriteMany(ranges, count); }
+
+  // The failed pages so far as sorted, merged [start, end) ranges
+  std::vector<std::pair<uint64_t, uint64_t>> Faults();
+
+ private:
+  void Note(uint64_t address, uint64_t size);
+
+  std::shared_ptr<ProcessHandle> process_;
+  std::mutex mutex_;
+  std::vector<std::pair<uint64_t, uint64_t>> faults_;
+};
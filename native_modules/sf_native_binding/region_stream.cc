@@ -0,0 +1,146 @@
+#include "region_stream.h"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "buffer_pool.h"
+
+namespace {
+
+// Default cap on buffers in flight: 16 x 256 KB windows = 4 MB
+const size_t kMaxDefaultBuffers = 16;
+
+struct Window {
+  uint64_t address;
+  size_t size;
+  size_t readSize;
+  size_t span;
+};
+
+}  // namespace
+
+bool StreamRegions(ProcessHandle& process, const std::vector<StreamSpan>& spans,
+                   const StreamOptions& options, const WindowHandler& handler,
+                   StreamStats& stats, const std::atomic<bool>* cancelled,
+                   const std::function<void()>& onTick,
+                   std::chrono::milliseconds tickInterval) {
+  ThreadPool& pool = ThreadPool::Shared();
+
+  auto isCancelled = [cancelled]() {
+    return cancelled && cancelled->load(std::memory_order_relaxed);
+  };
+
+  // Lay out the windows up front; each reads `overlap` bytes into its
+  // successor, clipped to the end of its span
+  std::vector<Window> windows;
+  std::unique_ptr<std::atomic<uint64_t>[]> windowsLeft(new std::atomic<uint64_t>[spans.size()]);
+  for (size_t s = 0; s < spans.size(); s++) {
+    const StreamSpan& span = spans[s];
+    windowsLeft[s] = 0;
+    if (span.size == 0) {
+      stats.spansDone++;
+      continue;
+    }
+    for (uint64_t offset = 0; offset < span.size; offset += options.windowSize) {
+      Window window;
+      window.address = span.address + offset;
+      window.size = static_cast<size_t>(std::min<uint64_t>(options.windowSize, span.size - offset));
+      window.readSize = static_cast<size_t>(std::min<uint64_t>(window.size + options.overlap, span.size - offset));
+      window.span = s;
+      windows.push_back(window);
+      windowsLeft[s]++;
+    }
+  }
+
+  size_t readers = options.readers;
+  if (readers == 0) {
+    readers = std::max<size_t>(1, std::min<size_t>(2, pool.Size()));
+  }
+  size_t buffers = options.buffers;
+  if (buffers == 0) {
+    buffers = std::min(kMaxDefaultBuffers, 2 * std::max(readers, pool.Size()));
+  }
+  buffers = std::max(buffers, readers + 1);
+
+  BufferPool bufferPool(buffers, options.windowSize + options.overlap);
+  if (!bufferPool.Valid()) {
+    return false;
+  }
+
+  std::atomic<size_t> nextWindow(0);
+  size_t windowsFinished = 0;
+  std::mutex finishedMutex;
+  std::condition_variable allFinished;
+  TaskGroup group(pool);
+
+  auto finishWindow = [&](const Window& window) {
+    stats.bytesDone += window.size;
+    if (--windowsLeft[window.span] == 0) {
+      stats.spansDone++;
+    }
+    std::lock_guard<std::mutex> lock(finishedMutex);
+    if (++windowsFinished == windows.size()) {
+      allFinished.notify_all();
+    }
+  };
+
+  auto readLoop = [&]() {
+    for (;;) {
+      size_t index = nextWindow.fetch_add(1);
+      if (index >= windows.size()) {
+        return;
+      }
+      const Window& window = windows[index];
+      if (isCancelled()) {
+        finishWindow(window);
+        continue;
+      }
+
+      uint8_t* buffer = bufferPool.Acquire();
+      size_t bytesRead = process.Read(window.address, buffer, window.readSize);
+      if (bytesRead < window.readSize) {
+        stats.failedReads++;
+      }
+
+      group.Run([&, buffer, bytesRead, index]() {
+        const Window& current = windows[index];
+        if (bytesRead > 0 && !isCancelled()) {
+          StreamWindow view;
+          view.address = current.address;
+          view.data = buffer;
+          view.size = current.size;
+          view.available = bytesRead;
+          view.tag = spans[current.span].tag;
+          handler(view);
+        }
+        bufferPool.Release(buffer);
+        finishWindow(current);
+      });
+    }
+  };
+
+  std::vector<std::thread> readerThreads;
+  for (size_t i = 0; i < readers; i++) {
+    readerThreads.emplace_back(readLoop);
+  }
+
+  // Tick until the last window has been compared
+  {
+    std::unique_lock<std::mutex> lock(finishedMutex);
+    while (!allFinished.wait_for(lock, tickInterval, [&]() { return windowsFinished == windows.size(); })) {
+      if (onTick) {
+        lock.unlock();
+        onTick();
+        lock.lock();
+      }
+    }
+  }
+
+  for (std::thread& thread : readerThreads) {
+    thread.join();
+  }
+  group.Wait();
+
+  return !isCancelled();
+}
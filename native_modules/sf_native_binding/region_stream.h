@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "platform.h"
+#include "thread_pool.h"
+
+// A contiguous range of target memory to stream, usually one region.
+// `tag` is handed back with every window so callers can attribute work.
+struct StreamSpan {
+  uint64_t address = 0;
+  uint64_t size = 0;
+  size_t tag = 0;
+};
+
+// One window of a span, valid only for the duration of the handler call.
+// The window owns [address, address + size); `data` also holds up to
+// `overlap` bytes past the end so values straddling the boundary can be
+// compared. `available` is how many bytes of `data` were actually read.
+struct StreamWindow {
+  uint64_t address = 0;
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  size_t available = 0;
+  size_t tag = 0;
+};
+
+struct StreamOptions {
+  size_t windowSize = 256 * 1024;
+  // Extra bytes read past each window, e.g. value size - 1
+  size_t overlap = 0;
+  // Threads issuing reads; 0 picks a default
+  size_t readers = 0;
+  // Buffers in flight; 0 picks two per reader/worker, capped to a few MB
+  size_t buffers = 0;
+};
+
+// Live counters, safe to poll from another thread while Stream runs
+struct StreamStats {
+  std::atomic<uint64_t> bytesDone{0};
+  std::atomic<uint64_t> spansDone{0};
+  std::atomic<uint64_t> failedReads{0};
+};
+
+typedef std::function<void(const StreamWindow&)> WindowHandler;
+
+// Walks `spans` in fixed-size windows. Reader threads fill buffers from a
+// BufferPool while pool workers run `handler` on buffers already filled, so
+// reading the next window overlaps comparing the current one and peak
+// memory is bounded by the pool whatever the size of the target.
+// `onTick` runs on the calling thread every `tickInterval` until done.
+// Returns false if `cancelled` was raised.
+bool StreamRegions(ProcessHandle& process, const std::vector<StreamSpan>& spans,
+                   const StreamOptions& options, const WindowHandler& handler,
+                   StreamStats& stats, const std::atomic<bool>* cancelled = nullptr,
+                   const std::function<void()>& onTick = nullptr,
+                   std::chrono::milliseconds tickInterval = std::chrono::milliseconds(50));
@@ -0,0 +1,167 @@
+#include "scan_kernels.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SF_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX2 instructions inside functions marked for
+// that target; MSVC accepts the intrinsics anywhere
+#if defined(SF_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SF_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SF_TARGET_AVX2
+#endif
+
+namespace {
+
+inline int CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+// Appends one address per set bit; bit n is the uint32 at offset + n * 4
+inline void EmitMatches(uint32_t mask, uint64_t address, std::vector<uint64_t>& matches) {
+  while (mask) {
+    matches.push_back(address + CountTrailingZeros(mask) * sizeof(uint32_t));
+    mask &= mask - 1;
+  }
+}
+
+void FindUint32Scalar(const uint8_t* data, size_t size, uint32_t value,
+                      uint64_t base, std::vector<uint64_t>& matches) {
+  size_t count = size / sizeof(uint32_t);
+  for (size_t i = 0; i < count; i++) {
+    uint32_t current;
+    memcpy(&current, data + i * sizeof(uint32_t), sizeof(current));
+    if (current == value) {
+      matches.push_back(base + i * sizeof(uint32_t));
+    }
+  }
+}
+
+#if defined(SF_X86)
+
+// 64 bytes per iteration: four 4-lane compares folded into a 16-bit mask
+void FindUint32Sse2(const uint8_t* data, size_t size, uint32_t value,
+                    uint64_t base, std::vector<uint64_t>& matches) {
+  const __m128i needle = _mm_set1_epi32(static_cast<int>(value));
+  size_t i = 0;
+
+  for (; i + 64 <= size; i += 64) {
+    const __m128i* block = reinterpret_cast<const __m128i*>(data + i);
+    __m128i a = _mm_cmpeq_epi32(_mm_loadu_si128(block + 0), needle);
+    __m128i b = _mm_cmpeq_epi32(_mm_loadu_si128(block + 1), needle);
+    __m128i c = _mm_cmpeq_epi32(_mm_loadu_si128(block + 2), needle);
+    __m128i d = _mm_cmpeq_epi32(_mm_loadu_si128(block + 3), needle);
+    __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+    if (_mm_movemask_epi8(any) == 0) {
+      continue;
+    }
+    uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(a)))
+                  | static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(b))) << 4
+                  | static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(c))) << 8
+                  | static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(d))) << 12;
+    EmitMatches(mask, base + i, matches);
+  }
+
+  FindUint32Scalar(data + i, size - i, value, base + i, matches);
+}
+
+// 128 bytes per iteration: four 8-lane compares folded into a 32-bit mask
+SF_TARGET_AVX2
+void FindUint32Avx2(const uint8_t* data, size_t size, uint32_t value,
+                    uint64_t base, std::vector<uint64_t>& matches) {
+  const __m256i needle = _mm256_set1_epi32(static_cast<int>(value));
+  size_t i = 0;
+
+  for (; i + 128 <= size; i += 128) {
+    const __m256i* block = reinterpret_cast<const __m256i*>(data + i);
+    __m256i a = _mm256_cmpeq_epi32(_mm256_loadu_si256(block + 0), needle);
+    __m256i b = _mm256_cmpeq_epi32(_mm256_loadu_si256(block + 1), needle);
+    __m256i c = _mm256_cmpeq_epi32(_mm256_loadu_si256(block + 2), needle);
+    __m256i d = _mm256_cmpeq_epi32(_mm256_loadu_si256(block + 3), needle);
+    __m256i any = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+    if (_mm256_testz_si256(any, any)) {
+      continue;
+    }
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(a)))
+                  | static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(b))) << 8
+                  | static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(c))) << 16
+                  | static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(d))) << 24;
+    EmitMatches(mask, base + i, matches);
+  }
+
+  FindUint32Sse2(data + i, size - i, value, base + i, matches);
+}
+
+bool CpuHasAvx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool avx = (info[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif  // SF_X86
+
+struct KernelChoice {
+  FindUint32Kernel findUint32;
+  const char* name;
+};
+
+KernelChoice ChooseKernel() {
+  const char* forced = getenv("SF_SCAN_KERNEL");
+  if (forced && strcmp(forced, "scalar") == 0) {
+    return { FindUint32Scalar, "scalar" };
+  }
+#if defined(SF_X86)
+  if (forced && strcmp(forced, "sse2") == 0) {
+    return { FindUint32Sse2, "sse2" };
+  }
+  if (CpuHasAvx2()) {
+    return { FindUint32Avx2, "avx2" };
+  }
+  // SSE2 is baseline on x86-64 and every CPU that can run Project64
+  return { FindUint32Sse2, "sse2" };
+#else
+  return { FindUint32Scalar, "scalar" };
+#endif
+}
+
+const KernelChoice& Kernel() {
+  static const KernelChoice choice = ChooseKernel();
+  return choice;
+}
+
+}  // namespace
+
+FindUint32Kernel SelectFindUint32Kernel() {
+  return Kernel().findUint32;
+}
+
+const char* FindUint32KernelName() {
+  return Kernel().name;
+}
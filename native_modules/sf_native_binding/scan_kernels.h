@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compare kernels used by the scanner. Each kernel turns a block of target
+// memory into match bitmasks and appends `base + offset` for every set bit.
+
+// Finds every 4-byte aligned uint32 in data[0, size) equal to `value`.
+// `data` must be 4-byte aligned relative to `base`.
+typedef void (*FindUint32Kernel)(const uint8_t* data, size_t size, uint32_t value,
+                                 uint64_t base, std::vector<uint64_t>& matches);
+
+// Picks the widest kernel this CPU supports (AVX2, SSE2, scalar) once per
+// process. Setting SF_SCAN_KERNEL=scalar|sse2|avx2 forces a specific one.
+FindUint32Kernel SelectFindUint32Kernel();
+
+// Name of the kernel SelectFindUint32Kernel() returns
+const char* FindUint32KernelName();
@@ -0,0 +1,366 @@
+#include "scan_results.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+// Loads a recorded value of type T, reversing its bytes when Swap is set
+template <typename T, bool Swap>
+T LoadValue(const uint8_t* data) {
+  uint8_t bytes[sizeof(T)];
+  for (size_t b = 0; b < sizeof(T); b++) {
+    bytes[b] = Swap ? data[sizeof(T) - 1 - b] : data[b];
+  }
+  T value;
+  memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+template <typename T>
+T OperandAs(uint64_t bits) {
+  ScanOperand operand;
+  operand.bits = bits;
+  return operand.As<T>();
+}
+
+// Whether a recorded value lies within the query's bounds; NaN never does
+template <typename T, bool Swap>
+bool InRange(const uint8_t* data, const ResultQuery& query) {
+  T value = LoadValue<T, Swap>(data);
+  if (query.hasMin && !(value >= query.min.As<T>())) {
+    return false;
+  }
+  return !query.hasMax || value <= query.max.As<T>();
+}
+
+// Orders host-order value bits as T, with NaN after every number
+template <typename T>
+bool ValueLess(uint64_t a, uint64_t b) {
+  T x = OperandAs<T>(a);
+  T y = OperandAs<T>(b);
+  if constexpr (std::is_floating_point<T>::value) {
+    if (std::isnan(x)) {
+      return false;
+    }
+    if (std::isnan(y)) {
+      return true;
+    }
+  }
+  return x < y;
+}
+
+template <typename T, bool Swap>
+uint64_t ValueBits(const uint8_t* data) {
+  return ScanOperand::From(LoadValue<T, Swap>(data)).bits;
+}
+
+typedef bool (*RangeFn)(const uint8_t* data, const ResultQuery& query);
+typedef bool (*LessFn)(uint64_t a, uint64_t b);
+typedef uint64_t (*BitsFn)(const uint8_t* data);
+
+struct ValueOps {
+  RangeFn inRange = nullptr;
+  LessFn less = nullptr;
+  BitsFn bits = nullptr;
+};
+
+template <typename T>
+struct TypeTag {
+  typedef T type;
+};
+
+template <typename Fn>
+void DispatchType(ValueType type, Fn&& fn) {
+  switch (type) {
+    case ValueType::Int8: fn(TypeTag<int8_t>()); break;
+    case ValueType::UInt8: fn(TypeTag<uint8_t>()); break;
+    case ValueType::Int16: fn(TypeTag<int16_t>()); break;
+    case ValueType::UInt16: fn(TypeTag<uint16_t>()); break;
+    case ValueType::Int32: fn(TypeTag<int32_t>()); break;
+    case ValueType::UInt32: fn(TypeTag<uint32_t>()); break;
+    case ValueType::Int64: fn(TypeTag<int64_t>()); break;
+    case ValueType::UInt64: fn(TypeTag<uint64_t>()); break;
+    case ValueType::Float32: fn(TypeTag<float>()); break;
+    case ValueType::Float64: fn(TypeTag<double>()); break;
+  }
+}
+
+// Picks the comparisons for a layout once, so the per-row work is a call
+// through a pointer to code specialized on the type and byte order
+ValueOps PickValueOps(const ValueLayout& layout) {
+  ValueOps ops;
+  DispatchType(layout.type, [&](auto tag) {
+    typedef typename decltype(tag)::type T;
+    ops.inRange = layout.byteSwap ? &InRange<T, true> : &InRange<T, false>;
+    ops.less = &ValueLess<T>;
+    ops.bits = layout.byteSwap ? &ValueBits<T, true> : &ValueBits<T, false>;
+  });
+  return ops;
+}
+
+class AddressResults : public ScanResults {
+ public:
+  explicit AddressResults(std::vector<uint64_t> addresses) : addresses_(std::move(addresses)) {
+    std::sort(addresses_.begin(), addresses_.end());
+  }
+
+  uint64_t Count() const override { return addresses_.size(); }
+  bool HasValues() const override { return false; }
+
+ protected:
+  void Get(uint64_t offset, size_t count, std::vector<uint64_t>& addresses,
+           std::vector<uint8_t>& values) const override {
+    size_t end = static_cast<size_t>(std::min<uint64_t>(addresses_.size(), offset + count));
+    addresses.assign(addresses_.begin() + static_cast<size_t>(offset), addresses_.begin() + end);
+    values.clear();
+  }
+
+  void ForEach(const std::function<void(uint64_t address, const uint8_t* value)>& visit) const override {
+    for (uint64_t address : addresses_) {
+      visit(address, nullptr);
+    }
+  }
+
+ private:
+  std::vector<uint64_t> addresses_;
+};
+
+// RDRAM words hold their bytes in reverse order, so the 1- and 2-byte
+// candidates of one word come out of the set in descending N64 order. A
+// word holds at most this many candidates.
+constexpr size_t kRowsPerRdramWord = 4;
+
+class CandidateResults : public ScanResults {
+ public:
+  CandidateResults(std::shared_ptr<const CandidateSet> candidates, const RdramLocation& space)
+    : candidates_(std::move(candidates)), space_(space) {}
+
+  uint64_t Count() const override { return candidates_->Count(); }
+  bool HasValues() const override { return true; }
+  ValueLayout Layout() const override { return candidates_->Layout(); }
+  bool IsLive() const override { return true; }
+
+ protected:
+  void Get(uint64_t offset, size_t count, std::vector<uint64_t>& addresses,
+           std::vector<uint8_t>& values) const override {
+    size_t valueSize = candidates_->ValueSize();
+    if (space_.size == 0 || valueSize >= 4) {
+      candidates_->Get(offset, count, addresses, values);
+      if (space_.size > 0) {
+        for (uint64_t& address : addresses) {
+          address = RdramVirtualAddress(space_, address, valueSize);
+        }
+      }
+      return;
+    }
+
+    // A page edge can split a word, so fetch the rest of the edge words
+    // and sort the rows by N64 address before cutting the page out
+    uint64_t first = offset < kRowsPerRdramWord - 1 ? 0 : offset - (kRowsPerRdramWord - 1);
+    std::vector<uint64_t> hostAddresses;
+    std::vector<uint8_t> hostValues;
+    candidates_->Get(first, count + (offset - first) + kRowsPerRdramWord - 1, hostAddresses, hostValues);
+    std::vector<std::pair<uint64_t, size_t>> rows(hostAddresses.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+      rows[i] = { RdramVirtualAddress(space_, hostAddresses[i], valueSize), i };
+    }
+    std::sort(rows.begin(), rows.end());
+
+    addresses.clear();
+    values.clear();
+    for (size_t i = offset - first; i < rows.size() && addresses.size() < count; i++) {
+      const uint8_t* value = hostValues.data() + rows[i].second * valueSize;
+      addresses.push_back(rows[i].first);
+      values.insert(values.end(), value, value + valueSize);
+    }
+  }
+
+  void ForEach(const std::function<void(uint64_t address, const uint8_t* value)>& visit) const override {
+    if (space_.size == 0) {
+      candidates_->ForEach(visit);
+      return;
+    }
+    size_t valueSize = candidates_->ValueSize();
+    if (valueSize >= 4) {
+      candidates_->ForEach([&](uint64_t address, const uint8_t* value) {
+        visit(RdramVirtualAddress(space_, address, valueSize), value);
+      });
+      return;
+    }
+
+    // Holds back each word's rows and visits them in N64 order once the
+    // next word starts
+    struct Row {
+      uint64_t address;
+      uint8_t value[2];
+    };
+    Row rows[kRowsPerRdramWord];
+    size_t pending = 0;
+    uint64_t word = UINT64_MAX;
+    auto flush = [&]() {
+      std::sort(rows, rows + pending, [](const Row& a, const Row& b) { return a.address < b.address; });
+      for (size_t i = 0; i < pending; i++) {
+        visit(rows[i].address, rows[i].value);
+      }
+      pending = 0;
+    };
+    candidates_->ForEach([&](uint64_t address, const uint8_t* value) {
+      if ((address & ~uint64_t(3)) != word) {
+        flush();
+        word = address & ~uint64_t(3);
+      }
+      rows[pending].address = RdramVirtualAddress(space_, address, valueSize);
+      memcpy(rows[pending].value, value, valueSize);
+      pending++;
+    });
+    flush();
+  }
+
+  uint64_t Version() const override { return candidates_->Passes(); }
+
+ private:
+  std::shared_ptr<const CandidateSet> candidates_;
+  RdramLocation space_;
+};
+
+}  // namespace
+
+bool ResultQuery::IsPlain() const {
+  return start == 0 && end == UINT64_MAX && !UsesValues();
+}
+
+bool ResultQuery::operator==(const ResultQuery& other) const {
+  return start == other.start && end == other.end && hasMin == other.hasMin && hasMax == other.hasMax &&
+         (!hasMin || min.bits == other.min.bits) && (!hasMax || max.bits == other.max.bits) && order == other.order;
+}
+
+bool ScanResults::Page(const ResultQuery& query, uint64_t offset, size_t count, std::vector<uint64_t>& addresses,
+                       std::vector<uint8_t>& values, uint64_t& total, std::string& error) {
+  addresses.clear();
+  values.clear();
+  total = 0;
+  if (query.UsesValues() && !HasValues()) {
+    error = "These results have no values to filter or sort by";
+    return false;
+  }
+  if (query.IsPlain()) {
+    total = Count();
+    if (offset < total) {
+      Get(offset, count, addresses, values);
+    }
+    return true;
+  }
+
+  size_t valueSize = ValueSize();
+  ValueOps ops = HasValues() ? PickValueOps(Layout()) : ValueOps();
+  bool valueFilter = query.hasMin || query.hasMax;
+  auto selects = [&](uint64_t address, const uint8_t* value) {
+    return address >= query.start && address < query.end && (!valueFilter || ops.inRange(value, query));
+  };
+
+  if (query.order == ResultOrder::Address) {
+    ForEach([&](uint64_t address, const uint8_t* value) {
+      if (!selects(address, value)) {
+        return;
+      }
+      if (total >= offset && addresses.size() < count) {
+        addresses.push_back(address);
+        values.insert(values.end(), value, value + valueSize);
+      }
+      total++;
+    });
+    return true;
+  }
+
+  if (!sorted_ || !(sortedQuery_ == query) || sortedVersion_ != Version()) {
+    sorted_ = false;
+    std::vector<uint64_t>().swap(sortedAddresses_);
+    std::vector<uint8_t>().swap(sortedValues_);
+
+    std::vector<uint64_t> rowAddresses;
+    std::vector<uint8_t> rowValues;
+    std::vector<uint64_t> rowBits;
+    uint64_t selected = 0;
+    ForEach([&](uint64_t address, const uint8_t* value) {
+      if (!selects(address, value)) {
+        return;
+      }
+      // Past the limit only the count is kept, for the error
+      if (++selected <= kMaxSortedRows) {
+        rowAddresses.push_back(address);
+        rowValues.insert(rowValues.end(), value, value + valueSize);
+        rowBits.push_back(ops.bits(value));
+      }
+    });
+    if (selected > kMaxSortedRows) {
+      error = std::to_string(selected) + " results are too many to sort; narrow or filter them first";
+      return false;
+    }
+
+    // Stable, so equal values stay in address order
+    std::vector<uint32_t> order(rowAddresses.size());
+    for (size_t i = 0; i < order.size(); i++) {
+      order[i] = static_cast<uint32_t>(i);
+    }
+    bool descending = query.order == ResultOrder::ValueDescending;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return descending ? ops.less(rowBits[b], rowBits[a]) : ops.less(rowBits[a], rowBits[b]);
+    });
+
+    sortedAddresses_.resize(order.size());
+    sortedValues_.resize(order.size() * valueSize);
+    for (size_t i = 0; i < order.size(); i++) {
+      sortedAddresses_[i] = rowAddresses[order[i]];
+      memcpy(sortedValues_.data() + i * valueSize, rowValues.data() + order[i] * valueSize, valueSize);
+    }
+    sorted_ = true;
+    sortedQuery_ = query;
+    sortedVersion_ = Version();
+  }
+
+  total = sortedAddresses_.size();
+  if (offset < total) {
+    size_t end = static_cast<size_t>(std::min<uint64_t>(total, offset + count));
+    addresses.assign(sortedAddresses_.begin() + static_cast<size_t>(offset), sortedAddresses_.begin() + end);
+    values.assign(sortedValues_.begin() + static_cast<size_t>(offset) * valueSize,
+                  sortedValues_.begin() + end * valueSize);
+  }
+  return true;
+}
+
+std::shared_ptr<ScanResults> MakeAddressResults(std::vector<uint64_t> addresses) {
+  return std::make_shared<AddressResults>(std::move(addresses));
+}
+
+std::shared_ptr<ScanResults> MakeCandidateResults(std::shared_ptr<const CandidateSet> candidates,
+                                                  const RdramLocation& space) {
+  return std::make_shared<CandidateResults>(std::move(candidates), space);
+}
+
+uint32_t ResultStore::Add(std::shared_ptr<ScanResults> results) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t handle = nextHandle_++;
+  if (nextHandle_ == 0) {
+    nextHandle_ = 1;
+  }
+  results_[handle] = std::move(results);
+  return handle;
+}
+
+std::shared_ptr<ScanResults> ResultStore::Get(uint32_t handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = results_.find(handle);
+  return found != results_.end() ? found->second : nullptr;
+}
+
+bool ResultStore::Release(uint32_t handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return results_.erase(handle) > 0;
+}
+
+void ResultStore::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  results_.clear();
+}
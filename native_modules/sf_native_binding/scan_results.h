@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "candidate_set.h"
+#include "rdram.h"
+
+enum class ResultOrder : uint8_t {
+  Address,
+  ValueAscending,
+  ValueDescending,
+};
+
+// Which matches a page is drawn from, and in what order
+struct ResultQuery {
+  // Address window [start, end)
+  uint64_t start = 0;
+  uint64_t end = UINT64_MAX;
+  // Inclusive bounds on the recorded value, as ScanOperand bits of the
+  // results' value type
+  bool hasMin = false;
+  bool hasMax = false;
+  ScanOperand min;
+  ScanOperand max;
+  ResultOrder order = ResultOrder::Address;
+
+  // Every match, in address order
+  bool IsPlain() const;
+  bool UsesValues() const { return hasMin || hasMax || order != ResultOrder::Address; }
+  bool operator==(const ResultQuery& other) const;
+};
+
+// Matches of one scan, kept on the native side so a view fetches only the
+// rows it shows. Plain pages are copied straight from the matches and
+// filtered ones stream over them without extra storage. Value-ordered
+// pages sort a copy of the selected rows, kept until the query or the
+// matches change. Not thread safe.
+class ScanResults {
+ public:
+  virtual ~ScanResults() = default;
+
+  virtual uint64_t Count() const = 0;
+  // Address lists from one-shot scans record no values
+  virtual bool HasValues() const = 0;
+  virtual ValueLayout Layout() const { return ValueLayout(); }
+  size_t ValueSize() const { return HasValues() ? ValueTypeSize(Layout().type) : 0; }
+
+  // True while later scan passes may still change the matches
+  virtual bool IsLive() const { return false; }
+
+  // Copies rows [offset, offset + count) of `query` into `addresses` and
+  // `values` (ValueSize() bytes per row, as recorded) and sets `total` to
+  // the rows `query` selects. False with `error` set for a value query on
+  // results without values, or a sort over more than kMaxSortedRows rows.
+  bool Page(const ResultQuery& query, uint64_t offset, size_t count, std::vector<uint64_t>& addresses,
+            std::vector<uint8_t>& values, uint64_t& total, std::string& error);
+
+  static const uint64_t kMaxSortedRows = 1 << 22;
+
+ protected:
+  // In address order
+  virtual void Get(uint64_t offset, size_t count, std::vector<uint64_t>& addresses,
+                   std::vector<uint8_t>& values) const = 0;
+  virtual void ForEach(const std::function<void(uint64_t address, const uint8_t* value)>& visit) const = 0;
+  // Changes whenever the matches do
+  virtual uint64_t Version() const { return 0; }
+
+ private:
+  // Rows of the last value-ordered query, sorted
+  bool sorted_ = false;
+  ResultQuery sortedQuery_;
+  uint64_t sortedVersion_ = 0;
+  std::vector<uint64_t> sortedAddresses_;
+  std::vector<uint8_t> sortedValues_;
+};
+
+// The addresses a one-shot scan found, sorted; no values are recorded
+std::shared_ptr<ScanResults> MakeAddressResults(std::vector<uint64_t> addresses);
+
+// The candidates of a narrowing scan, with their last-read values. The
+// results follow the set, so later passes narrow them too. `space` is the
+// RDRAM block a scan restricted to N64 memory ran over; its candidates are
+// reported as N64 addresses.
+std::shared_ptr<ScanResults> MakeCandidateResults(std::shared_ptr<const CandidateSet> candidates,
+                                                  const RdramLocation& space);
+
+// Result sets by handle, so JS holds a number instead of the matches
+class ResultStore {
+ public:
+  uint32_t Add(std::shared_ptr<ScanResults> results);
+  // Null for unknown or released handles
+  std::shared_ptr<ScanResults> Get(uint32_t handle);
+  bool Release(uint32_t handle);
+  void Clear();
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<uint32_t, std::shared_ptr<ScanResults>> results_;
+  uint32_t nextHandle_ = 1;
+};
@@ -0,0 +1,223 @@
+#include "scanner.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include "region_stream.h"
+#include "scan_kernels.h"
+#include "thread_pool.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+}  // namespace
+
+bool StreamReadableRegions(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                           const StreamOptions& options, const WindowHandler& handler,
+                           const std::atomic<uint64_t>& matchesFound,
+                           const std::atomic<bool>* cancelled,
+                           const ScanProgressCallback& onProgress) {
+  Clock::time_point start = Clock::now();
+
+  ScanProgress progress;
+  progress.regionsTotal = regions.size();
+
+  std::vector<StreamSpan> spans;
+  uint64_t skippedRegions = 0;
+  uint64_t skippedBytes = 0;
+  for (size_t r = 0; r < regions.size(); r++) {
+    const MemoryRegion& region = regions[r];
+    progress.bytesTotal += region.size;
+    if (!(region.protection & kProtRead) || (region.protection & kProtGuard)) {
+      skippedRegions++;
+      skippedBytes += region.size;
+      continue;
+    }
+    StreamSpan span;
+    span.address = region.base;
+    span.size = region.size;
+    span.tag = r;
+    spans.push_back(span);
+  }
+
+  StreamStats stats;
+  auto report = [&]() {
+    if (!onProgress) {
+      return;
+    }
+    progress.regionsDone = skippedRegions + stats.spansDone;
+    progress.bytesScanned = skippedBytes + stats.bytesDone;
+    progress.matches = matchesFound;
+    progress.elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    onProgress(progress);
+  };
+
+  if (!StreamRegions(process, spans, options, handler, stats, cancelled, report)) {
+    return false;
+  }
+  report();
+  RecordScanPass(spans.size(), skippedRegions, stats.bytesDone, Clock::now() - start);
+  return true;
+}
+
+namespace {
+
+// Appends every worker's matches to `matches` in ascending order
+void MergeMatches(std::vector<std::vector<uint64_t>>& workerMatches, size_t total,
+                  std::vector<uint64_t>& matches) {
+  size_t firstNew = matches.size();
+  matches.reserve(firstNew + total);
+  for (std::vector<uint64_t>& found : workerMatches) {
+    matches.insert(matches.end(), found.begin(), found.end());
+  }
+  std::sort(matches.begin() + firstNew, matches.end());
+}
+
+int HexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+}  // namespace
+
+bool ScanForUint32(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                   uint32_t valueToFind, std::vector<uint64_t>& matches,
+                   const std::atomic<bool>* cancelled,
+                   const ScanProgressCallback& onProgress) {
+  ThreadPool& pool = ThreadPool::Shared();
+  FindUint32Kernel kernel = SelectFindUint32Kernel();
+
+  // One match buffer per worker; merged once every window is compared
+  std::vector<std::vector<uint64_t>> workerMatches(pool.Size());
+  std::atomic<uint64_t> matchesFound(0);
+
+  // Windows are page aligned, so aligned uint32 values never straddle two
+  // windows and no overlap is needed
+  StreamOptions options;
+
+  auto handler = [&](const StreamWindow& window) {
+    size_t bytes = std::min(window.size, window.available);
+    std::vector<uint64_t>& found = workerMatches[ThreadPool::CurrentWorker()];
+    size_t before = found.size();
+    kernel(window.data, bytes, valueToFind, window.address, found);
+    matchesFound += found.size() - before;
+  };
+
+  if (!StreamReadableRegions(process, regions, options, handler, matchesFound, cancelled, onProgress)) {
+    return false;
+  }
+  MergeMatches(workerMatches, matchesFound, matches);
+  return true;
+}
+
+bool ParseBytePattern(const std::string& text, BytePattern& pattern, std::string& error) {
+  pattern.bytes.clear();
+  pattern.mask.clear();
+
+  size_t i = 0;
+  while (i < text.size()) {
+    if (isspace(static_cast<unsigned char>(text[i]))) {
+      i++;
+      continue;
+    }
+    if (text[i] == '?') {
+      i += (i + 1 < text.size() && text[i + 1] == '?') ? 2 : 1;
+      pattern.bytes.push_back(0);
+      pattern.mask.push_back(0);
+      continue;
+    }
+    int high = HexDigit(text[i]);
+    int low = i + 1 < text.size() ? HexDigit(text[i + 1]) : -1;
+    if (high < 0 || low < 0) {
+      error = "Invalid pattern byte at position " + std::to_string(i);
+      return false;
+    }
+    pattern.bytes.push_back(static_cast<uint8_t>(high << 4 | low));
+    pattern.mask.push_back(0xFF);
+    i += 2;
+  }
+
+  if (std::find(pattern.mask.begin(), pattern.mask.end(), 0xFF) == pattern.mask.end()) {
+    error = "A pattern needs at least one fixed byte";
+    return false;
+  }
+  return true;
+}
+
+bool ScanForPattern(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                    const BytePattern& pattern, std::vector<uint64_t>& matches,
+                    const std::atomic<bool>* cancelled,
+                    const ScanProgressCallback& onProgress) {
+  ThreadPool& pool = ThreadPool::Shared();
+  size_t length = pattern.bytes.size();
+  size_t alignment = std::max<size_t>(pattern.alignment, 1);
+
+  // memchr for the first fixed byte, then a masked compare of the rest
+  size_t anchor = std::find(pattern.mask.begin(), pattern.mask.end(), 0xFF) - pattern.mask.begin();
+  uint8_t anchorByte = pattern.bytes[anchor];
+
+  std::vector<std::vector<uint64_t>> workerMatches(pool.Size());
+  std::atomic<uint64_t> matchesFound(0);
+
+  // Matches may start anywhere in a window and run past its end; word
+  // swapping needs whole words, so the overlap is rounded up to one
+  StreamOptions options;
+  options.overlap = pattern.wordSwapped ? (length + 2) / 4 * 4 : length - 1;
+
+  auto handler = [&](const StreamWindow& window) {
+    size_t bytes = std::min(window.size + options.overlap, window.available);
+    const uint8_t* data = window.data;
+
+    thread_local std::vector<uint8_t> swapped;
+    if (pattern.wordSwapped) {
+      bytes &= ~static_cast<size_t>(3);
+      swapped.resize(bytes);
+      for (size_t i = 0; i < bytes; i += 4) {
+        swapped[i] = data[i + 3];
+        swapped[i + 1] = data[i + 2];
+        swapped[i + 2] = data[i + 1];
+        swapped[i + 3] = data[i];
+      }
+      data = swapped.data();
+    }
+    if (bytes < length) {
+      return;
+    }
+
+    std::vector<uint64_t>& found = workerMatches[ThreadPool::CurrentWorker()];
+    size_t before = found.size();
+    // Only starts inside the window itself belong to it
+    size_t lastStart = std::min(window.size - 1, bytes - length);
+    const uint8_t* cursor = data + anchor;
+    const uint8_t* end = data + lastStart + anchor + 1;
+    while (cursor < end) {
+      cursor = static_cast<const uint8_t*>(memchr(cursor, anchorByte, end - cursor));
+      if (!cursor) {
+        break;
+      }
+      size_t start = (cursor - data) - anchor;
+      cursor++;
+      if (start % alignment != 0) {
+        continue;
+      }
+      size_t i = 0;
+      while (i < length && (data[start + i] & pattern.mask[i]) == pattern.bytes[i]) {
+        i++;
+      }
+      if (i == length) {
+        found.push_back(window.address + start);
+      }
+    }
+    matchesFound += found.size() - before;
+  };
+
+  if (!StreamReadableRegions(process, regions, options, handler, matchesFound, cancelled, onProgress)) {
+    return false;
+  }
+  MergeMatches(workerMatches, matchesFound, matches);
+  return true;
+}
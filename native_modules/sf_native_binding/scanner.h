@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "platform.h"
+#include "region_stream.h"
+
+// Snapshot of a running scan, handed to ScanProgressCallback
+struct ScanProgress {
+  uint64_t regionsDone = 0;
+  uint64_t regionsTotal = 0;
+  uint64_t bytesScanned = 0;
+  uint64_t bytesTotal = 0;
+  uint64_t matches = 0;
+  double elapsedSeconds = 0;
+};
+
+typedef std::function<void(const ScanProgress&)> ScanProgressCallback;
+
+// Streams every readable region through `handler` on the shared pool,
+// counting unreadable ones as done up front so progress still reaches
+// 100%. The handler adds its matches to `matchesFound` for progress
+// reports. Window tags are indexes into `regions`.
+bool StreamReadableRegions(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                           const StreamOptions& options, const WindowHandler& handler,
+                           const std::atomic<uint64_t>& matchesFound,
+                           const std::atomic<bool>* cancelled = nullptr,
+                           const ScanProgressCallback& onProgress = nullptr);
+
+// Scans the readable regions for an aligned uint32 value and appends the
+// address of every match. Checks `cancelled` between blocks and reports
+// progress at most every few milliseconds. Returns false if cancelled.
+bool ScanForUint32(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                   uint32_t valueToFind, std::vector<uint64_t>& matches,
+                   const std::atomic<bool>* cancelled = nullptr,
+                   const ScanProgressCallback& onProgress = nullptr);
+
+// An array-of-bytes pattern. Bytes whose mask is 0 are wildcards.
+struct BytePattern {
+  std::vector<uint8_t> bytes;
+  std::vector<uint8_t> mask;
+  // Only report matches at multiples of this many bytes
+  size_t alignment = 1;
+  // Match memory whose 32-bit words are stored byte-reversed, as emulators
+  // keep big-endian RAM. Addresses are then in the target's byte order:
+  // the host address of the word plus the offset inside it.
+  bool wordSwapped = false;
+};
+
+// Parses "DE AD ?? EF" style text; "?" or "??" is a wildcard byte. At least
+// one byte must be fixed.
+bool ParseBytePattern(const std::string& text, BytePattern& pattern, std::string& error);
+
+// Scans the readable regions for `pattern`, appending match addresses in
+// ascending order. Same cancellation and progress contract as ScanForUint32.
+bool ScanForPattern(ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                    const BytePattern& pattern, std::vector<uint64_t>& matches,
+                    const std::atomic<bool>* cancelled = nullptr,
+                    const ScanProgressCallback& onProgress = nullptr);
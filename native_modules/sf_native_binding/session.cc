@@ -0,0 +1,2049 @@
+#include "session.h"
+#include "async_scan.h"
+#include "memory.h"
+#include "scanner.h"
+#include "structs.h"
+#include <algorithm>
+
+Napi::FunctionReference ProcessSession::constructor;
+
+namespace {
+
+// Addresses arrive as Numbers (exact below 2^53) or BigInts
+bool ToAddress(const Napi::Value& value, uint64_t& address) {
+  if (value.IsBigInt()) {
+    bool lossless = false;
+    address = value.As<Napi::BigInt>().Uint64Value(&lossless);
+    return lossless;
+  }
+  if (value.IsNumber()) {
+    address = static_cast<uint64_t>(value.As<Napi::Number>().Int64Value());
+    return true;
+  }
+  return false;
+}
+
+std::string ProtectionToString(uint32_t protection) {
+  std::string result = "---";
+  if (protection & kProtRead) result[0] = 'r';
+  if (protection & kProtWrite) result[1] = 'w';
+  if (protection & kProtExecute) result[2] = 'x';
+  if (protection & kProtGuard) result += 'g';
+  return result;
+}
+
+const char* RegionTypeToString(RegionType type) {
+  switch (type) {
+    case RegionType::Image:
+      return "image";
+    case RegionType::Mapped:
+      return "mapped";
+    default:
+      return "private";
+  }
+}
+
+bool ParseCompareMode(const std::string& name, CompareMode& mode) {
+  static const struct {
+    const char* name;
+    CompareMode mode;
+  } kModes[] = {
+    { "unknown", CompareMode::Unknown },
+    { "equal", CompareMode::Equal },
+    { "notEqual", CompareMode::NotEqual },
+    { "changed", CompareMode::Changed },
+    { "unchanged", CompareMode::Unchanged },
+    { "increased", CompareMode::Increased },
+    { "decreased", CompareMode::Decreased },
+    { "increasedBy", CompareMode::IncreasedBy },
+    { "decreasedBy", CompareMode::DecreasedBy },
+    { "range", CompareMode::InRange },
+  };
+  for (const auto& entry : kModes) {
+    if (name == entry.name) {
+      mode = entry.mode;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Copies packed raw values into a typed array of their type, undoing the
+// target's byte order
+template <typename T>
+Napi::Value PackValues(Napi::Env env, const std::vector<uint8_t>& bytes, size_t count, bool byteSwap) {
+  Napi::TypedArrayOf<T> array = Napi::TypedArrayOf<T>::New(env, count);
+  uint8_t* out = reinterpret_cast<uint8_t*>(array.Data());
+  if (count == 0) {
+    return array;
+  }
+  if (!byteSwap) {
+    memcpy(out, bytes.data(), count * sizeof(T));
+    return array;
+  }
+  for (size_t i = 0; i < count * sizeof(T); i += sizeof(T)) {
+    for (size_t b = 0; b < sizeof(T); b++) {
+      out[i + b] = bytes[i + sizeof(T) - 1 - b];
+    }
+  }
+  return array;
+}
+
+// Candidate values as the typed array matching the layout; 64-bit integers
+// land in BigInt64Array/BigUint64Array
+Napi::Value ValuesToJs(Napi::Env env, const std::vector<uint8_t>& bytes, size_t count, const ValueLayout& layout) {
+  switch (layout.type) {
+    case ValueType::Int8: return PackValues<int8_t>(env, bytes, count, layout.byteSwap);
+    case ValueType::UInt8: return PackValues<uint8_t>(env, bytes, count, layout.byteSwap);
+    case ValueType::Int16: return PackValues<int16_t>(env, bytes, count, layout.byteSwap);
+    case ValueType::UInt16: return PackValues<uint16_t>(env, bytes, count, layout.byteSwap);
+    case ValueType::Int32: return PackValues<int32_t>(env, bytes, count, layout.byteSwap);
+    case ValueType::UInt32: return PackValues<uint32_t>(env, bytes, count, layout.byteSwap);
+    case ValueType::Int64: return PackValues<int64_t>(env, bytes, count, layout.byteSwap);
+    case ValueType::UInt64: return PackValues<uint64_t>(env, bytes, count, layout.byteSwap);
+    case ValueType::Float32: return PackValues<float>(env, bytes, count, layout.byteSwap);
+    case ValueType::Float64: return PackValues<double>(env, bytes, count, layout.byteSwap);
+  }
+  return env.Undefined();
+}
+
+// A watched value, BigInt for 64-bit integers, null when unreadable
+Napi::Value WatchValueToJs(Napi::Env env, const WatchChange& change) {
+  if (!change.readable) {
+    return env.Null();
+  }
+  return OperandToJs(env, change.bits, change.type);
+}
+
+// Runs `scan` over RDRAM alone and turns its host matches into KSEG0
+// addresses; the session's region map is ignored
+ScanFunction ScopeToRdram(ScanFunction scan, const RdramLocation& rdram) {
+  return [scan, rdram](ProcessHandle& process, const std::vector<MemoryRegion>&, std::vector<uint64_t>& matches,
+                       const std::atomic<bool>* cancelled, const ScanProgressCallback& onProgress) {
+    std::vector<MemoryRegion> scope(1, RdramRegion(rdram));
+    if (!scan(process, scope, matches, cancelled, onProgress)) {
+      return false;
+    }
+    for (uint64_t& address : matches) {
+      address = RdramVirtualAddress(rdram, address, 4);
+    }
+    return true;
+  };
+}
+
+// Tick interval from { intervalMs }, 60 Hz by default
+bool ParseWatchInterval(const Napi::Value& options, std::chrono::microseconds& interval) {
+  interval = std::chrono::microseconds(16667);
+  if (!options.IsObject()) {
+    return true;
+  }
+  Napi::Value value = options.As<Napi::Object>().Get("intervalMs");
+  if (value.IsUndefined()) {
+    return true;
+  }
+  if (!value.IsNumber() || !(value.As<Napi::Number>().DoubleValue() >= 1)) {
+    return false;
+  }
+  interval = std::chrono::microseconds(static_cast<int64_t>(value.As<Napi::Number>().DoubleValue() * 1000));
+  return true;
+}
+
+bool GetBoolean(const Napi::Object& object, const char* key, bool fallback) {
+  Napi::Value value = object.Get(key);
+  return value.IsBoolean() ? value.As<Napi::Boolean>().Value() : fallback;
+}
+
+// { cached } of a read's options: serve it from the session's page cache
+bool IsCachedRead(const Napi::Value& options) {
+  return options.IsObject() && GetBoolean(options.As<Napi::Object>(), "cached", false);
+}
+
+// N64 addresses are 32 bits. ToAddress takes any 64-bit value (a negative
+// Number wraps around), which would otherwise truncate onto a valid RDRAM
+// address; throws a RangeError instead.
+bool CheckN64Address(Napi::Env env, uint64_t address) {
+  if (address > UINT32_MAX) {
+    Napi::RangeError::New(env, AddressToHexString(address) + " is not an N64 address").ThrowAsJavaScriptException();
+    return false;
+  }
+  return true;
+}
+
+// Value layout of a first scan: { type = 'uint32', aligned = true,
+// byteSwap = false } read from the criteria object
+bool ParseLayout(const Napi::Value& value, ValueLayout& layout, std::string& error) {
+  if (!value.IsObject()) {
+    return true;
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Value type = object.Get("type");
+  if (type.IsString() && !ParseValueType(type.As<Napi::String>().Utf8Value(), layout.type)) {
+    error = "Unknown value type";
+    return false;
+  }
+  layout.unaligned = !GetBoolean(object, "aligned", true);
+  layout.byteSwap = GetBoolean(object, "byteSwap", false);
+  return true;
+}
+
+// Criteria arrive as a bare value (equal) or { mode, value, min, max,
+// epsilon }, with operands converted to the layout's type
+bool ParseCriteria(const Napi::Value& value, const ValueLayout& layout, ScanCriteria& criteria,
+                   std::string& error) {
+  if (value.IsNumber() || value.IsBigInt()) {
+    criteria.mode = CompareMode::Equal;
+    return ToOperand(value, layout.type, criteria.value);
+  }
+  if (!value.IsObject()) {
+    error = "Scan criteria must be a number or an object";
+    return false;
+  }
+
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Value mode = object.Get("mode");
+  if (!mode.IsString() || !ParseCompareMode(mode.As<Napi::String>().Utf8Value(), criteria.mode)) {
+    error = "Unknown scan mode";
+    return false;
+  }
+  Napi::Value epsilon = object.Get("epsilon");
+  if (epsilon.IsNumber()) {
+    criteria.epsilon = epsilon.As<Napi::Number>().DoubleValue();
+  }
+
+  switch (criteria.mode) {
+    case CompareMode::Equal:
+    case CompareMode::NotEqual:
+    case CompareMode::IncreasedBy:
+    case CompareMode::DecreasedBy:
+      if (!ToOperand(object.Get("value"), layout.type, criteria.value)) {
+        error = "This scan mode requires a numeric value";
+        return false;
+      }
+      break;
+    case CompareMode::InRange:
+      if (!ToOperand(object.Get("min"), layout.type, criteria.value) ||
+          !ToOperand(object.Get("max"), layout.type, criteria.value2)) {
+        error = "A range scan requires numeric min and max";
+        return false;
+      }
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+// Region filter { writable, private, module, start, end, minSize, maxSize };
+// undefined leaves every region in
+bool ParseRegionFilter(const Napi::Value& value, RegionFilter& filter, std::string& error) {
+  if (value.IsUndefined() || value.IsNull()) {
+    return true;
+  }
+  if (!value.IsObject()) {
+    error = "Region filter must be an object";
+    return false;
+  }
+
+  Napi::Object object = value.As<Napi::Object>();
+  filter.writableOnly = GetBoolean(object, "writable", false);
+  filter.privateOnly = GetBoolean(object, "private", false);
+  Napi::Value module = object.Get("module");
+  if (module.IsString()) {
+    filter.module = module.As<Napi::String>().Utf8Value();
+  } else if (!module.IsUndefined()) {
+    error = "Region filter module must be a string";
+    return false;
+  }
+
+  const struct {
+    const char* key;
+    uint64_t* field;
+  } kBounds[] = {
+    { "start", &filter.start },
+    { "end", &filter.end },
+    { "minSize", &filter.minSize },
+    { "maxSize", &filter.maxSize },
+  };
+  for (const auto& bound : kBounds) {
+    Napi::Value boundValue = object.Get(bound.key);
+    if (!boundValue.IsUndefined() && !ToAddress(boundValue, *bound.field)) {
+      error = std::string("Region filter ") + bound.key + " must be a number";
+      return false;
+    }
+  }
+  if (filter.start >= filter.end || filter.minSize > filter.maxSize) {
+    error = "Region filter matches nothing";
+    return false;
+  }
+  return true;
+}
+
+// Reads { regions } from a scan's options or criteria object
+bool ParseScanRegions(const Napi::CallbackInfo& info, size_t index, RegionFilter& filter, std::string& error) {
+  if (info.Length() <= index || !info[index].IsObject()) {
+    return true;
+  }
+  return ParseRegionFilter(info[index].As<Napi::Object>().Get("regions"), filter, error);
+}
+
+Napi::Object RegionToJs(Napi::Env env, const MemoryRegion& region) {
+  Napi::Object entry = Napi::Object::New(env);
+  entry.Set("base", Napi::Number::New(env, region.base));
+  entry.Set("size", Napi::Number::New(env, region.size));
+  entry.Set("protection", Napi::String::New(env, ProtectionToString(region.protection)));
+  entry.Set("type", Napi::String::New(env, RegionTypeToString(region.type)));
+  entry.Set("module", Napi::String::New(env, RegionModule(region)));
+  entry.Set("path", Napi::String::New(env, region.path));
+  return entry;
+}
+
+// Pointer scan options { pointerSize, maxDepth, maxOffset, maxResults,
+// maxNodes, memoryLimitMB }; anything missing keeps its default
+bool ParsePointerScanOptions(const Napi::Value& value, PointerScanOptions& options, std::string& error) {
+  if (!value.IsObject()) {
+    return true;
+  }
+
+  Napi::Object object = value.As<Napi::Object>();
+  uint64_t memoryLimitMB = options.memoryLimit >> 20;
+  uint64_t pointerSize = options.pointerSize;
+  uint64_t maxDepth = options.maxDepth;
+  uint64_t maxResults = options.maxResults;
+  uint64_t maxNodes = options.maxNodes;
+  const struct {
+    const char* key;
+    uint64_t* field;
+  } kFields[] = {
+    { "pointerSize", &pointerSize },
+    { "maxDepth", &maxDepth },
+    { "maxOffset", &options.maxOffset },
+    { "maxResults", &maxResults },
+    { "maxNodes", &maxNodes },
+    { "memoryLimitMB", &memoryLimitMB },
+  };
+  for (const auto& field : kFields) {
+    Napi::Value fieldValue = object.Get(field.key);
+    if (!fieldValue.IsUndefined() && !ToAddress(fieldValue, *field.field)) {
+      error = std::string("Pointer scan ") + field.key + " must be a number";
+      return false;
+    }
+  }
+  if (pointerSize != 0 && pointerSize != 4 && pointerSize != 8) {
+    error = "Pointer size must be 4 or 8";
+    return false;
+  }
+  if (maxDepth < 1 || maxDepth > 16) {
+    error = "Pointer scan maxDepth must be between 1 and 16";
+    return false;
+  }
+  if (maxResults == 0 || maxNodes == 0 || memoryLimitMB == 0) {
+    error = "Pointer scan limits must be positive";
+    return false;
+  }
+  options.pointerSize = static_cast<uint32_t>(pointerSize);
+  options.maxDepth = static_cast<uint32_t>(maxDepth);
+  options.maxResults = static_cast<size_t>(maxResults);
+  options.maxNodes = static_cast<size_t>(maxNodes);
+  options.memoryLimit = static_cast<size_t>(std::min<uint64_t>(memoryLimitMB, SIZE_MAX >> 20) << 20);
+  return true;
+}
+
+// A chain as returned by pointerScan: { module, baseOffset, offsets }
+bool ParsePointerChain(const Napi::Value& value, PointerChain& chain) {
+  if (!value.IsObject()) {
+    return false;
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Value module = object.Get("module");
+  Napi::Value offsets = object.Get("offsets");
+  if (!module.IsString() || !ToAddress(object.Get("baseOffset"), chain.baseOffset) || !offsets.IsArray()) {
+    return false;
+  }
+  chain.module = module.As<Napi::String>().Utf8Value();
+  Napi::Array array = offsets.As<Napi::Array>();
+  chain.offsets.resize(array.Length());
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    if (!ToAddress(array.Get(i), chain.offsets[i])) {
+      return false;
+    }
+  }
+  return !chain.offsets.empty();
+}
+
+// Result query { start, end, min, max, sort: 'address'|'value',
+// descending }; min and max take the results' value type
+bool ParseResultQuery(const Napi::Value& value, const ScanResults& results, ResultQuery& query,
+                      std::string& error) {
+  if (value.IsUndefined() || value.IsNull()) {
+    return true;
+  }
+  if (!value.IsObject()) {
+    error = "Result query must be an object";
+    return false;
+  }
+
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Value start = object.Get("start");
+  Napi::Value end = object.Get("end");
+  if ((!start.IsUndefined() && !ToAddress(start, query.start)) || (!end.IsUndefined() && !ToAddress(end, query.end))) {
+    error = "Result query start and end must be numbers";
+    return false;
+  }
+
+  ValueType type = results.Layout().type;
+  Napi::Value min = object.Get("min");
+  Napi::Value max = object.Get("max");
+  query.hasMin = !min.IsUndefined() && !min.IsNull();
+  query.hasMax = !max.IsUndefined() && !max.IsNull();
+  if ((query.hasMin && !ToOperand(min, type, query.min)) || (query.hasMax && !ToOperand(max, type, query.max))) {
+    error = "Result query min and max must be numbers";
+    return false;
+  }
+
+  Napi::Value sort = object.Get("sort");
+  std::string order = sort.IsString() ? sort.As<Napi::String>().Utf8Value() : "address";
+  if (order == "value") {
+    query.order = GetBoolean(object, "descending", false) ? ResultOrder::ValueDescending
+                                                          : ResultOrder::ValueAscending;
+  } else if (order != "address") {
+    error = "Result query sort must be 'address' or 'value'";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+Napi::Object ProcessSession::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "ProcessSession", {
+    InstanceAccessor("pid", &ProcessSession::GetPid, nullptr),
+    InstanceMethod("isAlive", &ProcessSession::IsAlive),
+    InstanceMethod("detach", &ProcessSession::Detach),
+    InstanceMethod("read", &ProcessSession::Read),
+    InstanceMethod("readInto", &ProcessSession::ReadInto),
+    InstanceMethod("readBatch", &ProcessSession::ReadBatch),
+    InstanceMethod("write", &ProcessSession::Write),
+    InstanceMethod("scan", &ProcessSession::Scan),
+    InstanceMethod("scanAsync", &ProcessSession::ScanAsync),
+    InstanceMethod("scanPattern", &ProcessSession::ScanPattern),
+    InstanceMethod("cancelScan", &ProcessSession::CancelScan),
+    InstanceMethod("firstScan", &ProcessSession::FirstScan),
+    InstanceMethod("nextScan", &ProcessSession::NextScan),
+    InstanceMethod("candidates", &ProcessSession::GetCandidates),
+    InstanceMethod("candidateStats", &ProcessSession::CandidateStats),
+    InstanceMethod("resetScan", &ProcessSession::ResetScan),
+    InstanceMethod("freeze", &ProcessSession::Freeze),
+    InstanceMethod("unfreeze", &ProcessSession::Unfreeze),
+    InstanceMethod("unfreezeAll", &ProcessSession::UnfreezeAll),
+    InstanceMethod("freezeStats", &ProcessSession::FreezeStats),
+    InstanceMethod("addWatch", &ProcessSession::AddWatch),
+    InstanceMethod("removeWatch", &ProcessSession::RemoveWatch),
+    InstanceMethod("startWatching", &ProcessSession::StartWatching),
+    InstanceMethod("stopWatching", &ProcessSession::StopWatching),
+    InstanceMethod("watchStats", &ProcessSession::WatchStats),
+    InstanceMethod("regions", &ProcessSession::GetRegions),
+    InstanceMethod("refreshRegions", &ProcessSession::RefreshRegions),
+    InstanceMethod("locateRdram", &ProcessSession::LocateRdram),
+    InstanceMethod("readN64", &ProcessSession::ReadN64),
+    InstanceMethod("writeN64", &ProcessSession::WriteN64),
+    InstanceMethod("n64ToHost", &ProcessSession::N64ToHost),
+    InstanceMethod("pointerScan", &ProcessSession::PointerScan),
+    InstanceMethod("resolvePointers", &ProcessSession::ResolvePointers),
+    InstanceMethod("snapshot", &ProcessSession::TakeSnapshot),
+    InstanceMethod("diff", &ProcessSession::DiffSnapshot),
+    InstanceMethod("snapshotInfo", &ProcessSession::SnapshotInfo),
+    InstanceMethod("readStruct", &ProcessSession::ReadStruct),
+    InstanceMethod("readStructs", &ProcessSession::ReadStructs),
+    InstanceMethod("writeStruct", &ProcessSession::WriteStruct),
+    InstanceMethod("cacheStats", &ProcessSession::CacheStats),
+    InstanceMethod("configureCache", &ProcessSession::ConfigureCache),
+    InstanceMethod("invalidateCache", &ProcessSession::InvalidateCache),
+    InstanceMethod("storeCandidates", &ProcessSession::StoreCandidates),
+    InstanceMethod("resultPage", &ProcessSession::ResultPage),
+    InstanceMethod("resultCount", &ProcessSession::ResultCount),
+    InstanceMethod("releaseResults", &ProcessSession::ReleaseResults),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("ProcessSession", func);
+  return exports;
+}
+
+// attach(pid) - convenience factory for new ProcessSession(pid)
+Napi::Value ProcessSession::Attach(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "attach requires 1 argument: pid").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return constructor.New({ info[0] });
+}
+
+// openSnapshot(path) - a read-only session over a snapshot file
+Napi::Value ProcessSession::OpenSnapshot(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "openSnapshot requires 1 argument: path").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return constructor.New({ info[0] });
+}
+
+ProcessSession::ProcessSession(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<ProcessSession>(info) {
+  Napi::Env env = info.Env();
+
+  if (info.Length() > 0 && info[0].IsString()) {
+    std::string error;
+    std::unique_ptr<SnapshotFile> snapshot = SnapshotFile::Open(info[0].As<Napi::String>().Utf8Value(), error);
+    if (!snapshot) {
+      Napi::Error::New(env, error).ThrowAsJavaScriptException();
+      return;
+    }
+    pid_ = snapshot->Pid();
+    access_ = kAccessRead | kAccessQuery;
+    snapshot_ = std::move(snapshot);
+    process_ = snapshot_;
+    return;
+  }
+
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "ProcessSession requires 1 argument: pid").ThrowAsJavaScriptException();
+    return;
+  }
+
+  pid_ = info[0].As<Napi::Number>().Uint32Value();
+
+  // Prefer full access, but a read-only attachment is still useful for
+  // scanning targets we are not allowed to modify
+  access_ = kAccessRead | kAccessWrite | kAccessQuery;
+  std::unique_ptr<ProcessHandle> process = OpenProcessHandle(pid_, access_);
+  if (!process) {
+    access_ = kAccessRead | kAccessQuery;
+    process = OpenProcessHandle(pid_, access_);
+  }
+  if (!process) {
+    std::string errorMsg = "Failed to attach to process " + std::to_string(pid_) + ": " + GetLastErrorAsString();
+    Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
+    return;
+  }
+
+  process_ = std::move(process);
+}
+
+ProcessSession::~ProcessSession() {
+  StopWatchThread();
+}
+
+std::shared_ptr<ProcessHandle> ProcessSession::Handle() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return process_;
+}
+
+std::shared_ptr<SnapshotFile> ProcessSession::Snapshot() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return snapshot_;
+}
+
+std::shared_ptr<const std::vector<MemoryRegion>> ProcessSession::Regions() {
+  std::shared_ptr<ProcessHandle> process = Handle();
+  return process ? regionMap_.Get(*process) : nullptr;
+}
+
+std::shared_ptr<const std::vector<MemoryRegion>> ProcessSession::ScanRegions(const RegionFilter& filter) {
+  std::shared_ptr<ProcessHandle> process = Handle();
+  if (!process) {
+    return nullptr;
+  }
+  std::shared_ptr<const std::vector<MemoryRegion>> regions = regionMap_.Get(*process, kScanMapMaxAge);
+  if (!regions || filter.IsEmpty()) {
+    return regions;
+  }
+  return std::make_shared<const std::vector<MemoryRegion>>(FilterRegions(*regions, filter));
+}
+
+std::shared_ptr<FaultRecorder> ProcessSession::ScanHandle() {
+  std::shared_ptr<ProcessHandle> process = Handle();
+  return process ? std::make_shared<FaultRecorder>(std::move(process)) : nullptr;
+}
+
+void ProcessSession::ScanFinished(FaultRecorder& process) {
+  std::vector<std::pair<uint64_t, uint64_t>> faults = process.Faults();
+  if (!faults.empty()) {
+    regionMap_.RefreshFaults(process, faults);
+  }
+}
+
+std::shared_ptr<CandidateSet> ProcessSession::Candidates() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return candidates_;
+}
+
+void ProcessSession::SetCandidates(std::shared_ptr<CandidateSet> candidates, const RdramLocation& space) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  candidates_ = std::move(candidates);
+  candidateSpace_ = space;
+}
+
+RdramLocation ProcessSession::CandidateSpace() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return candidateSpace_;
+}
+
+bool ProcessSession::Rdram(RdramLocation& location, bool refresh) {
+  std::shared_ptr<ProcessHandle> process;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rdram_.size > 0 && !refresh) {
+      location = rdram_;
+      return true;
+    }
+    process = process_;
+  }
+  if (!process) {
+    return false;
+  }
+
+  // A fresh map: the emulator allocates RDRAM when a game starts, which
+  // may be after the cached map was taken
+  RdramLocation found;
+  if (!regionMap_.Refresh(*process)) {
+    return false;
+  }
+  std::shared_ptr<const std::vector<MemoryRegion>> regions = regionMap_.Get(*process);
+  if (!regions || !::LocateRdram(*process, *regions, found)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  rdram_ = found;
+  location = found;
+  return true;
+}
+
+std::shared_ptr<ProcessHandle> ProcessSession::RequireRdram(Napi::Env env, RdramLocation& location) {
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return nullptr;
+  }
+  if (!Rdram(location)) {
+    Napi::Error::New(env, "N64 RDRAM not found in process " + std::to_string(pid_)).ThrowAsJavaScriptException();
+    return nullptr;
+  }
+  return process;
+}
+
+std::shared_ptr<ProcessHandle> ProcessSession::RequireStructTarget(Napi::Env env, const Napi::Value& options,
+                                                                   uint64_t address, RdramLocation& rdram,
+                                                                   StructTarget& target) {
+  bool n64 = options.IsObject() && GetBoolean(options.As<Napi::Object>(), "n64", false);
+  if (n64 && !CheckN64Address(env, address)) {
+    return nullptr;
+  }
+  std::shared_ptr<ProcessHandle> process = n64 ? RequireRdram(env, rdram) : RequireHandle(env);
+  target.process = process.get();
+  target.rdram = n64 ? &rdram : nullptr;
+  return process;
+}
+
+std::shared_ptr<ProcessHandle> ProcessSession::RequireHandle(Napi::Env env) {
+  std::shared_ptr<ProcessHandle> process = Handle();
+  if (!process) {
+    Napi::Error::New(env, "Session is detached").ThrowAsJavaScriptException();
+    return nullptr;
+  }
+  return process;
+}
+
+void ProcessSession::ThrowTransferError(Napi::Env env, const std::string& message) {
+  std::string detail = GetLastErrorAsString();
+  std::shared_ptr<ProcessHandle> process = Handle();
+  if (process && !process->IsAlive()) {
+    // Drop the handle so every later call fails fast
+    std::lock_guard<std::mutex> lock(mutex_);
+    process_.reset();
+    regionMap_.Clear();
+    cache_.Clear();
+    Napi::Error::New(env, "Target process " + std::to_string(pid_) + " has exited").ThrowAsJavaScriptException();
+    return;
+  }
+  Napi::Error::New(env, message + ": " + detail).ThrowAsJavaScriptException();
+}
+
+Napi::Value ProcessSession::GetPid(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), pid_);
+}
+
+Napi::Value ProcessSession::IsAlive(const Napi::CallbackInfo& info) {
+  std::shared_ptr<ProcessHandle> process = Handle();
+  return Napi::Boolean::New(info.Env(), process && process->IsAlive());
+}
+
+Napi::Value ProcessSession::Detach(const Napi::CallbackInfo& info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (activeScan_) {
+    activeScan_->store(true);
+    activeScan_.reset();
+  }
+  process_.reset();
+  snapshot_.reset();
+  regionMap_.Clear();
+  cache_.Clear();
+  candidates_.reset();
+  results_.Clear();
+  rdram_ = RdramLocation();
+  freezer_.reset();
+  StopWatchThread();
+  watcher_.reset();
+  return info.Env().Undefined();
+}
+
+// read(address, size, { cached }) - returns a Buffer with exactly `size`
+// bytes. With cached, pages read within the cache's TTL are not read again.
+Napi::Value ProcessSession::Read(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  if (info.Length() < 2 || !ToAddress(info[0], address) || !info[1].IsNumber()) {
+    Napi::TypeError::New(env, "read requires 2 arguments: address, size").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return env.Null();
+  }
+
+  size_t size = info[1].As<Napi::Number>().Uint32Value();
+  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, size);
+  size_t bytesRead = info.Length() > 2 && IsCachedRead(info[2]) ? cache_.Read(*process, address, buffer.Data(), size)
+                                                                 : process->Read(address, buffer.Data(), size);
+  if (bytesRead != size) {
+    ThrowTransferError(env, "Failed to read " + std::to_string(size) + " bytes at " + AddressToHexString(address));
+    return env.Null();
+  }
+  return buffer;
+}
+
+// readInto(address, buffer, offset = 0, size) - reads into a caller-owned
+// Buffer, TypedArray or ArrayBuffer so polling loops can reuse one
+// allocation. Returns the bytes read; throws only once the target exits.
+Napi::Value ProcessSession::ReadInto(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  uint8_t* data = nullptr;
+  size_t length = 0;
+  if (info.Length() < 2 || !ToAddress(info[0], address) || !GetTargetBytes(info[1], data, length)) {
+    Napi::TypeError::New(env, "readInto requires 2 arguments: address, buffer").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t offset = info.Length() > 2 && info[2].IsNumber() ? info[2].As<Napi::Number>().Uint32Value() : 0;
+  if (offset > length) {
+    Napi::RangeError::New(env, "offset is past the end of the buffer").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t size = length - offset;
+  if (info.Length() > 3 && info[3].IsNumber()) {
+    size = std::min<size_t>(size, info[3].As<Napi::Number>().Uint32Value());
+  }
+
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return env.Null();
+  }
+
+  size_t bytesRead = process->Read(address, data + offset, size);
+  if (bytesRead == 0 && size > 0 && !process->IsAlive()) {
+    ThrowTransferError(env, "Failed to read " + std::to_string(size) + " bytes at " + AddressToHexString(address));
+    return env.Null();
+  }
+  return Napi::Number::New(env, bytesRead);
+}
+
+// readBatch(ranges) - reads (address, size) pairs in one call; failed
+// ranges are reported in `status` instead of throwing
+Napi::Value ProcessSession::ReadBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1) {
+    Napi::TypeError::New(env, "readBatch requires 1 argument: ranges").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return env.Null();
+  }
+  return ReadBatchToObject(env, *process, info[0]);
+}
+
+// write(address, buffer) - writes every byte of a Buffer, TypedArray or
+// ArrayBuffer or throws
+Napi::Value ProcessSession::Write(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  uint8_t* data = nullptr;
+  size_t size = 0;
+  if (info.Length() < 2 || !ToAddress(info[0], address) || !GetTargetBytes(info[1], data, size)) {
+    Napi::TypeError::New(env, "write requires 2 arguments: address, buffer").ThrowAsJavaScriptException();
+    return Napi::Boolean::New(env, false);
+  }
+  if (!(access_ & kAccessWrite)) {
+    Napi::Error::New(env, "Session was attached without write access").ThrowAsJavaScriptException();
+    return Napi::Boolean::New(env, false);
+  }
+
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return Napi::Boolean::New(env, false);
+  }
+
+  if (cache_.Write(*process, address, data, size) != size) {
+    ThrowTransferError(env, "Failed to write " + std::to_string(size) + " bytes at " + AddressToHexString(address));
+    return Napi::Boolean::New(env, false);
+  }
+  return Napi::Boolean::New(env, true);
+}
+
+// scan(value, { regions }) - aligned uint32 scan over the cached region
+// map, narrowed by the optional region filter; returns the hit addresses
+// as a Float64Array
+Napi::Value ProcessSession::Scan(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "scan requires 1 argument: value").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  RegionFilter filter;
+  std::string error;
+  if (!ParseScanRegions(info, 1, filter, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return env.Null();
+  }
+
+  std::shared_ptr<const std::vector<MemoryRegion>> regions = ScanRegions(filter);
+  if (!regions) {
+    ThrowTransferError(env, "Failed to enumerate memory regions");
+    return env.Null();
+  }
+
+  std::vector<uint64_t> matches;
+  FaultRecorder recorder(process);
+  ScanForUint32(recorder, *regions, info[0].As<Napi::Number>().Uint32Value(), matches);
+  ScanFinished(recorder);
+
+  return AddressesToJs(env, matches);
+}
+
+// scanAsync(value, { onProgress, token, regions, store }) - runs the scan
+// on a worker thread and returns a Promise. Starting a scan cancels the
+// previous one. With store the Promise resolves with { handle, count } and
+// the matches are paged with resultPage().
+Napi::Value ProcessSession::ScanAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "scanAsync requires 1 argument: value").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  RegionFilter filter;
+  std::string error;
+  if (!ParseScanRegions(info, 1, filter, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!RequireHandle(env)) {
+    return env.Null();
+  }
+
+  uint32_t valueToFind = info[0].As<Napi::Number>().Uint32Value();
+  ScanFunction scan = [valueToFind](ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                                    std::vector<uint64_t>& matches, const std::atomic<bool>* cancelled,
+                                    const ScanProgressCallback& onProgress) {
+    return ScanForUint32(process, regions, valueToFind, matches, cancelled, onProgress);
+  };
+  bool store = info.Length() > 1 && info[1].IsObject() && GetBoolean(info[1].As<Napi::Object>(), "store", false);
+
+  Napi::Value onProgress = env.Undefined();
+  std::shared_ptr<std::atomic<bool>> cancelled = BeginScan(info, 1, onProgress);
+  ScanWorker* worker = new ScanWorker(env, Value(), scan, filter, cancelled, onProgress, store);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+// scanPattern(pattern, { aligned, byteSwap, n64, regions, onProgress,
+// token, store }) - finds an array-of-bytes pattern such as "DE AD ?? EF".
+// aligned restricts matches to 4-byte boundaries; byteSwap matches
+// word-swapped (big-endian emulated) memory; n64 scans only RDRAM and
+// reports N64 addresses, ignoring the region filter. Resolves with the
+// match addresses as a Float64Array, or { handle, count } with store.
+Napi::Value ProcessSession::ScanPattern(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "scanPattern requires 1 argument: pattern").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  BytePattern pattern;
+  std::string error;
+  if (!ParseBytePattern(info[0].As<Napi::String>().Utf8Value(), pattern, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  bool n64 = false;
+  bool store = false;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+    pattern.alignment = GetBoolean(options, "aligned", false) ? 4 : 1;
+    pattern.wordSwapped = GetBoolean(options, "byteSwap", false);
+    n64 = GetBoolean(options, "n64", false);
+    store = GetBoolean(options, "store", false);
+    // RDRAM is big-endian; matches come back in N64 byte order already
+    pattern.wordSwapped = pattern.wordSwapped || n64;
+  }
+  RegionFilter filter;
+  if (!ParseScanRegions(info, 1, filter, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!RequireHandle(env)) {
+    return env.Null();
+  }
+
+  ScanFunction scan = [pattern](ProcessHandle& process, const std::vector<MemoryRegion>& regions,
+                                std::vector<uint64_t>& matches, const std::atomic<bool>* cancelled,
+                                const ScanProgressCallback& onProgress) {
+    return ScanForPattern(process, regions, pattern, matches, cancelled, onProgress);
+  };
+  if (n64) {
+    RdramLocation rdram;
+    if (!RequireRdram(env, rdram)) {
+      return env.Null();
+    }
+    scan = ScopeToRdram(scan, rdram);
+  }
+
+  Napi::Value onProgress = env.Undefined();
+  std::shared_ptr<std::atomic<bool>> cancelled = BeginScan(info, 1, onProgress);
+  ScanWorker* worker = new ScanWorker(env, Value(), scan, filter, cancelled, onProgress, store);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+std::shared_ptr<std::atomic<bool>> ProcessSession::BeginScan(const Napi::CallbackInfo& info, size_t optionsIndex,
+                                                             Napi::Value& onProgress) {
+  std::shared_ptr<std::atomic<bool>> cancelled;
+  if (info.Length() > optionsIndex && info[optionsIndex].IsObject()) {
+    Napi::Object options = info[optionsIndex].As<Napi::Object>();
+    onProgress = options.Get("onProgress");
+    cancelled = CancellationToken::FlagFrom(options.Get("token"));
+  }
+  if (!cancelled) {
+    cancelled = std::make_shared<std::atomic<bool>>(false);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (activeScan_) {
+    activeScan_->store(true);
+  }
+  activeScan_ = cancelled;
+  return cancelled;
+}
+
+Napi::Value ProcessSession::QueueCandidateScan(const Napi::CallbackInfo& info, bool refine) {
+  Napi::Env env = info.Env();
+  const char* name = refine ? "nextScan" : "firstScan";
+  if (info.Length() < 1) {
+    Napi::TypeError::New(env, std::string(name) + " requires 1 argument: criteria").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // A refinement keeps the layout its first scan was made with
+  ValueLayout layout;
+  std::string error;
+  if (refine) {
+    std::shared_ptr<CandidateSet> candidates = Candidates();
+    if (!candidates) {
+      Napi::Error::New(env, "Run a first scan before refining").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    layout = candidates->Layout();
+  } else if (!ParseLayout(info[0], layout, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  // { n64: true } restricts a first scan to RDRAM. Words there are already
+  // in host order and halfwords and bytes map with an address swizzle, but
+  // a 64-bit value has its two words swapped, so those are not supported.
+  RdramLocation space;
+  if (!refine && info[0].IsObject() && GetBoolean(info[0].As<Napi::Object>(), "n64", false)) {
+    if (ValueTypeSize(layout.type) > 4 || layout.unaligned || layout.byteSwap) {
+      Napi::TypeError::New(env, "N64 scans take aligned 8, 16 or 32-bit values without byteSwap")
+        .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+    if (!RequireRdram(env, space)) {
+      return env.Null();
+    }
+  }
+
+  ScanCriteria criteria;
+  if (!ParseCriteria(info[0], layout, criteria, error)) {
+    Napi::TypeError::New(env, error.empty() ? "Invalid scan value" : error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  // Refinements revisit the candidates wherever they are
+  RegionFilter filter;
+  if (!refine && !ParseScanRegions(info, 0, filter, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!RequireHandle(env)) {
+    return env.Null();
+  }
+
+  Napi::Value onProgress = env.Undefined();
+  std::shared_ptr<std::atomic<bool>> cancelled = BeginScan(info, 1, onProgress);
+  CandidateScanWorker* worker = new CandidateScanWorker(env, Value(), layout, criteria, refine, space, filter,
+                                                        cancelled, onProgress);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+// firstScan(criteria, { onProgress, token }) - starts a narrowing scan.
+// criteria is a value or { mode: 'equal'|'notEqual'|'range'|'unknown',
+// value, min, max, epsilon, type, aligned, byteSwap, n64, regions }; type
+// is one of int8..int64, uint8..uint64, float32, float64 (default uint32).
+// regions is a filter as for regions(). With n64 only RDRAM is scanned and
+// candidates are N64 addresses. An unknown scan copies every byte it
+// covers and is refused above 256 MB, so pair it with n64 or a filter.
+// Resolves with { count, memoryBytes }.
+Napi::Value ProcessSession::FirstScan(const Napi::CallbackInfo& info) {
+  return QueueCandidateScan(info, false);
+}
+
+// nextScan(criteria, { onProgress, token }) - keeps the candidates that
+// match; modes also include 'changed', 'unchanged', 'increased',
+// 'decreased', 'increasedBy' and 'decreasedBy'
+Napi::Value ProcessSession::NextScan(const Napi::CallbackInfo& info) {
+  return QueueCandidateScan(info, true);
+}
+
+// candidates(offset, count) - a page of { addresses, values } in address
+// order: a Float64Array and a parallel typed array of the scanned type
+// holding the values read by the last pass
+Napi::Value ProcessSession::GetCandidates(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber()) {
+    Napi::TypeError::New(env, "candidates requires 2 arguments: offset, count").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::unique_lock<std::mutex> busy(scanMutex_, std::try_to_lock);
+  if (!busy.owns_lock()) {
+    Napi::Error::New(env, "A scan is in progress").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<uint64_t> addresses;
+  std::vector<uint8_t> values;
+  std::shared_ptr<CandidateSet> candidates = Candidates();
+  if (candidates) {
+    candidates->Get(static_cast<uint64_t>(info[0].As<Napi::Number>().Int64Value()),
+                    info[1].As<Napi::Number>().Uint32Value(), addresses, values);
+    RdramLocation space = CandidateSpace();
+    if (space.size > 0) {
+      for (uint64_t& address : addresses) {
+        address = RdramVirtualAddress(space, address, candidates->ValueSize());
+      }
+    }
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("addresses", AddressesToJs(env, addresses));
+  result.Set("values", ValuesToJs(env, values, addresses.size(),
+                                  candidates ? candidates->Layout() : ValueLayout()));
+  return result;
+}
+
+// candidateStats() - { type, count, memoryBytes, denseRegions, sparseRegions }
+Napi::Value ProcessSession::CandidateStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::unique_lock<std::mutex> busy(scanMutex_, std::try_to_lock);
+  if (!busy.owns_lock()) {
+    Napi::Error::New(env, "A scan is in progress").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<CandidateSet> candidates = Candidates();
+  Napi::Object result = Napi::Object::New(env);
+  if (candidates) {
+    result.Set("type", Napi::String::New(env, ValueTypeName(candidates->Layout().type)));
+  }
+  result.Set("count", Napi::Number::New(env, candidates ? candidates->Count() : 0));
+  result.Set("memoryBytes", Napi::Number::New(env, candidates ? candidates->MemoryUsage() : 0));
+  result.Set("denseRegions", Napi::Number::New(env, candidates ? candidates->DenseRegionCount() : 0));
+  result.Set("sparseRegions", Napi::Number::New(env, candidates ? candidates->SparseRegionCount() : 0));
+  return result;
+}
+
+// resetScan() - cancels any running pass and drops the candidates. A pass
+// still finishing works on the old set and is discarded.
+Napi::Value ProcessSession::ResetScan(const Napi::CallbackInfo& info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (activeScan_) {
+    activeScan_->store(true);
+    activeScan_.reset();
+  }
+  candidates_.reset();
+  candidateSpace_ = RdramLocation();
+  return info.Env().Undefined();
+}
+
+// cancelScan() - cancels the running asynchronous scan, if any
+Napi::Value ProcessSession::CancelScan(const Napi::CallbackInfo& info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (activeScan_) {
+    activeScan_->store(true);
+    activeScan_.reset();
+  }
+  return info.Env().Undefined();
+}
+
+// freeze(address, bytes, { intervalMs, onChange }) - keeps rewriting
+// `bytes` at `address` from a native thread, every 1/60 s by default. With
+// onChange the value is read back each interval and only written when the
+// target changed it. Returns an id for unfreeze().
+Napi::Value ProcessSession::Freeze(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  uint8_t* data = nullptr;
+  size_t length = 0;
+  if (info.Length() < 2 || !ToAddress(info[0], address) || !GetTargetBytes(info[1], data, length) || length == 0) {
+    Napi::TypeError::New(env, "freeze requires 2 arguments: address, bytes").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!(access_ & kAccessWrite)) {
+    Napi::Error::New(env, "Session was attached without write access").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  FreezeOptions options;
+  if (info.Length() > 2 && info[2].IsObject()) {
+    Napi::Object object = info[2].As<Napi::Object>();
+    Napi::Value interval = object.Get("intervalMs");
+    if (interval.IsNumber()) {
+      double intervalMs = interval.As<Napi::Number>().DoubleValue();
+      if (!(intervalMs >= 1)) {
+        Napi::RangeError::New(env, "intervalMs must be at least 1").ThrowAsJavaScriptException();
+        return env.Null();
+      }
+      options.interval = std::chrono::microseconds(static_cast<int64_t>(intervalMs * 1000));
+    }
+    options.onChange = GetBoolean(object, "onChange", false);
+  }
+
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return env.Null();
+  }
+  if (!freezer_) {
+    freezer_.reset(new FreezeEngine(process));
+  }
+  uint32_t id = freezer_->Add(address, std::vector<uint8_t>(data, data + length), options);
+  return Napi::Number::New(env, id);
+}
+
+// unfreeze(id) - false if the entry was already gone
+Napi::Value ProcessSession::Unfreeze(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "unfreeze requires 1 argument: id").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  bool removed = freezer_ && freezer_->Remove(info[0].As<Napi::Number>().Uint32Value());
+  return Napi::Boolean::New(env, removed);
+}
+
+Napi::Value ProcessSession::UnfreezeAll(const Napi::CallbackInfo& info) {
+  if (freezer_) {
+    freezer_->Clear();
+  }
+  return info.Env().Undefined();
+}
+
+// freezeStats() - { entries, writes, bytes, batches, skipped, missed,
+// failed, maxLatenessMs, writesPerSecond, exited }
+Napi::Value ProcessSession::FreezeStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ::FreezeStats stats;
+  if (freezer_) {
+    stats = freezer_->Stats();
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("entries", Napi::Number::New(env, stats.entries));
+  result.Set("writes", Napi::Number::New(env, stats.writes));
+  result.Set("bytes", Napi::Number::New(env, stats.bytes));
+  result.Set("batches", Napi::Number::New(env, stats.batches));
+  result.Set("skipped", Napi::Number::New(env, stats.skipped));
+  result.Set("missed", Napi::Number::New(env, stats.missed));
+  result.Set("failed", Napi::Number::New(env, stats.failed));
+  result.Set("maxLatenessMs", Napi::Number::New(env, stats.maxLateness.count() / 1000.0));
+  result.Set("writesPerSecond", Napi::Number::New(env, stats.writesPerSecond));
+  result.Set("exited", Napi::Boolean::New(env, stats.exited));
+  return result;
+}
+
+void ProcessSession::StopWatchThread() {
+  if (watcher_) {
+    watcher_->Stop();
+  }
+  if (hasWatchCallback_) {
+    watchCallback_.Release();
+    hasWatchCallback_ = false;
+  }
+}
+
+// addWatch(address, type, { threshold, byteSwap }) - samples the value every
+// tick; threshold is the smallest move worth reporting. Returns an id.
+Napi::Value ProcessSession::AddWatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  WatchOptions options;
+  if (info.Length() < 2 || !ToAddress(info[0], address) || !info[1].IsString() ||
+      !ParseValueType(info[1].As<Napi::String>().Utf8Value(), options.type)) {
+    Napi::TypeError::New(env, "addWatch requires 2 arguments: address, type").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (info.Length() > 2 && info[2].IsObject()) {
+    Napi::Object object = info[2].As<Napi::Object>();
+    Napi::Value threshold = object.Get("threshold");
+    if (threshold.IsNumber()) {
+      options.threshold = threshold.As<Napi::Number>().DoubleValue();
+    }
+    options.byteSwap = GetBoolean(object, "byteSwap", false);
+  }
+
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return env.Null();
+  }
+  if (!watcher_) {
+    watcher_ = std::make_shared<WatchEngine>(process);
+  }
+  return Napi::Number::New(env, watcher_->Add(address, options));
+}
+
+// removeWatch(id) - false if the watch was already gone
+Napi::Value ProcessSession::RemoveWatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "removeWatch requires 1 argument: id").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  bool removed = watcher_ && watcher_->Remove(info[0].As<Napi::Number>().Uint32Value());
+  return Napi::Boolean::New(env, removed);
+}
+
+// startWatching(callback, { intervalMs }) - samples every watch once per
+// tick (60 Hz by default) and calls callback([{ id, value }]) with the
+// newest value of each watch that changed. Changes made while JS is busy
+// are merged into the next call rather than queued. Calling it again
+// replaces the callback and interval; with a new callback every watch
+// reports its current value first.
+Napi::Value ProcessSession::StartWatching(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::chrono::microseconds interval;
+  if (info.Length() < 1 || !info[0].IsFunction()) {
+    Napi::TypeError::New(env, "startWatching requires 1 argument: callback").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!ParseWatchInterval(info.Length() > 1 ? info[1] : env.Undefined(), interval)) {
+    Napi::RangeError::New(env, "intervalMs must be at least 1").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return env.Null();
+  }
+  if (!watcher_) {
+    watcher_ = std::make_shared<WatchEngine>(process);
+  }
+  StopWatchThread();
+
+  Napi::ThreadSafeFunction callback = Napi::ThreadSafeFunction::New(
+    env, info[0].As<Napi::Function>(), "sf_native watch", 0, 1);
+  watchCallback_ = callback;
+  hasWatchCallback_ = true;
+
+  // Queued calls outlive stopWatching(); the weak pointer lets them bail
+  // out once the engine is gone
+  std::weak_ptr<WatchEngine> weak = watcher_;
+  watcher_->Start([callback, weak]() {
+    callback.NonBlockingCall([weak](Napi::Env env, Napi::Function jsCallback) {
+      std::shared_ptr<WatchEngine> engine = weak.lock();
+      if (!engine) {
+        return;
+      }
+      std::vector<WatchChange> changes;
+      engine->TakeChanges(changes);
+      if (changes.empty()) {
+        return;
+      }
+      Napi::Array result = Napi::Array::New(env, changes.size());
+      for (size_t i = 0; i < changes.size(); i++) {
+        Napi::Object entry = Napi::Object::New(env);
+        entry.Set("id", Napi::Number::New(env, changes[i].id));
+        entry.Set("value", WatchValueToJs(env, changes[i]));
+        result[i] = entry;
+      }
+      jsCallback.Call({ result });
+    });
+  }, interval);
+  return env.Undefined();
+}
+
+Napi::Value ProcessSession::StopWatching(const Napi::CallbackInfo& info) {
+  StopWatchThread();
+  return info.Env().Undefined();
+}
+
+// watchStats() - { watches, ticks, changes, deliveries, coalesced,
+// missedTicks, lastReadMs, running }
+Napi::Value ProcessSession::WatchStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ::WatchStats stats;
+  bool running = false;
+  if (watcher_) {
+    stats = watcher_->Stats();
+    running = watcher_->Running();
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("watches", Napi::Number::New(env, stats.watches));
+  result.Set("ticks", Napi::Number::New(env, stats.ticks));
+  result.Set("changes", Napi::Number::New(env, stats.changes));
+  result.Set("deliveries", Napi::Number::New(env, stats.deliveries));
+  result.Set("coalesced", Napi::Number::New(env, stats.coalesced));
+  result.Set("missedTicks", Napi::Number::New(env, stats.missedTicks));
+  result.Set("lastReadMs", Napi::Number::New(env, stats.lastRead.count() / 1000.0));
+  result.Set("running", Napi::Boolean::New(env, running));
+  return result;
+}
+
+// regions(filter) - the cached region map as plain objects { base, size,
+// protection, type, module, path }, optionally narrowed by a filter
+// { writable, private, module, start, end, minSize, maxSize }. Regions
+// straddling start or end are clipped to them.
+Napi::Value ProcessSession::GetRegions(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  RegionFilter filter;
+  std::string error;
+  if (!ParseRegionFilter(info.Length() > 0 ? info[0] : env.Undefined(), filter, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!RequireHandle(env)) {
+    return env.Null();
+  }
+
+  std::shared_ptr<const std::vector<MemoryRegion>> regions = Regions();
+  if (!regions) {
+    ThrowTransferError(env, "Failed to enumerate memory regions");
+    return env.Null();
+  }
+  std::vector<MemoryRegion> filtered = FilterRegions(*regions, filter);
+
+  Napi::Array result = Napi::Array::New(env, filtered.size());
+  for (size_t i = 0; i < filtered.size(); i++) {
+    result[i] = RegionToJs(env, filtered[i]);
+  }
+  return result;
+}
+
+// refreshRegions(start, end) - re-enumerates the regions overlapping
+// [start, end), or the whole address space, and updates the cached map in
+// place. Returns { count, added, removed, changed, generation }.
+Napi::Value ProcessSession::RefreshRegions(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t start = 0;
+  uint64_t end = UINT64_MAX;
+  if ((info.Length() > 0 && !info[0].IsUndefined() && !ToAddress(info[0], start)) ||
+      (info.Length() > 1 && !info[1].IsUndefined() && !ToAddress(info[1], end)) || start >= end) {
+    Napi::TypeError::New(env, "refreshRegions takes an optional start and end address").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return env.Null();
+  }
+
+  RegionDelta delta;
+  if (!regionMap_.Refresh(*process, start, end, &delta)) {
+    ThrowTransferError(env, "Failed to enumerate memory regions");
+    return env.Null();
+  }
+  std::shared_ptr<const std::vector<MemoryRegion>> regions = regionMap_.Get(*process);
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("count", Napi::Number::New(env, regions ? regions->size() : 0));
+  result.Set("added", Napi::Number::New(env, delta.added));
+  result.Set("removed", Napi::Number::New(env, delta.removed));
+  result.Set("changed", Napi::Number::New(env, delta.changed));
+  result.Set("generation", Napi::Number::New(env, static_cast<double>(regionMap_.Generation())));
+  return result;
+}
+
+// locateRdram(refresh = false) - { base, size } of the emulated N64 RDRAM,
+// or null when the target holds none (no game running yet). The result is
+// cached; refresh searches again.
+Napi::Value ProcessSession::LocateRdram(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  bool refresh = info.Length() > 0 && info[0].IsBoolean() && info[0].As<Napi::Boolean>().Value();
+  if (!RequireHandle(env)) {
+    return env.Null();
+  }
+
+  RdramLocation rdram;
+  if (!Rdram(rdram, refresh)) {
+    return env.Null();
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("base", Napi::Number::New(env, static_cast<double>(rdram.base)));
+  result.Set("size", Napi::Number::New(env, rdram.size));
+  return result;
+}
+
+// readN64(address, size, { cached }) - reads at an N64 address such as
+// 0x80123456 and returns the bytes in N64 (big-endian) order, ready for a
+// DataView with littleEndian = false
+Napi::Value ProcessSession::ReadN64(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  if (info.Length() < 2 || !ToAddress(info[0], address) || !info[1].IsNumber()) {
+    Napi::TypeError::New(env, "readN64 requires 2 arguments: address, size").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!CheckN64Address(env, address)) {
+    return env.Null();
+  }
+
+  RdramLocation rdram;
+  std::shared_ptr<ProcessHandle> process = RequireRdram(env, rdram);
+  if (!process) {
+    return env.Null();
+  }
+  size_t size = info[1].As<Napi::Number>().Uint32Value();
+  uint32_t offset;
+  if (!RdramOffset(rdram, static_cast<uint32_t>(address), size, offset)) {
+    Napi::RangeError::New(env, AddressToHexString(address) + " is outside RDRAM").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  CachedProcess cached(*process, cache_);
+  ProcessHandle& source = info.Length() > 2 && IsCachedRead(info[2]) ? cached : *process;
+  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, size);
+  size_t bytesRead = ReadRdram(source, rdram, static_cast<uint32_t>(address), buffer.Data(), size);
+  // The emulator reallocates RDRAM when it restarts; look again once
+  if (bytesRead != size && Rdram(rdram, true)) {
+    bytesRead = ReadRdram(source, rdram, static_cast<uint32_t>(address), buffer.Data(), size);
+  }
+  if (bytesRead != size) {
+    ThrowTransferError(env, "Failed to read " + std::to_string(size) + " bytes at N64 address " +
+                            AddressToHexString(address));
+    return env.Null();
+  }
+  return buffer;
+}
+
+// writeN64(address, bytes) - writes big-endian bytes at an N64 address,
+// handling the emulator's word swapping. Writes everything or throws.
+Napi::Value ProcessSession::WriteN64(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  uint8_t* data = nullptr;
+  size_t size = 0;
+  if (info.Length() < 2 || !ToAddress(info[0], address) || !GetTargetBytes(info[1], data, size)) {
+    Napi::TypeError::New(env, "writeN64 requires 2 arguments: address, bytes").ThrowAsJavaScriptException();
+    return Napi::Boolean::New(env, false);
+  }
+  if (!CheckN64Address(env, address)) {
+    return Napi::Boolean::New(env, false);
+  }
+  if (!(access_ & kAccessWrite)) {
+    Napi::Error::New(env, "Session was attached without write access").ThrowAsJavaScriptException();
+    return Napi::Boolean::New(env, false);
+  }
+
+  RdramLocation rdram;
+  std::shared_ptr<ProcessHandle> process = RequireRdram(env, rdram);
+  if (!process) {
+    return Napi::Boolean::New(env, false);
+  }
+  uint32_t offset;
+  if (!RdramOffset(rdram, static_cast<uint32_t>(address), size, offset)) {
+    Napi::RangeError::New(env, AddressToHexString(address) + " is outside RDRAM").ThrowAsJavaScriptException();
+    return Napi::Boolean::New(env, false);
+  }
+
+  CachedProcess cached(*process, cache_);
+  size_t bytesWritten = WriteRdram(cached, rdram, static_cast<uint32_t>(address), data, size);
+  if (bytesWritten != size && Rdram(rdram, true)) {
+    bytesWritten = WriteRdram(cached, rdram, static_cast<uint32_t>(address), data, size);
+  }
+  if (bytesWritten != size) {
+    ThrowTransferError(env, "Failed to write " + std::to_string(size) + " bytes at N64 address " +
+                            AddressToHexString(address));
+    return Napi::Boolean::New(env, false);
+  }
+  return Napi::Boolean::New(env, true);
+}
+
+// n64ToHost(address, size = 4) - the host address holding the 1, 2 or 4
+// byte value at an N64 address, in host byte order. Lets freeze() and
+// addWatch() target emulated values directly.
+Napi::Value ProcessSession::N64ToHost(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  if (info.Length() < 1 || !ToAddress(info[0], address)) {
+    Napi::TypeError::New(env, "n64ToHost requires 1 argument: address").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!CheckN64Address(env, address)) {
+    return env.Null();
+  }
+  size_t size = info.Length() > 1 && info[1].IsNumber() ? info[1].As<Napi::Number>().Uint32Value() : 4;
+  if ((size != 1 && size != 2 && size != 4) || address % size != 0) {
+    Napi::RangeError::New(env, "size must be 1, 2 or 4 and the address aligned to it").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  RdramLocation rdram;
+  if (!RequireRdram(env, rdram)) {
+    return env.Null();
+  }
+  uint32_t offset;
+  if (!RdramOffset(rdram, static_cast<uint32_t>(address), size, offset)) {
+    Napi::RangeError::New(env, AddressToHexString(address) + " is outside RDRAM").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Number::New(env, static_cast<double>(RdramHostAddress(rdram, offset, size)));
+}
+
+// pointerScan(target, { maxDepth = 4, maxOffset = 0x1000, maxResults,
+// maxNodes, pointerSize, memoryLimitMB = 512, regions, onProgress, token })
+// - finds pointer chains from module images to `target` on a worker thread.
+// Resolves with { chains: [{ module, baseOffset, offsets }], pointers,
+// truncated }. Shares cancellation with the other scans.
+Napi::Value ProcessSession::PointerScan(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t target = 0;
+  if (info.Length() < 1 || !ToAddress(info[0], target)) {
+    Napi::TypeError::New(env, "pointerScan requires 1 argument: target").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  PointerScanOptions options;
+  RegionFilter filter;
+  std::string error;
+  if (!ParsePointerScanOptions(info.Length() > 1 ? info[1] : env.Undefined(), options, error) ||
+      !ParseScanRegions(info, 1, filter, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!RequireHandle(env)) {
+    return env.Null();
+  }
+
+  Napi::Value onProgress = env.Undefined();
+  std::shared_ptr<std::atomic<bool>> cancelled = BeginScan(info, 1, onProgress);
+  PointerScanWorker* worker = new PointerScanWorker(env, Value(), target, options, filter, cancelled, onProgress);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+// resolvePointers(chains, { pointerSize }) - follows chains from
+// pointerScan in the current process. Returns a Float64Array of the
+// addresses they lead to, 0 for chains that are broken right now.
+Napi::Value ProcessSession::ResolvePointers(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsArray()) {
+    Napi::TypeError::New(env, "resolvePointers requires 1 argument: chains").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  PointerScanOptions options;
+  std::string error;
+  if (!ParsePointerScanOptions(info.Length() > 1 ? info[1] : env.Undefined(), options, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::Array array = info[0].As<Napi::Array>();
+  std::vector<PointerChain> chains(array.Length());
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    if (!ParsePointerChain(array.Get(i), chains[i])) {
+      Napi::TypeError::New(env, "Each chain needs a module, baseOffset and offsets").ThrowAsJavaScriptException();
+      return env.Null();
+    }
+  }
+
+  std::shared_ptr<ProcessHandle> process = RequireHandle(env);
+  if (!process) {
+    return env.Null();
+  }
+  std::shared_ptr<const std::vector<MemoryRegion>> regions = Regions();
+  if (!regions) {
+    ThrowTransferError(env, "Failed to enumerate memory regions");
+    return env.Null();
+  }
+
+  std::vector<uint64_t> resolved;
+  ResolvePointerChains(*process, *regions, options.pointerSize, chains, resolved);
+  return AddressesToJs(env, resolved);
+}
+
+// snapshot(path, { regions, n64, compress = true, dedup = true, onProgress,
+// token }) - writes the regions passing the filter, or only RDRAM with n64,
+// to a snapshot file on a worker thread. Resolves with { path, regions,
+// pages, bytes, zeroPages, duplicatePages, compressedPages, missingPages,
+// fileSize }.
+Napi::Value ProcessSession::TakeSnapshot(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "snapshot requires 1 argument: path").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  SnapshotOptions options;
+  bool n64 = false;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object object = info[1].As<Napi::Object>();
+    options.compress = GetBoolean(object, "compress", true);
+    options.dedup = GetBoolean(object, "dedup", true);
+    n64 = GetBoolean(object, "n64", false);
+  }
+  RegionFilter filter;
+  std::string error;
+  if (!ParseScanRegions(info, 1, filter, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  RdramLocation rdram;
+  if (n64 ? !RequireRdram(env, rdram) : !RequireHandle(env)) {
+    return env.Null();
+  }
+
+  Napi::Value onProgress = env.Undefined();
+  std::shared_ptr<std::atomic<bool>> cancelled = BeginScan(info, 1, onProgress);
+  SnapshotWorker* worker = new SnapshotWorker(env, Value(), info[0].As<Napi::String>().Utf8Value(), options, filter,
+                                              rdram, cancelled, onProgress);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+// diff(path, { granularity = 1, maxChanges = 100000, onProgress, token }) -
+// compares the snapshot at `path` (before) with this session (after):
+// another snapshot for sessions from openSnapshot(), else live memory.
+// Resolves with the changed runs as parallel Float64Arrays { addresses,
+// sizes } plus { pagesCompared, pagesSkipped, pagesChanged, bytesChanged,
+// pagesUnreadable, truncated, n64 }. Stored pages that fail to decode
+// count as unreadable instead of compared.
+Napi::Value ProcessSession::DiffSnapshot(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    Napi::TypeError::New(env, "diff requires 1 argument: path").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  SnapshotDiffOptions options;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object object = info[1].As<Napi::Object>();
+    Napi::Value granularity = object.Get("granularity");
+    Napi::Value maxChanges = object.Get("maxChanges");
+    if (granularity.IsNumber()) {
+      options.granularity = granularity.As<Napi::Number>().Uint32Value();
+    }
+    if (maxChanges.IsNumber()) {
+      options.maxChanges = static_cast<size_t>(std::max<int64_t>(maxChanges.As<Napi::Number>().Int64Value(), 1));
+    }
+  }
+  if (options.granularity != 1 && options.granularity != 2 && options.granularity != 4 &&
+      options.granularity != 8) {
+    Napi::RangeError::New(env, "granularity must be 1, 2, 4 or 8").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (!RequireHandle(env)) {
+    return env.Null();
+  }
+
+  Napi::Value onProgress = env.Undefined();
+  std::shared_ptr<std::atomic<bool>> cancelled = BeginScan(info, 1, onProgress);
+  SnapshotDiffWorker* worker = new SnapshotDiffWorker(env, Value(), info[0].As<Napi::String>().Utf8Value(), options,
+                                                      cancelled, onProgress);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+// snapshotInfo() - { path, pid, created, regions, pages, fileSize, n64 }
+// for sessions opened from a snapshot, else null
+Napi::Value ProcessSession::SnapshotInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::shared_ptr<SnapshotFile> snapshot = Snapshot();
+  if (!snapshot) {
+    return env.Null();
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("path", Napi::String::New(env, snapshot->Path()));
+  result.Set("pid", Napi::Number::New(env, snapshot->Pid()));
+  result.Set("created", Napi::Number::New(env, static_cast<double>(snapshot->Created())));
+  result.Set("regions", Napi::Number::New(env, static_cast<double>(snapshot->Regions().size())));
+  result.Set("pages", Napi::Number::New(env, static_cast<double>(snapshot->PageCount())));
+  result.Set("fileSize", Napi::Number::New(env, static_cast<double>(snapshot->FileSize())));
+  result.Set("n64", Napi::Boolean::New(env, snapshot->RdramBase() != 0));
+  return result;
+}
+
+// readStruct(layout, address, { n64, cached }) - one instance of a
+// defineStruct() layout, read in one transfer. Pointer fields are followed
+// with one batched read per field and level. With n64, addresses (pointers
+// included) are N64 addresses. Throws when the instance cannot be read.
+Napi::Value ProcessSession::ReadStruct(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  std::shared_ptr<const StructPlan> plan = info.Length() > 0 ? StructLayout::PlanOf(info[0]) : nullptr;
+  if (!plan || info.Length() < 2 || !ToAddress(info[1], address)) {
+    Napi::TypeError::New(env, "readStruct requires 2 arguments: layout, address").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  RdramLocation rdram;
+  StructTarget target;
+  Napi::Value options = info.Length() > 2 ? info[2] : env.Undefined();
+  std::shared_ptr<ProcessHandle> process = RequireStructTarget(env, options, address, rdram, target);
+  if (!process) {
+    return env.Null();
+  }
+  CachedProcess cached(*process, cache_);
+  if (IsCachedRead(options)) {
+    target.process = &cached;
+  }
+  StructTree tree;
+  size_t read = ::ReadStructs(target, *plan, address, 1, plan->Size(), tree.buffer);
+  // The emulator reallocates RDRAM when it restarts; look again once
+  if (read == 0 && target.rdram && Rdram(rdram, true)) {
+    read = ::ReadStructs(target, *plan, address, 1, plan->Size(), tree.buffer);
+  }
+  if (read == 0) {
+    ThrowTransferError(env, "Failed to read " + std::to_string(plan->Size()) + " byte struct at " +
+                            AddressToHexString(address));
+    return env.Null();
+  }
+  ReadStructTargets(target, *plan, tree);
+  return StructToJs(env, *plan, tree, 0);
+}
+
+// readStructs(layout, address, count, { stride, n64, cached, columns }) -
+// `count` instances `stride` bytes apart (the layout's size by default) in
+// one transfer. Returns an array of objects, null for instances that could
+// not be read, or with columns a { count, valid, fields } object of typed
+// arrays; columns do not follow pointers.
+Napi::Value ProcessSession::ReadStructs(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  std::shared_ptr<const StructPlan> plan = info.Length() > 0 ? StructLayout::PlanOf(info[0]) : nullptr;
+  if (!plan || info.Length() < 3 || !ToAddress(info[1], address) || !info[2].IsNumber()) {
+    Napi::TypeError::New(env, "readStructs requires 3 arguments: layout, address, count")
+      .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  size_t count = info[2].As<Napi::Number>().Uint32Value();
+  size_t stride = plan->Size();
+  bool columns = false;
+  Napi::Value options = info.Length() > 3 ? info[3] : env.Undefined();
+  if (options.IsObject()) {
+    Napi::Value value = options.As<Napi::Object>().Get("stride");
+    if (value.IsNumber()) {
+      stride = value.As<Napi::Number>().Uint32Value();
+    }
+    columns = GetBoolean(options.As<Napi::Object>(), "columns", false);
+  }
+  // One transfer covers every instance, so keep it to a sane size
+  if (stride == 0 || count * static_cast<uint64_t>(stride) > (static_cast<uint64_t>(256) << 20)) {
+    Napi::RangeError::New(env, "stride must be at least 1 and count * stride at most 256 MB")
+      .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  RdramLocation rdram;
+  StructTarget target;
+  std::shared_ptr<ProcessHandle> process = RequireStructTarget(env, options, address, rdram, target);
+  if (!process) {
+    return env.Null();
+  }
+  CachedProcess cached(*process, cache_);
+  if (IsCachedRead(options)) {
+    target.process = &cached;
+  }
+  StructTree tree;
+  if (::ReadStructs(target, *plan, address, count, stride, tree.buffer) == 0 && count > 0 && target.rdram &&
+      Rdram(rdram, true)) {
+    ::ReadStructs(target, *plan, address, count, stride, tree.buffer);
+  }
+  if (columns) {
+    return StructColumnsToJs(env, *plan, tree.buffer);
+  }
+  ReadStructTargets(target, *plan, tree);
+  Napi::Array result = Napi::Array::New(env, count);
+  for (size_t i = 0; i < count; i++) {
+    result[i] = StructToJs(env, *plan, tree, i);
+  }
+  return result;
+}
+
+// writeStruct(layout, address, values, { n64 }) - writes the fields present
+// in `values` (arrays as arrays or typed arrays, pointers as numbers) and
+// leaves the rest of the struct alone. Neighbouring fields go out as one
+// range, and host writes as a single transfer. Writes everything or
+// throws.
+Napi::Value ProcessSession::WriteStruct(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  std::shared_ptr<const StructPlan> plan = info.Length() > 0 ? StructLayout::PlanOf(info[0]) : nullptr;
+  if (!plan || info.Length() < 3 || !ToAddress(info[1], address) || !info[2].IsObject()) {
+    Napi::TypeError::New(env, "writeStruct requires 3 arguments: layout, address, values")
+      .ThrowAsJavaScriptException();
+    return Napi::Boolean::New(env, false);
+  }
+  if (!(access_ & kAccessWrite)) {
+    Napi::Error::New(env, "Session was attached without write access").ThrowAsJavaScriptException();
+    return Napi::Boolean::New(env, false);
+  }
+
+  std::vector<uint8_t> image;
+  std::vector<std::pair<uint32_t, uint32_t>> spans;
+  std::string error;
+  if (!StructFromJs(info[2].As<Napi::Object>(), *plan, image, spans, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return Napi::Boolean::New(env, false);
+  }
+
+  RdramLocation rdram;
+  StructTarget target;
+  std::shared_ptr<ProcessHandle> process =
+    RequireStructTarget(env, info.Length() > 3 ? info[3] : env.Undefined(), address, rdram, target);
+  if (!process) {
+    return Napi::Boolean::New(env, false);
+  }
+  CachedProcess cached(*process, cache_);
+  target.process = &cached;
+  bool written = WriteStructSpans(target, address, image.data(), spans);
+  if (!written && target.rdram && Rdram(rdram, true)) {
+    written = WriteStructSpans(target, address, image.data(), spans);
+  }
+  if (!written) {
+    ThrowTransferError(env, "Failed to write struct at " + AddressToHexString(address));
+    return Napi::Boolean::New(env, false);
+  }
+  return Napi::Boolean::New(env, true);
+}
+
+// cacheStats() - { pages, hits, misses, prefetched, evictions,
+// invalidations, fetches } of the page cache behind cached reads; hits
+// and misses count pages
+Napi::Value ProcessSession::CacheStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  PageCacheStats stats = cache_.Stats();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("pages", Napi::Number::New(env, stats.pages));
+  result.Set("hits", Napi::Number::New(env, stats.hits));
+  result.Set("misses", Napi::Number::New(env, stats.misses));
+  result.Set("prefetched", Napi::Number::New(env, stats.prefetched));
+  result.Set("evictions", Napi::Number::New(env, stats.evictions));
+  result.Set("invalidations", Napi::Number::New(env, stats.invalidations));
+  result.Set("fetches", Napi::Number::New(env, stats.fetches));
+  return result;
+}
+
+// configureCache({ capacity, ttlMs, prefetch }) - capacity is in 4 KB
+// pages (0 turns caching off), a ttlMs of 0 keeps pages until they are
+// evicted, and prefetch is the number of pages fetched ahead of
+// sequential reads. Omitted settings keep their value.
+Napi::Value ProcessSession::ConfigureCache(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "configureCache requires 1 argument: options").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  Napi::Object options = info[0].As<Napi::Object>();
+  PageCacheOptions settings = cache_.Options();
+  Napi::Value value = options.Get("capacity");
+  if (value.IsNumber()) {
+    settings.capacity = value.As<Napi::Number>().Uint32Value();
+  }
+  value = options.Get("ttlMs");
+  if (value.IsNumber()) {
+    settings.ttl = std::chrono::milliseconds(value.As<Napi::Number>().Uint32Value());
+  }
+  value = options.Get("prefetch");
+  if (value.IsNumber()) {
+    settings.prefetch = value.As<Napi::Number>().Uint32Value();
+  }
+  cache_.Configure(settings);
+  return env.Undefined();
+}
+
+// invalidateCache(address, size) - drops the cached pages over a range,
+// or every page without arguments. Needed only after the target was
+// written around the session.
+Napi::Value ProcessSession::InvalidateCache(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t address = 0;
+  if (info.Length() == 0) {
+    cache_.Clear();
+    return env.Undefined();
+  }
+  if (info.Length() < 2 || !ToAddress(info[0], address) || !info[1].IsNumber()) {
+    Napi::TypeError::New(env, "invalidateCache requires 2 arguments: address, size").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  cache_.Invalidate(address, static_cast<uint64_t>(info[1].As<Napi::Number>().DoubleValue()));
+  return env.Undefined();
+}
+
+// storeCandidates() - { handle, count } over the narrowing scan's
+// candidates, or null before the first pass. The stored results follow the
+// candidates, so later passes narrow them too.
+Napi::Value ProcessSession::StoreCandidates(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::unique_lock<std::mutex> busy(scanMutex_, std::try_to_lock);
+  if (!busy.owns_lock()) {
+    Napi::Error::New(env, "A scan is in progress").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::shared_ptr<CandidateSet> candidates = Candidates();
+  if (!candidates) {
+    return env.Null();
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("handle", Napi::Number::New(env, StoreResults(MakeCandidateResults(candidates, CandidateSpace()))));
+  result.Set("count", Napi::Number::New(env, candidates->Count()));
+  return result;
+}
+
+bool ProcessSession::PageResults(const Napi::CallbackInfo& info, size_t queryIndex, uint64_t offset, size_t count,
+                                 std::vector<uint64_t>& addresses, std::vector<uint8_t>& values, uint64_t& total,
+                                 ValueLayout& layout, bool& hasValues) {
+  Napi::Env env = info.Env();
+  std::shared_ptr<ScanResults> results = results_.Get(info[0].As<Napi::Number>().Uint32Value());
+  if (!results) {
+    Napi::Error::New(env, "Unknown or released result handle").ThrowAsJavaScriptException();
+    return false;
+  }
+
+  ResultQuery query;
+  std::string error;
+  if (!ParseResultQuery(info.Length() > queryIndex ? info[queryIndex] : env.Undefined(), *results, query, error)) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return false;
+  }
+
+  // Candidate-backed results change under a running pass
+  std::unique_lock<std::mutex> busy(scanMutex_, std::defer_lock);
+  if (results->IsLive() && !busy.try_lock()) {
+    Napi::Error::New(env, "A scan is in progress").ThrowAsJavaScriptException();
+    return false;
+  }
+  if (!results->Page(query, offset, count, addresses, values, total, error)) {
+    Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    return false;
+  }
+  layout = results->Layout();
+  hasValues = results->HasValues();
+  return true;
+}
+
+// resultPage(handle, offset, count, { start, end, min, max, sort,
+// descending }) - rows [offset, offset + count) of stored results as
+// { total, addresses, values, type }. The query keeps matches in the
+// address window [start, end) whose value lies in [min, max], ordered by
+// address or, with sort: 'value', by value. total counts every row the
+// query selects. values is a typed array of the scanned type, or null for
+// one-shot scans, which record no values and cannot be filtered or sorted
+// by them.
+Napi::Value ProcessSession::ResultPage(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber()) {
+    Napi::TypeError::New(env, "resultPage requires 3 arguments: handle, offset, count").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<uint64_t> addresses;
+  std::vector<uint8_t> values;
+  uint64_t total = 0;
+  ValueLayout layout;
+  bool hasValues = false;
+  if (!PageResults(info, 3, static_cast<uint64_t>(info[1].As<Napi::Number>().Int64Value()),
+                   info[2].As<Napi::Number>().Uint32Value(), addresses, values, total, layout, hasValues)) {
+    return env.Null();
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("total", Napi::Number::New(env, total));
+  result.Set("addresses", AddressesToJs(env, addresses));
+  if (hasValues) {
+    result.Set("values", ValuesToJs(env, values, addresses.size(), layout));
+    result.Set("type", Napi::String::New(env, ValueTypeName(layout.type)));
+  } else {
+    result.Set("values", env.Null());
+  }
+  return result;
+}
+
+// resultCount(handle, query) - the rows a resultPage() query selects
+Napi::Value ProcessSession::ResultCount(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsNumber()) {
+    Napi::TypeError::New(env, "resultCount requires 1 argument: handle").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<uint64_t> addresses;
+  std::vector<uint8_t> values;
+  uint64_t total = 0;
+  ValueLayout layout;
+  bool hasValues = false;
+  if (!PageResults(info, 1, 0, 0, addresses, values, total, layout, hasValues)) {
+    return env.Null();
+  }
+  return Napi::Number::New(env, total);
+}
+
+// releaseResults(handle) - frees stored results; false if the handle was
+// unknown. Without arguments every stored result is released.
+Napi::Value ProcessSession::ReleaseResults(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() == 0) {
+    results_.Clear();
+    return env.Undefined();
+  }
+  if (!info[0].IsNumber()) {
+    Napi::TypeError::New(env, "releaseResults requires a numeric handle").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  return Napi::Boolean::New(env, results_.Release(info[0].As<Napi::Number>().Uint32Value()));
+}
+
+Napi::Object RegisterSessionFunctions(Napi::Env env, Napi::Object exports) {
+  exports = ProcessSession::Init(env, exports);
+  exports.Set("attach", Napi::Function::New(env, ProcessSession::Attach));
+  exports.Set("openSnapshot", Napi::Function::New(env, ProcessSession::OpenSnapshot));
+  return exports;
+}
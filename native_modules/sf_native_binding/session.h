@@ -0,0 +1,191 @@
+#pragma once
+#include <napi.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "candidate_set.h"
+#include "freeze_engine.h"
+#include "watch_engine.h"
+#include "page_cache.h"
+#include "platform.h"
+#include "rdram.h"
+#include "region_map.h"
+#include "scan_results.h"
+#include "snapshot.h"
+#include "struct_plan.h"
+
+// A persistent attachment to one process, created with attach(pid). The
+// process handle and the region map live as long as the session, so a small
+// read costs a single syscall instead of an open/read/close round trip and
+// a scan does not re-walk the address space. openSnapshot(path) creates a
+// read-only session over a snapshot file instead, on which every read and
+// scan sees the memory as it was captured. Reads made with { cached: true }
+// are served from a per-session page cache, which every write through the
+// session keeps up to date. Scans run with { store: true } keep their
+// matches in the session and hand out a handle that views page through.
+class ProcessSession : public Napi::ObjectWrap<ProcessSession> {
+ public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  static Napi::Value Attach(const Napi::CallbackInfo& info);
+  static Napi::Value OpenSnapshot(const Napi::CallbackInfo& info);
+
+  explicit ProcessSession(const Napi::CallbackInfo& info);
+  ~ProcessSession();
+
+  // Null once detached
+  std::shared_ptr<ProcessHandle> Handle();
+
+  // The snapshot file a session opened with openSnapshot() reads from;
+  // null for live processes
+  std::shared_ptr<SnapshotFile> Snapshot();
+
+  // Cached region map, enumerated on first use
+  std::shared_ptr<const std::vector<MemoryRegion>> Regions();
+
+  // The regions a scan with `filter` visits. Scans reuse the cached map and
+  // repair it where their reads fail (see ScanFinished); it is walked
+  // whole again only once older than kScanMapMaxAge, to pick up regions
+  // allocated since. refreshRegions() picks them up sooner.
+  std::shared_ptr<const std::vector<MemoryRegion>> ScanRegions(const RegionFilter& filter);
+  static constexpr std::chrono::milliseconds kScanMapMaxAge{30000};
+
+  // The session's handle for a scan over ScanRegions() to read through,
+  // recording its failed reads; null once detached
+  std::shared_ptr<FaultRecorder> ScanHandle();
+  // Re-enumerates the parts of the region map where `process` saw reads
+  // fail, dropping regions freed or reprotected since the map was taken
+  void ScanFinished(FaultRecorder& process);
+
+  // Candidates of the narrowing scan, null before the first pass
+  std::shared_ptr<CandidateSet> Candidates();
+  // `space` is the RDRAM block a scan restricted to N64 memory ran over;
+  // its candidates are reported as N64 addresses
+  void SetCandidates(std::shared_ptr<CandidateSet> candidates, const RdramLocation& space = RdramLocation());
+  RdramLocation CandidateSpace();
+
+  // Cached location of the emulated N64 RDRAM, searched for on first use or
+  // when `refresh` is set. False if the target holds no RDRAM.
+  bool Rdram(RdramLocation& location, bool refresh = false);
+
+  // Held by whichever worker is running a narrowing pass
+  std::mutex& ScanMutex() { return scanMutex_; }
+
+  // Keeps `results` until released or the session detaches; returns the
+  // handle resultPage() takes
+  uint32_t StoreResults(std::shared_ptr<ScanResults> results) { return results_.Add(std::move(results)); }
+
+ private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value GetPid(const Napi::CallbackInfo& info);
+  Napi::Value IsAlive(const Napi::CallbackInfo& info);
+  Napi::Value Detach(const Napi::CallbackInfo& info);
+  Napi::Value Read(const Napi::CallbackInfo& info);
+  Napi::Value ReadInto(const Napi::CallbackInfo& info);
+  Napi::Value ReadBatch(const Napi::CallbackInfo& info);
+  Napi::Value Write(const Napi::CallbackInfo& info);
+  Napi::Value Scan(const Napi::CallbackInfo& info);
+  Napi::Value ScanAsync(const Napi::CallbackInfo& info);
+  Napi::Value ScanPattern(const Napi::CallbackInfo& info);
+  Napi::Value CancelScan(const Napi::CallbackInfo& info);
+  Napi::Value FirstScan(const Napi::CallbackInfo& info);
+  Napi::Value NextScan(const Napi::CallbackInfo& info);
+  Napi::Value GetCandidates(const Napi::CallbackInfo& info);
+  Napi::Value CandidateStats(const Napi::CallbackInfo& info);
+  Napi::Value ResetScan(const Napi::CallbackInfo& info);
+  Napi::Value Freeze(const Napi::CallbackInfo& info);
+  Napi::Value Unfreeze(const Napi::CallbackInfo& info);
+  Napi::Value UnfreezeAll(const Napi::CallbackInfo& info);
+  Napi::Value FreezeStats(const Napi::CallbackInfo& info);
+  Napi::Value AddWatch(const Napi::CallbackInfo& info);
+  Napi::Value RemoveWatch(const Napi::CallbackInfo& info);
+  Napi::Value StartWatching(const Napi::CallbackInfo& info);
+  Napi::Value StopWatching(const Napi::CallbackInfo& info);
+  Napi::Value WatchStats(const Napi::CallbackInfo& info);
+  Napi::Value GetRegions(const Napi::CallbackInfo& info);
+  Napi::Value RefreshRegions(const Napi::CallbackInfo& info);
+  Napi::Value LocateRdram(const Napi::CallbackInfo& info);
+  Napi::Value ReadN64(const Napi::CallbackInfo& info);
+  Napi::Value WriteN64(const Napi::CallbackInfo& info);
+  Napi::Value N64ToHost(const Napi::CallbackInfo& info);
+  Napi::Value PointerScan(const Napi::CallbackInfo& info);
+  Napi::Value ResolvePointers(const Napi::CallbackInfo& info);
+  Napi::Value TakeSnapshot(const Napi::CallbackInfo& info);
+  Napi::Value DiffSnapshot(const Napi::CallbackInfo& info);
+  Napi::Value SnapshotInfo(const Napi::CallbackInfo& info);
+  Napi::Value ReadStruct(const Napi::CallbackInfo& info);
+  Napi::Value ReadStructs(const Napi::CallbackInfo& info);
+  Napi::Value WriteStruct(const Napi::CallbackInfo& info);
+  Napi::Value CacheStats(const Napi::CallbackInfo& info);
+  Napi::Value ConfigureCache(const Napi::CallbackInfo& info);
+  Napi::Value InvalidateCache(const Napi::CallbackInfo& info);
+  Napi::Value StoreCandidates(const Napi::CallbackInfo& info);
+  Napi::Value ResultPage(const Napi::CallbackInfo& info);
+  Napi::Value ResultCount(const Napi::CallbackInfo& info);
+  Napi::Value ReleaseResults(const Napi::CallbackInfo& info);
+
+  // Throws and returns null when the session is detached or the target
+  // has exited
+  std::shared_ptr<ProcessHandle> RequireHandle(Napi::Env env);
+
+  // Throws after a failed transfer, reporting target exit distinctly
+  void ThrowTransferError(Napi::Env env, const std::string& message);
+
+  // Reads { onProgress, token } and makes the new scan the active one,
+  // cancelling the previous. Returns the new scan's cancellation flag.
+  std::shared_ptr<std::atomic<bool>> BeginScan(const Napi::CallbackInfo& info, size_t optionsIndex,
+                                               Napi::Value& onProgress);
+
+  // Like RequireHandle, and also throws when the target has no RDRAM
+  std::shared_ptr<ProcessHandle> RequireRdram(Napi::Env env, RdramLocation& location);
+
+  // Host memory, or RDRAM when `options` has n64 set and `address` is an
+  // N64 address; `rdram` must outlive `target`. Throws and returns null
+  // like RequireRdram.
+  std::shared_ptr<ProcessHandle> RequireStructTarget(Napi::Env env, const Napi::Value& options, uint64_t address,
+                                                     RdramLocation& rdram, StructTarget& target);
+
+  // Stops the watch thread and releases its JS callback
+  void StopWatchThread();
+
+  // Starts a first or refinement pass of the narrowing scan
+  Napi::Value QueueCandidateScan(const Napi::CallbackInfo& info, bool refine);
+
+  // Pages the results behind info[0] with the query at info[queryIndex].
+  // Throws and returns false for an unknown handle, a bad query, or live
+  // results while a narrowing pass runs.
+  bool PageResults(const Napi::CallbackInfo& info, size_t queryIndex, uint64_t offset, size_t count,
+                   std::vector<uint64_t>& addresses, std::vector<uint8_t>& values, uint64_t& total,
+                   ValueLayout& layout, bool& hasValues);
+
+  std::mutex mutex_;
+  std::shared_ptr<ProcessHandle> process_;
+  // Same object as process_ for sessions opened from a snapshot
+  std::shared_ptr<SnapshotFile> snapshot_;
+  RegionMap regionMap_;
+  // Cancellation flag of the most recent asynchronous scan
+  std::shared_ptr<std::atomic<bool>> activeScan_;
+  std::shared_ptr<CandidateSet> candidates_;
+  RdramLocation candidateSpace_;
+  RdramLocation rdram_;
+  // Stored scan results by handle
+  ResultStore results_;
+  // Pages of target memory for cached reads. Writes from the freeze and
+  // watch engines go around it and show up once the pages expire.
+  PageCache cache_;
+  // Started by the first freeze()
+  std::unique_ptr<FreezeEngine> freezer_;
+  // Created by the first addWatch(); ticks between startWatching() and
+  // stopWatching()
+  std::shared_ptr<WatchEngine> watcher_;
+  Napi::ThreadSafeFunction watchCallback_;
+  bool hasWatchCallback_ = false;
+  std::mutex scanMutex_;
+  uint32_t pid_ = 0;
+  uint32_t access_ = 0;
+};
+
+// Function to register the session class and attach()
+Napi::Object RegisterSessionFunctions(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,783 @@
+#include "snapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include "log.h"
+#include "thread_pool.h"
+
+namespace {
+
+const char kMagic[8] = { 'S', 'F', 'S', 'N', 'A', 'P', '\r', '\n' };
+const uint32_t kVersion = 1;
+
+// Page flags
+const uint32_t kPageZero = 1;
+const uint32_t kPageCompressed = 2;
+const uint32_t kPageMissing = 4;
+
+// Pages compared by one pool task in DiffSnapshots
+const uint64_t kPagesPerTask = 256;
+// Bytes compared at once before looking for the changed units
+const size_t kCompareBlock = 64;
+// Stored blocks kept in memory to confirm dedup hash matches; pages stored
+// once this is used up are not offered as duplicates
+const size_t kDedupMemory = static_cast<size_t>(64) << 20;
+
+const uint8_t kZeroPage[kSnapshotPageSize] = {};
+
+// Written last, so a file cut short never passes for a snapshot
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t pageSize;
+  uint32_t pid;
+  uint32_t pointerSize;
+  uint64_t created;
+  uint64_t rdramBase;
+  uint64_t regionCount;
+  uint64_t regionTableOffset;
+  uint64_t pageCount;
+  uint64_t pageTableOffset;
+  uint64_t stringTableOffset;
+  uint64_t stringTableSize;
+};
+
+struct RegionEntry {
+  uint64_t base;
+  uint64_t size;
+  uint64_t firstPage;
+  // Path within the string table
+  uint64_t pathOffset;
+  uint32_t pathSize;
+  uint32_t protection;
+  uint32_t type;
+  uint32_t reserved;
+};
+
+struct PageEntry {
+  // Of the page data within the file; shared by deduplicated pages
+  uint64_t offset;
+  uint64_t hash;
+  uint32_t storedSize;
+  uint32_t flags;
+};
+
+bool IsReadable(const MemoryRegion& region) {
+  return (region.protection & kProtRead) && !(region.protection & kProtGuard);
+}
+
+uint64_t PagesIn(uint64_t size) {
+  return (size + kSnapshotPageSize - 1) / kSnapshotPageSize;
+}
+
+inline uint64_t RotateLeft(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Load64(const uint8_t* data) {
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+bool IsZero(const uint8_t* data, size_t size) {
+  uint64_t bits = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    bits |= Load64(data + i);
+  }
+  for (; i < size; i++) {
+    bits |= data[i];
+  }
+  return bits == 0;
+}
+
+// Two independent multiply-rotate lanes, finished with the MurmurHash3
+// mixer. Identifies pages for dedup and diffing, never for security.
+uint64_t HashPage(const uint8_t* data, size_t size) {
+  const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+  const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+  uint64_t a = kPrime1 ^ size;
+  uint64_t b = kPrime2;
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    a = RotateLeft(a + Load64(data + i) * kPrime2, 31) * kPrime1;
+    b = RotateLeft(b + Load64(data + i + 8) * kPrime2, 31) * kPrime1;
+  }
+  for (; i < size; i++) {
+    a = RotateLeft(a ^ (data[i] * kPrime1), 11) * kPrime2;
+  }
+  uint64_t hash = a ^ RotateLeft(b, 27);
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// Run-length encoding: a control byte c below 128 is followed by c + 1
+// literal bytes, a higher one by a single byte repeated c - 125 times (3 to
+// 130). Game memory is mostly zero runs and repeated fill values, which
+// this catches at memcpy-like speed. Returns the encoded size, or 0 if it
+// would exceed `limit`.
+size_t EncodePage(const uint8_t* data, size_t size, uint8_t* out, size_t limit) {
+  size_t written = 0;
+  size_t literals = 0;
+  auto flushLiterals = [&](size_t end) {
+    while (literals < end) {
+      size_t count = std::min<size_t>(end - literals, 128);
+      if (written + 1 + count > limit) {
+        return false;
+      }
+      out[written++] = static_cast<uint8_t>(count - 1);
+      memcpy(out + written, data + literals, count);
+      written += count;
+      literals += count;
+    }
+    return true;
+  };
+
+  size_t i = 0;
+  while (i < size) {
+    size_t run = 1;
+    while (i + run < size && run < 130 && data[i + run] == data[i]) {
+      run++;
+    }
+    if (run < 3) {
+      i += run;
+      continue;
+    }
+    if (!flushLiterals(i) || written + 2 > limit) {
+      return 0;
+    }
+    out[written++] = static_cast<uint8_t>(run + 125);
+    out[written++] = data[i];
+    i += run;
+    literals = i;
+  }
+  return flushLiterals(size) ? written : 0;
+}
+
+bool DecodePage(const uint8_t* data, size_t size, uint8_t* out, size_t outSize) {
+  size_t read = 0;
+  size_t written = 0;
+  while (read < size) {
+    uint8_t control = data[read++];
+    if (control < 128) {
+      size_t count = control + 1;
+      if (count > size - read || count > outSize - written) {
+        return false;
+      }
+      memcpy(out + written, data + read, count);
+      read += count;
+      written += count;
+    } else {
+      size_t count = control - 125;
+      if (read == size || count > outSize - written) {
+        return false;
+      }
+      memset(out + written, data[read++], count);
+      written += count;
+    }
+  }
+  return written == outSize;
+}
+
+PageEntry LoadEntry(const uint8_t* table, uint64_t index) {
+  PageEntry entry;
+  memcpy(&entry, table + index * sizeof(PageEntry), sizeof(entry));
+  return entry;
+}
+
+// Appends a changed run, merging it into the previous one when adjacent
+void AddChange(std::vector<SnapshotChange>& changes, uint64_t address, uint64_t size) {
+  if (!changes.empty() && changes.back().address + changes.back().size == address) {
+    changes.back().size += size;
+    return;
+  }
+  SnapshotChange change;
+  change.address = address;
+  change.size = size;
+  changes.push_back(change);
+}
+
+// Compares one page's bytes and records the units that differ, keeping at
+// most `maxChanges` runs. Returns true if anything changed.
+bool ComparePage(uint64_t address, const uint8_t* before, const uint8_t* after, size_t size,
+                 const SnapshotDiffOptions& options, std::vector<SnapshotChange>& changes,
+                 SnapshotDiffStats& stats) {
+  bool changed = false;
+  size_t i = 0;
+  while (i < size) {
+    size_t block = std::min(kCompareBlock, size - i);
+    if (memcmp(before + i, after + i, block) == 0) {
+      i += block;
+      continue;
+    }
+    changed = true;
+    for (size_t end = i + block; i < end; i += options.granularity) {
+      size_t unit = std::min<size_t>(options.granularity, end - i);
+      if (memcmp(before + i, after + i, unit) == 0) {
+        continue;
+      }
+      stats.bytesChanged += unit;
+      bool adjacent = !changes.empty() && changes.back().address + changes.back().size == address + i;
+      if (changes.size() < options.maxChanges || adjacent) {
+        AddChange(changes, address + i, unit);
+      } else {
+        stats.truncated = true;
+      }
+    }
+  }
+  return changed;
+}
+
+void AddStats(SnapshotDiffStats& total, const SnapshotDiffStats& part) {
+  total.pagesCompared += part.pagesCompared;
+  total.pagesSkipped += part.pagesSkipped;
+  total.pagesChanged += part.pagesChanged;
+  total.bytesChanged += part.bytesChanged;
+  total.pagesUnreadable += part.pagesUnreadable;
+  total.truncated = total.truncated || part.truncated;
+}
+
+// Appends sorted `part` to `changes`, merging across the seam and
+// honouring maxChanges
+void MergeChanges(std::vector<SnapshotChange>& changes, const std::vector<SnapshotChange>& part,
+                  const SnapshotDiffOptions& options, SnapshotDiffStats& stats) {
+  for (const SnapshotChange& change : part) {
+    bool adjacent = !changes.empty() && changes.back().address + changes.back().size == change.address;
+    if (changes.size() >= options.maxChanges && !adjacent) {
+      stats.truncated = true;
+      return;
+    }
+    AddChange(changes, change.address, change.size);
+  }
+}
+
+}  // namespace
+
+bool WriteSnapshot(ProcessHandle& process, const std::vector<MemoryRegion>& regions, const std::string& path,
+                   const SnapshotOptions& options, SnapshotStats& stats, std::string& error,
+                   const std::atomic<bool>* cancelled, const ScanProgressCallback& onProgress) {
+  stats = SnapshotStats();
+
+  std::vector<MemoryRegion> readable;
+  std::vector<RegionEntry> regionEntries;
+  std::string strings;
+  uint64_t pageCount = 0;
+  for (const MemoryRegion& region : regions) {
+    if (!IsReadable(region) || region.size == 0) {
+      continue;
+    }
+    readable.push_back(region);
+    RegionEntry entry = {};
+    entry.base = region.base;
+    entry.size = region.size;
+    entry.firstPage = pageCount;
+    entry.pathOffset = strings.size();
+    entry.pathSize = static_cast<uint32_t>(region.path.size());
+    entry.protection = region.protection;
+    entry.type = static_cast<uint32_t>(region.type);
+    regionEntries.push_back(entry);
+    strings += region.path;
+    pageCount += PagesIn(region.size);
+    stats.bytes += region.size;
+  }
+  stats.regions = readable.size();
+  stats.pages = pageCount;
+
+  FILE* file = OpenFile(path, "w+b");
+  if (!file) {
+    error = "Failed to create " + path + ": " + GetLastErrorAsString();
+    return false;
+  }
+  std::vector<char> fileBuffer(1 << 20);
+  setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+  auto fail = [&](const std::string& message) {
+    fclose(file);
+    RemoveFile(path);
+    error = message;
+    return false;
+  };
+
+  FileHeader header = {};
+  if (fwrite(&header, sizeof(header), 1, file) != 1) {
+    return fail("Failed to write " + path);
+  }
+
+  // Everything below is guarded by `mutex`: workers encode pages on their
+  // own, then append a whole window at once
+  std::mutex mutex;
+  std::vector<PageEntry> pages(pageCount);
+  uint64_t dataEnd = sizeof(FileHeader);
+  bool writeFailed = false;
+
+  // The first page stored with each hash, and a copy of its stored block.
+  // The hash only nominates a duplicate; comparing against the copy keeps
+  // a collision from corrupting the snapshot without reading the file back
+  // through the write buffer.
+  struct StoredBlock {
+    uint64_t page;
+    size_t copy;
+  };
+  std::unordered_map<uint64_t, StoredBlock> firstWithHash;
+  std::vector<uint8_t> storedCopies;
+
+  struct Encoded {
+    uint64_t page;
+    PageEntry entry;
+    const uint8_t* data;
+  };
+  size_t workers = ThreadPool::Shared().Size();
+  std::vector<std::vector<uint8_t>> workerScratch(workers);
+  std::vector<std::vector<Encoded>> workerEncoded(workers);
+  std::atomic<uint64_t> pagesDone{0};
+
+  auto handler = [&](const StreamWindow& window) {
+    int worker = ThreadPool::CurrentWorker();
+    std::vector<uint8_t>& scratch = workerScratch[worker];
+    std::vector<Encoded>& encoded = workerEncoded[worker];
+    scratch.resize(window.size);
+    encoded.clear();
+
+    const RegionEntry& region = regionEntries[window.tag];
+    uint64_t firstPage = region.firstPage + (window.address - region.base) / kSnapshotPageSize;
+    size_t scratchUsed = 0;
+    for (size_t offset = 0; offset < window.size; offset += kSnapshotPageSize) {
+      size_t size = std::min<size_t>(kSnapshotPageSize, window.size - offset);
+      Encoded page = {};
+      page.page = firstPage + offset / kSnapshotPageSize;
+      const uint8_t* data = window.data + offset;
+      if (offset + size > window.available) {
+        page.entry.flags = kPageMissing;
+      } else if (IsZero(data, size)) {
+        page.entry.flags = kPageZero;
+      } else {
+        page.entry.hash = HashPage(data, size);
+        page.entry.storedSize = static_cast<uint32_t>(size);
+        page.data = data;
+        size_t compressed = options.compress
+          ? EncodePage(data, size, scratch.data() + scratchUsed, size - size / 8) : 0;
+        if (compressed > 0) {
+          page.entry.flags = kPageCompressed;
+          page.entry.storedSize = static_cast<uint32_t>(compressed);
+          page.data = scratch.data() + scratchUsed;
+          scratchUsed += compressed;
+        }
+      }
+      encoded.push_back(page);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Encoded& page : encoded) {
+      PageEntry& entry = page.entry;
+      if (entry.flags & kPageMissing) {
+        stats.missingPages++;
+      } else if (entry.flags & kPageZero) {
+        stats.zeroPages++;
+      } else {
+        auto existing = options.dedup ? firstWithHash.find(entry.hash) : firstWithHash.end();
+        const PageEntry* original = existing != firstWithHash.end() ? &pages[existing->second.page] : nullptr;
+        if (original && original->storedSize == entry.storedSize && original->flags == entry.flags &&
+            memcmp(storedCopies.data() + existing->second.copy, page.data, entry.storedSize) == 0) {
+          entry.offset = original->offset;
+          stats.duplicatePages++;
+        } else {
+          if (fwrite(page.data, 1, entry.storedSize, file) != entry.storedSize) {
+            writeFailed = true;
+          }
+          entry.offset = dataEnd;
+          dataEnd += entry.storedSize;
+          if (options.dedup && storedCopies.size() + entry.storedSize <= kDedupMemory &&
+              firstWithHash.emplace(entry.hash, StoredBlock{ page.page, storedCopies.size() }).second) {
+            storedCopies.insert(storedCopies.end(), page.data, page.data + entry.storedSize);
+          }
+        }
+        if (entry.flags & kPageCompressed) {
+          stats.compressedPages++;
+        }
+      }
+      pages[page.page] = entry;
+    }
+    pagesDone += encoded.size();
+  };
+
+  StreamOptions streamOptions;
+  if (!StreamReadableRegions(process, readable, streamOptions, handler, pagesDone, cancelled, onProgress)) {
+    return fail("");
+  }
+  if (writeFailed) {
+    return fail("Failed to write " + path + ": " + GetLastErrorAsString());
+  }
+
+  header.regionTableOffset = dataEnd;
+  header.stringTableOffset = header.regionTableOffset + regionEntries.size() * sizeof(RegionEntry);
+  header.stringTableSize = strings.size();
+  header.pageTableOffset = header.stringTableOffset + strings.size();
+  stats.fileSize = header.pageTableOffset + pages.size() * sizeof(PageEntry);
+  if (fwrite(regionEntries.data(), sizeof(RegionEntry), regionEntries.size(), file) != regionEntries.size() ||
+      fwrite(strings.data(), 1, strings.size(), file) != strings.size() ||
+      fwrite(pages.data(), sizeof(PageEntry), pages.size(), file) != pages.size()) {
+    return fail("Failed to write " + path + ": " + GetLastErrorAsString());
+  }
+
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.pageSize = kSnapshotPageSize;
+  header.pid = process.Pid();
+  header.pointerSize = process.PointerSize();
+  header.created = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count());
+  header.rdramBase = options.rdramBase;
+  header.regionCount = regionEntries.size();
+  header.pageCount = pageCount;
+  if (!SeekFile(file, 0) || fwrite(&header, sizeof(header), 1, file) != 1 || fflush(file) != 0) {
+    return fail("Failed to write " + path + ": " + GetLastErrorAsString());
+  }
+  if (fclose(file) != 0) {
+    RemoveFile(path);
+    error = "Failed to write " + path + ": " + GetLastErrorAsString();
+    return false;
+  }
+
+  SF_LOG(Info, "Wrote %s: %llu pages (%llu zero, %llu duplicate, %llu compressed), %llu bytes",
+         path.c_str(), static_cast<unsigned long long>(stats.pages),
+         static_cast<unsigned long long>(stats.zeroPages),
+         static_cast<unsigned long long>(stats.duplicatePages),
+         static_cast<unsigned long long>(stats.compressedPages),
+         static_cast<unsigned long long>(stats.fileSize));
+  return true;
+}
+
+std::unique_ptr<SnapshotFile> SnapshotFile::Open(const std::string& path, std::string& error) {
+  std::unique_ptr<MappedFile> file = MapFile(path);
+  if (!file) {
+    error = "Failed to open " + path + ": " + GetLastErrorAsString();
+    return nullptr;
+  }
+
+  FileHeader header;
+  uint64_t fileSize = file->Size();
+  if (fileSize < sizeof(header)) {
+    error = path + " is not a snapshot";
+    return nullptr;
+  }
+  memcpy(&header, file->Data(), sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+    error = path + " is not a snapshot";
+    return nullptr;
+  }
+  if (header.version != kVersion || header.pageSize != kSnapshotPageSize) {
+    error = path + " was written by an incompatible version";
+    return nullptr;
+  }
+
+  auto fits = [fileSize](uint64_t offset, uint64_t count, uint64_t size) {
+    return offset <= fileSize && count <= (fileSize - offset) / size;
+  };
+  if (!fits(header.regionTableOffset, header.regionCount, sizeof(RegionEntry)) ||
+      !fits(header.stringTableOffset, header.stringTableSize, 1) ||
+      !fits(header.pageTableOffset, header.pageCount, sizeof(PageEntry))) {
+    error = path + " is truncated";
+    return nullptr;
+  }
+
+  std::unique_ptr<SnapshotFile> snapshot(new SnapshotFile());
+  const uint8_t* data = file->Data();
+  const char* strings = reinterpret_cast<const char*>(data + header.stringTableOffset);
+  uint64_t pageCount = 0;
+  for (uint64_t i = 0; i < header.regionCount; i++) {
+    RegionEntry entry;
+    memcpy(&entry, data + header.regionTableOffset + i * sizeof(RegionEntry), sizeof(entry));
+    bool sorted = snapshot->regions_.empty() ||
+                  entry.base >= snapshot->regions_.back().base + snapshot->regions_.back().size;
+    if (!sorted || entry.size == 0 || entry.base + entry.size < entry.base || entry.firstPage != pageCount ||
+        entry.pathOffset > header.stringTableSize || entry.pathSize > header.stringTableSize - entry.pathOffset) {
+      error = path + " is corrupt";
+      return nullptr;
+    }
+    MemoryRegion region;
+    region.base = entry.base;
+    region.size = entry.size;
+    region.protection = entry.protection;
+    region.type = static_cast<RegionType>(entry.type);
+    region.path.assign(strings + entry.pathOffset, entry.pathSize);
+    snapshot->regions_.push_back(region);
+    snapshot->firstPages_.push_back(entry.firstPage);
+    pageCount += PagesIn(entry.size);
+  }
+  if (pageCount != header.pageCount) {
+    error = path + " is corrupt";
+    return nullptr;
+  }
+
+  snapshot->path_ = path;
+  snapshot->pid_ = header.pid;
+  snapshot->pointerSize_ = header.pointerSize == 4 ? 4 : 8;
+  snapshot->created_ = header.created;
+  snapshot->rdramBase_ = header.rdramBase;
+  snapshot->pageCount_ = header.pageCount;
+  snapshot->pageTable_ = data + header.pageTableOffset;
+  snapshot->file_ = std::move(file);
+  return snapshot;
+}
+
+bool SnapshotFile::EnumerateRegions(std::vector<MemoryRegion>& regions, uint64_t start, uint64_t end) {
+  regions.clear();
+  for (const MemoryRegion& region : regions_) {
+    if (region.base < end && region.base + region.size > start) {
+      regions.push_back(region);
+    }
+  }
+  return true;
+}
+
+size_t SnapshotFile::ReadMany(MemoryRange* ranges, size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    ranges[i].transferred = Copy(ranges[i].address, ranges[i].buffer, ranges[i].size);
+    ranges[i].error = 0;
+    total += ranges[i].transferred;
+  }
+  return total;
+}
+
+size_t SnapshotFile::RegionOfPage(uint64_t index) const {
+  return std::upper_bound(firstPages_.begin(), firstPages_.end(), index) - firstPages_.begin() - 1;
+}
+
+bool SnapshotFile::GetPage(uint64_t index, Page& page) const {
+  if (index >= pageCount_) {
+    return false;
+  }
+  const MemoryRegion& region = regions_[RegionOfPage(index)];
+  PageEntry entry = LoadEntry(pageTable_, index);
+  page.address = region.base + (index - firstPages_[RegionOfPage(index)]) * kSnapshotPageSize;
+  page.size = static_cast<uint32_t>(std::min<uint64_t>(kSnapshotPageSize, region.base + region.size - page.address));
+  page.hash = entry.hash;
+  page.zero = (entry.flags & kPageZero) != 0;
+  page.missing = (entry.flags & kPageMissing) != 0;
+  return true;
+}
+
+bool SnapshotFile::FindPage(uint64_t address, uint64_t& index) const {
+  auto next = std::upper_bound(regions_.begin(), regions_.end(), address,
+                               [](uint64_t value, const MemoryRegion& region) { return value < region.base; });
+  if (next == regions_.begin()) {
+    return false;
+  }
+  size_t r = next - regions_.begin() - 1;
+  if (address - regions_[r].base >= regions_[r].size) {
+    return false;
+  }
+  index = firstPages_[r] + (address - regions_[r].base) / kSnapshotPageSize;
+  return true;
+}
+
+const uint8_t* SnapshotFile::MappedPage(uint64_t index) const {
+  Page page;
+  if (!GetPage(index, page) || page.zero || page.missing) {
+    return nullptr;
+  }
+  PageEntry entry = LoadEntry(pageTable_, index);
+  if ((entry.flags & kPageCompressed) || entry.storedSize != page.size || entry.offset > file_->Size() ||
+      entry.storedSize > file_->Size() - entry.offset) {
+    return nullptr;
+  }
+  return file_->Data() + entry.offset;
+}
+
+bool SnapshotFile::ReadPage(uint64_t index, uint8_t* out) const {
+  Page page;
+  if (!GetPage(index, page) || page.missing) {
+    return false;
+  }
+  if (page.zero) {
+    memset(out, 0, page.size);
+    return true;
+  }
+  PageEntry entry = LoadEntry(pageTable_, index);
+  if (entry.offset > file_->Size() || entry.storedSize > file_->Size() - entry.offset) {
+    return false;
+  }
+  const uint8_t* stored = file_->Data() + entry.offset;
+  if (entry.flags & kPageCompressed) {
+    return DecodePage(stored, entry.storedSize, out, page.size);
+  }
+  if (entry.storedSize != page.size) {
+    return false;
+  }
+  memcpy(out, stored, page.size);
+  return true;
+}
+
+size_t SnapshotFile::Copy(uint64_t address, void* buffer, size_t size) const {
+  uint8_t* out = static_cast<uint8_t*>(buffer);
+  uint8_t scratch[kSnapshotPageSize];
+  size_t done = 0;
+  while (done < size) {
+    uint64_t index;
+    Page page;
+    if (!FindPage(address + done, index) || !GetPage(index, page)) {
+      break;
+    }
+    uint64_t offset = address + done - page.address;
+    size_t count = static_cast<size_t>(std::min<uint64_t>(page.size - offset, size - done));
+    const uint8_t* mapped = MappedPage(index);
+    if (mapped) {
+      memcpy(out + done, mapped + offset, count);
+    } else if (offset == 0 && count == page.size) {
+      if (!ReadPage(index, out + done)) {
+        break;
+      }
+    } else {
+      if (!ReadPage(index, scratch)) {
+        break;
+      }
+      memcpy(out + done, scratch + offset, count);
+    }
+    done += count;
+  }
+  return done;
+}
+
+bool DiffSnapshots(const SnapshotFile& before, const SnapshotFile& after, const SnapshotDiffOptions& options,
+                   std::vector<SnapshotChange>& changes, SnapshotDiffStats& stats,
+                   const std::atomic<bool>* cancelled) {
+  struct TaskResult {
+    std::vector<SnapshotChange> changes;
+    SnapshotDiffStats stats;
+  };
+  uint64_t pageCount = before.PageCount();
+  std::vector<TaskResult> results(static_cast<size_t>((pageCount + kPagesPerTask - 1) / kPagesPerTask));
+
+  {
+    TaskGroup group(ThreadPool::Shared());
+    for (size_t task = 0; task < results.size(); task++) {
+      group.Run([&, task]() {
+        TaskResult& result = results[task];
+        uint8_t beforeBuffer[kSnapshotPageSize];
+        uint8_t afterBuffer[kSnapshotPageSize];
+        uint64_t end = std::min(pageCount, (task + 1) * kPagesPerTask);
+        for (uint64_t index = task * kPagesPerTask; index < end; index++) {
+          if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+            return;
+          }
+          SnapshotFile::Page page;
+          uint64_t other;
+          SnapshotFile::Page otherPage;
+          if (!before.GetPage(index, page) || page.missing || !after.FindPage(page.address, other) ||
+              !after.GetPage(other, otherPage) || otherPage.missing) {
+            continue;
+          }
+
+          const uint8_t* afterData = nullptr;
+          size_t size = page.size;
+          if (otherPage.address == page.address && otherPage.size == page.size) {
+            // Same page in both: equal hashes settle it without the data
+            if ((page.zero && otherPage.zero) || (!page.zero && !otherPage.zero && page.hash == otherPage.hash)) {
+              result.stats.pagesCompared++;
+              result.stats.pagesSkipped++;
+              continue;
+            }
+            afterData = otherPage.zero ? kZeroPage : after.MappedPage(other);
+            if (!afterData && after.ReadPage(other, afterBuffer)) {
+              afterData = afterBuffer;
+            }
+          } else {
+            // Regions were clipped differently; compare what `after` holds
+            size = after.Copy(page.address, afterBuffer, page.size);
+            afterData = afterBuffer;
+          }
+          const uint8_t* beforeData = page.zero ? kZeroPage : before.MappedPage(index);
+          if (!beforeData && before.ReadPage(index, beforeBuffer)) {
+            beforeData = beforeBuffer;
+          }
+          if (!beforeData || !afterData) {
+            result.stats.pagesUnreadable++;
+            continue;
+          }
+          result.stats.pagesCompared++;
+          if (ComparePage(page.address, beforeData, afterData, size, options, result.changes, result.stats)) {
+            result.stats.pagesChanged++;
+          }
+        }
+      });
+    }
+  }
+  if (cancelled && cancelled->load()) {
+    return false;
+  }
+
+  for (const TaskResult& result : results) {
+    AddStats(stats, result.stats);
+    MergeChanges(changes, result.changes, options, stats);
+  }
+  return true;
+}
+
+bool DiffSnapshotWithProcess(const SnapshotFile& before, ProcessHandle& process, const SnapshotDiffOptions& options,
+                             std::vector<SnapshotChange>& changes, SnapshotDiffStats& stats,
+                             const std::atomic<bool>* cancelled, const ScanProgressCallback& onProgress) {
+  struct WorkerResult {
+    SnapshotDiffStats stats;
+    std::vector<uint8_t> page;
+  };
+  std::vector<WorkerResult> workers(ThreadPool::Shared().Size());
+  std::atomic<uint64_t> changesFound{0};
+  // Changes of each window by address; windows finish in no particular
+  // order, so they are capped only once merged in address order
+  std::map<uint64_t, std::vector<SnapshotChange>> windowChanges;
+  std::mutex windowChangesMutex;
+
+  auto handler = [&](const StreamWindow& window) {
+    WorkerResult& result = workers[ThreadPool::CurrentWorker()];
+    result.page.resize(kSnapshotPageSize);
+    std::vector<SnapshotChange> changed;
+    for (size_t offset = 0; offset < window.size && offset < window.available; offset += kSnapshotPageSize) {
+      uint64_t index;
+      SnapshotFile::Page page;
+      if (!before.FindPage(window.address + offset, index) || !before.GetPage(index, page) || page.missing) {
+        continue;
+      }
+      const uint8_t* beforeData = page.zero ? kZeroPage : before.MappedPage(index);
+      if (!beforeData) {
+        if (!before.ReadPage(index, result.page.data())) {
+          result.stats.pagesUnreadable++;
+          continue;
+        }
+        beforeData = result.page.data();
+      }
+      size_t size = std::min<size_t>(page.size, window.available - offset);
+      size_t found = changed.size();
+      result.stats.pagesCompared++;
+      if (ComparePage(page.address, beforeData, window.data + offset, size, options, changed, result.stats)) {
+        result.stats.pagesChanged++;
+      }
+      changesFound += changed.size() - found;
+    }
+    if (!changed.empty()) {
+      std::lock_guard<std::mutex> lock(windowChangesMutex);
+      windowChanges[window.address].swap(changed);
+    }
+  };
+
+  StreamOptions streamOptions;
+  if (!StreamReadableRegions(process, before.Regions(), streamOptions, handler, changesFound, cancelled,
+                             onProgress)) {
+    return false;
+  }
+
+  for (const WorkerResult& result : workers) {
+    AddStats(stats, result.stats);
+  }
+  for (const auto& window : windowChanges) {
+    MergeChanges(changes, window.second, options, stats);
+  }
+  return true;
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "platform.h"
+#include "scanner.h"
+
+// Snapshot files hold a copy of selected regions of a process: a header, a
+// region table and a page table, followed by the page data. Zero pages
+// take no data, pages identical to an earlier one are stored once and the
+// rest may be run-length encoded. Every page carries a hash so two
+// snapshots can be compared without touching unchanged pages.
+
+const uint32_t kSnapshotPageSize = 4096;
+
+struct SnapshotOptions {
+  // Run-length encode pages where that saves at least an eighth of a page
+  bool compress = true;
+  // Store pages identical to an earlier page once. Matches are confirmed
+  // against in-memory copies of the first 64 MB of distinct stored data.
+  bool dedup = true;
+  // Host address of RDRAM when the regions are the emulated N64 memory,
+  // so diffs can report N64 addresses
+  uint64_t rdramBase = 0;
+};
+
+struct SnapshotStats {
+  uint64_t regions = 0;
+  uint64_t pages = 0;
+  // Bytes of target memory covered
+  uint64_t bytes = 0;
+  uint64_t zeroPages = 0;
+  uint64_t duplicatePages = 0;
+  uint64_t compressedPages = 0;
+  // Pages that could not be read
+  uint64_t missingPages = 0;
+  uint64_t fileSize = 0;
+};
+
+// Streams the readable regions of `regions` into a snapshot at `path`,
+// replacing any file there. Same cancellation and progress contract as
+// ScanForUint32, with pages stored counted as matches. On failure or
+// cancellation the partial file is removed.
+bool WriteSnapshot(ProcessHandle& process, const std::vector<MemoryRegion>& regions, const std::string& path,
+                   const SnapshotOptions& options, SnapshotStats& stats, std::string& error,
+                   const std::atomic<bool>* cancelled = nullptr, const ScanProgressCallback& onProgress = nullptr);
+
+// A snapshot file mapped back into memory. It behaves as a read-only
+// process frozen at capture time, so every scan works on it unchanged;
+// writes move nothing. Pages are only faulted in when read, so snapshots
+// need not fit in memory.
+class SnapshotFile : public ProcessHandle {
+ public:
+  // Null with `error` set if the file is missing, truncated or not a
+  // snapshot
+  static std::unique_ptr<SnapshotFile> Open(const std::string& path, std::string& error);
+
+  uint32_t Pid() const override { return pid_; }
+  bool IsAlive() override { return true; }
+  uint32_t PointerSize() override { return pointerSize_; }
+  bool EnumerateRegions(std::vector<MemoryRegion>& regions, uint64_t start = 0, uint64_t end = UINT64_MAX) override;
+  // Stops at the first byte the snapshot does not hold
+  size_t Read(uint64_t address, void* buffer, size_t size) override { return Copy(address, buffer, size); }
+  size_t Write(uint64_t, const void*, size_t) override { return 0; }
+  size_t ReadMany(MemoryRange* ranges, size_t count) override;
+  size_t WriteMany(MemoryRange*, size_t) override { return 0; }
+
+  const std::string& Path() const { return path_; }
+  // Capture time, in milliseconds since the Unix epoch
+  uint64_t Created() const { return created_; }
+  uint64_t RdramBase() const { return rdramBase_; }
+  uint64_t FileSize() const { return file_->Size(); }
+  const std::vector<MemoryRegion>& Regions() const { return regions_; }
+  uint64_t PageCount() const { return pageCount_; }
+
+  // One page of the snapshot. Pages split regions from their base in
+  // kSnapshotPageSize steps; the last page of a region may be shorter.
+  struct Page {
+    uint64_t address = 0;
+    uint32_t size = 0;
+    uint64_t hash = 0;
+    bool zero = false;
+    bool missing = false;
+  };
+
+  bool GetPage(uint64_t index, Page& page) const;
+  // Index of the page holding `address`; false outside every region
+  bool FindPage(uint64_t address, uint64_t& index) const;
+  // Decodes a page into `out` (at least page.size bytes); false for
+  // missing or corrupt pages
+  bool ReadPage(uint64_t index, uint8_t* out) const;
+  // The page's bytes inside the mapping when it is stored as is, else
+  // null
+  const uint8_t* MappedPage(uint64_t index) const;
+  // Read() for const snapshots
+  size_t Copy(uint64_t address, void* buffer, size_t size) const;
+
+ private:
+  SnapshotFile() = default;
+
+  // Region holding page `index`
+  size_t RegionOfPage(uint64_t index) const;
+
+  std::string path_;
+  std::unique_ptr<MappedFile> file_;
+  uint32_t pid_ = 0;
+  uint32_t pointerSize_ = 8;
+  uint64_t created_ = 0;
+  uint64_t rdramBase_ = 0;
+  uint64_t pageCount_ = 0;
+  const uint8_t* pageTable_ = nullptr;
+  std::vector<MemoryRegion> regions_;
+  // First page of each region
+  std::vector<uint64_t> firstPages_;
+};
+
+// A run of changed bytes
+struct SnapshotChange {
+  uint64_t address = 0;
+  uint64_t size = 0;
+};
+
+struct SnapshotDiffOptions {
+  // Compare in aligned units of 1, 2, 4 or 8 bytes; a unit with any
+  // changed byte is reported whole
+  uint32_t granularity = 1;
+  // Changes reported before the diff stops collecting
+  size_t maxChanges = 100000;
+};
+
+struct SnapshotDiffStats {
+  uint64_t pagesCompared = 0;
+  // Compared by hash alone
+  uint64_t pagesSkipped = 0;
+  uint64_t pagesChanged = 0;
+  uint64_t bytesChanged = 0;
+  // Stored pages that failed to decode; not counted as compared
+  uint64_t pagesUnreadable = 0;
+  bool truncated = false;
+};
+
+// Compares two snapshots over the addresses both hold, appending the
+// changed runs in address order. Pages whose hashes match are not read.
+bool DiffSnapshots(const SnapshotFile& before, const SnapshotFile& after, const SnapshotDiffOptions& options,
+                   std::vector<SnapshotChange>& changes, SnapshotDiffStats& stats,
+                   const std::atomic<bool>* cancelled = nullptr);
+
+// Compares a snapshot with the live memory of `process` over the
+// snapshot's regions. Same cancellation and progress contract as
+// ScanForUint32, with changed runs counted as matches.
+bool DiffSnapshotWithProcess(const SnapshotFile& before, ProcessHandle& process, const SnapshotDiffOptions& options,
+                             std::vector<SnapshotChange>& changes, SnapshotDiffStats& stats,
+                             const std::atomic<bool>* cancelled = nullptr,
+                             const ScanProgressCallback& onProgress = nullptr);
@@ -0,0 +1,390 @@
+#include "struct_plan.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+#include "batch_read.h"
+
+namespace {
+
+inline uint8_t SwapBytes(uint8_t value) { return value; }
+
+inline uint16_t SwapBytes(uint16_t value) {
+#ifdef _MSC_VER
+  return _byteswap_ushort(value);
+#else
+  return __builtin_bswap16(value);
+#endif
+}
+
+inline uint32_t SwapBytes(uint32_t value) {
+#ifdef _MSC_VER
+  return _byteswap_ulong(value);
+#else
+  return __builtin_bswap32(value);
+#endif
+}
+
+inline uint64_t SwapBytes(uint64_t value) {
+#ifdef _MSC_VER
+  return _byteswap_uint64(value);
+#else
+  return __builtin_bswap64(value);
+#endif
+}
+
+template <size_t Size> struct UIntOfSize;
+template <> struct UIntOfSize<1> { typedef uint8_t type; };
+template <> struct UIntOfSize<2> { typedef uint16_t type; };
+template <> struct UIntOfSize<4> { typedef uint32_t type; };
+template <> struct UIntOfSize<8> { typedef uint64_t type; };
+
+// Values in the target's own bytes; packed host-order values are copied
+// as they are
+template <size_t Size, bool Swap>
+void DecodeBytes(const uint8_t* bytes, size_t position, size_t stride, size_t count, uint8_t* out) {
+  typedef typename UIntOfSize<Size>::type Bits;
+  const uint8_t* p = bytes + position;
+  if (!Swap && stride == Size) {
+    memcpy(out, p, count * Size);
+    return;
+  }
+  for (size_t i = 0; i < count; i++, p += stride, out += Size) {
+    Bits bits;
+    memcpy(&bits, p, Size);
+    if constexpr (Swap) {
+      bits = SwapBytes(bits);
+    }
+    memcpy(out, &bits, Size);
+  }
+}
+
+// Loads the big-endian value at N64 offset `position` from RDRAM words.
+// Aligned halfwords and words are stored in host order already; a
+// doubleword is two words, high first.
+template <size_t Size>
+inline typename UIntOfSize<Size>::type LoadRdramAligned(const uint8_t* bytes, size_t position) {
+  if constexpr (Size == 1) {
+    return bytes[position ^ 3];
+  } else if constexpr (Size == 2) {
+    uint16_t value;
+    memcpy(&value, bytes + (position ^ 2), 2);
+    return value;
+  } else if constexpr (Size == 4) {
+    uint32_t value;
+    memcpy(&value, bytes + position, 4);
+    return value;
+  } else {
+    uint32_t high, low;
+    memcpy(&high, bytes + position, 4);
+    memcpy(&low, bytes + position + 4, 4);
+    return (static_cast<uint64_t>(high) << 32) | low;
+  }
+}
+
+// Same for values straddling words, gathered a byte at a time
+template <size_t Size>
+inline typename UIntOfSize<Size>::type LoadRdramBytes(const uint8_t* bytes, size_t position) {
+  typename UIntOfSize<Size>::type value = 0;
+  for (size_t b = 0; b < Size; b++) {
+    value = static_cast<typename UIntOfSize<Size>::type>((value << 8) | bytes[(position + b) ^ 3]);
+  }
+  return value;
+}
+
+template <size_t Size, bool Aligned, bool LittleEndian>
+void DecodeRdram(const uint8_t* bytes, size_t position, size_t stride, size_t count, uint8_t* out) {
+  typedef typename UIntOfSize<Size>::type Bits;
+  for (size_t i = 0; i < count; i++, position += stride, out += Size) {
+    Bits bits = Aligned ? LoadRdramAligned<Size>(bytes, position) : LoadRdramBytes<Size>(bytes, position);
+    if constexpr (LittleEndian) {
+      bits = SwapBytes(bits);
+    }
+    memcpy(out, &bits, Size);
+  }
+}
+
+template <size_t Size, bool Swap>
+void StoreValue(uint64_t value, uint8_t* out) {
+  typedef typename UIntOfSize<Size>::type Bits;
+  Bits bits = static_cast<Bits>(value);
+  if constexpr (Swap) {
+    bits = SwapBytes(bits);
+  }
+  memcpy(out, &bits, Size);
+}
+
+size_t RoundUpToWord(size_t size) {
+  return (size + 3) & ~static_cast<size_t>(3);
+}
+
+}  // namespace
+
+template <size_t Size>
+StructPlan::Codec StructPlan::MakeCodec(bool bigEndian, bool wordAligned) {
+  Codec codec;
+  codec.decode = bigEndian ? DecodeBytes<Size, true> : DecodeBytes<Size, false>;
+  if (wordAligned) {
+    codec.decodeRdram = bigEndian ? DecodeRdram<Size, true, false> : DecodeRdram<Size, true, true>;
+  } else {
+    codec.decodeRdram = bigEndian ? DecodeRdram<Size, false, false> : DecodeRdram<Size, false, true>;
+  }
+  codec.store = bigEndian ? StoreValue<Size, true> : StoreValue<Size, false>;
+  return codec;
+}
+
+std::shared_ptr<const StructPlan> StructPlan::Compile(std::vector<Field> fields, uint32_t size, std::string& error) {
+  if (fields.empty()) {
+    error = "A struct needs at least one field";
+    return nullptr;
+  }
+
+  std::shared_ptr<StructPlan> plan(new StructPlan());
+  std::unordered_set<std::string> names;
+  uint64_t end = 0;
+  for (size_t i = 0; i < fields.size(); i++) {
+    const Field& field = fields[i];
+    if (field.name.empty()) {
+      error = "Struct field " + std::to_string(i) + " has no name";
+      return nullptr;
+    }
+    if (!names.insert(field.name).second) {
+      error = "Struct field " + field.name + " is defined twice";
+      return nullptr;
+    }
+    if (field.count == 0) {
+      error = "Array field " + field.name + " has no elements";
+      return nullptr;
+    }
+    if (field.target && field.type != ValueType::UInt32 && field.type != ValueType::UInt64) {
+      error = "Pointer field " + field.name + " must be 4 or 8 bytes";
+      return nullptr;
+    }
+    size_t valueSize = ValueTypeSize(field.type);
+    uint64_t fieldEnd = field.offset + static_cast<uint64_t>(valueSize) * field.count;
+    if (size != 0 && fieldEnd > size) {
+      error = "Struct field " + field.name + " ends past the struct's " + std::to_string(size) + " bytes";
+      return nullptr;
+    }
+    end = std::max(end, fieldEnd);
+
+    // RDRAM halfwords and words load natively when they do not straddle
+    // a word; doublewords need word alignment
+    bool wordAligned = field.offset % std::min<size_t>(valueSize, 4) == 0;
+    switch (valueSize) {
+      case 1: plan->codecs_.push_back(MakeCodec<1>(field.bigEndian, wordAligned)); break;
+      case 2: plan->codecs_.push_back(MakeCodec<2>(field.bigEndian, wordAligned)); break;
+      case 4: plan->codecs_.push_back(MakeCodec<4>(field.bigEndian, wordAligned)); break;
+      default: plan->codecs_.push_back(MakeCodec<8>(field.bigEndian, wordAligned)); break;
+    }
+    if (field.target) {
+      plan->pointers_.push_back(i);
+    }
+  }
+  if (end > UINT32_MAX) {
+    error = "Struct is larger than 4 GB";
+    return nullptr;
+  }
+
+  plan->size_ = size != 0 ? size : static_cast<uint32_t>(end);
+  plan->fields_ = std::move(fields);
+  return plan;
+}
+
+void StructPlan::Decode(size_t field, const StructBuffer& buffer, size_t first, size_t count, uint8_t* out) const {
+  const Field& f = fields_[field];
+  DecodeFn decode = buffer.rdramWords ? codecs_[field].decodeRdram : codecs_[field].decode;
+  size_t valueSize = ValueTypeSize(f.type);
+  if (f.count == 1) {
+    decode(buffer.bytes.data(), first * buffer.stride + f.offset, buffer.stride, count, out);
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    decode(buffer.bytes.data(), (first + i) * buffer.stride + f.offset, valueSize, f.count,
+           out + i * f.count * valueSize);
+  }
+}
+
+uint64_t StructPlan::Load(size_t field, const StructBuffer& buffer, size_t instance, uint32_t element) const {
+  const Field& f = fields_[field];
+  DecodeFn decode = buffer.rdramWords ? codecs_[field].decodeRdram : codecs_[field].decode;
+  size_t valueSize = ValueTypeSize(f.type);
+  uint64_t bits = 0;
+  decode(buffer.bytes.data(), instance * buffer.stride + f.offset + element * valueSize, valueSize, 1,
+         reinterpret_cast<uint8_t*>(&bits));
+  return bits;
+}
+
+void StructPlan::Store(size_t field, uint32_t element, uint64_t bits, uint8_t* image) const {
+  const Field& f = fields_[field];
+  codecs_[field].store(bits, image + f.offset + element * ValueTypeSize(f.type));
+}
+
+size_t ReadStructs(const StructTarget& target, const StructPlan& plan, uint64_t address, size_t count,
+                   size_t stride, StructBuffer& buffer) {
+  buffer.count = count;
+  buffer.stride = stride;
+  buffer.valid.assign(count, 0);
+  size_t span = count == 0 ? 0 : (count - 1) * stride + plan.Size();
+  size_t read = 0;
+  uint32_t offset;
+  if (!target.rdram) {
+    buffer.rdramWords = false;
+    buffer.bytes.assign(span, 0);
+    read = target.process->Read(address, buffer.bytes.data(), span);
+  } else if (address % 4 == 0 && stride % 4 == 0 && RdramOffset(*target.rdram, static_cast<uint32_t>(address),
+                                                                 RoundUpToWord(span), offset)) {
+    // Take the words as they are; the plan's RDRAM codecs read them
+    buffer.rdramWords = true;
+    buffer.bytes.assign(RoundUpToWord(span), 0);
+    read = target.process->Read(target.rdram->base + offset, buffer.bytes.data(), buffer.bytes.size());
+  } else {
+    buffer.rdramWords = false;
+    buffer.bytes.assign(span, 0);
+    read = ReadRdram(*target.process, *target.rdram, static_cast<uint32_t>(address), buffer.bytes.data(), span);
+  }
+
+  size_t complete = 0;
+  for (size_t i = 0; i < count && i * stride + plan.Size() <= read; i++) {
+    buffer.valid[i] = 1;
+    complete++;
+  }
+  return complete;
+}
+
+size_t ReadStructsAt(const StructTarget& target, const StructPlan& plan, const std::vector<uint64_t>& addresses,
+                     StructBuffer& buffer) {
+  size_t size = plan.Size();
+  buffer.count = addresses.size();
+  buffer.valid.assign(addresses.size(), 0);
+  buffer.rdramWords = target.rdram != nullptr;
+  for (uint64_t address : addresses) {
+    if (address % 4 != 0) {
+      buffer.rdramWords = false;
+    }
+  }
+  buffer.stride = buffer.rdramWords ? RoundUpToWord(size) : size;
+  buffer.bytes.assign(addresses.size() * buffer.stride, 0);
+
+  size_t complete = 0;
+  if (!target.rdram) {
+    std::vector<ReadRequest> requests;
+    std::vector<size_t> offsets;
+    std::vector<size_t> instances;
+    for (size_t i = 0; i < addresses.size(); i++) {
+      if (addresses[i] != 0) {
+        ReadRequest request;
+        request.address = addresses[i];
+        request.size = static_cast<uint32_t>(size);
+        requests.push_back(request);
+        offsets.push_back(i * buffer.stride);
+        instances.push_back(i);
+      }
+    }
+    std::vector<ReadStatus> status(requests.size());
+    ReadBatch(*target.process, requests.data(), requests.size(), offsets, buffer.bytes.data(), status.data());
+    for (size_t r = 0; r < requests.size(); r++) {
+      if (status[r].transferred == size) {
+        buffer.valid[instances[r]] = 1;
+        complete++;
+      }
+    }
+    return complete;
+  }
+
+  if (!buffer.rdramWords) {
+    for (size_t i = 0; i < addresses.size(); i++) {
+      if (addresses[i] != 0 &&
+          ReadRdram(*target.process, *target.rdram, static_cast<uint32_t>(addresses[i]),
+                    buffer.bytes.data() + i * buffer.stride, size) == size) {
+        buffer.valid[i] = 1;
+        complete++;
+      }
+    }
+    return complete;
+  }
+
+  std::vector<MemoryRange> ranges;
+  std::vector<size_t> instances;
+  for (size_t i = 0; i < addresses.size(); i++) {
+    uint32_t offset;
+    if (addresses[i] == 0 ||
+        !RdramOffset(*target.rdram, static_cast<uint32_t>(addresses[i]), buffer.stride, offset)) {
+      continue;
+    }
+    MemoryRange range;
+    range.address = target.rdram->base + offset;
+    range.buffer = buffer.bytes.data() + i * buffer.stride;
+    range.size = buffer.stride;
+    ranges.push_back(range);
+    instances.push_back(i);
+  }
+  target.process->ReadMany(ranges.data(), ranges.size());
+  for (size_t r = 0; r < ranges.size(); r++) {
+    if (ranges[r].transferred == ranges[r].size) {
+      buffer.valid[instances[r]] = 1;
+      complete++;
+    } else {
+      memset(ranges[r].buffer, 0, ranges[r].size);
+    }
+  }
+  return complete;
+}
+
+void ReadStructTargets(const StructTarget& target, const StructPlan& plan, StructTree& tree) {
+  const std::vector<size_t>& pointers = plan.Pointers();
+  tree.targets.resize(pointers.size());
+  for (size_t k = 0; k < pointers.size(); k++) {
+    const StructPlan::Field& field = plan.Fields()[pointers[k]];
+    std::vector<uint64_t> addresses(tree.buffer.count * field.count, 0);
+    for (size_t i = 0; i < tree.buffer.count; i++) {
+      if (!tree.buffer.valid[i]) {
+        continue;
+      }
+      for (uint32_t e = 0; e < field.count; e++) {
+        addresses[i * field.count + e] = plan.Load(pointers[k], tree.buffer, i, e);
+      }
+    }
+    StructTree& child = tree.targets[k];
+    if (ReadStructsAt(target, *field.target, addresses, child.buffer) > 0) {
+      ReadStructTargets(target, *field.target, child);
+    } else {
+      child.targets.resize(field.target->Pointers().size());
+    }
+  }
+}
+
+bool WriteStructSpans(const StructTarget& target, uint64_t address, const uint8_t* image,
+                      std::vector<std::pair<uint32_t, uint32_t>> spans) {
+  std::sort(spans.begin(), spans.end());
+  std::vector<std::pair<uint32_t, uint32_t>> merged;
+  for (const auto& span : spans) {
+    if (!merged.empty() && span.first <= merged.back().first + merged.back().second) {
+      uint32_t end = std::max(merged.back().first + merged.back().second, span.first + span.second);
+      merged.back().second = end - merged.back().first;
+    } else {
+      merged.push_back(span);
+    }
+  }
+
+  size_t total = 0;
+  for (const auto& span : merged) {
+    total += span.second;
+  }
+
+  size_t written = 0;
+  if (target.rdram) {
+    for (const auto& span : merged) {
+      written += WriteRdram(*target.process, *target.rdram, static_cast<uint32_t>(address + span.first),
+                            image + span.first, span.second);
+    }
+    return written == total;
+  }
+
+  std::vector<MemoryRange> ranges(merged.size());
+  for (size_t i = 0; i < merged.size(); i++) {
+    ranges[i].address = address + merged[i].first;
+    ranges[i].buffer = const_cast<uint8_t*>(image) + merged[i].first;
+    ranges[i].size = merged[i].second;
+  }
+  return target.process->WriteMany(ranges.data(), ranges.size()) == total;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "candidate_set.h"
+#include "platform.h"
+#include "rdram.h"
+
+// Instances of a struct as read from the target, `stride` bytes apart.
+// Host reads keep the target's bytes as they are. RDRAM reads from a word
+// aligned N64 address keep the emulator's host-order words instead of
+// unswapping them, so aligned big-endian fields load natively.
+struct StructBuffer {
+  std::vector<uint8_t> bytes;
+  size_t count = 0;
+  size_t stride = 0;
+  bool rdramWords = false;
+  // Per instance: 1 when read completely
+  std::vector<uint8_t> valid;
+};
+
+// A struct layout compiled once from its schema. Every field gets codecs
+// specialized on its type, byte order and (for RDRAM words) alignment, so
+// decoding a field of many instances is a strided copy, and a plain copy
+// when the values are packed and already in host order.
+class StructPlan {
+ public:
+  struct Field {
+    std::string name;
+    uint32_t offset = 0;
+    ValueType type = ValueType::UInt32;
+    // Elements of an array field, 1 for scalars
+    uint32_t count = 1;
+    bool array = false;
+    bool bigEndian = false;
+    // Struct a pointer field leads to; the field's type is then UInt32 or
+    // UInt64 and a value of 0 is a null pointer
+    std::shared_ptr<const StructPlan> target;
+  };
+
+  // Null with `error` set when a field is unnamed, named twice or ends
+  // past `size`. A `size` of 0 ends the struct at its last field. Fields
+  // may overlap, so one offset can be viewed as several types.
+  static std::shared_ptr<const StructPlan> Compile(std::vector<Field> fields, uint32_t size, std::string& error);
+
+  uint32_t Size() const { return size_; }
+  const std::vector<Field>& Fields() const { return fields_; }
+  // Indexes of the fields with a target struct
+  const std::vector<size_t>& Pointers() const { return pointers_; }
+
+  // Decodes field `field` of instances [first, first + count) into `out`
+  // in host order, instance by instance and element by element: count *
+  // fields[field].count values of ValueTypeSize(type) bytes
+  void Decode(size_t field, const StructBuffer& buffer, size_t first, size_t count, uint8_t* out) const;
+
+  // One element of one instance, as ScanOperand bits
+  uint64_t Load(size_t field, const StructBuffer& buffer, size_t instance, uint32_t element) const;
+
+  // Stores one element into a single instance image `Size()` bytes long,
+  // in the field's byte order. Images meant for RDRAM are in N64 order.
+  void Store(size_t field, uint32_t element, uint64_t bits, uint8_t* image) const;
+
+ private:
+  // Converts `count` values `stride` bytes apart at `position` in `bytes`
+  // into packed host-order values at `out`
+  typedef void (*DecodeFn)(const uint8_t* bytes, size_t position, size_t stride, size_t count, uint8_t* out);
+  typedef void (*StoreFn)(uint64_t bits, uint8_t* out);
+
+  struct Codec {
+    DecodeFn decode = nullptr;
+    DecodeFn decodeRdram = nullptr;
+    StoreFn store = nullptr;
+  };
+
+  StructPlan() = default;
+
+  template <size_t Size>
+  static Codec MakeCodec(bool bigEndian, bool wordAligned);
+
+  uint32_t size_ = 0;
+  std::vector<Field> fields_;
+  std::vector<Codec> codecs_;
+  std::vector<size_t> pointers_;
+};
+
+// Where struct transfers go: host memory of `process`, or N64 addresses
+// inside the emulated RDRAM when `rdram` is set
+struct StructTarget {
+  ProcessHandle* process = nullptr;
+  const RdramLocation* rdram = nullptr;
+};
+
+// Reads `count` instances `stride` bytes apart starting at `address` in a
+// single transfer. Instances past a short read are marked invalid.
+// Returns the number read completely.
+size_t ReadStructs(const StructTarget& target, const StructPlan& plan, uint64_t address, size_t count,
+                   size_t stride, StructBuffer& buffer);
+
+// Reads one instance at each of `addresses` as one batch; 0 is a null
+// pointer and leaves its instance invalid
+size_t ReadStructsAt(const StructTarget& target, const StructPlan& plan, const std::vector<uint64_t>& addresses,
+                     StructBuffer& buffer);
+
+// Instances together with what their pointer fields lead to
+struct StructTree {
+  StructBuffer buffer;
+  // One per entry of plan.Pointers(); element e of instance i's pointer
+  // lands at instance i * count + e
+  std::vector<StructTree> targets;
+};
+
+// Follows every pointer field of the instances in `tree`, one batched
+// read per pointer field and level, down to the end of the schema
+void ReadStructTargets(const StructTarget& target, const StructPlan& plan, StructTree& tree);
+
+// Writes the [offset, offset + size) spans of an instance image to
+// `address`; touching spans are merged first, and host writes go out as
+// one scatter-gather transfer. False unless every byte was written.
+bool WriteStructSpans(const StructTarget& target, uint64_t address, const uint8_t* image,
+                        std::vector<std::pair<uint32_t, uint32_t>> spans);
@@ -0,0 +1,371 @@
+#include "structs.h"
+#include <algorithm>
+#include <cstring>
+#include "memory.h"
+
+Napi::FunctionReference StructLayout::constructor;
+
+namespace {
+
+bool ParseEndian(const Napi::Object& object, bool fallback, bool& bigEndian, std::string& error) {
+  Napi::Value endian = object.Get("endian");
+  if (endian.IsUndefined()) {
+    bigEndian = fallback;
+    return true;
+  }
+  std::string name = endian.IsString() ? endian.As<Napi::String>().Utf8Value() : "";
+  if (name != "big" && name != "little") {
+    error = "endian must be 'big' or 'little'";
+    return false;
+  }
+  bigEndian = name == "big";
+  return true;
+}
+
+// Schemas are { size, endian, fields: [{ name, offset, type, count,
+// endian, pointerSize, struct }] }; nested schemas inherit the byte order
+// of the struct holding them
+std::shared_ptr<const StructPlan> ParseSchema(const Napi::Value& value, bool bigEndian, std::string& error) {
+  std::shared_ptr<const StructPlan> defined = StructLayout::PlanOf(value);
+  if (defined) {
+    return defined;
+  }
+  if (!value.IsObject()) {
+    error = "A struct schema must be an object";
+    return nullptr;
+  }
+  Napi::Object schema = value.As<Napi::Object>();
+  if (!ParseEndian(schema, bigEndian, bigEndian, error)) {
+    return nullptr;
+  }
+  Napi::Value list = schema.Get("fields");
+  if (!list.IsArray()) {
+    error = "A struct schema needs a fields array";
+    return nullptr;
+  }
+  Napi::Value size = schema.Get("size");
+
+  std::vector<StructPlan::Field> fields;
+  Napi::Array array = list.As<Napi::Array>();
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    Napi::Value item = array.Get(i);
+    if (!item.IsObject()) {
+      error = "Struct field " + std::to_string(i) + " must be an object";
+      return nullptr;
+    }
+    Napi::Object object = item.As<Napi::Object>();
+    StructPlan::Field field;
+    Napi::Value name = object.Get("name");
+    if (name.IsString()) {
+      field.name = name.As<Napi::String>().Utf8Value();
+    }
+    Napi::Value offset = object.Get("offset");
+    if (!offset.IsNumber()) {
+      error = "Struct field " + field.name + " needs an offset";
+      return nullptr;
+    }
+    field.offset = offset.As<Napi::Number>().Uint32Value();
+
+    Napi::Value typeValue = object.Get("type");
+    std::string type = typeValue.IsString() ? typeValue.As<Napi::String>().Utf8Value() : "";
+    if (type == "pointer") {
+      Napi::Value pointerSize = object.Get("pointerSize");
+      uint32_t bytes = pointerSize.IsNumber() ? pointerSize.As<Napi::Number>().Uint32Value() : 4;
+      if (bytes != 4 && bytes != 8) {
+        error = "Pointer field " + field.name + " needs a pointerSize of 4 or 8";
+        return nullptr;
+      }
+      field.type = bytes == 8 ? ValueType::UInt64 : ValueType::UInt32;
+      Napi::Value target = object.Get("struct");
+      if (!target.IsUndefined()) {
+        field.target = ParseSchema(target, bigEndian, error);
+        if (!field.target) {
+          return nullptr;
+        }
+      }
+    } else if (!ParseValueType(type, field.type)) {
+      error = "Struct field " + field.name + " has unknown type '" + type + "'";
+      return nullptr;
+    }
+
+    Napi::Value count = object.Get("count");
+    if (!count.IsUndefined()) {
+      if (!count.IsNumber()) {
+        error = "Array field " + field.name + " needs a numeric count";
+        return nullptr;
+      }
+      field.array = true;
+      field.count = count.As<Napi::Number>().Uint32Value();
+    }
+    if (!ParseEndian(object, bigEndian, field.bigEndian, error)) {
+      return nullptr;
+    }
+    fields.push_back(std::move(field));
+  }
+  return StructPlan::Compile(std::move(fields), size.IsNumber() ? size.As<Napi::Number>().Uint32Value() : 0, error);
+}
+
+template <typename T>
+Napi::Value NewArrayOf(Napi::Env env, size_t length, uint8_t*& data) {
+  Napi::TypedArrayOf<T> array = Napi::TypedArrayOf<T>::New(env, length);
+  data = reinterpret_cast<uint8_t*>(array.Data());
+  return array;
+}
+
+// A typed array of `length` values of `type`; 64-bit integers land in
+// BigInt64Array/BigUint64Array
+Napi::Value NewTypedArray(Napi::Env env, ValueType type, size_t length, uint8_t*& data) {
+  switch (type) {
+    case ValueType::Int8: return NewArrayOf<int8_t>(env, length, data);
+    case ValueType::UInt8: return NewArrayOf<uint8_t>(env, length, data);
+    case ValueType::Int16: return NewArrayOf<int16_t>(env, length, data);
+    case ValueType::UInt16: return NewArrayOf<uint16_t>(env, length, data);
+    case ValueType::Int32: return NewArrayOf<int32_t>(env, length, data);
+    case ValueType::UInt32: return NewArrayOf<uint32_t>(env, length, data);
+    case ValueType::Int64: return NewArrayOf<int64_t>(env, length, data);
+    case ValueType::UInt64: return NewArrayOf<uint64_t>(env, length, data);
+    case ValueType::Float32: return NewArrayOf<float>(env, length, data);
+    case ValueType::Float64: return NewArrayOf<double>(env, length, data);
+  }
+  return env.Undefined();
+}
+
+}  // namespace
+
+Napi::Object StructLayout::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "StructLayout", {
+    InstanceAccessor("size", &StructLayout::GetSize, nullptr),
+    InstanceMethod("decode", &StructLayout::Decode),
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+  return exports;
+}
+
+// defineStruct(schema) - compiles a schema of { size, endian, fields } into
+// a layout. Fields are { name, offset, type, count, endian }: type is a
+// value type or 'pointer' (with pointerSize, 4 by default, and an optional
+// struct schema or layout it points to), count makes an array and endian
+// ('little' unless the struct says otherwise) overrides the struct's byte
+// order. size defaults to the end of the last field.
+Napi::Value StructLayout::Define(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsObject()) {
+    Napi::TypeError::New(env, "defineStruct requires 1 argument: schema").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  std::string error;
+  std::shared_ptr<const StructPlan> plan = ParseSchema(info[0], false, error);
+  if (!plan) {
+    Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  Napi::Object layout = constructor.New({});
+  Unwrap(layout)->plan_ = plan;
+  return layout;
+}
+
+std::shared_ptr<const StructPlan> StructLayout::PlanOf(const Napi::Value& value) {
+  if (!value.IsObject() || constructor.IsEmpty()) {
+    return nullptr;
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  if (!object.InstanceOf(constructor.Value())) {
+    return nullptr;
+  }
+  return Unwrap(object)->plan_;
+}
+
+StructLayout::StructLayout(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<StructLayout>(info) {}
+
+Napi::Value StructLayout::GetSize(const Napi::CallbackInfo& info) {
+  return Napi::Number::New(info.Env(), plan_ ? plan_->Size() : 0);
+}
+
+// decode(bytes, { offset, count, stride, columns }) - decodes instances
+// from bytes already read, in the target's byte order. Without count it
+// returns one object; with it an array of objects, or columns as from
+// readStructs(). Pointer fields stay numbers. count is clamped to the
+// instances the bytes after offset hold.
+Napi::Value StructLayout::Decode(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint8_t* data = nullptr;
+  size_t length = 0;
+  if (info.Length() < 1 || !GetTargetBytes(info[0], data, length) || !plan_) {
+    Napi::TypeError::New(env, "decode requires 1 argument: bytes").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  size_t offset = 0;
+  size_t count = 1;
+  size_t stride = plan_->Size();
+  bool many = false;
+  bool columns = false;
+  if (info.Length() > 1 && info[1].IsObject()) {
+    Napi::Object options = info[1].As<Napi::Object>();
+    Napi::Value value = options.Get("offset");
+    offset = value.IsNumber() ? value.As<Napi::Number>().Uint32Value() : 0;
+    value = options.Get("count");
+    if (value.IsNumber()) {
+      count = value.As<Napi::Number>().Uint32Value();
+      many = true;
+    }
+    value = options.Get("stride");
+    stride = value.IsNumber() ? value.As<Napi::Number>().Uint32Value() : stride;
+    value = options.Get("columns");
+    columns = value.IsBoolean() && value.As<Napi::Boolean>().Value();
+  }
+  if (offset > length || stride == 0) {
+    Napi::RangeError::New(env, "offset is past the end of the bytes").ThrowAsJavaScriptException();
+    return env.Null();
+  }
+  if (many) {
+    size_t remaining = length - offset;
+    size_t fits = remaining < plan_->Size() ? 0 : (remaining - plan_->Size()) / stride + 1;
+    count = std::min(count, fits);
+  }
+
+  StructTree tree;
+  StructBuffer& buffer = tree.buffer;
+  buffer.count = count;
+  buffer.stride = stride;
+  buffer.valid.assign(count, 0);
+  size_t span = count == 0 ? 0 : (count - 1) * stride + plan_->Size();
+  size_t available = std::min(span, length - offset);
+  buffer.bytes.assign(span, 0);
+  memcpy(buffer.bytes.data(), data + offset, available);
+  for (size_t i = 0; i < count && i * stride + plan_->Size() <= available; i++) {
+    buffer.valid[i] = 1;
+  }
+
+  if (columns) {
+    return StructColumnsToJs(env, *plan_, buffer);
+  }
+  if (!many) {
+    return StructToJs(env, *plan_, tree, 0);
+  }
+  Napi::Array result = Napi::Array::New(env, count);
+  for (size_t i = 0; i < count; i++) {
+    result[i] = StructToJs(env, *plan_, tree, i);
+  }
+  return result;
+}
+
+Napi::Value StructToJs(Napi::Env env, const StructPlan& plan, const StructTree& tree, size_t index) {
+  if (index >= tree.buffer.count || !tree.buffer.valid[index]) {
+    return env.Null();
+  }
+  Napi::Object result = Napi::Object::New(env);
+  const std::vector<StructPlan::Field>& fields = plan.Fields();
+  size_t pointer = 0;
+  for (size_t f = 0; f < fields.size(); f++) {
+    const StructPlan::Field& field = fields[f];
+    const StructTree* target = nullptr;
+    if (field.target) {
+      if (pointer < tree.targets.size()) {
+        target = &tree.targets[pointer];
+      }
+      pointer++;
+    }
+
+    if (target && field.array) {
+      Napi::Array items = Napi::Array::New(env, field.count);
+      for (uint32_t e = 0; e < field.count; e++) {
+        items[e] = StructToJs(env, *field.target, *target, index * field.count + e);
+      }
+      result.Set(field.name, items);
+    } else if (target) {
+      result.Set(field.name, StructToJs(env, *field.target, *target, index));
+    } else if (field.array) {
+      uint8_t* data = nullptr;
+      Napi::Value values = NewTypedArray(env, field.type, field.count, data);
+      plan.Decode(f, tree.buffer, index, 1, data);
+      result.Set(field.name, values);
+    } else {
+      result.Set(field.name, OperandToJs(env, plan.Load(f, tree.buffer, index, 0), field.type));
+    }
+  }
+  return result;
+}
+
+Napi::Object StructColumnsToJs(Napi::Env env, const StructPlan& plan, const StructBuffer& buffer) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("count", Napi::Number::New(env, static_cast<double>(buffer.count)));
+  Napi::Uint8Array valid = Napi::Uint8Array::New(env, buffer.count);
+  if (buffer.count > 0) {
+    memcpy(valid.Data(), buffer.valid.data(), buffer.count);
+  }
+  result.Set("valid", valid);
+
+  Napi::Object columns = Napi::Object::New(env);
+  const std::vector<StructPlan::Field>& fields = plan.Fields();
+  for (size_t f = 0; f < fields.size(); f++) {
+    uint8_t* data = nullptr;
+    Napi::Value values = NewTypedArray(env, fields[f].type, buffer.count * fields[f].count, data);
+    plan.Decode(f, buffer, 0, buffer.count, data);
+    columns.Set(fields[f].name, values);
+  }
+  result.Set("fields", columns);
+  return result;
+}
+
+bool StructFromJs(const Napi::Object& values, const StructPlan& plan, std::vector<uint8_t>& image,
+                  std::vector<std::pair<uint32_t, uint32_t>>& spans, std::string& error) {
+  image.assign(plan.Size(), 0);
+  const std::vector<StructPlan::Field>& fields = plan.Fields();
+  Napi::Array keys = values.GetPropertyNames();
+  for (uint32_t k = 0; k < keys.Length(); k++) {
+    std::string name = keys.Get(k).ToString().Utf8Value();
+    Napi::Value value = values.Get(name);
+    if (value.IsUndefined()) {
+      continue;
+    }
+    auto found = std::find_if(fields.begin(), fields.end(),
+                              [&name](const StructPlan::Field& field) { return field.name == name; });
+    if (found == fields.end()) {
+      error = "Struct has no field " + name;
+      return false;
+    }
+    size_t f = found - fields.begin();
+    uint32_t valueSize = static_cast<uint32_t>(ValueTypeSize(found->type));
+    ScanOperand operand;
+
+    if (!found->array) {
+      if (!ToOperand(value, found->type, operand)) {
+        error = "Field " + name + " needs a number";
+        return false;
+      }
+      plan.Store(f, 0, operand.bits, image.data());
+      spans.emplace_back(found->offset, valueSize);
+      continue;
+    }
+
+    if (!value.IsObject()) {
+      error = "Field " + name + " needs an array";
+      return false;
+    }
+    Napi::Object items = value.As<Napi::Object>();
+    Napi::Value lengthValue = items.Get("length");
+    uint32_t length = lengthValue.IsNumber() ? lengthValue.As<Napi::Number>().Uint32Value() : 0;
+    length = std::min(length, found->count);
+    for (uint32_t e = 0; e < length; e++) {
+      if (!ToOperand(items.Get(e), found->type, operand)) {
+        error = "Field " + name + " needs numbers";
+        return false;
+      }
+      plan.Store(f, e, operand.bits, image.data());
+    }
+    if (length > 0) {
+      spans.emplace_back(found->offset, length * valueSize);
+    }
+  }
+  return true;
+}
+
+Napi::Object RegisterStructFunctions(Napi::Env env, Napi::Object exports) {
+  StructLayout::Init(env, exports);
+  exports.Set("defineStruct", Napi::Function::New(env, StructLayout::Define));
+  return exports;
+}
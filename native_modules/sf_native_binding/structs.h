@@ -0,0 +1,48 @@
+#pragma once
+#include <napi.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "struct_plan.h"
+
+// A compiled struct schema, created with defineStruct(schema). Sessions
+// read and write instances of it with readStruct(), readStructs() and
+// writeStruct().
+class StructLayout : public Napi::ObjectWrap<StructLayout> {
+ public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports);
+  static Napi::Value Define(const Napi::CallbackInfo& info);
+
+  // The plan behind a StructLayout object; null for any other value
+  static std::shared_ptr<const StructPlan> PlanOf(const Napi::Value& value);
+
+  explicit StructLayout(const Napi::CallbackInfo& info);
+
+ private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value GetSize(const Napi::CallbackInfo& info);
+  Napi::Value Decode(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<const StructPlan> plan_;
+};
+
+// Instance `index` of `tree` as an object, null when it could not be
+// read. Arrays become typed arrays. Pointer fields become the struct they
+// lead to (null for null or unreadable pointers) once `tree` has their
+// targets, and stay numbers otherwise.
+Napi::Value StructToJs(Napi::Env env, const StructPlan& plan, const StructTree& tree, size_t index);
+
+// { count, valid, fields: { <name>: typed array } }, each field's values
+// of every instance back to back; pointer fields hold the raw pointers
+Napi::Object StructColumnsToJs(Napi::Env env, const StructPlan& plan, const StructBuffer& buffer);
+
+// Stores the fields present in `values` into an instance image and adds
+// the bytes each one covers to `spans`. Fields left out are not written.
+bool StructFromJs(const Napi::Object& values, const StructPlan& plan, std::vector<uint8_t>& image,
+                  std::vector<std::pair<uint32_t, uint32_t>>& spans, std::string& error);
+
+// Function to register the struct functions
+Napi::Object RegisterStructFunctions(Napi::Env env, Napi::Object exports);
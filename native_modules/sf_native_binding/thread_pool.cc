@@ -0,0 +1,129 @@
+#include "thread_pool.h"
+
+namespace {
+
+thread_local int currentWorker = -1;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0) {
+    threads = 1;
+  }
+  for (size_t i = 0; i < threads; i++) {
+    workers_.emplace_back(new Worker());
+  }
+  for (size_t i = 0; i < threads; i++) {
+    threads_.emplace_back(&ThreadPool::Run, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+ThreadPool& ThreadPool::Shared() {
+  static ThreadPool pool(std::thread::hardware_concurrency());
+  return pool;
+}
+
+int ThreadPool::CurrentWorker() {
+  return currentWorker;
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+  // Workers keep their own children local; outside callers spread tasks
+  // round-robin so stealing starts from a balanced state
+  size_t index = currentWorker >= 0
+    ? static_cast<size_t>(currentWorker) % workers_.size()
+    : nextQueue_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+
+  // Count the task before publishing it so a worker that pops it early
+  // never drives the counter below zero
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    pending_.fetch_add(1, std::memory_order_release);
+  }
+  {
+    std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+    workers_[index]->tasks.push_back(std::move(task));
+  }
+  wake_.notify_one();
+}
+
+bool ThreadPool::PopLocal(size_t index, std::function<void()>& task) {
+  Worker& worker = *workers_[index];
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  task = std::move(worker.tasks.back());
+  worker.tasks.pop_back();
+  return true;
+}
+
+bool ThreadPool::Steal(size_t index, std::function<void()>& task) {
+  for (size_t offset = 1; offset < workers_.size(); offset++) {
+    Worker& victim = *workers_[(index + offset) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Run(size_t index) {
+  currentWorker = static_cast<int>(index);
+  std::function<void()> task;
+
+  for (;;) {
+    if (PopLocal(index, task) || Steal(index, task)) {
+      pending_.fetch_sub(1, std::memory_order_acq_rel);
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    wake_.wait(lock, [this]() {
+      return stopping_ || pending_.load(std::memory_order_acquire) > 0;
+    });
+    if (stopping_ && pending_.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+void TaskGroup::Run(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    outstanding_++;
+  }
+  pool_.Submit([this, task]() {
+    task();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--outstanding_ == 0) {
+      done_.notify_all();
+    }
+  });
+}
+
+void TaskGroup::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this]() { return outstanding_ == 0; });
+}
+
+bool TaskGroup::WaitFor(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return done_.wait_for(lock, timeout, [this]() { return outstanding_ == 0; });
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops
+// its own tasks at the back (LIFO, cache-warm) and steals from the front of
+// other workers' deques when it runs dry.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Process-wide pool sized to the number of hardware threads
+  static ThreadPool& Shared();
+
+  size_t Size() const { return workers_.size(); }
+
+  // Index of the calling worker in its pool, or -1 outside any pool
+  static int CurrentWorker();
+
+  void Submit(std::function<void()> task);
+
+ private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  bool PopLocal(size_t index, std::function<void()>& task);
+  bool Steal(size_t index, std::function<void()>& task);
+  void Run(size_t index);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> nextQueue_{0};
+  std::atomic<size_t> pending_{0};
+  std::mutex sleepMutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+};
+
+// Tracks a batch of tasks submitted to a pool so the submitting thread can
+// wait for all of them. Wait must not be called from a pool worker.
+class TaskGroup {
+ public:
+  explicit TaskGroup(ThreadPool& pool) : pool_(pool) {}
+  ~TaskGroup() { Wait(); }
+
+  void Run(std::function<void()> task);
+
+  void Wait();
+
+  // Returns true if every task finished within `timeout`
+  bool WaitFor(std::chrono::milliseconds timeout);
+
+ private:
+  ThreadPool& pool_;
+  std::mutex mutex_;
+  std::condition_variable done_;
+  size_t outstanding_ = 0;
+};
@@ -0,0 +1,245 @@
+#include "watch_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "batch_read.h"
+
+namespace {
+
+double ToDouble(uint64_t bits, ValueType type) {
+  ScanOperand value;
+  value.bits = bits;
+  switch (type) {
+    case ValueType::Int8: return value.As<int8_t>();
+    case ValueType::UInt8: return value.As<uint8_t>();
+    case ValueType::Int16: return value.As<int16_t>();
+    case ValueType::UInt16: return value.As<uint16_t>();
+    case ValueType::Int32: return value.As<int32_t>();
+    case ValueType::UInt32: return value.As<uint32_t>();
+    case ValueType::Int64: return static_cast<double>(value.As<int64_t>());
+    case ValueType::UInt64: return static_cast<double>(value.As<uint64_t>());
+    case ValueType::Float32: return value.As<float>();
+    case ValueType::Float64: return value.As<double>();
+  }
+  return 0;
+}
+
+}  // namespace
+
+WatchEngine::WatchEngine(std::shared_ptr<ProcessHandle> process)
+  : process_(std::move(process)) {}
+
+WatchEngine::~WatchEngine() {
+  Stop();
+}
+
+void WatchEngine::Start(NotifyCallback onChanges, std::chrono::microseconds interval) {
+  Stop();
+  std::lock_guard<std::mutex> lock(mutex_);
+  // A new consumer starts from the current values
+  for (Watch& watch : watches_) {
+    watch.reported = false;
+  }
+  pending_.clear();
+  pendingIndex_.clear();
+  notified_ = false;
+  onChanges_ = std::move(onChanges);
+  interval_ = interval;
+  stopping_ = false;
+  thread_ = std::thread(&WatchEngine::Run, this);
+}
+
+void WatchEngine::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool WatchEngine::Running() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return thread_.joinable() && !stopping_;
+}
+
+void WatchEngine::SetInterval(std::chrono::microseconds interval) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interval_ = interval;
+  }
+  wake_.notify_one();
+}
+
+uint32_t WatchEngine::Add(uint64_t address, const WatchOptions& options) {
+  Watch watch;
+  watch.address = address;
+  watch.options = options;
+  watch.size = ValueTypeSize(options.type);
+  if (watch.size == 1) {
+    watch.options.byteSwap = false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  watch.id = nextId_++;
+  watches_.push_back(watch);
+  generation_++;
+  return watch.id;
+}
+
+bool WatchEngine::Remove(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(watches_.begin(), watches_.end(), [id](const Watch& watch) { return watch.id == id; });
+  if (it == watches_.end()) {
+    return false;
+  }
+  watches_.erase(it);
+  generation_++;
+
+  if (pendingIndex_.count(id)) {
+    pending_.erase(pending_.begin() + pendingIndex_[id]);
+    pendingIndex_.clear();
+    for (size_t i = 0; i < pending_.size(); i++) {
+      pendingIndex_[pending_[i].id] = i;
+    }
+  }
+  return true;
+}
+
+void WatchEngine::TakeChanges(std::vector<WatchChange>& changes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  changes.clear();
+  changes.swap(pending_);
+  pendingIndex_.clear();
+  notified_ = false;
+}
+
+WatchStats WatchEngine::Stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  WatchStats stats = stats_;
+  stats.watches = watches_.size();
+  return stats;
+}
+
+void WatchEngine::Run() {
+  BeginHighResolutionTimer();
+  Clock::time_point next = Clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    Clock::time_point now = Clock::now();
+    if (now < next) {
+      wake_.wait_until(lock, next);
+      continue;
+    }
+
+    lock.unlock();
+    Tick();
+    lock.lock();
+
+    next += interval_;
+    now = Clock::now();
+    if (next <= now) {
+      stats_.missedTicks += (now - next) / interval_ + 1;
+      next = now + interval_;
+    }
+  }
+  EndHighResolutionTimer();
+}
+
+void WatchEngine::Tick() {
+  std::vector<ReadRequest> requests;
+  uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation = generation_;
+    requests.resize(watches_.size());
+    for (size_t i = 0; i < watches_.size(); i++) {
+      requests[i].address = watches_[i].address;
+      requests[i].size = static_cast<uint32_t>(watches_[i].size);
+    }
+  }
+
+  // Neighbouring fields of one struct coalesce into a single read
+  std::vector<size_t> offsets;
+  std::vector<uint8_t> data(LayoutBatch(requests.data(), requests.size(), offsets));
+  std::vector<ReadStatus> status(requests.size());
+  Clock::time_point start = Clock::now();
+  ReadBatch(*process_, requests.data(), requests.size(), offsets, data.data(), status.data());
+  std::chrono::microseconds elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+
+  bool notify = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.ticks++;
+    stats_.lastRead = elapsed;
+    if (generation != generation_) {
+      // The list changed under the read; the next tick picks it up
+      return;
+    }
+
+    for (size_t i = 0; i < watches_.size(); i++) {
+      Watch& watch = watches_[i];
+      bool readable = status[i].transferred == watch.size;
+      uint64_t bits = 0;
+      if (readable) {
+        uint8_t raw[8];
+        const uint8_t* bytes = data.data() + offsets[i];
+        for (size_t b = 0; b < watch.size; b++) {
+          raw[b] = watch.options.byteSwap ? bytes[watch.size - 1 - b] : bytes[b];
+        }
+        memcpy(&bits, raw, watch.size);
+      }
+
+      bool changed;
+      if (!watch.reported || readable != watch.readable) {
+        changed = true;
+      } else if (!readable || bits == watch.bits) {
+        changed = false;
+      } else if (watch.options.threshold > 0) {
+        // Compared against the last reported value, so slow drift still
+        // gets reported once it adds up; NaN always counts as a change
+        double delta = std::fabs(ToDouble(bits, watch.options.type) - ToDouble(watch.bits, watch.options.type));
+        changed = !(delta < watch.options.threshold);
+      } else {
+        changed = true;
+      }
+
+      if (changed) {
+        watch.reported = true;
+        watch.readable = readable;
+        watch.bits = bits;
+        Queue(watch);
+      }
+    }
+
+    if (!pending_.empty() && !notified_) {
+      notified_ = true;
+      stats_.deliveries++;
+      notify = true;
+    }
+  }
+
+  if (notify && onChanges_) {
+    onChanges_();
+  }
+}
+
+void WatchEngine::Queue(const Watch& watch) {
+  WatchChange change;
+  change.id = watch.id;
+  change.type = watch.options.type;
+  change.readable = watch.readable;
+  change.bits = watch.bits;
+  stats_.changes++;
+
+  auto it = pendingIndex_.find(watch.id);
+  if (it != pendingIndex_.end()) {
+    pending_[it->second] = change;
+    stats_.coalesced++;
+    return;
+  }
+  pendingIndex_[watch.id] = pending_.size();
+  pending_.push_back(change);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "candidate_set.h"
+#include "platform.h"
+
+struct WatchOptions {
+  ValueType type = ValueType::UInt32;
+  bool byteSwap = false;
+  // Smallest move worth reporting; 0 reports any change of the bits
+  double threshold = 0;
+};
+
+// Newest value of one watch. `bits` holds the value in host byte order,
+// reinterpreted per `type`; unreadable watches report readable = false.
+struct WatchChange {
+  uint32_t id = 0;
+  ValueType type = ValueType::UInt32;
+  bool readable = false;
+  uint64_t bits = 0;
+};
+
+struct WatchStats {
+  size_t watches = 0;
+  uint64_t ticks = 0;
+  uint64_t changes = 0;
+  // Notifications sent to the consumer
+  uint64_t deliveries = 0;
+  // Changes overwritten by a newer value before the consumer took them
+  uint64_t coalesced = 0;
+  // Ticks skipped because the previous one overran
+  uint64_t missedTicks = 0;
+  // Time the last tick's batched read took
+  std::chrono::microseconds lastRead{0};
+};
+
+// Samples a watch list from a background thread, one batched read per
+// tick, and keeps only the newest value of every watch that changed. The
+// notify callback fires once when changes become pending and not again
+// until the consumer takes them, so a slow consumer sees fewer, fresher
+// updates instead of a growing queue.
+class WatchEngine {
+ public:
+  typedef std::function<void()> NotifyCallback;
+
+  explicit WatchEngine(std::shared_ptr<ProcessHandle> process);
+  ~WatchEngine();
+
+  WatchEngine(const WatchEngine&) = delete;
+  WatchEngine& operator=(const WatchEngine&) = delete;
+
+  // Starts ticking; `onChanges` runs on the sampling thread
+  void Start(NotifyCallback onChanges, std::chrono::microseconds interval);
+  void Stop();
+  bool Running();
+  void SetInterval(std::chrono::microseconds interval);
+
+  // Watches may be added and removed while running. A new watch reports
+  // its first value on the next tick.
+  uint32_t Add(uint64_t address, const WatchOptions& options);
+  bool Remove(uint32_t id);
+
+  // Moves the pending changes into `changes`, one per watch
+  void TakeChanges(std::vector<WatchChange>& changes);
+
+  WatchStats Stats();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Watch {
+    uint32_t id = 0;
+    uint64_t address = 0;
+    WatchOptions options;
+    size_t size = 0;
+    // Last reported state
+    bool reported = false;
+    bool readable = false;
+    uint64_t bits = 0;
+  };
+
+  void Run();
+  void Tick();
+  // Records a change, replacing an undelivered one. Called with mutex_ held.
+  void Queue(const Watch& watch);
+
+  std::shared_ptr<ProcessHandle> process_;
+  std::vector<Watch> watches_;
+  // Bumped whenever watches_ changes, so a tick that raced an edit is dropped
+  uint64_t generation_ = 0;
+  uint32_t nextId_ = 1;
+  std::vector<WatchChange> pending_;
+  std::unordered_map<uint32_t, size_t> pendingIndex_;
+  bool notified_ = false;
+  NotifyCallback onChanges_;
+  std::chrono::microseconds interval_{16667};
+  WatchStats stats_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
@@ -1,9 +1,235 @@
 const { app, BrowserWindow, ipcMain } = require('electron');
+const fs = require('node:fs');
 const path = require('node:path');
 
 // Load the native module in the main process
 const SFNative = require('../native_modules/sf_native_binding/build/Release/sf_native');
 
+// Attached process sessions, keyed by pid. A session keeps the process
+// handle open, so repeated reads and writes skip the open/close round trip.
+const sessions = new Map();
+
+// Running emulators, keyed by pid. A native watcher reports them as they
+// start and exit, so nothing polls the process list.
+const emulators = new Map();
+let processWatch = null;
+
+function startProcessWatch() {
+  processWatch = SFNative.watchProcesses({ names: ['project64', 'pj64'] }, (events) => {
+    for (const event of events) {
+      if (event.type === 'start') {
+        emulators.set(event.pid, event);
+        continue;
+      }
+      emulators.delete(event.pid);
+      // The handle of an exited process is useless; drop it now rather
+      // than on the next request
+      dropSession(event.pid);
+    }
+    for (const window of BrowserWindow.getAllWindows()) {
+      window.webContents.send('process-events', events);
+    }
+  });
+}
+
+// The addon logs into a fixed ring instead of stdout; drain it here so
+// native messages still reach the main process console
+const NATIVE_LOG_METHODS = { trace: 'debug', debug: 'debug', info: 'info', warn: 'warn', error: 'error' };
+
+function drainNativeLog() {
+  for (const { time, level, message } of SFNative.drainLog()) {
+    console[NATIVE_LOG_METHODS[level]](`[sf_native ${new Date(time).toISOString()}] ${message}`);
+  }
+}
+
+setInterval(drainNativeLog, 1000).unref();
+
+// Detaches the session for `pid`. Detaching releases its stored results,
+// so their formats go too and a reused pid starts clean.
+function dropSession(pid) {
+  const session = sessions.get(pid);
+  if (!session) {
+    return;
+  }
+  session.detach();
+  sessions.delete(pid);
+  for (const key of resultFormats.keys()) {
+    if (key.startsWith(`${pid}:`)) {
+      resultFormats.delete(key);
+    }
+  }
+}
+
+function getSession(pid) {
+  let session = sessions.get(pid);
+  if (session && !session.isAlive()) {
+    dropSession(pid);
+    session = undefined;
+  }
+  if (!session) {
+    session = SFNative.attach(pid);
+    sessions.set(pid, session);
+  }
+  return session;
+}
+
+// Forwards native scan progress to the renderer that started the scan
+function progressForwarder(event, pid) {
+  return (progress) => {
+    if (!event.sender.isDestroyed()) {
+      event.sender.send('scan-progress', { pid, ...progress });
+    }
+  };
+}
+
+// Snapshot files live under the user data directory; the renderer only
+// names them
+function snapshotPath(name) {
+  return path.join(app.getPath('userData'), 'snapshots', `${path.basename(String(name))}.sfsnap`);
+}
+
+// Changed runs from session.diff(), the first `limit` as plain objects
+function formatDiff(diff, limit) {
+  const changes = Array.from(diff.addresses.subarray(0, limit), (address, i) => ({
+    address,
+    hexAddress: `0x${address.toString(16).toUpperCase()}`,
+    size: diff.sizes[i]
+  }));
+  const { pagesCompared, pagesSkipped, pagesChanged, bytesChanged, pagesUnreadable, truncated, n64 } = diff;
+  return {
+    count: diff.addresses.length, changes, pagesCompared, pagesSkipped, pagesChanged, bytesChanged, pagesUnreadable,
+    truncated, n64
+  };
+}
+
+// Struct layouts registered by the renderer with define-struct, by name.
+// Each schema is compiled once into a native plan and reused for every
+// read and write.
+const structLayouts = new Map();
+
+function getStructLayout(name) {
+  const layout = structLayouts.get(name);
+  if (!layout) {
+    throw new Error(`Unknown struct layout: ${name}`);
+  }
+  return layout;
+}
+
+// Views of the value at the start of a read-memory-as-array buffer, one
+// overlapping field per format; the 64-bit ones need 8 bytes
+let valueViews = null;
+
+function getValueViews() {
+  if (!valueViews) {
+    const narrow = [
+      { name: 'asInt32', offset: 0, type: 'int32' },
+      { name: 'asUint32', offset: 0, type: 'uint32' },
+      { name: 'asFloat', offset: 0, type: 'float32' }
+    ];
+    const wide = [
+      ...narrow,
+      { name: 'asInt64', offset: 0, type: 'int64' },
+      { name: 'asUint64', offset: 0, type: 'uint64' },
+      { name: 'asDouble', offset: 0, type: 'float64' }
+    ];
+    valueViews = {
+      narrow: SFNative.defineStruct({ fields: narrow }),
+      wide: SFNative.defineStruct({ fields: wide })
+    };
+  }
+  return valueViews;
+}
+
+// Bit width of each integer scan type, for two's complement hex display
+const INTEGER_TYPE_BITS = {
+  int8: 8, uint8: 8, int16: 16, uint16: 16, int32: 32, uint32: 32, int64: 64, uint64: 64
+};
+
+function formatCandidate({ address, value }, type) {
+  const bits = INTEGER_TYPE_BITS[type];
+  return {
+    address,
+    hexAddress: `0x${address.toString(16).toUpperCase()}`,
+    // 64-bit values arrive as BigInt, which React cannot render
+    value: typeof value === 'bigint' ? value.toString() : value,
+    hexValue: bits ? `0x${BigInt.asUintN(bits, BigInt(value)).toString(16).toUpperCase()}` : ''
+  };
+}
+
+// Rows of a 32-bit value scan with the value now at each match, confirmed
+// with one batched read of 4 bytes per address
+function formatValueMatches(session, addresses) {
+  const ranges = new Float64Array(addresses.length * 2);
+  addresses.forEach((address, i) => {
+    ranges[i * 2] = address;
+    ranges[i * 2 + 1] = 4;
+  });
+  const batch = session.readBatch(ranges);
+  const dataView = new DataView(batch.buffer.buffer, batch.buffer.byteOffset, batch.buffer.byteLength);
+  return Array.from(addresses, (address, i) => {
+    const hexAddress = `0x${address.toString(16).toUpperCase()}`;
+    if (batch.lengths[i] < 4) {
+      return {
+        address,
+        hexAddress,
+        value: 'Read error',
+        error: `Could not read 4 bytes (error ${batch.status[i]})`
+      };
+    }
+    const signedValue = dataView.getInt32(batch.offsets[i], true);
+    const unsignedValue = dataView.getUint32(batch.offsets[i], true);
+    return {
+      address,
+      hexAddress,
+      value: signedValue,
+      unsignedValue,
+      hexValue: `0x${unsignedValue.toString(16).toUpperCase()}`
+    };
+  });
+}
+
+// Rows of a pattern scan with the bytes now at each match. Word-swapped
+// matches are in the target's byte order, so the raw bytes at the host
+// address would not read as the pattern and it is shown as searched; N64
+// addresses read back in N64 byte order.
+function formatPatternMatches(session, addresses, pattern, options) {
+  const length = (pattern.match(/\?\??|[0-9a-fA-F]{2}/g) || []).length;
+  return Array.from(addresses, (address) => {
+    let value = pattern;
+    if (options.n64 || !options.byteSwap) {
+      try {
+        const bytes = options.n64 ? session.readN64(address, length) : session.read(address, length);
+        value = Array.from(bytes).map((b) => b.toString(16).padStart(2, '0').toUpperCase()).join(' ');
+      } catch (readErr) {
+        value = 'Read error';
+      }
+    }
+    return { address, hexAddress: `0x${address.toString(16).toUpperCase()}`, value, hexValue: '' };
+  });
+}
+
+// Scan results stay in the native session and the renderer pages through
+// them by handle. One-shot scans record no values, so their rows are
+// formatted from memory by the function kept here, by pid and handle.
+const resultFormats = new Map();
+
+const resultKey = (pid, handle) => `${pid}:${handle}`;
+
+// Rows [offset, offset + count) of stored results as { total, rows }
+function pageResults(session, pid, handle, offset, count, query) {
+  const page = session.resultPage(handle, offset, count, query);
+  let rows;
+  if (page.values) {
+    rows = Array.from(page.addresses, (address, i) => formatCandidate({ address, value: page.values[i] }, page.type));
+  } else {
+    const format = resultFormats.get(resultKey(pid, handle));
+    rows = format
+      ? format(session, page.addresses)
+      : Array.from(page.addresses, (address) => formatCandidate({ address, value: '' }));
+  }
+  return { total: page.total, rows };
+}
+
 // Handle creating/removing shortcuts on Windows when installing/uninstalling.
 if (require('electron-squirrel-startup')) {
   app.quit();
@@ -36,6 +262,9 @@ app.whenReady().then(() => {
 
   // Set up IPC handlers for native module functions
   setupIpcHandlers();
+  if (SFNative) {
+    startProcessWatch();
+  }
 
   // On OS X it's common to re-create a window in the app when the
   // dock icon is clicked and there are no other windows open.
@@ -63,92 +292,175 @@ function setupIpcHandlers() {
     }
   });
 
+  // Emulators running now, as { pid, name, path, bits, modules }; later
+  // changes arrive as 'process-events'
+  ipcMain.handle('watched-processes', async () => {
+    if (moduleError) throw moduleError;
+    return Array.from(emulators.values(), ({ type, ...process }) => process);
+  });
+
   // Memory functions
-  ipcMain.handle('scan-memory', async (_, pid, value) => {
+  // Scans for a 32-bit value. The matches stay native; resolves with their
+  // handle and count and the first `limit` matches with their current
+  // values. Page through the rest with result-page.
+  ipcMain.handle('scan-memory', async (event, pid, value, regions, limit = 100) => {
     if (moduleError) throw moduleError;
     try {
-      const addresses = SFNative.scanMemoryForValue(pid, value);
-      console.log(`Found ${addresses.length} addresses with value ${value}`);
-      
-      // For each address, read the memory to confirm the value
-      const results = await Promise.all(addresses.map(async (address) => {
-        try {
-          // Read 4 bytes (assuming we're looking for a 32-bit integer)
-          // Use the more reliable array-based reading
-          const byteArray = SFNative.readMemoryAsArray(pid, address, 4);
-          
-          if (!byteArray || byteArray.length < 4) {
-            console.warn(`Insufficient data read at address 0x${address.toString(16).toUpperCase()}: got ${byteArray ? byteArray.length : 0} bytes`);
-            return {
-              address,
-              hexAddress: `0x${address.toString(16).toUpperCase()}`,
-              value: 'Insufficient data',
-              error: 'Could not read 4 bytes'
-            };
-          }
-          
-          // Convert array to Int32Array for reading the value
-          try {
-            // Convert the array to a buffer
-            const buffer = new ArrayBuffer(4);
-            const view = new Uint8Array(buffer);
-            for (let i = 0; i < 4; i++) {
-              view[i] = byteArray[i];
-            }
-            
-            // Read as both signed and unsigned
-            const dataView = new DataView(buffer);
-            const signedValue = dataView.getInt32(0, true); // true for little-endian
-            const unsignedValue = dataView.getUint32(0, true);
-            
-            return {
-              address,
-              hexAddress: `0x${address.toString(16).toUpperCase()}`,
-              value: signedValue,
-              unsignedValue,
-              hexValue: `0x${unsignedValue.toString(16).toUpperCase()}`
-            };
-          } catch (parseErr) {
-            console.warn(`Failed to parse data at address 0x${address.toString(16).toUpperCase()}: ${parseErr.message}`);
-            return {
-              address,
-              hexAddress: `0x${address.toString(16).toUpperCase()}`,
-              value: 'Parse error',
-              error: parseErr.message
-            };
-          }
-        } catch (readErr) {
-          console.warn(`Failed to read memory at address 0x${address.toString(16).toUpperCase()}: ${readErr.message}`);
-          return {
-            address,
-            hexAddress: `0x${address.toString(16).toUpperCase()}`,
-            value: 'Read error',
-            error: readErr.message
-          };
-        }
-      }));
-      
-      // Filter out addresses with read errors if needed
-      const validResults = results.filter(result => !result.error);
-      console.log(`Successfully read ${validResults.length} out of ${results.length} addresses`);
-      
-      return results;
+      const session = getSession(pid);
+      // Runs on a native worker thread; starting a new scan cancels the
+      // previous one, which then rejects with err.cancelled === true
+      const { handle, count } = await session.scanAsync(value, {
+        regions,
+        store: true,
+        onProgress: progressForwarder(event, pid)
+      });
+      console.log(`Found ${count} addresses with value ${value}`);
+
+      resultFormats.set(resultKey(pid, handle), formatValueMatches);
+      const { rows } = pageResults(session, pid, handle, 0, limit);
+      return { handle, count, results: rows };
     } catch (err) {
-      console.error('Error scanning memory:', err);
+      if (err.cancelled) {
+        console.log(`Scan for value ${value} cancelled`);
+      } else {
+        console.error('Error scanning memory:', err);
+      }
       throw err;
     }
   });
 
-  ipcMain.handle('read-memory', async (_, pid, address, size) => {
+  // Narrowing scan: a first pass followed by any number of refinements
+  // that only re-read the surviving candidates. Criteria are a value or
+  // { mode, value, min, max, epsilon }, plus { type, aligned, byteSwap }
+  // on the first pass; both resolve with { count, memoryBytes }.
+  const runCandidateScan = async (event, pid, criteria, refine) => {
     if (moduleError) throw moduleError;
+    const session = getSession(pid);
+    const options = { onProgress: progressForwarder(event, pid) };
     try {
-      return SFNative.readMemory(pid, address, size);
+      const summary = refine
+        ? await session.nextScan(criteria, options)
+        : await session.firstScan(criteria, options);
+      console.log(`${refine ? 'Next' : 'First'} scan left ${summary.count} candidates (${summary.memoryBytes} bytes)`);
+      return summary;
+    } catch (err) {
+      if (err.cancelled) {
+        console.log(`${refine ? 'Next' : 'First'} scan cancelled`);
+      } else {
+        console.error('Error scanning memory:', err);
+      }
+      throw err;
+    }
+  };
+
+  ipcMain.handle('first-scan', (event, pid, criteria) => runCandidateScan(event, pid, criteria, false));
+  ipcMain.handle('next-scan', (event, pid, criteria) => runCandidateScan(event, pid, criteria, true));
+
+  // A page of candidates with the values read by the last pass
+  ipcMain.handle('scan-candidates', async (_, pid, offset, count) => {
+    if (moduleError) throw moduleError;
+    const session = getSession(pid);
+    const { type } = session.candidateStats();
+    const { addresses, values } = session.candidates(offset, count);
+    return Array.from(addresses, (address, i) => formatCandidate({ address, value: values[i] }, type));
+  });
+
+  // Array-of-bytes scan, e.g. "DE AD ?? EF". The matches stay native;
+  // resolves with their handle and count and the first `limit` matches
+  // with their current bytes. Page through the rest with result-page.
+  ipcMain.handle('scan-pattern', async (event, pid, pattern, options = {}, limit = 100) => {
+    if (moduleError) throw moduleError;
+    const session = getSession(pid);
+    try {
+      const { handle, count } = await session.scanPattern(pattern, {
+        aligned: options.aligned,
+        byteSwap: options.byteSwap,
+        n64: options.n64,
+        regions: options.regions,
+        store: true,
+        onProgress: progressForwarder(event, pid)
+      });
+      console.log(`Found ${count} matches for pattern ${pattern}`);
+
+      resultFormats.set(resultKey(pid, handle), (s, addresses) => formatPatternMatches(s, addresses, pattern, options));
+      const { rows } = pageResults(session, pid, handle, 0, limit);
+      return { handle, count, results: rows };
+    } catch (err) {
+      if (err.cancelled) {
+        console.log(`Pattern scan for ${pattern} cancelled`);
+      } else {
+        console.error('Error scanning memory:', err);
+      }
+      throw err;
+    }
+  });
+
+  // Keeps the narrowing scan's candidates as stored results, or null
+  // before the first pass. Later passes narrow the same handle.
+  ipcMain.handle('store-candidates', async (_, pid) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).storeCandidates();
+  });
+
+  // A page of stored results as { total, rows }. query is { start, end,
+  // min, max, sort: 'address'|'value', descending }; total counts the rows
+  // it selects. Only the page is read or formatted.
+  ipcMain.handle('result-page', async (_, pid, handle, offset, count, query) => {
+    if (moduleError) throw moduleError;
+    return pageResults(getSession(pid), pid, handle, offset, count, query);
+  });
+
+  ipcMain.handle('result-count', async (_, pid, handle, query) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).resultCount(handle, query);
+  });
+
+  ipcMain.handle('release-results', async (_, pid, handle) => {
+    if (moduleError) throw moduleError;
+    resultFormats.delete(resultKey(pid, handle));
+    const session = sessions.get(pid);
+    return session ? session.releaseResults(handle) : false;
+  });
+
+  ipcMain.handle('reset-scan', async (_, pid) => {
+    if (moduleError) throw moduleError;
+    const session = sessions.get(pid);
+    if (session) {
+      session.resetScan();
+    }
+  });
+
+  ipcMain.handle('cancel-scan', async (_, pid) => {
+    if (moduleError) throw moduleError;
+    const session = sessions.get(pid);
+    if (session) {
+      session.cancelScan();
+    }
+  });
+
+  // Options: { cached } serves the read from the session's page cache
+  ipcMain.handle('read-memory', async (_, pid, address, size, options = {}) => {
+    if (moduleError) throw moduleError;
+    try {
+      return getSession(pid).read(address, size, options);
     } catch (err) {
       console.error('Error reading memory:', err);
       throw err;
     }
   });
 
+  // Batched read: ranges are (address, size) pairs; resolves with
+  // { buffer, offsets, lengths, status, complete }
+  ipcMain.handle('read-memory-batch', async (_, pid, ranges) => {
+    if (moduleError) throw moduleError;
+    try {
+      return getSession(pid).readBatch(ranges);
+    } catch (err) {
+      console.error('Error reading memory batch:', err);
+      throw err;
+    }
+  });
+
   // Memory writing function
   ipcMain.handle('write-memory', async (_, pid, address, buffer) => {
     if (moduleError) throw moduleError;
@@ -156,7 +468,7 @@ function setupIpcHandlers() {
       console.log(`Writing memory: PID=${pid}, Address=0x${address.toString(16).toUpperCase()}, Size=${buffer.length}`);
       console.log(`Buffer contents: ${Array.from(buffer).map(b => b.toString(16).padStart(2, '0')).join(' ')}`);
       
-      const success = SFNative.writeMemory(pid, address, buffer);
+      const success = getSession(pid).write(address, buffer);
       
       if (success) {
         console.log(`Successfully wrote ${buffer.length} bytes to address 0x${address.toString(16).toUpperCase()}`);
@@ -171,45 +483,269 @@ function setupIpcHandlers() {
     }
   });
 
-  // Read memory and display value
-  ipcMain.handle('read-memory-as-array', async (_, pid, address, size) => {
+  // The session's cached region map, optionally filtered by { writable,
+  // private, module, start, end, minSize, maxSize }
+  ipcMain.handle('memory-regions', async (_, pid, filter) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).regions(filter);
+  });
+
+  // Re-enumerates [start, end) or the whole map; resolves with what changed
+  ipcMain.handle('refresh-regions', async (_, pid, start, end) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).refreshRegions(start, end);
+  });
+
+  // Memory snapshots: take() streams the selected regions (or RDRAM alone
+  // with n64) to disk; diffs compare a snapshot with live memory or with a
+  // later snapshot without rereading the game
+  ipcMain.handle('take-snapshot', async (event, pid, name, options = {}) => {
+    if (moduleError) throw moduleError;
+    const file = snapshotPath(name);
+    await fs.promises.mkdir(path.dirname(file), { recursive: true });
+    try {
+      const stats = await getSession(pid).snapshot(file, {
+        regions: options.regions,
+        n64: options.n64,
+        onProgress: progressForwarder(event, pid)
+      });
+      console.log(`Snapshot ${name}: ${stats.pages} pages in ${stats.fileSize} bytes`);
+      return { name, ...stats };
+    } catch (err) {
+      if (!err.cancelled) {
+        console.error('Error taking snapshot:', err);
+      }
+      throw err;
+    }
+  });
+
+  ipcMain.handle('list-snapshots', async () => {
+    const dir = path.dirname(snapshotPath('_'));
+    const files = await fs.promises.readdir(dir).catch(() => []);
+    const snapshots = [];
+    for (const file of files.filter((f) => f.endsWith('.sfsnap'))) {
+      const { size, mtimeMs } = await fs.promises.stat(path.join(dir, file));
+      snapshots.push({ name: path.basename(file, '.sfsnap'), size, created: mtimeMs });
+    }
+    return snapshots.sort((a, b) => a.created - b.created);
+  });
+
+  // Compares snapshot `name` (before) with the live process (after)
+  ipcMain.handle('diff-snapshot', async (event, pid, name, options = {}, limit = 100) => {
+    if (moduleError) throw moduleError;
+    const diff = await getSession(pid).diff(snapshotPath(name), {
+      granularity: options.granularity,
+      maxChanges: options.maxChanges,
+      onProgress: progressForwarder(event, pid)
+    });
+    return formatDiff(diff, limit);
+  });
+
+  // Compares two snapshots; pages with matching hashes are never read
+  ipcMain.handle('diff-snapshots', async (_, before, after, options = {}, limit = 100) => {
+    if (moduleError) throw moduleError;
+    const session = SFNative.openSnapshot(snapshotPath(after));
+    try {
+      const diff = await session.diff(snapshotPath(before), {
+        granularity: options.granularity,
+        maxChanges: options.maxChanges
+      });
+      return formatDiff(diff, limit);
+    } finally {
+      session.detach();
+    }
+  });
+
+  // Pointer chains from static module memory to `target`, so a found value
+  // can be located again after the game restarts. Options are { maxDepth,
+  // maxOffset, maxResults, regions }; progress covers indexing the pointers.
+  ipcMain.handle('pointer-scan', async (event, pid, target, options = {}) => {
+    if (moduleError) throw moduleError;
+    try {
+      const result = await getSession(pid).pointerScan(target, {
+        maxDepth: options.maxDepth,
+        maxOffset: options.maxOffset,
+        maxResults: options.maxResults,
+        regions: options.regions,
+        onProgress: progressForwarder(event, pid)
+      });
+      console.log(`Found ${result.chains.length} pointer chains to 0x${target.toString(16)} ` +
+        `among ${result.pointers} pointers${result.truncated ? ' (truncated)' : ''}`);
+      return result;
+    } catch (err) {
+      if (err.cancelled) {
+        console.log('Pointer scan cancelled');
+      } else {
+        console.error('Error scanning pointers:', err);
+      }
+      throw err;
+    }
+  });
+
+  // Addresses the chains lead to right now, 0 for broken chains
+  ipcMain.handle('resolve-pointers', async (_, pid, chains) => {
+    if (moduleError) throw moduleError;
+    return Array.from(getSession(pid).resolvePointers(chains));
+  });
+
+  // Emulated N64 memory. Addresses are N64 ones (0x80xxxxxx) and bytes are
+  // in N64 (big-endian) order; the native side finds RDRAM in the emulator
+  // and undoes its word swapping.
+  ipcMain.handle('rdram-locate', async (_, pid, refresh = false) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).locateRdram(refresh);
+  });
+
+  ipcMain.handle('read-n64', async (_, pid, address, size, options = {}) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).readN64(address, size, options);
+  });
+
+  ipcMain.handle('write-n64', async (_, pid, address, bytes) => {
+    if (moduleError) throw moduleError;
+    try {
+      return getSession(pid).writeN64(address, bytes);
+    } catch (err) {
+      console.error(`Error writing N64 memory: ${err.message}`);
+      throw err;
+    }
+  });
+
+  // Struct schemas: { size, endian, fields: [{ name, offset, type, count,
+  // endian, struct }] }. Registering a name again replaces its layout.
+  ipcMain.handle('define-struct', async (_, name, schema) => {
+    if (moduleError) throw moduleError;
+    const layout = SFNative.defineStruct(schema);
+    structLayouts.set(name, layout);
+    return layout.size;
+  });
+
+  // Options: { n64 } for N64 addresses, plus { stride, columns } when
+  // reading several instances
+  ipcMain.handle('read-struct', async (_, pid, name, address, options = {}) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).readStruct(getStructLayout(name), address, options);
+  });
+
+  ipcMain.handle('read-structs', async (_, pid, name, address, count, options = {}) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).readStructs(getStructLayout(name), address, count, options);
+  });
+
+  ipcMain.handle('write-struct', async (_, pid, name, address, values, options = {}) => {
+    if (moduleError) throw moduleError;
+    try {
+      return getSession(pid).writeStruct(getStructLayout(name), address, values, options);
+    } catch (err) {
+      console.error(`Error writing struct ${name}: ${err.message}`);
+      throw err;
+    }
+  });
+
+  // Host address of a 1, 2 or 4 byte N64 value, for freezes and watches
+  ipcMain.handle('n64-to-host', async (_, pid, address, size = 4) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).n64ToHost(address, size);
+  });
+
+  // Value freezing: a native thread rewrites the bytes at the requested
+  // rate (default 60 Hz), so holding values costs no IPC or JS timers
+  ipcMain.handle('freeze-value', async (_, pid, address, bytes, options = {}) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).freeze(address, bytes, options);
+  });
+
+  ipcMain.handle('unfreeze-value', async (_, pid, id) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).unfreeze(id);
+  });
+
+  ipcMain.handle('freeze-stats', async (_, pid) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).freezeStats();
+  });
+
+  // Watch list: a native thread samples every watch once per tick and
+  // pushes only the values that changed to the renderer that started it
+  ipcMain.handle('watch-start', async (event, pid, options = {}) => {
+    if (moduleError) throw moduleError;
+    const sender = event.sender;
+    getSession(pid).startWatching((changes) => {
+      if (!sender.isDestroyed()) {
+        sender.send('watch-changes', { pid, changes });
+      }
+    }, options);
+  });
+
+  ipcMain.handle('watch-stop', async (_, pid) => {
+    if (moduleError) throw moduleError;
+    getSession(pid).stopWatching();
+  });
+
+  ipcMain.handle('watch-add', async (_, pid, address, type, options = {}) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).addWatch(address, type, options);
+  });
+
+  ipcMain.handle('watch-remove', async (_, pid, id) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).removeWatch(id);
+  });
+
+  ipcMain.handle('watch-stats', async (_, pid) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).watchStats();
+  });
+
+  // Process-wide native counters: syscalls, bytes moved, failures by
+  // error code, scan throughput and latency histograms
+  ipcMain.handle('native-stats', async () => {
+    if (moduleError) throw moduleError;
+    return SFNative.getStats();
+  });
+
+  // Page cache behind cached reads: { capacity (pages), ttlMs, prefetch }.
+  // Writes made through the session keep it current.
+  ipcMain.handle('cache-stats', async (_, pid) => {
+    if (moduleError) throw moduleError;
+    return getSession(pid).cacheStats();
+  });
+
+  ipcMain.handle('configure-cache', async (_, pid, options) => {
+    if (moduleError) throw moduleError;
+    getSession(pid).configureCache(options);
+  });
+
+  // Read memory and display value. Write verifications read the target
+  // directly, since the page cache would only echo back the bytes just
+  // written; display-only callers that re-read the same bytes pass
+  // { cached: true }.
+  ipcMain.handle('read-memory-as-array', async (_, pid, address, size, options = {}) => {
     if (moduleError) throw moduleError;
     try {
       console.log(`Reading memory as array: PID=${pid}, Address=0x${address.toString(16).toUpperCase()}, Size=${size}`);
-      const byteArray = SFNative.readMemoryAsArray(pid, address, size);
+      const byteArray = getSession(pid).read(address, size, options);
       
       if (byteArray && byteArray.length >= 4) {
-        // Convert to array buffer for reading values
-        const buffer = new ArrayBuffer(byteArray.length);
-        const view = new Uint8Array(buffer);
-        
-        for (let i = 0; i < byteArray.length; i++) {
-          view[i] = byteArray[i];
-        }
-        
-        const dataView = new DataView(buffer);
+        const views = getValueViews();
+        const wide = byteArray.length >= 8;
+        const values = (wide ? views.wide : views.narrow).decode(byteArray);
         
         // Display values in different formats
         const valueInfo = {
           address: `0x${address.toString(16).toUpperCase()}`,
           rawBytes: Array.from(byteArray).map(b => b.toString(16).padStart(2, '0')).join(' '),
-          asInt32: dataView.getInt32(0, true),
-          asUint32: dataView.getUint32(0, true),
-          hexUint32: `0x${dataView.getUint32(0, true).toString(16).toUpperCase()}`
+          asInt32: values.asInt32,
+          asUint32: values.asUint32,
+          hexUint32: `0x${values.asUint32.toString(16).toUpperCase()}`,
+          asFloat: values.asFloat
         };
         
-        if (byteArray.length >= 8) {
-          valueInfo.asInt64 = Number(dataView.getBigInt64(0, true));
-          valueInfo.asUint64 = Number(dataView.getBigUint64(0, true));
-          valueInfo.hexUint64 = `0x${dataView.getBigUint64(0, true).toString(16).toUpperCase()}`;
-        }
-        
-        if (byteArray.length >= 4) {
-          valueInfo.asFloat = dataView.getFloat32(0, true);
-        }
-        
-        if (byteArray.length >= 8) {
-          valueInfo.asDouble = dataView.getFloat64(0, true);
+        if (wide) {
+          valueInfo.asInt64 = Number(values.asInt64);
+          valueInfo.asUint64 = Number(values.asUint64);
+          valueInfo.hexUint64 = `0x${values.asUint64.toString(16).toUpperCase()}`;
+          valueInfo.asDouble = values.asDouble;
         }
         
         console.log('Memory read result:', valueInfo);
@@ -227,6 +763,13 @@ function setupIpcHandlers() {
   });
 }
 
+app.on('will-quit', () => {
+  if (processWatch) {
+    processWatch.stop();
+    processWatch = null;
+  }
+});
+
 // Quit when all windows are closed, except on macOS. There, it's common
 // for applications and their menu bar to stay active until the user quits
 // explicitly with Cmd + Q.
@@ -7,10 +7,103 @@ const { contextBridge, ipcRenderer } = require('electron');
 contextBridge.exposeInMainWorld('sfAPI', {
   // Process functions
   listProcesses: () => ipcRenderer.invoke('list-processes'),
+  // Running emulators: [{ pid, name, path, bits, modules }]
+  getWatchedProcesses: () => ipcRenderer.invoke('watched-processes'),
+  // Subscribes to emulator start/exit events, delivered in batches of
+  // { type: 'start' | 'exit', pid, name, path, bits, modules }; returns an
+  // unsubscribe function
+  onProcessEvents: (callback) => {
+    const listener = (_, events) => callback(events);
+    ipcRenderer.on('process-events', listener);
+    return () => ipcRenderer.removeListener('process-events', listener);
+  },
   
   // Memory functions
-  scanMemory: (pid, value) => ipcRenderer.invoke('scan-memory', pid, value),
-  readMemory: (pid, address, size) => ipcRenderer.invoke('read-memory', pid, address, size),
-  readMemoryAsArray: (pid, address, size) => ipcRenderer.invoke('read-memory-as-array', pid, address, size),
-  writeMemory: (pid, address, buffer) => ipcRenderer.invoke('write-memory', pid, address, buffer)
+  // regions narrows every scan: { writable, private, module, start, end,
+  // minSize, maxSize }. firstScan takes it in the criteria.
+  // Resolves with { handle, count, results } holding the first `limit` rows
+  scanMemory: (pid, value, regions, limit) => ipcRenderer.invoke('scan-memory', pid, value, regions, limit),
+  cancelScan: (pid) => ipcRenderer.invoke('cancel-scan', pid),
+  // Narrowing scan: firstScan, then nextScan until few candidates remain
+  firstScan: (pid, criteria) => ipcRenderer.invoke('first-scan', pid, criteria),
+  nextScan: (pid, criteria) => ipcRenderer.invoke('next-scan', pid, criteria),
+  getScanCandidates: (pid, offset, count) => ipcRenderer.invoke('scan-candidates', pid, offset, count),
+  // Array-of-bytes scan; options are { aligned, byteSwap, n64, regions }.
+  // Resolves with { handle, count, results } holding the first `limit` rows.
+  scanPattern: (pid, pattern, options, limit) => ipcRenderer.invoke('scan-pattern', pid, pattern, options, limit),
+  // Stored results are paged by handle: storeCandidates keeps the narrowing
+  // scan's candidates, getResultPage returns { total, rows } for a query
+  // { start, end, min, max, sort: 'address'|'value', descending }, and
+  // releaseResults frees them
+  storeCandidates: (pid) => ipcRenderer.invoke('store-candidates', pid),
+  getResultPage: (pid, handle, offset, count, query) =>
+    ipcRenderer.invoke('result-page', pid, handle, offset, count, query),
+  getResultCount: (pid, handle, query) => ipcRenderer.invoke('result-count', pid, handle, query),
+  releaseResults: (pid, handle) => ipcRenderer.invoke('release-results', pid, handle),
+  resetScan: (pid) => ipcRenderer.invoke('reset-scan', pid),
+  // Subscribes to scan progress events; returns an unsubscribe function
+  onScanProgress: (callback) => {
+    const listener = (_, progress) => callback(progress);
+    ipcRenderer.on('scan-progress', listener);
+    return () => ipcRenderer.removeListener('scan-progress', listener);
+  },
+  // Options: { cached } reads through the session's page cache, which
+  // writes made through the app keep current
+  readMemory: (pid, address, size, options) => ipcRenderer.invoke('read-memory', pid, address, size, options),
+  readMemoryAsArray: (pid, address, size, options) =>
+    ipcRenderer.invoke('read-memory-as-array', pid, address, size, options),
+  readMemoryBatch: (pid, ranges) => ipcRenderer.invoke('read-memory-batch', pid, ranges),
+  writeMemory: (pid, address, buffer) => ipcRenderer.invoke('write-memory', pid, address, buffer),
+  getRegions: (pid, filter) => ipcRenderer.invoke('memory-regions', pid, filter),
+  refreshRegions: (pid, start, end) => ipcRenderer.invoke('refresh-regions', pid, start, end),
+  // Snapshots are named files in the app's data directory. Diffs resolve
+  // with { count, changes: [{ address, hexAddress, size }], pagesChanged,
+  // bytesChanged, pagesUnreadable, truncated, n64 }; options are
+  // { granularity, maxChanges }.
+  takeSnapshot: (pid, name, options) => ipcRenderer.invoke('take-snapshot', pid, name, options),
+  listSnapshots: () => ipcRenderer.invoke('list-snapshots'),
+  diffSnapshot: (pid, name, options, limit) => ipcRenderer.invoke('diff-snapshot', pid, name, options, limit),
+  diffSnapshots: (before, after, options, limit) => ipcRenderer.invoke('diff-snapshots', before, after, options, limit),
+  // Resolves with { chains: [{ module, baseOffset, offsets }], pointers,
+  // truncated }; reports progress through onScanProgress
+  pointerScan: (pid, target, options) => ipcRenderer.invoke('pointer-scan', pid, target, options),
+  resolvePointers: (pid, chains) => ipcRenderer.invoke('resolve-pointers', pid, chains),
+  // N64 memory inside the emulator: N64 addresses, big-endian bytes.
+  // locateRdram resolves with { base, size } or null before a game runs.
+  locateRdram: (pid, refresh) => ipcRenderer.invoke('rdram-locate', pid, refresh),
+  readN64: (pid, address, size, options) => ipcRenderer.invoke('read-n64', pid, address, size, options),
+  writeN64: (pid, address, bytes) => ipcRenderer.invoke('write-n64', pid, address, bytes),
+  n64ToHost: (pid, address, size) => ipcRenderer.invoke('n64-to-host', pid, address, size),
+  // Structs: defineStruct(name, schema) compiles a layout once, then reads
+  // and writes refer to it by name. Options take { n64 } for N64 addresses;
+  // readStructs also { stride, columns }. writeStruct writes only the
+  // fields present in `values`.
+  defineStruct: (name, schema) => ipcRenderer.invoke('define-struct', name, schema),
+  readStruct: (pid, name, address, options) => ipcRenderer.invoke('read-struct', pid, name, address, options),
+  readStructs: (pid, name, address, count, options) =>
+    ipcRenderer.invoke('read-structs', pid, name, address, count, options),
+  writeStruct: (pid, name, address, values, options) =>
+    ipcRenderer.invoke('write-struct', pid, name, address, values, options),
+  // Keeps `bytes` written at `address`; options are { intervalMs, onChange }.
+  // Resolves with an id for unfreezeValue.
+  freezeValue: (pid, address, bytes, options) => ipcRenderer.invoke('freeze-value', pid, address, bytes, options),
+  unfreezeValue: (pid, id) => ipcRenderer.invoke('unfreeze-value', pid, id),
+  getFreezeStats: (pid) => ipcRenderer.invoke('freeze-stats', pid),
+  // Page cache: configureCache(pid, { capacity, ttlMs, prefetch })
+  getCacheStats: (pid) => ipcRenderer.invoke('cache-stats', pid),
+  configureCache: (pid, options) => ipcRenderer.invoke('configure-cache', pid, options),
+  // Watches: startWatching(pid, { intervalMs }) begins ticking, addWatch
+  // takes (pid, address, type, { threshold, byteSwap }) and resolves with an id
+  startWatching: (pid, options) => ipcRenderer.invoke('watch-start', pid, options),
+  stopWatching: (pid) => ipcRenderer.invoke('watch-stop', pid),
+  addWatch: (pid, address, type, options) => ipcRenderer.invoke('watch-add', pid, address, type, options),
+  removeWatch: (pid, id) => ipcRenderer.invoke('watch-remove', pid, id),
+  getWatchStats: (pid) => ipcRenderer.invoke('watch-stats', pid),
+  // Subscribes to { pid, changes: [{ id, value }] }; returns an unsubscribe function
+  onWatchChanges: (callback) => {
+    const listener = (_, update) => callback(update);
+    ipcRenderer.on('watch-changes', listener);
+    return () => ipcRenderer.removeListener('watch-changes', listener);
+  },
+  getNativeStats: () => ipcRenderer.invoke('native-stats')
 });
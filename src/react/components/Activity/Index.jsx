@@ -1,17 +1,109 @@
-import React, { useState } from 'react';
+import React, { useState, useEffect, useRef } from 'react';
+import { useAppContext } from '../../context/AppContext';
+
+// N64 address of the item spawn slot written by the item table: id, then
+// x/y/z floats
+const ITEM_SLOT_ADDRESS = 0x802E6B64;
+const ITEM_FIELDS = [
+  { field: 'id', offset: 0, type: 'int32' },
+  // Positions jitter while items settle; ignore sub-unit moves
+  { field: 'x', offset: 4, type: 'float32', threshold: 1 },
+  { field: 'y', offset: 8, type: 'float32', threshold: 1 },
+  { field: 'z', offset: 12, type: 'float32', threshold: 1 },
+];
+
+const ITEMS = {
+  0: { name: 'Box', icon: '📦' },
+  1: { name: 'Barrel', icon: '🛢️' },
+  2: { name: 'Capsule', icon: '💊' },
+  3: { name: 'Egg', icon: '🥚' },
+  4: { name: 'Maxim Tomato', icon: '🍅' },
+  5: { name: 'Heart Container', icon: '❤️' },
+  6: { name: 'Star Man', icon: '⭐' },
+  7: { name: 'Beam Sword', icon: '⚔️' },
+};
 
 const Activity = () => {
-  // Sample activity data
-  const [activities, setActivities] = useState([
-    { id: 1, timestamp: '2023-04-27 15:32:45', itemName: 'Bob-omb', icon: '💣', coordinates: { x: 120, y: 450, z: 0 }, status: 'success' },
-    { id: 2, timestamp: '2023-04-27 15:30:21', itemName: 'Star', icon: '⭐', coordinates: { x: 300, y: 200, z: 0 }, status: 'success' },
-    { id: 3, timestamp: '2023-04-27 15:28:12', itemName: 'Heart Container', icon: '❤️', coordinates: { x: 400, y: 250, z: 0 }, status: 'success' },
-    { id: 4, timestamp: '2023-04-27 15:25:33', itemName: 'Ray Gun', icon: '🔫', coordinates: { x: 150, y: 320, z: 0 }, status: 'success' },
-    { id: 5, timestamp: '2023-04-27 15:22:17', itemName: 'Beam Sword', icon: '⚔️', coordinates: { x: 280, y: 380, z: 0 }, status: 'failed' },
-    { id: 6, timestamp: '2023-04-27 15:20:05', itemName: 'Motion Sensor Bomb', icon: '💥', coordinates: { x: 220, y: 190, z: 0 }, status: 'success' },
-    { id: 7, timestamp: '2023-04-27 15:18:52', itemName: 'Maxim Tomato', icon: '🍅', coordinates: { x: 350, y: 270, z: 0 }, status: 'success' },
-    { id: 8, timestamp: '2023-04-27 15:15:11', itemName: 'Home Run Bat', icon: '🏏', coordinates: { x: 180, y: 300, z: 0 }, status: 'failed' },
-  ]);
+  const { pj64Pid } = useAppContext();
+  const [activities, setActivities] = useState([]);
+  // Latest value of every watched field, kept outside state so the
+  // watch callback always sees the current slot
+  const slotRef = useRef({});
+
+  // Track the spawn slot with native watches; the main process only hears
+  // about fields that actually changed
+  useEffect(() => {
+    if (!pj64Pid) {
+      return undefined;
+    }
+
+    let cancelled = false;
+    const fieldsById = {};
+    slotRef.current = {};
+
+    const unsubscribe = window.sfAPI.onWatchChanges(({ pid, changes }) => {
+      if (pid !== pj64Pid) return;
+      const slot = slotRef.current;
+      let spawned = false;
+      changes.forEach(({ id, value }) => {
+        const field = fieldsById[id];
+        if (!field) return;
+        // The first report is whatever already sits in the slot
+        if (field === 'id' && slot.id !== undefined && value !== slot.id) spawned = true;
+        slot[field] = value;
+      });
+
+      const coordinates = {
+        x: Math.round(slot.x ?? 0),
+        y: Math.round(slot.y ?? 0),
+        z: Math.round(slot.z ?? 0),
+      };
+      const readable = slot.id !== null && slot.id !== undefined;
+      setActivities((prev) => {
+        if (spawned) {
+          const item = ITEMS[slot.id] || { name: readable ? `Item ${slot.id}` : 'Unknown', icon: '❔' };
+          return [{
+            id: Date.now(),
+            timestamp: new Date().toLocaleString(),
+            itemName: item.name,
+            icon: item.icon,
+            coordinates,
+            status: readable ? 'success' : 'failed',
+          }, ...prev];
+        }
+        // The newest item keeps following its position
+        if (prev.length === 0) return prev;
+        return [{ ...prev[0], coordinates }, ...prev.slice(1)];
+      });
+    });
+
+    const start = async () => {
+      try {
+        await window.sfAPI.startWatching(pj64Pid, { intervalMs: 1000 / 60 });
+        for (const { field, offset, type, threshold } of ITEM_FIELDS) {
+          // Whole words sit in RDRAM in host order, so the watch reads
+          // them natively at their host address
+          const address = await window.sfAPI.n64ToHost(pj64Pid, ITEM_SLOT_ADDRESS + offset, 4);
+          const id = await window.sfAPI.addWatch(pj64Pid, address, type, { threshold });
+          if (cancelled) {
+            window.sfAPI.removeWatch(pj64Pid, id);
+            return;
+          }
+          fieldsById[id] = field;
+        }
+      } catch (error) {
+        console.error('Error watching item slot:', error);
+      }
+    };
+    start();
+
+    return () => {
+      cancelled = true;
+      unsubscribe();
+      Object.keys(fieldsById).forEach((id) => window.sfAPI.removeWatch(pj64Pid, Number(id)).catch(() => {}));
+      window.sfAPI.stopWatching(pj64Pid).catch(() => {});
+    };
+  }, [pj64Pid]);
 
   // Function to clear activity log
   const clearActivityLog = () => {
@@ -75,7 +167,7 @@ const Activity = () => {
       </div>
 
       <div className="mt-4 text-gray-400 text-sm">
-        <p>Shows history of item spawns and their status.</p>
+        <p>Live history of item spawns, tracked from the item slot at 60 Hz.</p>
       </div>
     </div>
   );
@@ -8,32 +8,31 @@ const Debugger = () => {
   const [pj64Process, setPj64Process] = useState(null);
   
   useEffect(() => {
+    // The main process watches for Project64 starting and exiting
+    const unsubscribe = window.sfAPI.onProcessEvents((events) => {
+      for (const event of events) {
+        if (event.type === 'start') {
+          console.log('Project64 detected:', event);
+          setPj64Process(current => current || event);
+        } else {
+          setPj64Process(current => (current && current.pid === event.pid ? null : current));
+        }
+      }
+    });
+
     // Detect Project64 process on component mount
-    const detectPj64Process = async () => {
-      try {
-        const processes = await window.sfAPI.listProcesses();
-        const pj64 = processes.find(p => 
-          p.name.toLowerCase().includes('project64') || 
-          p.name.toLowerCase().includes('pj64')
-        );
-        
-        if (pj64) {
-          console.log('Project64 detected:', pj64);
-          setPj64Process(pj64);
+    window.sfAPI.getWatchedProcesses()
+      .then((processes) => {
+        if (processes.length > 0) {
+          console.log('Project64 detected:', processes[0]);
+          setPj64Process(current => current || processes[0]);
         } else {
           console.log('Project64 not detected');
         }
-      } catch (error) {
-        console.error('Error detecting processes:', error);
-      }
-    };
-    
-    detectPj64Process();
-    
-    // Poll for Project64 process every 5 seconds
-    const interval = setInterval(detectPj64Process, 5000);
-    
-    return () => clearInterval(interval);
+      })
+      .catch(error => console.error('Error detecting processes:', error));
+
+    return unsubscribe;
   }, []);
 
   return (
@@ -1,4 +1,4 @@
-import React, { useState } from 'react';
+import React, { useState, useEffect } from 'react';
 
 const MemoryEditor = ({ pid }) => {
   const [address, setAddress] = useState('');
@@ -6,6 +6,32 @@ const MemoryEditor = ({ pid }) => {
   const [valueType, setValueType] = useState('int32');
   const [writeResult, setWriteResult] = useState('');
   const [isWriting, setIsWriting] = useState(false);
+  // Keep rewriting the value natively after the first write
+  const [hold, setHold] = useState(false);
+  const [heldValues, setHeldValues] = useState([]);
+  const [freezeStats, setFreezeStats] = useState(null);
+
+  // Poll the freeze engine's stats while this target has held values
+  const heldForPid = heldValues.filter((entry) => entry.pid === pid);
+  useEffect(() => {
+    if (!pid || heldForPid.length === 0) {
+      setFreezeStats(null);
+      return undefined;
+    }
+    const update = () => window.sfAPI.getFreezeStats(pid).then(setFreezeStats).catch(() => setFreezeStats(null));
+    update();
+    const interval = setInterval(update, 1000);
+    return () => clearInterval(interval);
+  }, [pid, heldForPid.length]);
+
+  const releaseValue = async (entry) => {
+    try {
+      await window.sfAPI.unfreezeValue(entry.pid, entry.id);
+    } catch (error) {
+      console.error('Error releasing value:', error);
+    }
+    setHeldValues((prev) => prev.filter((other) => other !== entry));
+  };
 
   const handleAddressChange = (e) => {
     setAddress(e.target.value);
@@ -118,16 +144,18 @@ const MemoryEditor = ({ pid }) => {
       
       if (success) {
         setWriteResult(`Successfully wrote ${valueType} value to ${address}`);
+
+        if (hold) {
+          const id = await window.sfAPI.freezeValue(pid, addressValue, byteArray);
+          setHeldValues((prev) => [...prev, { id, pid, address, value, valueType }]);
+        }
         
-        // Optionally read back the value to confirm
-        const readBuffer = await window.sfAPI.readMemoryAsArray(pid, addressValue, buffer.byteLength);
+        // Read back the value to confirm. This bypasses the page cache, which
+        // holds the bytes just written and would hide an overwrite by the game.
+        const readBuffer = await window.sfAPI.readMemory(pid, addressValue, buffer.byteLength);
         if (readBuffer && readBuffer.length === buffer.byteLength) {
           let readValue;
-          const readView = new DataView(new ArrayBuffer(buffer.byteLength));
-          
-          for (let i = 0; i < buffer.byteLength; i++) {
-            readView.setUint8(i, readBuffer[i]);
-          }
+          const readView = new DataView(readBuffer.buffer, readBuffer.byteOffset, readBuffer.byteLength);
           
           switch (valueType) {
             case 'int32':
@@ -212,7 +240,31 @@ const MemoryEditor = ({ pid }) => {
       >
         {isWriting ? "Writing..." : "Write to Memory"}
       </button>
+      <label className="hold-option">
+        <input
+          type="checkbox"
+          checked={hold}
+          onChange={(e) => setHold(e.target.checked)}
+        />
+        Hold value (rewrite at 60 Hz)
+      </label>
       <div className="write-result">{writeResult}</div>
+      {heldForPid.length > 0 && (
+        <div className="held-values">
+          <h4>
+            Held values
+            {freezeStats && ` (${Math.round(freezeStats.writesPerSecond)} writes/s, ${freezeStats.missed} missed)`}
+          </h4>
+          <ul>
+            {heldForPid.map((entry) => (
+              <li key={entry.id}>
+                {entry.address} = {entry.value} ({entry.valueType})
+                <button className="release-button" onClick={() => releaseValue(entry)}>Release</button>
+              </li>
+            ))}
+          </ul>
+        </div>
+      )}
     </div>
   );
 };
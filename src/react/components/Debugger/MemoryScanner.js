@@ -1,88 +1,566 @@
-import React, { useState } from 'react';
+import React, { useState, useEffect, useRef } from 'react';
+
+// Formats a byte count as a short human-readable string
+const formatBytes = (bytes) => {
+  if (bytes >= 1024 * 1024 * 1024) return `${(bytes / (1024 * 1024 * 1024)).toFixed(2)} GB`;
+  if (bytes >= 1024 * 1024) return `${(bytes / (1024 * 1024)).toFixed(1)} MB`;
+  return `${Math.round(bytes / 1024)} KB`;
+};
+
+// Rows fetched per page of results; the rest stay in the native session
+const RESULTS_SHOWN = 100;
+
+// Orders a page of results can be viewed in
+const RESULT_ORDERS = [
+  { order: 'address', label: 'Address' },
+  { order: 'valueAsc', label: 'Value (lowest first)' },
+  { order: 'valueDesc', label: 'Value (highest first)' }
+];
+
+// Comparisons offered for each pass. Relative ones compare against the
+// value read by the previous pass, so they only apply to a next scan.
+const SCAN_MODES = [
+  { mode: 'equal', label: 'Exact value', operand: 'value', first: true },
+  { mode: 'notEqual', label: 'Not equal to', operand: 'value', first: true },
+  { mode: 'range', label: 'Between', operand: 'range', first: true },
+  { mode: 'unknown', label: 'Unknown initial value', operand: null, first: true, next: false },
+  { mode: 'changed', label: 'Changed', operand: null },
+  { mode: 'unchanged', label: 'Unchanged', operand: null },
+  { mode: 'increased', label: 'Increased', operand: null },
+  { mode: 'decreased', label: 'Decreased', operand: null },
+  { mode: 'increasedBy', label: 'Increased by', operand: 'value' },
+  { mode: 'decreasedBy', label: 'Decreased by', operand: 'value' }
+];
+
+// Value types the native scanner understands, plus array-of-bytes patterns
+const VALUE_TYPES = [
+  { type: 'int8', label: '1 byte' },
+  { type: 'int16', label: '2 bytes' },
+  { type: 'int32', label: '4 bytes' },
+  { type: 'int64', label: '8 bytes' },
+  { type: 'uint8', label: '1 byte (unsigned)' },
+  { type: 'uint16', label: '2 bytes (unsigned)' },
+  { type: 'uint32', label: '4 bytes (unsigned)' },
+  { type: 'uint64', label: '8 bytes (unsigned)' },
+  { type: 'float32', label: 'Float' },
+  { type: 'float64', label: 'Double' },
+  { type: 'aob', label: 'Array of bytes' }
+];
+
+const isFloatType = (type) => type === 'float32' || type === 'float64';
+
+// Parses user input for `type`; 64-bit integers become BigInts so they
+// keep full precision. Returns null if the text is not a number.
+const parseValue = (text, type) => {
+  const trimmed = text.trim();
+  if (!trimmed) return null;
+  if (isFloatType(type)) {
+    const parsed = parseFloat(trimmed);
+    return Number.isNaN(parsed) ? null : parsed;
+  }
+  if (type === 'int64' || type === 'uint64') {
+    try {
+      return trimmed.startsWith('-') ? -BigInt(trimmed.slice(1)) : BigInt(trimmed);
+    } catch (e) {
+      return null;
+    }
+  }
+  const negative = trimmed.startsWith('-');
+  const digits = negative ? trimmed.slice(1) : trimmed;
+  const parsed = digits.toLowerCase().startsWith('0x') ? parseInt(digits, 16) : parseInt(digits, 10);
+  if (Number.isNaN(parsed)) return null;
+  return negative ? -parsed : parsed;
+};
 
 const MemoryScanner = ({ pid }) => {
   const [searchValue, setSearchValue] = useState('');
+  const [rangeMax, setRangeMax] = useState('');
+  const [scanMode, setScanMode] = useState('equal');
+  const [valueType, setValueType] = useState('int32');
+  const [aligned, setAligned] = useState(true);
+  const [byteSwap, setByteSwap] = useState(false);
+  // Restricts scans to the emulator's RDRAM and reports N64 addresses
+  const [n64, setN64] = useState(false);
+  // Region filters; skipping read-only and module memory shrinks a scan of
+  // a large emulator process considerably
+  const [writableOnly, setWritableOnly] = useState(false);
+  const [privateOnly, setPrivateOnly] = useState(false);
+  const [epsilon, setEpsilon] = useState('');
+  const [candidateCount, setCandidateCount] = useState(null);
   const [scanResults, setScanResults] = useState([]);
   const [isScanning, setIsScanning] = useState(false);
   const [scanStatus, setScanStatus] = useState('');
+  const [scanProgress, setScanProgress] = useState(null);
+  const [pointerChains, setPointerChains] = useState(null);
+  // Stored results being viewed, as { pid, handle }, and the page shown
+  const storedResults = useRef(null);
+  const [pageOffset, setPageOffset] = useState(0);
+  const [resultTotal, setResultTotal] = useState(0);
+  // View controls, and the query they made when last applied
+  const [resultOrder, setResultOrder] = useState('address');
+  const [filterMin, setFilterMin] = useState('');
+  const [filterMax, setFilterMax] = useState('');
+  const [filterStart, setFilterStart] = useState('');
+  const [filterEnd, setFilterEnd] = useState('');
+  const [resultQuery, setResultQuery] = useState({});
+
+  const isPattern = valueType === 'aob';
+  // Pattern scans are one-shot, so only value scans can be narrowed
+  const hasCandidates = candidateCount !== null && !isPattern;
+  const availableModes = isPattern
+    ? [{ mode: 'pattern', label: 'Pattern (e.g., DE AD ?? EF)', operand: 'pattern' }]
+    : SCAN_MODES.filter((entry) => (hasCandidates ? entry.next !== false : entry.first));
+  const currentMode = availableModes.find((entry) => entry.mode === scanMode) || availableModes[0];
+
+  // Frees the stored results being viewed, if any
+  const releaseResults = () => {
+    if (storedResults.current) {
+      const { pid: owner, handle } = storedResults.current;
+      storedResults.current = null;
+      window.sfAPI.releaseResults(owner, handle).catch(() => {});
+    }
+  };
+
+  // A new target starts a new scan
+  useEffect(() => {
+    setCandidateCount(null);
+    setScanResults([]);
+    setScanStatus('');
+    setPointerChains(null);
+    setResultQuery({});
+    return releaseResults;
+  }, [pid]);
+
+  // Listen for progress events from the native scan worker
+  useEffect(() => {
+    const unsubscribe = window.sfAPI.onScanProgress((progress) => {
+      if (progress.pid === pid) {
+        setScanProgress(progress);
+      }
+    });
+    return unsubscribe;
+  }, [pid]);
+
+  const regionFilter = () => ({ writable: writableOnly, private: privateOnly });
 
   const handleSearchValueChange = (e) => {
     setSearchValue(e.target.value);
   };
 
-  const scanMemory = async () => {
-    if (!searchValue) {
-      setScanStatus('Please enter a value to search for');
-      return;
+  // Views results stored under `handle`, releasing the previous ones
+  const keepResults = (handle) => {
+    releaseResults();
+    storedResults.current = handle ? { pid, handle } : null;
+  };
+
+  // Fetches one page of the stored results; only its rows cross to the
+  // renderer. Returns the rows the query selects.
+  const showPage = async (offset, query = resultQuery) => {
+    if (!storedResults.current) {
+      setScanResults([]);
+      setResultTotal(0);
+      return 0;
+    }
+    const { total, rows } = await window.sfAPI.getResultPage(pid, storedResults.current.handle, offset, RESULTS_SHOWN, query);
+    setScanResults(rows);
+    setResultTotal(total);
+    setPageOffset(offset);
+    return total;
+  };
+
+  // The query the view controls describe. One-shot pattern results have no
+  // recorded values, so only their address window applies.
+  const buildQuery = () => {
+    const query = {};
+    const start = parseValue(filterStart, 'uint64');
+    const end = parseValue(filterEnd, 'uint64');
+    if (start !== null) query.start = start;
+    if (end !== null) query.end = end;
+    if (!isPattern) {
+      const min = parseValue(filterMin, valueType);
+      const max = parseValue(filterMax, valueType);
+      if (min !== null) query.min = min;
+      if (max !== null) query.max = max;
+      if (resultOrder !== 'address') {
+        query.sort = 'value';
+        query.descending = resultOrder === 'valueDesc';
+      }
     }
+    return query;
+  };
+
+  const applyView = async () => {
+    const query = buildQuery();
+    setResultQuery(query);
+    try {
+      if (await showPage(0, query) === 0) {
+        setScanStatus('No results match this view');
+      }
+    } catch (error) {
+      setScanStatus(`Error: ${error.message}`);
+    }
+  };
+
+  const turnPage = async (offset) => {
+    try {
+      await showPage(offset);
+    } catch (error) {
+      setScanStatus(`Error: ${error.message}`);
+    }
+  };
 
+  const runPatternScan = async () => {
     setIsScanning(true);
     setScanStatus('Scanning memory...');
-    setScanResults([]);
+    setScanProgress(null);
 
     try {
-      // Parse the value
-      let parsedValue;
-      try {
-        if (searchValue.startsWith('0x')) {
-          parsedValue = parseInt(searchValue, 16);
-        } else {
-          parsedValue = parseInt(searchValue);
-        }
-      } catch (e) {
-        setScanStatus(`Invalid value format: ${e.message}`);
-        setIsScanning(false);
+      const { handle, count, results } = await window.sfAPI.scanPattern(pid, searchValue, { aligned, byteSwap: byteSwap && !n64, n64, regions: regionFilter() }, RESULTS_SHOWN);
+      keepResults(handle);
+      setResultQuery({});
+      setCandidateCount(count);
+      setScanResults(results);
+      setResultTotal(count);
+      setPageOffset(0);
+      setScanStatus(count > 0 ? `Found ${count} matches` : 'No matches found');
+    } catch (error) {
+      if (error.message.includes('Scan cancelled')) {
+        setScanStatus('Scan cancelled');
+      } else {
+        console.error('Error scanning memory:', error);
+        setScanStatus(`Error: ${error.message}`);
+      }
+    } finally {
+      setIsScanning(false);
+      setScanProgress(null);
+    }
+  };
+
+  // Runs a first scan when there are no candidates, else narrows them
+  const runScan = async () => {
+    if (isPattern) {
+      await runPatternScan();
+      return;
+    }
+
+    const criteria = { mode: currentMode.mode };
+    if (!hasCandidates) {
+      Object.assign(criteria, { type: valueType, aligned, byteSwap: byteSwap && !n64, n64, regions: regionFilter() });
+    }
+    if (isFloatType(valueType) && epsilon) {
+      criteria.epsilon = parseFloat(epsilon);
+    }
+    if (currentMode.operand === 'value') {
+      criteria.value = parseValue(searchValue, valueType);
+      if (criteria.value === null) {
+        setScanStatus('Please enter a value (e.g., 1234, 0xABCD or 1.5)');
+        return;
+      }
+    } else if (currentMode.operand === 'range') {
+      criteria.min = parseValue(searchValue, valueType);
+      criteria.max = parseValue(rangeMax, valueType);
+      if (criteria.min === null || criteria.max === null) {
+        setScanStatus('Please enter both ends of the range');
         return;
       }
+    }
 
-      // Perform the scan
-      const results = await window.sfAPI.scanMemory(pid, parsedValue);
-      
-      if (results && results.length > 0) {
-        setScanResults(results);
-        setScanStatus(`Found ${results.length} matches`);
-      } else {
+    setIsScanning(true);
+    setScanStatus(hasCandidates ? 'Narrowing candidates...' : 'Scanning memory...');
+    setScanProgress(null);
+
+    try {
+      const summary = hasCandidates
+        ? await window.sfAPI.nextScan(pid, criteria)
+        : await window.sfAPI.firstScan(pid, criteria);
+      setCandidateCount(summary.count);
+
+      // Stored candidates follow later passes, so a first scan's handle
+      // serves every refinement of it
+      if (!hasCandidates) {
+        const stored = await window.sfAPI.storeCandidates(pid);
+        keepResults(stored ? stored.handle : null);
+        setResultQuery({});
+      }
+      if (summary.count === 0) {
+        setScanResults([]);
+        setResultTotal(0);
         setScanStatus('No matches found');
+      } else {
+        await showPage(0, hasCandidates ? resultQuery : {});
+        setScanStatus(`${summary.count} candidates (${formatBytes(summary.memoryBytes)} of candidate storage)`);
       }
     } catch (error) {
-      console.error('Error scanning memory:', error);
-      setScanStatus(`Error: ${error.message}`);
+      if (error.message.includes('Scan cancelled')) {
+        setScanStatus('Scan cancelled');
+      } else {
+        console.error('Error scanning memory:', error);
+        setScanStatus(`Error: ${error.message}`);
+      }
     } finally {
       setIsScanning(false);
+      setScanProgress(null);
     }
   };
 
+  // Finds static pointer chains to a result, which survive game restarts
+  const findPointers = async (result) => {
+    setIsScanning(true);
+    setScanStatus(`Indexing pointers for ${result.hexAddress}...`);
+    setScanProgress(null);
+    setPointerChains(null);
+
+    try {
+      const { chains, pointers, truncated } = await window.sfAPI.pointerScan(pid, result.address, { regions: regionFilter() });
+      setPointerChains({ address: result.hexAddress, chains });
+      setScanStatus(`Found ${chains.length} pointer chains among ${pointers} pointers${truncated ? ' (search cut short)' : ''}`);
+    } catch (error) {
+      if (error.message.includes('Scan cancelled')) {
+        setScanStatus('Scan cancelled');
+      } else {
+        console.error('Error scanning pointers:', error);
+        setScanStatus(`Error: ${error.message}`);
+      }
+    } finally {
+      setIsScanning(false);
+      setScanProgress(null);
+    }
+  };
+
+  const newScan = async () => {
+    await window.sfAPI.resetScan(pid);
+    keepResults(null);
+    setResultQuery({});
+    setCandidateCount(null);
+    setScanResults([]);
+    setScanStatus('');
+    setScanMode('equal');
+  };
+
+  const cancelScan = () => {
+    window.sfAPI.cancelScan(pid);
+  };
+
   return (
     <div className="memory-scanner">
       <h3>Memory Scanner</h3>
       <div className="input-group">
-        <label htmlFor="search-value">Search Value:</label>
-        <input 
-          type="text" 
-          id="search-value" 
-          value={searchValue}
-          onChange={handleSearchValueChange}
-          placeholder="Enter value to find (e.g., 1234 or 0xABCD)" 
-        />
+        <label htmlFor="value-type">Value Type:</label>
+        <select
+          id="value-type"
+          value={valueType}
+          onChange={(e) => {
+            setValueType(e.target.value);
+            keepResults(null);
+            setResultQuery({});
+            setCandidateCount(null);
+            setScanResults([]);
+          }}
+          disabled={isScanning || hasCandidates}
+        >
+          {VALUE_TYPES.map((entry) => (
+            <option key={entry.type} value={entry.type}>{entry.label}</option>
+          ))}
+        </select>
+      </div>
+      <div className="input-group">
+        <label>
+          <input
+            type="checkbox"
+            checked={aligned}
+            onChange={(e) => setAligned(e.target.checked)}
+            disabled={isScanning || hasCandidates}
+          />
+          Aligned
+        </label>
+        <label>
+          <input
+            type="checkbox"
+            checked={byteSwap}
+            onChange={(e) => setByteSwap(e.target.checked)}
+            disabled={isScanning || hasCandidates || n64}
+          />
+          Byte-swapped (big-endian)
+        </label>
+        <label>
+          <input
+            type="checkbox"
+            checked={n64}
+            onChange={(e) => setN64(e.target.checked)}
+            disabled={isScanning || hasCandidates}
+          />
+          N64 RDRAM only
+        </label>
+      </div>
+      <div className="input-group">
+        <label>
+          <input
+            type="checkbox"
+            checked={writableOnly}
+            onChange={(e) => setWritableOnly(e.target.checked)}
+            disabled={isScanning || hasCandidates || n64}
+          />
+          Writable only
+        </label>
+        <label>
+          <input
+            type="checkbox"
+            checked={privateOnly}
+            onChange={(e) => setPrivateOnly(e.target.checked)}
+            disabled={isScanning || hasCandidates || n64}
+          />
+          Skip modules and mapped files
+        </label>
       </div>
+      <div className="input-group">
+        <label htmlFor="scan-mode">Scan Type:</label>
+        <select
+          id="scan-mode"
+          value={currentMode.mode}
+          onChange={(e) => setScanMode(e.target.value)}
+          disabled={isScanning}
+        >
+          {availableModes.map((entry) => (
+            <option key={entry.mode} value={entry.mode}>{entry.label}</option>
+          ))}
+        </select>
+      </div>
+      {currentMode.operand && (
+        <div className="input-group">
+          <label htmlFor="search-value">
+            {currentMode.operand === 'range' ? 'From:' : currentMode.operand === 'pattern' ? 'Pattern:' : 'Search Value:'}
+          </label>
+          <input 
+            type="text" 
+            id="search-value" 
+            value={searchValue}
+            onChange={handleSearchValueChange}
+            placeholder="Enter value to find (e.g., 1234 or 0xABCD)" 
+          />
+        </div>
+      )}
+      {isFloatType(valueType) && currentMode.operand && (
+        <div className="input-group">
+          <label htmlFor="scan-epsilon">Tolerance:</label>
+          <input
+            type="text"
+            id="scan-epsilon"
+            value={epsilon}
+            onChange={(e) => setEpsilon(e.target.value)}
+            placeholder="0 for an exact match (e.g., 0.01)"
+          />
+        </div>
+      )}
+      {currentMode.operand === 'range' && (
+        <div className="input-group">
+          <label htmlFor="range-max">To:</label>
+          <input
+            type="text"
+            id="range-max"
+            value={rangeMax}
+            onChange={(e) => setRangeMax(e.target.value)}
+            placeholder="Upper bound (inclusive)"
+          />
+        </div>
+      )}
       <button 
         className="scan-button" 
-        onClick={scanMemory}
-        disabled={isScanning || !searchValue || !pid}
+        onClick={runScan}
+        disabled={isScanning || !pid || (currentMode.operand && !searchValue)}
       >
-        {isScanning ? "Scanning..." : "Scan for Value"}
+        {isScanning ? "Scanning..." : isPattern ? "Scan" : hasCandidates ? "Next Scan" : "First Scan"}
       </button>
+      {hasCandidates && !isScanning && (
+        <button className="cancel-button" onClick={newScan}>
+          New Scan
+        </button>
+      )}
+      {isScanning && (
+        <button className="cancel-button" onClick={cancelScan}>
+          Cancel
+        </button>
+      )}
       <div className="scan-status">{scanStatus}</div>
+      {isScanning && scanProgress && (
+        <div className="scan-progress">
+          <progress value={scanProgress.bytesScanned} max={scanProgress.bytesTotal || 1} />
+          <div>
+            {scanProgress.regionsDone}/{scanProgress.regionsTotal} regions, {formatBytes(scanProgress.bytesScanned)} scanned,{' '}
+            {scanProgress.matches} matches, {formatBytes(scanProgress.bytesPerSecond)}/s
+          </div>
+        </div>
+      )}
+
+      {candidateCount > 0 && (
+        <div className="input-group">
+          {!isPattern && (
+            <>
+              <label htmlFor="result-order">Sort by:</label>
+              <select
+                id="result-order"
+                value={resultOrder}
+                onChange={(e) => setResultOrder(e.target.value)}
+                disabled={isScanning}
+              >
+                {RESULT_ORDERS.map((entry) => (
+                  <option key={entry.order} value={entry.order}>{entry.label}</option>
+                ))}
+              </select>
+              <input
+                type="text"
+                value={filterMin}
+                onChange={(e) => setFilterMin(e.target.value)}
+                placeholder="Min value"
+              />
+              <input
+                type="text"
+                value={filterMax}
+                onChange={(e) => setFilterMax(e.target.value)}
+                placeholder="Max value"
+              />
+            </>
+          )}
+          <input
+            type="text"
+            value={filterStart}
+            onChange={(e) => setFilterStart(e.target.value)}
+            placeholder="From address"
+          />
+          <input
+            type="text"
+            value={filterEnd}
+            onChange={(e) => setFilterEnd(e.target.value)}
+            placeholder="To address (exclusive)"
+          />
+          <button onClick={applyView} disabled={isScanning}>
+            Apply
+          </button>
+        </div>
+      )}
 
       {scanResults.length > 0 && (
         <div className="results-container">
-          <h4>Results:</h4>
+          <h4>
+            Results{resultTotal > scanResults.length ? ` ${pageOffset + 1}-${pageOffset + scanResults.length} of ${resultTotal}` : ''}
+            {resultTotal !== candidateCount ? ` (filtered from ${candidateCount})` : ''}:
+          </h4>
+          {resultTotal > RESULTS_SHOWN && (
+            <div className="input-group">
+              <button onClick={() => turnPage(Math.max(0, pageOffset - RESULTS_SHOWN))} disabled={isScanning || pageOffset === 0}>
+                Previous
+              </button>
+              <button onClick={() => turnPage(pageOffset + RESULTS_SHOWN)} disabled={isScanning || pageOffset + RESULTS_SHOWN >= resultTotal}>
+                Next
+              </button>
+            </div>
+          )}
           <table className="results-table">
             <thead>
               <tr>
                 <th>Address</th>
                 <th>Value</th>
                 <th>Hex Value</th>
+                <th></th>
               </tr>
             </thead>
             <tbody>
@@ -91,12 +569,34 @@ const MemoryScanner = ({ pid }) => {
                   <td>{result.hexAddress}</td>
                   <td>{result.value}</td>
                   <td>{result.hexValue}</td>
+                  <td>
+                    {/* N64 results are emulated addresses, not host pointers */}
+                    {!n64 && (
+                      <button onClick={() => findPointers(result)} disabled={isScanning}>
+                        Pointers
+                      </button>
+                    )}
+                  </td>
                 </tr>
               ))}
             </tbody>
           </table>
         </div>
       )}
+
+      {pointerChains && pointerChains.chains.length > 0 && (
+        <div className="results-container">
+          <h4>Pointer chains to {pointerChains.address}:</h4>
+          <ul className="pointer-chains">
+            {pointerChains.chains.slice(0, RESULTS_SHOWN).map((chain, index) => (
+              <li key={index}>
+                {`${chain.module}+0x${chain.baseOffset.toString(16).toUpperCase()}`}
+                {chain.offsets.map((offset) => ` -> 0x${offset.toString(16).toUpperCase()}`).join('')}
+              </li>
+            ))}
+          </ul>
+        </div>
+      )}
     </div>
   );
 };
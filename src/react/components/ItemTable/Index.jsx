@@ -1,6 +1,31 @@
 import React, { useState } from 'react';
 import { useAppContext } from '../../context/AppContext';
 
+// N64 address of the item spawn slot: id, then x/y/z floats
+export const ITEM_SLOT_ADDRESS = 0x802E6B64;
+
+let itemSlotDefined = null;
+
+// Registers the slot layout with the main process once; spawns then write
+// it by name, with only the fields they set
+export const defineItemSlot = () => {
+    if (!itemSlotDefined) {
+        itemSlotDefined = window.sfAPI.defineStruct('ItemSlot', {
+            endian: 'big',
+            fields: [
+                { name: 'id', offset: 0, type: 'int32' },
+                { name: 'x', offset: 4, type: 'float32' },
+                { name: 'y', offset: 8, type: 'float32' },
+                { name: 'z', offset: 12, type: 'float32' },
+            ],
+        }).catch((error) => {
+            itemSlotDefined = null;
+            throw error;
+        });
+    }
+    return itemSlotDefined;
+};
+
 const ItemTable = () => {
     const { itemsEnabled, setItemsEnabled, pj64Pid } = useAppContext();
     const [xValue, setXValue] = useState(0);
@@ -24,31 +49,13 @@ const ItemTable = () => {
         }
         
         try {
-            const baseAddress = parseInt("0xE02E6B64", 16); // Ensure base address is parsed as hex
-            
-            // Function to create a buffer containing an float32 value
-            const createFloat32Buffer = (value) => {
-                const buffer = new ArrayBuffer(4);
-                const dataView = new DataView(buffer);
-                dataView.setFloat32(0, value, true); // true for little-endian
-                return new Uint8Array(buffer);
-            };
-
-            const createInt32Buffer = (value) => {
-                const buffer = new ArrayBuffer(4);
-                const dataView = new DataView(buffer);
-                dataView.setInt32(0, value, true); // true for little-endian
-                return new Uint8Array(buffer);
-            };
-            
-            // Write item ID to baseAddress
-            await window.sfAPI.writeMemory(pj64Pid, baseAddress, createInt32Buffer(item.id));
-            
-            // Write X coordinate to baseAddress + 4
-            await window.sfAPI.writeMemory(pj64Pid, baseAddress + 4, createFloat32Buffer(parseFloat(xValue)));
-            
-            // Write Y coordinate to baseAddress + 8
-            await window.sfAPI.writeMemory(pj64Pid, baseAddress + 8, createFloat32Buffer(4000.0));
+            // id, x and y go out as one write; z is left as it is
+            await defineItemSlot();
+            await window.sfAPI.writeStruct(pj64Pid, 'ItemSlot', ITEM_SLOT_ADDRESS, {
+                id: item.id,
+                x: parseFloat(xValue),
+                y: 4000.0,
+            }, { n64: true });
             
             console.log(`Spawned ${item.name} (ID: ${item.id}) at coordinates X:${xValue}, Y:${item.y}, Z:${item.z}`);
         } catch (error) {
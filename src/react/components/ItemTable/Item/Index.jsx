@@ -1,5 +1,6 @@
 import React, { useState } from 'react';
 import { useAppContext } from '../../../context/AppContext';
+import { ITEM_SLOT_ADDRESS, defineItemSlot } from '../Index';
 
 const Item = ({ itemProps }) => {
     const { itemsEnabled, pj64Pid } = useAppContext();
@@ -13,49 +14,21 @@ const Item = ({ itemProps }) => {
     };
 
     const spawnItem = async () => {
-        // Base item id address: 0xE02E6B64
         if (!pj64Pid) {
             console.error("Project64 is not running");
             return;
         }
         
         try {
-            const baseAddress = parseInt("0xE02E6B64", 16); // Ensure base address is parsed as hex
-            
-            // Function to create a buffer containing an int32 value
-            const createFloat32Buffer = (value) => {
-                const buffer = new ArrayBuffer(4);
-                const dataView = new DataView(buffer);
-                dataView.setFloat32(0, value, true); // true for little-endian
-                return new Uint8Array(buffer);
-            };
-
-            const createInt32Buffer = (value) => {
-                const buffer = new ArrayBuffer(4);
-                const dataView = new DataView(buffer);
-                dataView.setInt32(0, value, true); // true for little-endian
-                return new Uint8Array(buffer);
-            };
-            
-            // Write item ID to baseAddress
-            await window.sfAPI.writeMemory(pj64Pid, baseAddress, createInt32Buffer(parseInt(item.id, 16)));
-            
-            // Write X coordinate to baseAddress + 4
-            await window.sfAPI.writeMemory(pj64Pid, baseAddress + 4, createFloat32Buffer(parseFloat(item.x)));
-            
-            // Write Y coordinate to baseAddress + 8
-            await window.sfAPI.writeMemory(pj64Pid, baseAddress + 8, createFloat32Buffer(parseFloat(item.y)));
-            
-            // Write Z coordinate to baseAddress + 12
-            await window.sfAPI.writeMemory(pj64Pid, baseAddress + 12, createFloat32Buffer(parseFloat(item.z)));
+            await defineItemSlot();
+            await window.sfAPI.writeStruct(pj64Pid, 'ItemSlot', ITEM_SLOT_ADDRESS, {
+                id: parseInt(item.id, 16),
+                x: parseFloat(item.x),
+                y: parseFloat(item.y),
+                z: parseFloat(item.z),
+            }, { n64: true });
             
             console.log(`Spawned ${item.name} (ID: ${item.id}) at coordinates X:${item.x}, Y:${item.y}, Z:${item.z}`);
-            console.log(`Memory writes (hex): 
-                ID: 0x${item.id.toString(16).padStart(8, '0')} at 0x${baseAddress.toString(16).toUpperCase()}
-                X: 0x${item.x.toString(16).padStart(8, '0')} at 0x${(baseAddress + 4).toString(16).toUpperCase()}
-                Y: 0x${item.y.toString(16).padStart(8, '0')} at 0x${(baseAddress + 8).toString(16).toUpperCase()}
-                Z: 0x${item.z.toString(16).padStart(8, '0')} at 0x${(baseAddress + 12).toString(16).toUpperCase()}
-            `);
             
         } catch (error) {
             console.error("Error spawning item:", error);
@@ -5,29 +5,28 @@ const Project64 = () => {
   const { pj64Pid, setPj64Pid } = useAppContext();
 
   useEffect(() => {
-    const detectPj64Process = async () => {
-      try {
-        const processes = await window.sfAPI.listProcesses();
-        const pj64 = processes.find(p =>
-          p.name.toLowerCase().includes('project64') ||
-          p.name.toLowerCase().includes('pj64')
-        );
-
-        if (pj64) {
-          setPj64Pid(pj64.pid);
+    // Start and exit events come from the main process's watcher
+    const unsubscribe = window.sfAPI.onProcessEvents((events) => {
+      for (const event of events) {
+        if (event.type === 'start') {
+          setPj64Pid(current => current || event.pid);
         } else {
-          console.log('Project64 not detected');
+          setPj64Pid(current => (current === event.pid ? null : current));
         }
-      } catch (error) {
-        console.error('Error detecting processes:', error);
       }
-    };
-
-    const interval = setInterval(detectPj64Process, 1000);
+    });
 
-    detectPj64Process();
+    window.sfAPI.getWatchedProcesses()
+      .then((processes) => {
+        if (processes.length > 0) {
+          setPj64Pid(current => current || processes[0].pid);
+        } else {
+          console.log('Project64 not detected');
+        }
+      })
+      .catch(error => console.error('Error detecting processes:', error));
 
-    return () => clearInterval(interval);
+    return unsubscribe;
   }, []);
 
   return (
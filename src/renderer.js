@@ -1,5 +1,7 @@
 // Access the exposed API functions
-const { listProcesses, scanMemory, readMemory, readMemoryAsArray, writeMemory } = window.sfAPI;
+const {
+  getWatchedProcesses, onProcessEvents, scanMemory, getResultPage, releaseResults, readMemory, readMemoryAsArray, writeMemory
+} = window.sfAPI;
 
 // DOM elements
 const pj64StatusElement = document.getElementById('pj64-status');
@@ -16,28 +18,19 @@ const writeResultElement = document.getElementById('write-result');
 // Store the process ID for reuse
 let pj64Process = null;
 
-// Function to check for Project64 process
-function checkForProject64() {
-  listProcesses()
-    .then(processes => {
-      pj64Process = processes.find(process => process.name.match(/Project64/i));
-      
-      if (pj64Process) {
-        pj64StatusElement.textContent = `Found (PID: ${pj64Process.pid}, Name: ${pj64Process.name})`;
-        scanButton.disabled = false;
-        writeButton.disabled = false;
-      } else {
-        pj64StatusElement.textContent = 'Not detected';
-        scanButton.disabled = true;
-        writeButton.disabled = true;
-      }
-    })
-    .catch(error => {
-      console.error('Error listing processes:', error);
-      pj64StatusElement.textContent = 'Error: ' + error.message;
-      scanButton.disabled = true;
-      writeButton.disabled = true;
-    });
+// Function to show the Project64 process, or its absence
+function showProject64(process) {
+  pj64Process = process || null;
+
+  if (pj64Process) {
+    pj64StatusElement.textContent = `Found (PID: ${pj64Process.pid}, Name: ${pj64Process.name})`;
+    scanButton.disabled = false;
+    writeButton.disabled = false;
+  } else {
+    pj64StatusElement.textContent = 'Not detected';
+    scanButton.disabled = true;
+    writeButton.disabled = true;
+  }
 }
 
 // Function to convert hex or decimal string to number
@@ -209,6 +202,142 @@ function writeToMemory() {
   }
 }
 
+// Scan results stay in the main process's native session; the page shows
+// one page of them at a time
+const SCAN_PAGE_SIZE = 100;
+// { pid, handle, count, offset } of the results shown, null when none
+let scanResults = null;
+
+// Paging controls, placed under the results
+const scanPager = document.createElement('div');
+const previousPageButton = document.createElement('button');
+const nextPageButton = document.createElement('button');
+previousPageButton.textContent = 'Previous';
+nextPageButton.textContent = 'Next';
+scanPager.append(previousPageButton, nextPageButton);
+scanResultsElement.after(scanPager);
+
+function updateScanPager() {
+  const paged = scanResults && scanResults.count > SCAN_PAGE_SIZE;
+  scanPager.style.display = paged ? '' : 'none';
+  if (paged) {
+    previousPageButton.disabled = scanResults.offset === 0;
+    nextPageButton.disabled = scanResults.offset + SCAN_PAGE_SIZE >= scanResults.count;
+  }
+}
+
+// Frees the stored results of the previous scan
+function releaseScanResults() {
+  if (scanResults) {
+    releaseResults(scanResults.pid, scanResults.handle).catch(() => {});
+    scanResults = null;
+  }
+  updateScanPager();
+}
+
+// Renders one page of rows from the stored results
+function showScanPage(results) {
+  // Count valid results (without errors)
+  const validResults = results.filter(result => !result.error);
+  const { count, offset } = scanResults;
+  const shown = count > results.length ? `, showing ${offset + 1}-${offset + results.length}` : '';
+
+  // Create a table-like format for results
+  let resultsText = 
+    `Found ${count} addresses${shown} (${validResults.length} readable):\n` + 
+    'Address            | Signed Value     | Unsigned Value   | Hex Value          | Notes\n' +
+    '------------------ | ---------------- | ---------------- | ------------------ | ------------------\n';
+    
+  resultsText += results.map(result => {
+    // Create different formatting for errors vs valid values
+    if (result.error) {
+      return `${result.hexAddress.padEnd(18, ' ')} | ${result.value.toString().padEnd(16, ' ')} | ${' '.padEnd(16, ' ')} | ${' '.padEnd(18, ' ')} | ${result.error}`;
+    } else {
+      // For unsigned values, we need to handle potential BigInts
+      const unsignedStr = result.unsignedValue !== undefined ? 
+        (typeof result.unsignedValue === 'bigint' ? 
+          result.unsignedValue.toString() : 
+          result.unsignedValue.toString()
+        ) : '';
+          
+      return `${result.hexAddress.padEnd(18, ' ')} | ${
+        result.value.toString().padEnd(16, ' ')
+      } | ${
+        unsignedStr.padEnd(16, ' ')
+      } | ${
+        (result.hexValue ? result.hexValue.padEnd(18, ' ') : ' '.padEnd(18, ' '))
+      } | `;
+    }
+  }).join('\n');
+  
+  // On the first page, examine the first valid result in detail
+  if (offset === 0 && validResults.length > 0) {
+    const firstResult = validResults[0];
+    resultsText += '\n\n----- First Result Details -----\n';
+    resultsText += `Address: ${firstResult.hexAddress}\n`;
+    resultsText += `Value (signed): ${firstResult.value}\n`;
+    resultsText += `Value (unsigned): ${firstResult.unsignedValue}\n`;
+    resultsText += `Value (hex): ${firstResult.hexValue}\n`;
+    
+    // Read additional memory around this location
+    resultsText += '\nReading surrounding memory...\n';
+    
+    // Promise to read memory at the first valid address. Paging back to
+    // the first page reads the same bytes again, so it uses the page cache.
+    const address = firstResult.address;
+    const readPromise = readMemoryAsArray(scanResults.pid, address, 16, { cached: true });
+    
+    readPromise.then(result => {
+      if (result && result.valueInfo) {
+        let detailText = '\n----- Memory Details -----\n';
+        detailText += `Address: ${result.valueInfo.address}\n`;
+        detailText += `Raw bytes: ${result.valueInfo.rawBytes}\n`;
+        detailText += `As Int32: ${result.valueInfo.asInt32}\n`;
+        detailText += `As Uint32: ${result.valueInfo.asUint32} (${result.valueInfo.hexUint32})\n`;
+        
+        if (result.valueInfo.asInt64 !== undefined) {
+          detailText += `As Int64: ${result.valueInfo.asInt64}\n`;
+          detailText += `As Uint64: ${result.valueInfo.asUint64} (${result.valueInfo.hexUint64})\n`;
+        }
+        
+        if (result.valueInfo.asFloat !== undefined) {
+          detailText += `As Float: ${result.valueInfo.asFloat}\n`;
+        }
+        
+        if (result.valueInfo.asDouble !== undefined) {
+          detailText += `As Double: ${result.valueInfo.asDouble}\n`;
+        }
+        
+        scanResultsElement.textContent += detailText;
+      }
+    }).catch(error => {
+      scanResultsElement.textContent += `\nError reading memory details: ${error.message}\n`;
+    });
+  }
+  
+  scanResultsElement.textContent = resultsText;
+  updateScanPager();
+}
+
+// Fetches and shows the page of stored results starting at `offset`
+function turnScanPage(offset) {
+  if (!scanResults) return;
+  const { pid, handle } = scanResults;
+  getResultPage(pid, handle, offset, SCAN_PAGE_SIZE)
+    .then(({ rows }) => {
+      if (scanResults && scanResults.handle === handle) {
+        scanResults.offset = offset;
+        showScanPage(rows);
+      }
+    })
+    .catch(error => {
+      scanResultsElement.textContent = `Error reading scan results: ${error.message}`;
+    });
+}
+
+previousPageButton.addEventListener('click', () => turnScanPage(Math.max(0, scanResults.offset - SCAN_PAGE_SIZE)));
+nextPageButton.addEventListener('click', () => turnScanPage(scanResults.offset + SCAN_PAGE_SIZE));
+
 // Function to scan for specific value
 function scanForValue() {
   if (!pj64Process) {
@@ -219,88 +348,16 @@ function scanForValue() {
   // Disable button during scan
   scanButton.disabled = true;
   scanButton.textContent = 'Scanning...';
+  releaseScanResults();
   
   const VALUE_TO_FIND = 4277009102;
+  const pid = pj64Process.pid;
   
-  scanMemory(pj64Process.pid, VALUE_TO_FIND)
-    .then(results => {
-      if (results && results.length > 0) {
-        // Count valid results (without errors)
-        const validResults = results.filter(result => !result.error);
-        
-        // Create a table-like format for results
-        let resultsText = 
-          `Found ${results.length} addresses (${validResults.length} readable):\n` + 
-          'Address            | Signed Value     | Unsigned Value   | Hex Value          | Notes\n' +
-          '------------------ | ---------------- | ---------------- | ------------------ | ------------------\n';
-          
-        resultsText += results.map(result => {
-          // Create different formatting for errors vs valid values
-          if (result.error) {
-            return `${result.hexAddress.padEnd(18, ' ')} | ${result.value.toString().padEnd(16, ' ')} | ${' '.padEnd(16, ' ')} | ${' '.padEnd(18, ' ')} | ${result.error}`;
-          } else {
-            // For unsigned values, we need to handle potential BigInts
-            const unsignedStr = result.unsignedValue !== undefined ? 
-              (typeof result.unsignedValue === 'bigint' ? 
-                result.unsignedValue.toString() : 
-                result.unsignedValue.toString()
-              ) : '';
-                
-            return `${result.hexAddress.padEnd(18, ' ')} | ${
-              result.value.toString().padEnd(16, ' ')
-            } | ${
-              unsignedStr.padEnd(16, ' ')
-            } | ${
-              (result.hexValue ? result.hexValue.padEnd(18, ' ') : ' '.padEnd(18, ' '))
-            } | `;
-          }
-        }).join('\n');
-        
-        // If there are valid results, let's examine the first one in detail
-        if (validResults.length > 0) {
-          const firstResult = validResults[0];
-          resultsText += '\n\n----- First Result Details -----\n';
-          resultsText += `Address: ${firstResult.hexAddress}\n`;
-          resultsText += `Value (signed): ${firstResult.value}\n`;
-          resultsText += `Value (unsigned): ${firstResult.unsignedValue}\n`;
-          resultsText += `Value (hex): ${firstResult.hexValue}\n`;
-          
-          // Read additional memory around this location
-          resultsText += '\nReading surrounding memory...\n';
-          
-          // Promise to read memory at the first valid address
-          const address = firstResult.address;
-          const readPromise = readMemoryAsArray(pj64Process.pid, address, 16);
-          
-          readPromise.then(result => {
-            if (result && result.valueInfo) {
-              let detailText = '\n----- Memory Details -----\n';
-              detailText += `Address: ${result.valueInfo.address}\n`;
-              detailText += `Raw bytes: ${result.valueInfo.rawBytes}\n`;
-              detailText += `As Int32: ${result.valueInfo.asInt32}\n`;
-              detailText += `As Uint32: ${result.valueInfo.asUint32} (${result.valueInfo.hexUint32})\n`;
-              
-              if (result.valueInfo.asInt64 !== undefined) {
-                detailText += `As Int64: ${result.valueInfo.asInt64}\n`;
-                detailText += `As Uint64: ${result.valueInfo.asUint64} (${result.valueInfo.hexUint64})\n`;
-              }
-              
-              if (result.valueInfo.asFloat !== undefined) {
-                detailText += `As Float: ${result.valueInfo.asFloat}\n`;
-              }
-              
-              if (result.valueInfo.asDouble !== undefined) {
-                detailText += `As Double: ${result.valueInfo.asDouble}\n`;
-              }
-              
-              scanResultsElement.textContent += detailText;
-            }
-          }).catch(error => {
-            scanResultsElement.textContent += `\nError reading memory details: ${error.message}\n`;
-          });
-        }
-        
-        scanResultsElement.textContent = resultsText;
+  scanMemory(pid, VALUE_TO_FIND, undefined, SCAN_PAGE_SIZE)
+    .then(({ handle, count, results }) => {
+      scanResults = { pid, handle, count, offset: 0 };
+      if (count > 0) {
+        showScanPage(results);
       } else {
         scanResultsElement.textContent = 'No addresses found with this value.';
       }
@@ -328,6 +385,27 @@ addressInput.addEventListener('input', () => {
   }
 });
 
-// Check for Project64 on load and periodically
-checkForProject64();
-setInterval(checkForProject64, 5000); // Check every 5 seconds 
\ No newline at end of file
+// Find Project64 on load, then follow the main process's watcher
+onProcessEvents(events => {
+  for (const event of events) {
+    if (event.type === 'start' && !pj64Process) {
+      showProject64(event);
+    } else if (event.type === 'exit' && pj64Process && event.pid === pj64Process.pid) {
+      releaseScanResults();
+      showProject64(null);
+    }
+  }
+});
+
+getWatchedProcesses()
+  .then(processes => {
+    if (!pj64Process) {
+      showProject64(processes[0]);
+    }
+  })
+  .catch(error => {
+    console.error('Error listing processes:', error);
+    pj64StatusElement.textContent = 'Error: ' + error.message;
+    scanButton.disabled = true;
+    writeButton.disabled = true;
+  }); 
\ No newline at end of file